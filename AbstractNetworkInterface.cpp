@@ -1,11 +1,12 @@
 #include "AbstractNetworkInterface.h"
 #include "emitter.h"
 #include "pe.h"
+#include "JsonRecordDecoder.h"
 #include <QJsonObject>
 #include <QJsonArray>
 #include <QJsonDocument>
-#include <iostream>
 #include <stdexcept>
+#include "Log.h"
 
 /*!
     \class NetworkImplementation
@@ -13,16 +14,60 @@
 
     This class provides methods for sending and receiving PE and Emitter data,
     as well as individual settings and complex blobs over a TCP network connection.
+    Records are framed as JSON lines until a binary format is negotiated, see
+    negotiateWireFormat().
+
+    By default sends write to the socket on the calling thread and must not be
+    called concurrently. Callers with several producer threads call
+    startSending() first, after which every send serializes its frames on the
+    calling thread and hands them to a single writer thread through a lock-free
+    queue.
 */
 
 /*!
     \fn NetworkImplementation::NetworkImplementation()
     \brief Constructs a NetworkImplementation object.
 
-    Initializes the socket with a new boost::asio::ip::tcp::socket.
+    Initializes the socket with a new boost::asio::ip::tcp::socket on a private
+    io_context, run by the receive thread once startReceiving() is called.
 */
 NetworkImplementation::NetworkImplementation()
-    : socket(std::make_unique<boost::asio::ip::tcp::socket>(io_context)) {}
+    : ownedContext(std::make_unique<boost::asio::io_context>()),
+      io_context(*ownedContext),
+      strand(boost::asio::make_strand(io_context)),
+      socket(std::make_unique<boost::asio::ip::tcp::socket>(io_context)),
+      wireFormat(wire::WireFormat::Json),
+      receiving(false),
+      readInFlight(false),
+      sending(false),
+      writerIdle(false) {}
+
+/*!
+    \fn NetworkImplementation::NetworkImplementation(boost::asio::io_context& sharedContext)
+    \brief Constructs a NetworkImplementation whose socket runs on \a sharedContext.
+
+    Used to multiplex many connections over one pool of io threads, see
+    FeedManager. startReceiving() then only queues reads, the owner of
+    \a sharedContext is responsible for running it, and it must outlive this object.
+*/
+NetworkImplementation::NetworkImplementation(boost::asio::io_context& sharedContext)
+    : io_context(sharedContext),
+      strand(boost::asio::make_strand(io_context)),
+      socket(std::make_unique<boost::asio::ip::tcp::socket>(io_context)),
+      wireFormat(wire::WireFormat::Json),
+      receiving(false),
+      readInFlight(false),
+      sending(false),
+      writerIdle(false) {}
+
+/*!
+    \fn NetworkImplementation::~NetworkImplementation()
+    \brief Stops the writer and receive threads, if running, before the socket is destroyed.
+*/
+NetworkImplementation::~NetworkImplementation() {
+    stopSending();
+    stopReceiving();
+}
 
 /*!
     \fn void NetworkImplementation::initialise(const std::string& address, unsigned short port)
@@ -31,22 +76,76 @@ NetworkImplementation::NetworkImplementation()
     \param port The port number to connect to.
 */
 void NetworkImplementation::initialise(const std::string& address, unsigned short port) {
-    std::lock_guard<std::mutex> lock(std::mutex);
     try {
         boost::asio::ip::tcp::endpoint endpoint(boost::asio::ip::address::from_string(address), port);
         socket->connect(endpoint);
+        frameReader.reset();
     } catch (const std::exception& e) {
         logError("Failed to initialize connection: " + std::string(e.what()));
         throw;
     }
 }
 
+/*!
+    \fn bool NetworkImplementation::negotiateWireFormat(wire::WireFormat format)
+    \brief Asks the peer to switch the connection to \a format.
+    \param format The framing to use for all subsequent sends and receives.
+    \return True if the peer acknowledged the format, false otherwise.
+
+    The request and the acknowledgement are both WIRE_FORMAT control messages sent
+    in the framing currently in use. Interned string tables are reset on both sides
+    when the switch succeeds. Negotiation is refused while the writer thread runs.
+*/
+bool NetworkImplementation::negotiateWireFormat(wire::WireFormat format) {
+    if (sending) {
+        logError("Cannot negotiate wire format while the writer thread is running");
+        return false;
+    }
+    QJsonObject json;
+    json["type"] = "WIRE_FORMAT";
+    json["format"] = wire::formatName(format);
+    std::string request = QJsonDocument(json).toJson(QJsonDocument::Compact).toStdString();
+
+    try {
+        encodeText(request, batchWriter.buffer());
+        batchWriter.flush(*socket);
+        std::string reply(readFrame(wire::FrameType::Text));
+
+        QJsonObject ack = QJsonDocument::fromJson(QByteArray::fromStdString(reply)).object();
+        wire::WireFormat agreed;
+        if (ack["type"].toString() != "WIRE_FORMAT"
+            || !wire::parseFormatName(ack["format"].toString().toStdString(), agreed)
+            || agreed != format) {
+            logError("Peer declined wire format " + std::string(wire::formatName(format)));
+            return false;
+        }
+    } catch (const std::exception& e) {
+        logError("Failed to negotiate wire format: " + std::string(e.what()));
+        return false;
+    }
+
+    wireFormat = format;
+    frameReader.setFormat(format);
+    binaryEncoder.reset();
+    binaryDecoder.reset();
+    return true;
+}
+
+/*!
+    \fn wire::WireFormat NetworkImplementation::getWireFormat() const
+    \brief Returns the framing currently used on the connection.
+*/
+wire::WireFormat NetworkImplementation::getWireFormat() const {
+    return wireFormat;
+}
+
 /*!
     \fn void NetworkImplementation::close()
     \brief Closes the network connection.
 */
 void NetworkImplementation::close() {
-    std::lock_guard<std::mutex> lock(std::mutex);
+    stopSending();
+    stopReceiving();
     if (socket->is_open()) {
         boost::system::error_code ec;
         socket->close(ec);
@@ -56,6 +155,279 @@ void NetworkImplementation::close() {
     }
 }
 
+/*!
+    \fn void NetworkImplementation::startReceiving(const ReceiveHandlers& handlers)
+    \brief Starts decoding incoming messages on a dedicated thread.
+    \param handlers Callbacks for each decoded message, invoked on the receive thread.
+
+    The io_context is run on its own thread with a chain of async_read_some
+    operations, so callers never block waiting for a full message. The receive
+    buffer persists across reads, any bytes past the end of one message are kept
+    for the next. The blocking receive functions must not be used until
+    stopReceiving() has been called.
+
+    With a shared io_context no thread is started, the reads run on whichever
+    thread runs the context and the handlers are never called concurrently.
+*/
+void NetworkImplementation::startReceiving(const ReceiveHandlers& handlers) {
+    if (receiving.exchange(true)) {
+        logError("Receive thread already running");
+        return;
+    }
+    receiveHandlers = handlers;
+    readInFlight = true;
+    if (ownedContext) io_context.restart();
+    boost::asio::post(strand, [this] { readNextAsync(); });
+    if (ownedContext) receiveThread = std::thread([this] { io_context.run(); });
+}
+
+/*!
+    \fn void NetworkImplementation::stopReceiving()
+    \brief Cancels outstanding reads and joins the receive thread.
+
+    With a shared io_context this waits for the last read handler to finish
+    instead, so it must not be called from a receive handler in that mode.
+*/
+void NetworkImplementation::stopReceiving() {
+    if (receiving.exchange(false)) {
+        boost::asio::post(strand, [this] {
+            boost::system::error_code ec;
+            socket->cancel(ec);
+        });
+    }
+    if (receiveThread.joinable() && receiveThread.get_id() != std::this_thread::get_id()) {
+        receiveThread.join();
+    }
+    while (!ownedContext && readInFlight && !io_context.stopped()) {
+        std::this_thread::yield();
+    }
+}
+
+/*!
+    \fn void NetworkImplementation::startSending()
+    \brief Starts the writer thread that owns all socket writes.
+
+    Afterwards every send may be called from any thread. Frames are serialized on
+    the calling thread and pushed to a lock-free multi-producer queue, then the
+    writer drains whatever has accumulated and sends it with one gather write.
+    Send calls return once their frames are queued, so a true result no longer
+    means the bytes reached the socket; write failures are logged by the writer.
+    Frames queued by one thread are written in the order that thread queued them.
+*/
+void NetworkImplementation::startSending() {
+    if (sending.exchange(true)) {
+        logError("Writer thread already running");
+        return;
+    }
+    try {
+        batchWriter.flush(*socket); // Anything batched earlier goes out ahead of queued frames
+    } catch (const std::exception& e) {
+        logError("Failed to flush batch: " + std::string(e.what()));
+    }
+    writerThread = std::thread([this] { writeQueuedFrames(); });
+}
+
+/*!
+    \fn void NetworkImplementation::stopSending()
+    \brief Writes every frame already queued, then joins the writer thread.
+
+    Sends must not be in progress on other threads when this is called.
+*/
+void NetworkImplementation::stopSending() {
+    if (sending.exchange(false)) {
+        std::lock_guard<std::mutex> lock(writerMutex);
+        writerWake.notify_one();
+    }
+    if (writerThread.joinable() && writerThread.get_id() != std::this_thread::get_id()) {
+        writerThread.join();
+    }
+}
+
+/*!
+    \fn void NetworkImplementation::writeQueuedFrames()
+    \brief Writer thread loop, drains the send queue into the batch writer and flushes it.
+
+    In binary mode the StringDef frames for references first used by a queued
+    record are written just ahead of it. When the queue is empty the writer
+    sleeps until a producer wakes it, or for at most a millisecond in case a
+    wake up raced with the queue check.
+*/
+void NetworkImplementation::writeQueuedFrames() {
+    for (;;) {
+        while (std::optional<std::string> frames = sendQueue.pop()) {
+            if (wireFormat != wire::WireFormat::Binary) {
+                batchWriter.buffer() += *frames;
+            } else if (std::size_t dropped = binaryEncoder.appendFrames(*frames, batchWriter.buffer())) {
+                logError("Dropped " + std::to_string(dropped) + " records whose interned strings were forgotten before sending");
+            }
+        }
+        try {
+            batchWriter.flush(*socket);
+        } catch (const std::exception& e) {
+            logError("Writer thread failed to send: " + std::string(e.what()));
+        }
+
+        if (!sending) {
+            if (sendQueue.empty()) return;
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(writerMutex);
+        writerIdle = true;
+        if (sending && sendQueue.empty()) {
+            writerWake.wait_for(lock, std::chrono::milliseconds(1));
+        }
+        writerIdle = false;
+    }
+}
+
+/*!
+    \fn bool NetworkImplementation::startCapture(const std::string& path)
+    \brief Starts appending every received frame, with its arrival time, to a capture file.
+    \param path The capture file, truncated if it exists.
+    \return False if the file could not be created.
+
+    Frames are recorded as they are consumed by the receive calls or the
+    receive thread. A capture can be replayed with ReplayNetworkInterface.
+*/
+bool NetworkImplementation::startCapture(const std::string& path) {
+    if (!captureWriter.open(path)) {
+        logError("Failed to open capture file " + path);
+        return false;
+    }
+    return true;
+}
+
+/*!
+    \fn void NetworkImplementation::stopCapture()
+    \brief Stops capturing and closes the capture file.
+*/
+void NetworkImplementation::stopCapture() {
+    captureWriter.close();
+}
+
+/*!
+    \fn void NetworkImplementation::captureFrame(const FrameReader::Frame& frame)
+    \brief Records \a frame in the capture file, if capturing.
+*/
+void NetworkImplementation::captureFrame(const FrameReader::Frame& frame) {
+    if (captureWriter.isOpen()) captureWriter.append(wireFormat, frame.type, frame.payload);
+}
+
+/*!
+    \fn void NetworkImplementation::readNextAsync()
+    \brief Queues the next asynchronous read and dispatches every complete frame it completes.
+
+    Runs on the connection's strand. readInFlight is cleared only once the chain
+    ends, after which the handler no longer touches this object.
+*/
+void NetworkImplementation::readNextAsync() {
+    if (!receiving) {
+        readInFlight = false;
+        return;
+    }
+    socket->async_read_some(frameReader.prepare(), boost::asio::bind_executor(strand, [this](const boost::system::error_code& ec, std::size_t bytes) {
+        if (ec) {
+            if (receiving.exchange(false) && receiveHandlers.onError) {
+                receiveHandlers.onError("Receive failed: " + ec.message());
+            }
+            readInFlight = false;
+            return;
+        }
+
+        frameReader.commit(bytes);
+        FrameReader::Frame frame;
+        for (;;) {
+            try {
+                if (!frameReader.next(frame)) break;
+                captureFrame(frame);
+            } catch (const std::exception& e) {
+                // A bad binary header leaves the stream unframed, nothing after it can be decoded
+                receiving = false;
+                if (receiveHandlers.onError) receiveHandlers.onError(e.what());
+                readInFlight = false;
+                return;
+            }
+            try {
+                if (wireFormat == wire::WireFormat::Binary) dispatchBinaryFrame(frame.type, frame.payload);
+                else dispatchJsonFrame(frame.payload);
+            } catch (const std::exception& e) {
+                if (receiveHandlers.onError) receiveHandlers.onError(e.what());
+            }
+        }
+
+        readNextAsync();
+    }));
+}
+
+/*!
+    \fn wire::FrameType NetworkImplementation::classifyJsonFrame(std::string_view frame)
+    \brief Identifies the kind of message carried by a JSON line from its top-level keys.
+
+    Settings carry "setting", Emitters carry "freqMin" and PEs carry "lat", see
+    wire::classifyJsonMessage. Complex blobs, WIRE_FORMAT control messages and
+    anything else are reported as Text.
+*/
+wire::FrameType NetworkImplementation::classifyJsonFrame(std::string_view frame) {
+    switch (wire::classifyJsonMessage(frame)) {
+    case wire::JsonMessageKind::Setting: return wire::FrameType::Setting;
+    case wire::JsonMessageKind::Emitter: return wire::FrameType::Emitter;
+    case wire::JsonMessageKind::PE: return wire::FrameType::PE;
+    default: return wire::FrameType::Text;
+    }
+}
+
+/*!
+    \fn void NetworkImplementation::dispatchJsonFrame(std::string_view frame)
+    \brief Decodes a JSON line and passes it to the matching receive handler.
+*/
+void NetworkImplementation::dispatchJsonFrame(std::string_view frame) {
+    switch (wire::classifyJsonMessage(frame)) {
+    case wire::JsonMessageKind::Setting:
+        if (receiveHandlers.onSetting) receiveHandlers.onSetting(deserializeSetting(frame));
+        break;
+    case wire::JsonMessageKind::Emitter:
+        if (receiveHandlers.onEmitter) receiveHandlers.onEmitter(deserializeEmitter(frame));
+        break;
+    case wire::JsonMessageKind::PE:
+        if (receiveHandlers.onPE) receiveHandlers.onPE(deserializePE(frame));
+        break;
+    case wire::JsonMessageKind::ComplexBlob:
+        if (receiveHandlers.onComplexBlob) receiveHandlers.onComplexBlob(deserializeComplexBlob(frame));
+        break;
+    case wire::JsonMessageKind::WireFormat:
+        break;
+    case wire::JsonMessageKind::Other:
+        if (receiveHandlers.onBlob) receiveHandlers.onBlob(std::string(frame));
+        break;
+    }
+}
+
+/*!
+    \fn void NetworkImplementation::dispatchBinaryFrame(wire::FrameType type, std::string_view payload)
+    \brief Decodes a binary frame payload and passes it to the matching receive handler.
+*/
+void NetworkImplementation::dispatchBinaryFrame(wire::FrameType type, std::string_view payload) {
+    switch (type) {
+    case wire::FrameType::StringDef:
+        if (!binaryDecoder.applyStringDef(payload)) {
+            throw std::runtime_error("Invalid binary string definition");
+        }
+        break;
+    case wire::FrameType::PE:
+        if (receiveHandlers.onPE) receiveHandlers.onPE(binaryDecoder.decodePE(payload));
+        break;
+    case wire::FrameType::Emitter:
+        if (receiveHandlers.onEmitter) receiveHandlers.onEmitter(binaryDecoder.decodeEmitter(payload));
+        break;
+    case wire::FrameType::Setting:
+        if (receiveHandlers.onSetting) receiveHandlers.onSetting(binaryDecoder.decodeSetting(payload));
+        break;
+    case wire::FrameType::Text:
+        dispatchJsonFrame(payload);
+        break;
+    }
+}
+
 /*!
     \fn boost::asio::ip::tcp::socket* NetworkImplementation::getSocket()
     \brief Returns a pointer to the underlying socket.
@@ -66,16 +438,17 @@ boost::asio::ip::tcp::socket* NetworkImplementation::getSocket() {
 }
 
 /*!
-    \fn void NetworkImplementation::validateAndPrintDataBufferSize(std::string dataBuff, std::string funcName)
+    \fn void NetworkImplementation::validateAndPrintDataBufferSize(const std::string& dataBuff, const char* funcName)
     \brief Validates and prints the size of the data buffer.
     \param dataBuff The data buffer to validate.
     \param funcName The name of the function calling this method.
 */
-void NetworkImplementation::validateAndPrintDataBufferSize(std::string dataBuff, std::string funcName) {
-    dataBuff.data() ? std::cout << funcName << " - Received intact data buffer of length: "
-                                << dataBuff.length() << std::endl
-                    : std::cerr << "Received invalid data buffer of length: "
-                                << dataBuff.length() << std::endl;
+void NetworkImplementation::validateAndPrintDataBufferSize(const std::string& dataBuff, const char* funcName) {
+    if (dataBuff.data()) {
+        LOG_DEBUG("{} - Received intact data buffer of length: {}", funcName, dataBuff.length());
+    } else {
+        LOG_ERROR("Received invalid data buffer of length: {}", dataBuff.length());
+    }
 }
 
 /*!
@@ -100,11 +473,11 @@ bool NetworkImplementation::validateEmitter(const Emitter& emitter) {
 
 /*!
  * \fn void NetworkImplementation::logError(const std::string& message)
- * \brief Logs a given string to std::cerr in a standardised format.
+ * \brief Logs a given string as an error in a standardised format.
  * \param message The string to log.
  */
 void NetworkImplementation::logError(const std::string& message) {
-    std::cerr << "NetworkImplementation Error: " << message << std::endl;
+    LOG_ERROR("NetworkImplementation Error: {}", message);
 }
 
 /*!
@@ -116,18 +489,10 @@ void NetworkImplementation::logError(const std::string& message) {
     \return True if the setting was sent successfully, false otherwise.
 */
 bool NetworkImplementation::sendPESetting(const std::string& setting, const std::string& id, int updateVal) {
-    std::lock_guard<std::mutex> lock(std::mutex);
-    QJsonObject json;
-    json["type"] = "PE_SETTING";
-    json["id"] = QString::fromStdString(id);
-    json["setting"] = QString::fromStdString(setting);
-    json["value"] = updateVal;
-
-    QJsonDocument doc(json);
-    std::string data = doc.toJson(QJsonDocument::Compact).toStdString() + "\n";
-
     try {
-        boost::asio::write(*socket, boost::asio::buffer(data));
+        std::string staged;
+        encodeSetting(wire::SettingKind::PE, setting, id, updateVal, outboundBuffer(staged));
+        submit(staged, true);
         return true;
     } catch (const std::exception& e) {
         logError("Failed to send PE setting: " + std::string(e.what()));
@@ -144,18 +509,10 @@ bool NetworkImplementation::sendPESetting(const std::string& setting, const std:
     \return True if the setting was sent successfully, false otherwise.
 */
 bool NetworkImplementation::sendEmitterSetting(const std::string& setting, const std::string& id, int updateVal) {
-    std::lock_guard<std::mutex> lock(std::mutex);
-    QJsonObject json;
-    json["type"] = "EMITTER_SETTING";
-    json["id"] = QString::fromStdString(id);
-    json["setting"] = QString::fromStdString(setting);
-    json["value"] = updateVal;
-
-    QJsonDocument doc(json);
-    std::string data = doc.toJson(QJsonDocument::Compact).toStdString() + "\n";
-
     try {
-        boost::asio::write(*socket, boost::asio::buffer(data));
+        std::string staged;
+        encodeSetting(wire::SettingKind::Emitter, setting, id, updateVal, outboundBuffer(staged));
+        submit(staged, true);
         return true;
     } catch (const std::exception& e) {
         logError("Failed to send Emitter setting: " + std::string(e.what()));
@@ -170,7 +527,9 @@ bool NetworkImplementation::sendEmitterSetting(const std::string& setting, const
     \return True if the blob was sent successfully, false otherwise.
 */
 bool NetworkImplementation::sendBlob(const std::string& blobString) {
-    boost::asio::write(*socket, boost::asio::buffer(blobString + "\n"));
+    std::string staged;
+    encodeText(blobString, outboundBuffer(staged));
+    submit(staged, true);
     return true;
 }
 
@@ -181,14 +540,14 @@ bool NetworkImplementation::sendBlob(const std::string& blobString) {
     \return True if the PE was sent successfully, false otherwise.
 */
 bool NetworkImplementation::sendPE(const PE& pe) {
-    std::lock_guard<std::mutex> lock(std::mutex);
     if (!validatePE(pe)) {
         logError("Invalid PE data");
         return false;
     }
     try {
-        std::string data = serializePE(pe);
-        boost::asio::write(*socket, boost::asio::buffer(data));
+        std::string staged;
+        encodePE(pe, outboundBuffer(staged));
+        submit(staged, true);
         return true;
     } catch (const std::exception& e) {
         logError("Failed to send PE: " + std::string(e.what()));
@@ -203,14 +562,14 @@ bool NetworkImplementation::sendPE(const PE& pe) {
     \return True if the Emitter was sent successfully, false otherwise.
 */
 bool NetworkImplementation::sendEmitter(const Emitter& emitter) {
-    std::lock_guard<std::mutex> lock(std::mutex);
     if (!validateEmitter(emitter)) {
         logError("Invalid Emitter data");
         return false;
     }
     try {
-        std::string data = serializeEmitter(emitter);
-        boost::asio::write(*socket, boost::asio::buffer(data));
+        std::string staged;
+        encodeEmitter(emitter, outboundBuffer(staged));
+        submit(staged, true);
         return true;
     } catch (const std::exception& e) {
         logError("Failed to send Emitter: " + std::string(e.what()));
@@ -228,11 +587,123 @@ bool NetworkImplementation::sendEmitter(const Emitter& emitter) {
 */
 bool NetworkImplementation::sendComplexBlob(const PE& pe, const Emitter& emitter, const std::map<std::string, double>& doubleMap) {
     std::string data = serializeComplexBlob(pe, emitter, doubleMap);
+    data.pop_back(); // encodeText adds the framing for the negotiated format
     try {
-        boost::asio::write(*socket, boost::asio::buffer(data));
+        std::string staged;
+        encodeText(data, outboundBuffer(staged));
+        submit(staged, true);
         return true;
     } catch (const std::exception& e){
-        std::cerr << "Write to socket except while sending complex blob: " << e.what() << std::endl;
+        LOG_ERROR("Write to socket except while sending complex blob: {}", e.what());
+        return false;
+    }
+}
+
+/*!
+    \fn bool NetworkImplementation::sendPEBatch(const std::vector<PE>& pes)
+    \brief Queues a batch of PE objects, flushing once the flush threshold is reached.
+    \param pes The PE objects to send.
+    \return False if any PE was invalid and skipped, or if the flush failed.
+
+    Records are encoded into pooled buffers and written together with one gather
+    write. Single-record sends flush any batched records ahead of themselves, so
+    ordering on the wire always matches call order.
+*/
+bool NetworkImplementation::sendPEBatch(const std::vector<PE>& pes) {
+    bool valid = true;
+    try {
+        std::string staged;
+        for (const PE& pe : pes) {
+            if (!validatePE(pe)) {
+                valid = false;
+                continue;
+            }
+            encodePE(pe, outboundBuffer(staged));
+        }
+        submit(staged, false);
+    } catch (const std::exception& e) {
+        logError("Failed to send PE batch: " + std::string(e.what()));
+        return false;
+    }
+    if (!valid) logError("Invalid PE data skipped in batch");
+    return valid;
+}
+
+/*!
+    \fn bool NetworkImplementation::sendEmitterBatch(const std::vector<Emitter>& emitters)
+    \brief Queues a batch of Emitter objects, flushing once the flush threshold is reached.
+    \param emitters The Emitter objects to send.
+    \return False if any Emitter was invalid and skipped, or if the flush failed.
+*/
+bool NetworkImplementation::sendEmitterBatch(const std::vector<Emitter>& emitters) {
+    bool valid = true;
+    try {
+        std::string staged;
+        for (const Emitter& emitter : emitters) {
+            if (!validateEmitter(emitter)) {
+                valid = false;
+                continue;
+            }
+            encodeEmitter(emitter, outboundBuffer(staged));
+        }
+        submit(staged, false);
+    } catch (const std::exception& e) {
+        logError("Failed to send Emitter batch: " + std::string(e.what()));
+        return false;
+    }
+    if (!valid) logError("Invalid Emitter data skipped in batch");
+    return valid;
+}
+
+/*!
+    \fn bool NetworkImplementation::sendSettingsBatch(const std::vector<SettingUpdate>& settings)
+    \brief Queues a batch of PE and Emitter setting updates, flushing once the flush threshold is reached.
+    \param settings The setting updates to send.
+    \return True if the settings were queued or sent successfully, false otherwise.
+*/
+bool NetworkImplementation::sendSettingsBatch(const std::vector<SettingUpdate>& settings) {
+    try {
+        std::string staged;
+        for (const SettingUpdate& update : settings) {
+            encodeSetting(update.kind, update.setting, update.id, update.value, outboundBuffer(staged));
+        }
+        submit(staged, false);
+        return true;
+    } catch (const std::exception& e) {
+        logError("Failed to send settings batch: " + std::string(e.what()));
+        return false;
+    }
+}
+
+/*!
+    \fn void NetworkImplementation::setFlushThreshold(std::size_t bytes, std::chrono::microseconds delay)
+    \brief Sets when batched records are written.
+    \param bytes Flush once at least this many bytes are pending, 0 to disable.
+    \param delay Flush once the oldest pending record has waited this long, 0 to disable.
+
+    With both thresholds at 0 (the default) every batch is written as soon as it
+    is queued. The delay is checked when records are queued, callers that use it
+    should also call flush() periodically. Thresholds do not apply while the
+    writer thread runs, it writes whatever has been queued as soon as it can.
+*/
+void NetworkImplementation::setFlushThreshold(std::size_t bytes, std::chrono::microseconds delay) {
+    batchWriter.setThreshold(bytes, delay);
+}
+
+/*!
+    \fn bool NetworkImplementation::flush()
+    \brief Writes all pending batched records.
+    \return True if the write succeeded or nothing was pending, false otherwise.
+
+    Does nothing while the writer thread runs, queued frames are written without being asked.
+*/
+bool NetworkImplementation::flush() {
+    if (sending) return true;
+    try {
+        batchWriter.flush(*socket);
+        return true;
+    } catch (const std::exception& e) {
+        logError("Failed to flush batch: " + std::string(e.what()));
         return false;
     }
 }
@@ -243,27 +714,14 @@ bool NetworkImplementation::sendComplexBlob(const PE& pe, const Emitter& emitter
     \return A tuple containing the type of setting, ID, setting name, and new value.
 */
 std::tuple<std::string, std::string, std::string, int> NetworkImplementation::receiveSetting() {
-    std::lock_guard<std::mutex> lock(std::mutex);
     try {
-        boost::asio::streambuf buf;
-        boost::asio::read_until(*socket, buf, '\n');
-        std::string data{boost::asio::buffers_begin(buf.data()),
-                         boost::asio::buffers_end(buf.data())};
-        buf.consume(buf.size());
-        validateAndPrintDataBufferSize(data, "receiveSetting");
-
-        QJsonDocument doc = QJsonDocument::fromJson(QString::fromStdString(data).toUtf8());
-        if (doc.isNull()) {
-            throw std::runtime_error("Invalid JSON data for setting deserialization");
+        std::string_view frame = readFrame(wire::FrameType::Setting);
+        if (wireFormat == wire::WireFormat::Binary) {
+            return binaryDecoder.decodeSetting(frame);
         }
-        QJsonObject json = doc.object();
-
-        std::string type = json["type"].toString().toStdString();
-        std::string id = json["id"].toString().toStdString();
-        std::string setting = json["setting"].toString().toStdString();
-        int value = json["value"].toInt();
-
-        return std::make_tuple(type, id, setting, value);
+        std::string data(frame);
+        validateAndPrintDataBufferSize(data, "receiveSetting");
+        return deserializeSetting(data);
     } catch (const std::exception& e) {
         logError("Failed to receive Setting: " + std::string(e.what()));
         throw;
@@ -276,13 +734,12 @@ std::tuple<std::string, std::string, std::string, int> NetworkImplementation::re
     \return The deserialized PE object.
 */
 PE NetworkImplementation::receivePE() {
-    std::lock_guard<std::mutex> lock(std::mutex);
     try {
-        boost::asio::streambuf buf;
-        boost::asio::read_until(*socket, buf, '\n');
-        std::string data{boost::asio::buffers_begin(buf.data()),
-                         boost::asio::buffers_end(buf.data())};
-        buf.consume(buf.size());
+        std::string_view frame = readFrame(wire::FrameType::PE);
+        if (wireFormat == wire::WireFormat::Binary) {
+            return binaryDecoder.decodePE(frame);
+        }
+        std::string data(frame);
         validateAndPrintDataBufferSize(data, "receivePE");
         return deserializePE(data);
     } catch (const std::exception& e) {
@@ -291,19 +748,56 @@ PE NetworkImplementation::receivePE() {
     }
 }
 
+/*!
+    \fn std::vector<PE> NetworkImplementation::receivePEBatch()
+    \brief Receives every PE that is already buffered, reading from the socket only if none is.
+    \return The deserialized PE objects, in arrival order.
+
+    Decoding stops at the first buffered message that is not a PE, which is left
+    for the matching receive call.
+*/
+std::vector<PE> NetworkImplementation::receivePEBatch() {
+    std::vector<PE> result;
+    try {
+        FrameReader::Frame frame;
+        while (result.empty()) {
+            while (frameReader.peek(frame)) {
+                if (frame.type == wire::FrameType::StringDef) {
+                    if (!binaryDecoder.applyStringDef(frame.payload)) {
+                        throw std::runtime_error("Invalid binary string definition");
+                    }
+                } else if (frame.type == wire::FrameType::PE) {
+                    result.push_back(binaryDecoder.decodePE(frame.payload));
+                } else if (wireFormat == wire::WireFormat::Json && classifyJsonFrame(frame.payload) == wire::FrameType::PE) {
+                    result.push_back(deserializePE(frame.payload));
+                } else {
+                    if (result.empty()) throw std::runtime_error("Next buffered message is not a PE");
+                    return result;
+                }
+                captureFrame(frame);
+                frameReader.pop();
+            }
+            if (result.empty()) frameReader.readSome(*socket);
+        }
+        return result;
+    } catch (const std::exception& e) {
+        logError("Failed to receive PE batch: " + std::string(e.what()));
+        throw;
+    }
+}
+
 /*!
     \fn Emitter NetworkImplementation::receiveEmitters()
     \brief Receives a serialized JSON Emitter object.
     \return The deserialized Emitter object.
 */
 Emitter NetworkImplementation::receiveEmitter() {
-    std::lock_guard<std::mutex> lock(std::mutex);
     try {
-        boost::asio::streambuf buf;
-        boost::asio::read_until(*socket, buf, '\n');
-        std::string data{boost::asio::buffers_begin(buf.data()),
-                         boost::asio::buffers_end(buf.data())};
-        buf.consume(buf.size());
+        std::string_view frame = readFrame(wire::FrameType::Emitter);
+        if (wireFormat == wire::WireFormat::Binary) {
+            return binaryDecoder.decodeEmitter(frame);
+        }
+        std::string data(frame);
         validateAndPrintDataBufferSize(data, "receiveEmitter");
         return deserializeEmitter(data);
     } catch (const std::exception& e) {
@@ -318,19 +812,13 @@ Emitter NetworkImplementation::receiveEmitter() {
     \return A vector of strings containing the received blob data.
 */
 std::vector<std::string> NetworkImplementation::receiveBlob() {
-    std::lock_guard<std::mutex> lock(std::mutex);
     try {
-        boost::asio::streambuf buf;
-        boost::asio::read_until(*socket, buf, '\n');
-        std::string data{boost::asio::buffers_begin(buf.data()),
-                         boost::asio::buffers_end(buf.data())};
-        buf.consume(buf.size());
-        validateAndPrintDataBufferSize(data, "receiveEmitter");
         std::vector<std::string> result;
-        result.push_back(data);
+        result.emplace_back(readFrame(wire::FrameType::Text));
+        validateAndPrintDataBufferSize(result.back(), "receiveBlob");
         return result;
     } catch (const std::exception& e) {
-        logError("Failed to receive Emitter: " + std::string(e.what()));
+        logError("Failed to receive blob: " + std::string(e.what()));
         throw;
     }
 }
@@ -341,16 +829,125 @@ std::vector<std::string> NetworkImplementation::receiveBlob() {
     \return A tuple containing the received PE, Emitter, and map of doubles.
 */
 std::tuple<PE, Emitter, std::map<std::string, double>> NetworkImplementation::receiveComplexBlob() {
-    boost::asio::streambuf buf;
-    boost::asio::read_until(*socket, buf, '\n');
-    std::string data{boost::asio::buffers_begin(buf.data()),
-                     boost::asio::buffers_begin(buf.data()) + buf.size() - 1}; // Remove the trailing newline
-    buf.consume(buf.size()); // Consume the read data
-    std::cout << "RECEIVED COMPLEX BLOB:\n" << data << std::endl;
+    std::string data(readFrame(wire::FrameType::Text));
+    LOG_DEBUG("RECEIVED COMPLEX BLOB:\n{}", data);
     validateAndPrintDataBufferSize(data, "receiveComplexBlob");
     return deserializeComplexBlob(data);
 }
 
+/*!
+    \fn void NetworkImplementation::encodePE(const PE& pe, std::string& out)
+    \brief Appends a PE object to \a out in the wire format negotiated for the connection.
+*/
+void NetworkImplementation::encodePE(const PE& pe, std::string& out) {
+    if (wireFormat == wire::WireFormat::Json) out += serializePE(pe);
+    else if (sending) binaryEncoder.encodePERecord(pe, out);
+    else binaryEncoder.encodePE(pe, out);
+}
+
+/*!
+    \fn void NetworkImplementation::encodeEmitter(const Emitter& emitter, std::string& out)
+    \brief Appends an Emitter object to \a out in the wire format negotiated for the connection.
+*/
+void NetworkImplementation::encodeEmitter(const Emitter& emitter, std::string& out) {
+    if (wireFormat == wire::WireFormat::Json) out += serializeEmitter(emitter);
+    else if (sending) binaryEncoder.encodeEmitterRecord(emitter, out);
+    else binaryEncoder.encodeEmitter(emitter, out);
+}
+
+/*!
+    \fn void NetworkImplementation::encodeSetting(wire::SettingKind kind, const std::string& setting, const std::string& id, int updateVal, std::string& out)
+    \brief Appends a PE or Emitter setting update to \a out in the wire format negotiated for the connection.
+*/
+void NetworkImplementation::encodeSetting(wire::SettingKind kind, const std::string& setting, const std::string& id, int updateVal, std::string& out) {
+    if (wireFormat == wire::WireFormat::Binary) {
+        if (sending) binaryEncoder.encodeSettingRecord(kind, id, setting, updateVal, out);
+        else binaryEncoder.encodeSetting(kind, id, setting, updateVal, out);
+        return;
+    }
+    QJsonObject json;
+    json["type"] = kind == wire::SettingKind::Emitter ? "EMITTER_SETTING" : "PE_SETTING";
+    json["id"] = QString::fromStdString(id);
+    json["setting"] = QString::fromStdString(setting);
+    json["value"] = updateVal;
+    out += QJsonDocument(json).toJson(QJsonDocument::Compact).toStdString();
+    out += '\n';
+}
+
+/*!
+    \fn void NetworkImplementation::encodeText(const std::string& text, std::string& out)
+    \brief Appends an opaque text payload to \a out, as a line in JSON mode or a Text frame in binary mode.
+*/
+void NetworkImplementation::encodeText(const std::string& text, std::string& out) {
+    if (wireFormat == wire::WireFormat::Binary) {
+        binaryEncoder.encodeText(text, out);
+        return;
+    }
+    out += text;
+    out += '\n';
+}
+
+/*!
+    \fn std::string& NetworkImplementation::outboundBuffer(std::string& staged)
+    \brief Returns where the next outbound frame should be encoded.
+
+    While the writer thread runs frames are encoded into the caller's \a staged
+    string, otherwise straight into the batch writer's current chunk.
+*/
+std::string& NetworkImplementation::outboundBuffer(std::string& staged) {
+    return sending ? staged : batchWriter.buffer();
+}
+
+/*!
+    \fn void NetworkImplementation::submit(std::string& staged, bool flushNow)
+    \brief Completes a send started with outboundBuffer().
+    \param staged The frames encoded while the writer thread runs, queued for it as one item.
+    \param flushNow Write immediately instead of waiting for the flush threshold.
+*/
+void NetworkImplementation::submit(std::string& staged, bool flushNow) {
+    if (sending) {
+        if (staged.empty()) return;
+        sendQueue.push(std::move(staged));
+        if (writerIdle) {
+            std::lock_guard<std::mutex> lock(writerMutex);
+            writerWake.notify_one();
+        }
+        return;
+    }
+    if (flushNow || batchWriter.shouldFlush()) batchWriter.flush(*socket);
+}
+
+/*!
+    \fn std::string_view NetworkImplementation::readFrame(wire::FrameType expected)
+    \brief Blocks until the next complete message is buffered and returns it.
+    \param expected The binary frame type the caller can decode, ignored for JSON lines.
+    \return The message payload, valid until the next read from the socket.
+
+    StringDef frames received on the way are applied to the connection's string
+    table. Any other binary frame type than \a expected is a protocol error.
+*/
+std::string_view NetworkImplementation::readFrame(wire::FrameType expected) {
+    FrameReader::Frame frame;
+    for (;;) {
+        while (!frameReader.next(frame)) {
+            frameReader.readSome(*socket);
+        }
+        captureFrame(frame);
+        if (wireFormat == wire::WireFormat::Json) return frame.payload;
+
+        if (frame.type == wire::FrameType::StringDef) {
+            if (!binaryDecoder.applyStringDef(frame.payload)) {
+                throw std::runtime_error("Invalid binary string definition");
+            }
+            continue;
+        }
+        if (frame.type != expected) {
+            throw std::runtime_error("Unexpected binary frame type " + std::to_string(static_cast<int>(frame.type)));
+        }
+        return frame.payload;
+    }
+}
+
 /*!
     \fn std::string NetworkImplementation::serializePE(const PE& pe)
     \brief Serializes a PE object to a JSON string.
@@ -431,16 +1028,33 @@ std::string NetworkImplementation::serializeComplexBlob(const PE& pe, const Emit
 }
 
 /*!
-    \fn PE NetworkImplementation::deserializePE(const std::string& data)
+    \fn PE NetworkImplementation::deserializePE(std::string_view data)
     \brief Deserializes a JSON string to a PE object.
     \param data The JSON string to deserialize.
     \return A PE object created from the JSON data.
+
+    The schema-specific decoder in JsonRecordDecoder is tried first; QJsonDocument
+    is only used for input it doesn't handle, such as escaped strings.
 */
-PE NetworkImplementation::deserializePE(const std::string& data) {
-    QJsonDocument doc = QJsonDocument::fromJson(QString::fromStdString(data).toUtf8());
+PE NetworkImplementation::deserializePE(std::string_view data) {
+    std::optional<PE> decoded;
+    std::string_view missingField;
+    switch (wire::decodePEJson(data, decoded, missingField)) {
+    case wire::JsonDecodeResult::Ok:
+        if (validatePE(*decoded)) return std::move(*decoded);
+        logError("Invalid PE object deserialized");
+        throw std::runtime_error("Invalid PE object deserialized");
+    case wire::JsonDecodeResult::MissingField:
+        logError("JSON does not contain required field " + std::string(missingField));
+        throw std::runtime_error("JSON does not contain required field " + std::string(missingField));
+    case wire::JsonDecodeResult::Unsupported:
+        break;
+    }
+
+    QJsonDocument doc = QJsonDocument::fromJson(QByteArray(data.data(), static_cast<int>(data.size())));
     if (doc.isNull()) {
         logError("Invalid JSON data for PE deserialization");
-        throw;
+        throw std::runtime_error("Invalid JSON data for PE deserialization");
     }
     QJsonObject json = doc.object();
 
@@ -449,7 +1063,7 @@ PE NetworkImplementation::deserializePE(const std::string& data) {
     for(auto& field : requiredFields) {
         if(!json.contains(field)){
             logError("JSON does not contain required field " + field.toStdString());
-            throw;
+            throw std::runtime_error("JSON does not contain required field " + field.toStdString());
         }
     }
 
@@ -472,21 +1086,38 @@ PE NetworkImplementation::deserializePE(const std::string& data) {
     if (validatePE(pe)) return pe;
     else {
         logError("Invalid PE object deserialized");
-        throw;
+        throw std::runtime_error("Invalid PE object deserialized");
     }
 }
 
 /*!
-    \fn Emitter NetworkImplementation::deserializeEmitter(const std::string& data)
+    \fn Emitter NetworkImplementation::deserializeEmitter(std::string_view data)
     \brief Deserializes a JSON string to an Emitter object.
     \param data The JSON string to deserialize.
     \return An Emitter object created from the JSON data.
+
+    The schema-specific decoder in JsonRecordDecoder is tried first; QJsonDocument
+    is only used for input it doesn't handle, such as escaped strings.
 */
-Emitter NetworkImplementation::deserializeEmitter(const std::string& data) {
-    QJsonDocument doc = QJsonDocument::fromJson(QString::fromStdString(data).toUtf8());
+Emitter NetworkImplementation::deserializeEmitter(std::string_view data) {
+    std::optional<Emitter> decoded;
+    std::string_view missingField;
+    switch (wire::decodeEmitterJson(data, decoded, missingField)) {
+    case wire::JsonDecodeResult::Ok:
+        if (validateEmitter(*decoded)) return std::move(*decoded);
+        logError("Invalid Emitter object deserialized");
+        throw std::runtime_error("Invalid Emitter object deserialized");
+    case wire::JsonDecodeResult::MissingField:
+        logError("JSON does not contain required field " + std::string(missingField));
+        throw std::runtime_error("JSON does not contain required field " + std::string(missingField));
+    case wire::JsonDecodeResult::Unsupported:
+        break;
+    }
+
+    QJsonDocument doc = QJsonDocument::fromJson(QByteArray(data.data(), static_cast<int>(data.size())));
     if (doc.isNull()) {
         logError("Invalid JSON data for PE deserialization");
-        throw;
+        throw std::runtime_error("Invalid JSON data for PE deserialization");
     }
     QJsonObject json = doc.object();
 
@@ -495,7 +1126,7 @@ Emitter NetworkImplementation::deserializeEmitter(const std::string& data) {
     for(auto& field : requiredFields) {
         if(!json.contains(field)){
             logError("JSON does not contain required field " + field.toStdString());
-            throw;
+            throw std::runtime_error("JSON does not contain required field " + field.toStdString());
         }
     }
 
@@ -526,18 +1157,40 @@ Emitter NetworkImplementation::deserializeEmitter(const std::string& data) {
     if (validateEmitter(emitter)) return emitter;
     else {
         logError("Invalid Emitter object deserialized");
-        throw;
+        throw std::runtime_error("Invalid Emitter object deserialized");
+    }
+}
+
+/*!
+    \fn std::tuple<std::string, std::string, std::string, int> NetworkImplementation::deserializeSetting(std::string_view data)
+    \brief Deserializes a JSON string to a setting update.
+    \param data The JSON string to deserialize.
+    \return A tuple containing the type of setting, ID, setting name, and new value.
+*/
+std::tuple<std::string, std::string, std::string, int> NetworkImplementation::deserializeSetting(std::string_view data) {
+    // The JSON is already UTF-8, parse it in place
+    QJsonDocument doc = QJsonDocument::fromJson(QByteArray::fromRawData(data.data(), static_cast<int>(data.size())));
+    if (doc.isNull()) {
+        throw std::runtime_error("Invalid JSON data for setting deserialization");
     }
+    QJsonObject json = doc.object();
+
+    std::string type = json["type"].toString().toStdString();
+    std::string id = json["id"].toString().toStdString();
+    std::string setting = json["setting"].toString().toStdString();
+    int value = json["value"].toInt();
+
+    return std::make_tuple(type, id, setting, value);
 }
 
 /*!
-    \fn std::tuple<PE, Emitter, std::map<std::string, double>> NetworkImplementation::deserializeComplexBlob(const std::string& data)
+    \fn std::tuple<PE, Emitter, std::map<std::string, double>> NetworkImplementation::deserializeComplexBlob(std::string_view data)
     \brief Deserializes a JSON string to a complex blob containing a PE, an Emitter, and a map of doubles.
     \param data The JSON string to deserialize.
     \return A tuple containing a PE object, an Emitter object, and a map of string keys to double values.
 */
-std::tuple<PE, Emitter, std::map<std::string, double>> NetworkImplementation::deserializeComplexBlob(const std::string& data) {
-    QJsonDocument doc = QJsonDocument::fromJson(QString::fromStdString(data).toUtf8());
+std::tuple<PE, Emitter, std::map<std::string, double>> NetworkImplementation::deserializeComplexBlob(std::string_view data) {
+    QJsonDocument doc = QJsonDocument::fromJson(QByteArray::fromRawData(data.data(), static_cast<int>(data.size())));
     QJsonObject json = doc.object();
 
     // Deserialize PE
@@ -2,20 +2,51 @@
 
 #include <vector>
 #include <boost/asio.hpp>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
 #include <memory>
 #include <map>
+#include <mutex>
+#include <thread>
 #include <tuple>
 #include "pe.h"
 #include "emitter.h"
+#include "WireProtocol.h"
+#include "FrameReader.h"
+#include "BatchWriter.h"
+#include "MpscQueue.h"
+#include "WireCapture.h"
 
 #ifndef ABSTRACTNETWORKINTERFACE_H
 #define ABSTRACTNETWORKINTERFACE_H
 
+// Callbacks invoked on the receive thread for every decoded message, unset members are skipped
+struct ReceiveHandlers {
+    std::function<void(const PE&)> onPE;
+    std::function<void(const Emitter&)> onEmitter;
+    std::function<void(const std::tuple<std::string, std::string, std::string, int>&)> onSetting;
+    std::function<void(const std::tuple<PE, Emitter, std::map<std::string, double>>&)> onComplexBlob;
+    std::function<void(const std::string&)> onBlob;
+    std::function<void(const std::string&)> onError;
+};
+
+// A single PE or Emitter setting change, as sent by sendPESetting/sendEmitterSetting
+struct SettingUpdate {
+    wire::SettingKind kind;
+    std::string setting;
+    std::string id;
+    int value;
+};
+
 class AbstractNetworkInterface {
 public:
     virtual ~AbstractNetworkInterface() = default;
     // Initialize the network connection
     virtual void initialise(const std::string& address, unsigned short port) = 0;
+    // Ask the peer to switch framing, returns true once both sides use the new format
+    virtual bool negotiateWireFormat(wire::WireFormat format) = 0;
     // Send air entity data
     virtual bool sendPE(const PE& pe) = 0;
     // Send emitter data
@@ -28,16 +59,36 @@ public:
     virtual bool sendPESetting(const std::string& setting, const std::string& id, int updateVal) = 0;
     // Send single update setting for an Emitter
     virtual bool sendEmitterSetting(const std::string& setting, const std::string& id, int updateVal) = 0;
+    // Queue many air entities, written together once the flush threshold is reached
+    virtual bool sendPEBatch(const std::vector<PE>& pes) = 0;
+    // Queue many emitters, written together once the flush threshold is reached
+    virtual bool sendEmitterBatch(const std::vector<Emitter>& emitters) = 0;
+    // Queue many setting updates, written together once the flush threshold is reached
+    virtual bool sendSettingsBatch(const std::vector<SettingUpdate>& settings) = 0;
+    // Configure when queued batches are written, by pending bytes and/or age
+    virtual void setFlushThreshold(std::size_t bytes, std::chrono::microseconds delay) = 0;
+    // Write all queued batches now
+    virtual bool flush() = 0;
     // Receives and constructs a tuple of a given emitter or pe setting
     virtual std::tuple<std::string, std::string, std::string, int> receiveSetting() = 0;
     // Receive air entity data
     virtual PE receivePE() = 0;
+    // Receive every air entity already buffered, blocking only until at least one is available
+    virtual std::vector<PE> receivePEBatch() = 0;
     // Receive emitter data
     virtual Emitter receiveEmitter() = 0;
     // Receive entire data blob
     virtual std::vector<std::string> receiveBlob() = 0;
     // Receive complex blob (PE, Emitter, and map of doubles)
     virtual std::tuple<PE, Emitter, std::map<std::string, double>> receiveComplexBlob() = 0;
+    // Start decoding incoming messages on a background thread and pass them to the handlers
+    virtual void startReceiving(const ReceiveHandlers& handlers) = 0;
+    // Stop the background receive thread, blocking receive calls may be used again afterwards
+    virtual void stopReceiving() = 0;
+    // Hand all sends to a background writer thread so they may be called from any number of threads
+    virtual void startSending() = 0;
+    // Write everything already queued and stop the writer thread, sends block on the socket again afterwards
+    virtual void stopSending() = 0;
     // Close the connection
     virtual void close() = 0;
 };
@@ -45,9 +96,12 @@ public:
 class NetworkImplementation : public AbstractNetworkInterface {
 public:
     NetworkImplementation();
-    ~NetworkImplementation() override = default;
+    explicit NetworkImplementation(boost::asio::io_context& sharedContext);
+    ~NetworkImplementation() override;
     boost::asio::ip::tcp::socket* getSocket();
     void initialise(const std::string& address, unsigned short port) override;
+    bool negotiateWireFormat(wire::WireFormat format) override;
+    wire::WireFormat getWireFormat() const;
     bool sendPE(const PE& pe) override;
     bool sendEmitter(const Emitter& emitter) override;
     bool sendBlob(const std::string& blobString) override;
@@ -55,25 +109,72 @@ public:
     bool sendPESetting(const std::string& setting, const std::string& id, int updateVal) override;
     std::tuple<std::string, std::string, std::string, int> receiveSetting() override;
     bool sendEmitterSetting(const std::string& setting, const std::string& id, int updateVal) override;
+    bool sendPEBatch(const std::vector<PE>& pes) override;
+    bool sendEmitterBatch(const std::vector<Emitter>& emitters) override;
+    bool sendSettingsBatch(const std::vector<SettingUpdate>& settings) override;
+    void setFlushThreshold(std::size_t bytes, std::chrono::microseconds delay) override;
+    bool flush() override;
     PE receivePE() override;
+    std::vector<PE> receivePEBatch() override;
     Emitter receiveEmitter() override;
     std::vector<std::string> receiveBlob() override;
     std::tuple<PE, Emitter, std::map<std::string, double>> receiveComplexBlob() override;
-    void validateAndPrintDataBufferSize(std::string dataBuff, std::string funcName);
+    void validateAndPrintDataBufferSize(const std::string& dataBuff, const char* funcName);
+    void startReceiving(const ReceiveHandlers& handlers) override;
+    void stopReceiving() override;
+    void startSending() override;
+    void stopSending() override;
     void close() override;
+    // Record every received frame to `path` for later replay with ReplayNetworkInterface
+    bool startCapture(const std::string& path);
+    void stopCapture();
+
+    // Stateless JSON record codec, also used by the other transports
+    static std::string serializePE(const PE& pe);
+    static std::string serializeEmitter(const Emitter& emitter);
+    static std::string serializeComplexBlob(const PE& pe, const Emitter& emitter, const std::map<std::string, double>& doubleMap);
+    static PE deserializePE(std::string_view data);
+    static Emitter deserializeEmitter(std::string_view data);
+    static std::tuple<std::string, std::string, std::string, int> deserializeSetting(std::string_view data);
+    static std::tuple<PE, Emitter, std::map<std::string, double>> deserializeComplexBlob(std::string_view data);
+    static wire::FrameType classifyJsonFrame(std::string_view frame);
+    static bool validatePE(const PE& pe);
+    static bool validateEmitter(const Emitter& emitter);
 
 private:
-    std::string serializePE(const PE& pe);
-    std::string serializeEmitter(const Emitter& emitter);
-    std::string serializeComplexBlob(const PE& pe, const Emitter& emitter, const std::map<std::string, double>& doubleMap);
-    PE deserializePE(const std::string& data);
-    Emitter deserializeEmitter(const std::string& data);
-    std::tuple<PE, Emitter, std::map<std::string, double>> deserializeComplexBlob(const std::string& data);
-    boost::asio::io_context io_context;
+    void encodePE(const PE& pe, std::string& out);
+    void encodeEmitter(const Emitter& emitter, std::string& out);
+    void encodeSetting(wire::SettingKind kind, const std::string& setting, const std::string& id, int updateVal, std::string& out);
+    void encodeText(const std::string& text, std::string& out);
+    std::string& outboundBuffer(std::string& staged);
+    void submit(std::string& staged, bool flushNow);
+    void writeQueuedFrames();
+    std::string_view readFrame(wire::FrameType expected);
+    void readNextAsync();
+    void captureFrame(const FrameReader::Frame& frame);
+    void dispatchJsonFrame(std::string_view frame);
+    void dispatchBinaryFrame(wire::FrameType type, std::string_view payload);
+    std::unique_ptr<boost::asio::io_context> ownedContext;
+    boost::asio::io_context& io_context;
+    boost::asio::strand<boost::asio::io_context::executor_type> strand;
     std::unique_ptr<boost::asio::ip::tcp::socket> socket;
-    bool validatePE(const PE& pe);
-    bool validateEmitter(const Emitter& emitter);
-    void logError(const std::string& message);
+    wire::WireFormat wireFormat;
+    wire::BinaryEncoder binaryEncoder;
+    wire::BinaryDecoder binaryDecoder;
+    ReceiveHandlers receiveHandlers;
+    FrameReader frameReader;
+    BatchWriter batchWriter;
+    std::thread receiveThread;
+    std::atomic<bool> receiving;
+    std::atomic<bool> readInFlight;
+    MpscQueue<std::string> sendQueue;
+    std::thread writerThread;
+    std::atomic<bool> sending;
+    std::atomic<bool> writerIdle;
+    std::mutex writerMutex;
+    std::condition_variable writerWake;
+    wire::CaptureWriter captureWriter;
+    static void logError(const std::string& message);
 };
 
 #endif // ABSTRACTNETWORKINTERFACE_H
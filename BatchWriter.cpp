@@ -0,0 +1,67 @@
+#include "BatchWriter.h"
+
+/*!
+    \class BatchWriter
+    \brief Pooled outbound buffers flushed with a single scatter-gather write.
+
+    Records are encoded straight into chunk buffers that are recycled after every
+    flush, so steady state sends do not allocate. All pending chunks go to the
+    socket as one buffer sequence, which boost::asio turns into writev/sendmsg
+    calls instead of one write per record.
+*/
+
+BatchWriter::BatchWriter(std::size_t chunkSize)
+    : m_chunkSize(chunkSize), m_thresholdBytes(0), m_thresholdDelay(0) {}
+
+std::string& BatchWriter::buffer() {
+    if (m_pending.empty()) {
+        m_firstPending = std::chrono::steady_clock::now();
+    }
+    if (m_pending.empty() || m_pending.back().size() >= m_chunkSize) {
+        if (m_pool.empty()) {
+            m_pending.emplace_back();
+            m_pending.back().reserve(m_chunkSize);
+        } else {
+            m_pending.push_back(std::move(m_pool.back()));
+            m_pool.pop_back();
+        }
+    }
+    return m_pending.back();
+}
+
+void BatchWriter::setThreshold(std::size_t bytes, std::chrono::microseconds delay) {
+    m_thresholdBytes = bytes;
+    m_thresholdDelay = delay;
+}
+
+std::chrono::microseconds BatchWriter::delay() const {
+    return m_thresholdDelay;
+}
+
+bool BatchWriter::shouldFlush() const {
+    if (m_pending.empty()) return false;
+    if (m_thresholdBytes == 0 && m_thresholdDelay.count() == 0) return true;
+    if (m_thresholdBytes > 0 && pendingBytes() >= m_thresholdBytes) return true;
+    return m_thresholdDelay.count() > 0
+        && std::chrono::steady_clock::now() - m_firstPending >= m_thresholdDelay;
+}
+
+std::size_t BatchWriter::pendingBytes() const {
+    std::size_t bytes = 0;
+    for (const std::string& chunk : m_pending) {
+        bytes += chunk.size();
+    }
+    return bytes;
+}
+
+bool BatchWriter::empty() const {
+    return pendingBytes() == 0;
+}
+
+void BatchWriter::recycle() {
+    for (std::string& chunk : m_pending) {
+        chunk.clear();
+        m_pool.push_back(std::move(chunk));
+    }
+    m_pending.clear();
+}
@@ -0,0 +1,60 @@
+#ifndef BATCHWRITER_H
+#define BATCHWRITER_H
+
+#include <boost/asio/buffer.hpp>
+#include <boost/asio/write.hpp>
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Accumulates encoded records in pooled buffers and writes them with one gather write
+class BatchWriter {
+public:
+    explicit BatchWriter(std::size_t chunkSize = 64 * 1024);
+
+    // Buffer to append the next record to, a fresh pooled chunk once the current one is full
+    std::string& buffer();
+
+    // Flush once this many bytes are pending, or once the oldest pending record is this old.
+    // Zero for both flushes at the end of every batch.
+    void setThreshold(std::size_t bytes, std::chrono::microseconds delay);
+    std::chrono::microseconds delay() const;
+    bool shouldFlush() const;
+
+    std::size_t pendingBytes() const;
+    bool empty() const;
+
+    // Writes every pending chunk in a single buffer sequence and returns the chunks to the pool.
+    // Pending data is discarded if the write fails, the exception is rethrown.
+    template <typename SyncWriteStream>
+    std::size_t flush(SyncWriteStream& stream) {
+        if (m_pending.empty()) return 0;
+        m_gather.clear();
+        for (const std::string& chunk : m_pending) {
+            if (!chunk.empty()) m_gather.push_back(boost::asio::buffer(chunk));
+        }
+        std::size_t written = 0;
+        try {
+            written = boost::asio::write(stream, m_gather);
+        } catch (...) {
+            recycle();
+            throw;
+        }
+        recycle();
+        return written;
+    }
+
+private:
+    void recycle();
+
+    std::size_t m_chunkSize;
+    std::vector<std::string> m_pending;
+    std::vector<std::string> m_pool;
+    std::vector<boost::asio::const_buffer> m_gather;
+    std::size_t m_thresholdBytes;
+    std::chrono::microseconds m_thresholdDelay;
+    std::chrono::steady_clock::time_point m_firstPending;
+};
+
+#endif // BATCHWRITER_H
@@ -0,0 +1,160 @@
+#include "ClusterIndex.h"
+#include <cmath>
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+// Web Mercator's latitude limit, atan(sinh(pi)), which makes the projected world square
+constexpr double kMaxMercatorLatitude = 1.4844222297453324;
+
+// 4 cells across at zoom 0, doubling with every zoom
+constexpr int kZoomZeroShift = 2;
+
+}
+
+int ClusterIndex::clampZoom(int zoom)
+{
+    return zoom < 0 ? 0 : (zoom > kMaxZoom ? kMaxZoom : zoom);
+}
+
+std::uint32_t ClusterIndex::cellsAcross(int zoom)
+{
+    return std::uint32_t(1) << (kZoomZeroShift + zoom);
+}
+
+double ClusterIndex::mercatorX(double longitude)
+{
+    return (longitude + kPi) / (2 * kPi);
+}
+
+double ClusterIndex::mercatorY(double latitude)
+{
+    latitude = latitude < -kMaxMercatorLatitude ? -kMaxMercatorLatitude : (latitude > kMaxMercatorLatitude ? kMaxMercatorLatitude : latitude);
+    return 0.5 - std::asinh(std::tan(latitude)) / (2 * kPi);
+}
+
+double ClusterIndex::latitudeAt(double y)
+{
+    return std::atan(std::sinh(kPi * (1 - 2 * y)));
+}
+
+ClusterIndex::CellKey ClusterIndex::key(std::uint32_t column, std::uint32_t row)
+{
+    return (static_cast<CellKey>(column) << 32) | row;
+}
+
+std::uint32_t ClusterIndex::column(CellKey key)
+{
+    return static_cast<std::uint32_t>(key >> 32);
+}
+
+std::uint32_t ClusterIndex::row(CellKey key)
+{
+    return static_cast<std::uint32_t>(key);
+}
+
+/*!
+    \fn void ClusterIndex::update(Slot slot, double latitude, double longitude)
+    \brief Puts \a slot in the leaf cell for the coordinate and every cluster above it.
+
+    Moving within a leaf cell costs a comparison. Moving to another leaf updates
+    each zoom's cluster sums, and only zooms where the cell itself changed add
+    and remove clusters.
+*/
+void ClusterIndex::update(Slot slot, double latitude, double longitude)
+{
+    if (slot >= m_leafOf.size()) {
+        m_leafOf.resize(slot + 1, kUnclustered);
+    }
+    if (!std::isfinite(latitude) || !std::isfinite(longitude)) {
+        remove(slot);
+        return;
+    }
+
+    const std::uint32_t across = cellsAcross(kMaxZoom);
+    auto cellAt = [across](double fraction) {
+        double cell = std::floor(fraction * across);
+        return static_cast<std::uint32_t>(cell < 0 ? 0 : (cell >= across ? across - 1 : cell));
+    };
+    std::uint32_t x = cellAt(mercatorX(longitude));
+    std::uint32_t y = cellAt(mercatorY(latitude));
+    CellKey leaf = key(x, y);
+    CellKey previous = m_leafOf[slot];
+    if (previous == leaf) return;
+    m_leafOf[slot] = leaf;
+
+    std::uint32_t previousX = column(previous);
+    std::uint32_t previousY = row(previous);
+    for (int zoom = kMaxZoom; zoom >= 0; --zoom) {
+        int shift = kMaxZoom - zoom;
+        auto& level = m_levels[zoom];
+        CellKey cell = key(x >> shift, y >> shift);
+        if (previous != kUnclustered) {
+            CellKey previousCell = key(previousX >> shift, previousY >> shift);
+            if (previousCell == cell) {
+                // Same cluster at this zoom, only the centroid moves
+                Cluster& cluster = level[cell];
+                cluster.sumX += x;
+                cluster.sumX -= previousX;
+                cluster.sumY += y;
+                cluster.sumY -= previousY;
+                continue;
+            }
+            auto found = level.find(previousCell);
+            if (--found->second.count == 0) {
+                level.erase(found);
+            } else {
+                found->second.sumX -= previousX;
+                found->second.sumY -= previousY;
+                found->second.sumSlot -= slot;
+            }
+        }
+        Cluster& cluster = level[cell];
+        ++cluster.count;
+        cluster.sumX += x;
+        cluster.sumY += y;
+        cluster.sumSlot += slot;
+    }
+}
+
+void ClusterIndex::remove(Slot slot)
+{
+    if (slot >= m_leafOf.size() || m_leafOf[slot] == kUnclustered) return;
+
+    std::uint32_t x = column(m_leafOf[slot]);
+    std::uint32_t y = row(m_leafOf[slot]);
+    for (int zoom = kMaxZoom; zoom >= 0; --zoom) {
+        int shift = kMaxZoom - zoom;
+        auto& level = m_levels[zoom];
+        auto found = level.find(key(x >> shift, y >> shift));
+        if (--found->second.count == 0) {
+            level.erase(found);
+        } else {
+            found->second.sumX -= x;
+            found->second.sumY -= y;
+            found->second.sumSlot -= slot;
+        }
+    }
+    m_leafOf[slot] = kUnclustered;
+}
+
+void ClusterIndex::clear()
+{
+    for (auto& level : m_levels) {
+        level.clear();
+    }
+    m_leafOf.clear();
+}
+
+ClusterIndex::Cell ClusterIndex::describe(CellKey key, const Cluster &cluster)
+{
+    const double leafAcross = cellsAcross(kMaxZoom);
+    Cell cell;
+    cell.key = key;
+    cell.count = cluster.count;
+    cell.member = cluster.count == 1 ? static_cast<Slot>(cluster.sumSlot) : kNoMember;
+    // Centre of the mean leaf cell
+    cell.latitude = latitudeAt((double(cluster.sumY) / cluster.count + 0.5) / leafAcross);
+    cell.longitude = (double(cluster.sumX) / cluster.count + 0.5) / leafAcross * 2 * kPi - kPi;
+    return cell;
+}
@@ -0,0 +1,117 @@
+#ifndef CLUSTERINDEX_H
+#define CLUSTERINDEX_H
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Hierarchical grid clusters over Web Mercator, one level per map zoom. At each zoom the world
+// is divided into cells of kCellPixels screen pixels, and every cell at one zoom splits into four
+// at the next, so one leaf cell per slot at kMaxZoom determines its cluster at every level.
+// Clusters keep a count and sums of their members' leaf cells and slots, and only change when a
+// slot crosses a leaf cell boundary, so moving entities cost a comparison until they do.
+class ClusterIndex
+{
+public:
+    using Slot = std::uint32_t;
+    using CellKey = std::uint64_t;
+
+    // Zooms beyond this are served the kMaxZoom clusters, which are about 150 m across at the equator
+    static constexpr int kMaxZoom = 16;
+    // Side of a cluster cell on screen, a 256 pixel tile holds 4 x 4 cells
+    static constexpr int kCellPixels = 64;
+
+    static constexpr Slot kNoMember = ~Slot(0);
+
+    // One occupied cell at some zoom
+    struct Cell {
+        CellKey key;
+        std::uint32_t count;
+        // The only entity in a cell of one, kNoMember otherwise
+        Slot member;
+        // Mean position of the members, accurate to a leaf cell
+        double latitude;
+        double longitude;
+    };
+
+    // Adds or moves `slot`, in radians. Non-finite coordinates are left unclustered.
+    void update(Slot slot, double latitude, double longitude);
+    void remove(Slot slot);
+    void clear();
+
+    // Calls `visit(const Cell&)` for every occupied cell at `zoom` overlapping the box, in radians.
+    // The box must not cross the antimeridian, callers split such boxes in two.
+    template <typename Visit>
+    void visitCells(int zoom, double minLatitude, double minLongitude, double maxLatitude, double maxLongitude, Visit visit) const;
+
+private:
+    struct Cluster {
+        std::uint32_t count = 0;
+        // Sums of the members' leaf columns and rows, and of their slots, which is the slot of a cluster of one
+        std::uint64_t sumX = 0;
+        std::uint64_t sumY = 0;
+        std::uint64_t sumSlot = 0;
+    };
+
+    static constexpr CellKey kUnclustered = ~CellKey(0);
+
+    static int clampZoom(int zoom);
+    static std::uint32_t cellsAcross(int zoom);
+    // Fractions of the Mercator square, 0 at the west and north edges. Latitudes beyond the square
+    // are clamped, so polar entities cluster into the edge rows.
+    static double mercatorX(double longitude);
+    static double mercatorY(double latitude);
+    static double latitudeAt(double y);
+    static CellKey key(std::uint32_t column, std::uint32_t row);
+    static std::uint32_t column(CellKey key);
+    static std::uint32_t row(CellKey key);
+    static Cell describe(CellKey key, const Cluster &cluster);
+
+    // One map per zoom from 0 to kMaxZoom, only occupied cells are stored
+    std::vector<std::unordered_map<CellKey, Cluster>> m_levels = std::vector<std::unordered_map<CellKey, Cluster>>(kMaxZoom + 1);
+    // Per slot: its leaf cell at kMaxZoom
+    std::vector<CellKey> m_leafOf;
+};
+
+template <typename Visit>
+void ClusterIndex::visitCells(int zoom, double minLatitude, double minLongitude, double maxLatitude, double maxLongitude, Visit visit) const
+{
+    zoom = clampZoom(zoom);
+    const auto& level = m_levels[zoom];
+    if (!(minLatitude <= maxLatitude) || !(minLongitude <= maxLongitude) || level.empty()) {
+        return;
+    }
+    std::uint32_t across = cellsAcross(zoom);
+    auto cellAt = [across](double fraction) {
+        double cell = fraction * across;
+        return static_cast<std::uint32_t>(cell < 0 ? 0 : (cell >= across ? across - 1 : cell));
+    };
+    std::uint32_t firstColumn = cellAt(mercatorX(minLongitude));
+    std::uint32_t lastColumn = cellAt(mercatorX(maxLongitude));
+    std::uint32_t firstRow = cellAt(mercatorY(maxLatitude));
+    std::uint32_t lastRow = cellAt(mercatorY(minLatitude));
+
+    // A box covering more cells than are occupied is cheaper to answer by walking the occupied cells
+    std::uint64_t boxCells = static_cast<std::uint64_t>(lastRow - firstRow + 1) * (lastColumn - firstColumn + 1);
+    if (boxCells > level.size()) {
+        for (const auto& cell : level) {
+            std::uint32_t x = column(cell.first);
+            std::uint32_t y = row(cell.first);
+            if (x >= firstColumn && x <= lastColumn && y >= firstRow && y <= lastRow) {
+                visit(describe(cell.first, cell.second));
+            }
+        }
+        return;
+    }
+
+    for (std::uint32_t y = firstRow; y <= lastRow; ++y) {
+        for (std::uint32_t x = firstColumn; x <= lastColumn; ++x) {
+            auto found = level.find(key(x, y));
+            if (found != level.end()) {
+                visit(describe(found->first, found->second));
+            }
+        }
+    }
+}
+
+#endif // CLUSTERINDEX_H
@@ -1,130 +1,177 @@
 #include "Entity.h"
-#include <QDebug>
 #include <cmath>
+#include "EntityManager.h"
+#include "Log.h"
 
-Entity::Entity(QObject *parent)
-    : QObject(parent), m_name("Unknown"), m_symbol(EntitySymbol::UNKNOWN),
-      m_UID("UKN"), m_speed(0.0), m_radius(0.0), m_altitude(0.0),
-      m_latitudeRadians(0.0), m_longitudeRadians(0.0)
+Entity::Entity(EntityManager *manager, EntityStore::Slot slot, std::uint32_t generation)
+    : QObject(manager), m_manager(manager), m_slot(slot), m_generation(generation)
 {
 }
 
+EntityStore::Slot Entity::slot() const
+{
+    return m_slot;
+}
+
+std::uint32_t Entity::generation() const
+{
+    return m_generation;
+}
+
+template <typename T, typename Read>
+T Entity::current(Read read, T fallback) const
+{
+    EntitySnapshotHandle snapshot = m_manager->snapshot();
+    const EntityStore &store = snapshot->store;
+    if (!store.contains(m_slot) || store.generation(m_slot) != m_generation) {
+        return fallback;
+    }
+    return read(store, m_slot);
+}
+
+void Entity::update(std::function<void(EntityStore &, EntityStore::Slot)> write)
+{
+    m_manager->updateEntity(m_slot, m_generation, std::move(write));
+}
+
+/*!
+    \fn void Entity::notifyChanged(std::uint16_t fields)
+    \brief Emits the NOTIFY signal of every property in \a fields, a mask of EntityStore::Field bits.
+
+    Setters only write the store, EntityManager calls this when it flushes the
+    store's dirty masks, so a property set several times between flushes notifies once.
+*/
+void Entity::notifyChanged(std::uint16_t fields)
+{
+    if (fields & EntityStore::NameField) emit nameChanged();
+    if (fields & EntityStore::SymbolField) emit symbolChanged();
+    if (fields & EntityStore::UIDField) emit UIDChanged();
+    if (fields & EntityStore::SpeedField) emit speedChanged();
+    if (fields & EntityStore::RadiusField) emit radiusChanged();
+    if (fields & EntityStore::AltitudeField) emit altitudeChanged();
+    if (fields & EntityStore::HeadingField) emit headingChanged();
+    if (fields & EntityStore::LatitudeField) emit latitudeRadiansChanged();
+    if (fields & EntityStore::LongitudeField) emit longitudeRadiansChanged();
+}
+
 QString Entity::name() const
 {
-    return m_name;
+    return current<QString>([](const EntityStore &store, EntityStore::Slot slot) { return store.name(slot); }, QString());
 }
 
 void Entity::setName(const QString &name)
 {
-    if (m_name != name) {
-        m_name = name;
-        emit nameChanged();
-    }
+    update([name](EntityStore &store, EntityStore::Slot slot) { store.setName(slot, name); });
 }
 EntitySymbol Entity::symbol() const
 {
-    return m_symbol;
+    return current<EntitySymbol>([](const EntityStore &store, EntityStore::Slot slot) { return store.symbol(slot); }, EntitySymbol());
 }
 
 void Entity::setSymbol(const EntitySymbol &symbol)
 {
-    if (m_symbol != symbol) {
-        m_symbol = symbol;
-        emit symbolChanged();
-    }
+    update([symbol](EntityStore &store, EntityStore::Slot slot) { store.setSymbol(slot, symbol); });
 }
 
 QString Entity::UID() const
 {
-    return m_UID;
+    return current<QString>([](const EntityStore &store, EntityStore::Slot slot) { return store.UID(slot); }, QString());
 }
 
 void Entity::setUID(const QString &UID)
 {
-    if (m_UID != UID) {
-        m_UID = UID;
-        qDebug() << "CPP: Entity UID changed to " << UID;
-        emit UIDChanged();
-    }
+    update([UID](EntityStore &store, EntityStore::Slot slot) {
+        if (store.UID(slot) == UID) {
+            return;
+        }
+        if (!store.setUID(slot, UID)) {
+            LOG_WARNING("CPP: Entity {} can't be renamed to {} which is already in use", store.UID(slot), UID);
+            return;
+        }
+        LOG_DEBUG("CPP: Entity UID changed to {}", UID);
+    });
 }
 
 double Entity::speed() const
 {
-    return m_radius;
+    return current<double>([](const EntityStore &store, EntityStore::Slot slot) { return store.speed(slot); }, 0.0);
 }
 
 void Entity::setSpeed(double speed)
 {
-    if (m_speed != speed) {
-        m_speed = speed;
-        emit speedChanged();
-    }
+    update([speed](EntityStore &store, EntityStore::Slot slot) { store.setSpeed(slot, speed); });
 }
 
 double Entity::altitude() const
 {
-    return m_altitude;
+    return current<double>([](const EntityStore &store, EntityStore::Slot slot) { return store.altitude(slot); }, 0.0);
 }
 
 void Entity::setAltitude(double altitude)
 {
-    if (m_altitude != altitude) {
-        m_altitude = altitude;
-        emit altitudeChanged();
-    }
+    update([altitude](EntityStore &store, EntityStore::Slot slot) { store.setAltitude(slot, altitude); });
+}
+
+double Entity::heading() const
+{
+    return current<double>([](const EntityStore &store, EntityStore::Slot slot) { return store.heading(slot); }, 0.0);
+}
+
+void Entity::setHeading(double heading)
+{
+    update([heading](EntityStore &store, EntityStore::Slot slot) { store.setHeading(slot, heading); });
 }
 
 double Entity::radius() const
 {
-    return m_radius;
+    return current<double>([](const EntityStore &store, EntityStore::Slot slot) { return store.radius(slot); }, 0.0);
 }
 
 void Entity::setRadius(double radius)
 {
-    if (m_radius != radius) {
-        m_radius = radius;
-        emit radiusChanged();
-    }
+    update([radius](EntityStore &store, EntityStore::Slot slot) { store.setRadius(slot, radius); });
 }
 
 double Entity::latitudeRadians() const
 {
-    return m_latitudeRadians;
+    return current<double>([](const EntityStore &store, EntityStore::Slot slot) { return store.latitudeRadians(slot); }, 0.0);
 }
 
 void Entity::setLatitudeRadians(double latitudeRadians)
 {
-    if (m_latitudeRadians != latitudeRadians) {
-        m_latitudeRadians = latitudeRadians;
-        qDebug() << "Entity lat changed to " << latitudeRadians;
-        emit latitudeRadiansChanged();
-    }
+    update([latitudeRadians](EntityStore &store, EntityStore::Slot slot) {
+        if (store.latitudeRadians(slot) != latitudeRadians) {
+            store.setLatitudeRadians(slot, latitudeRadians);
+            LOG_TRACE("Entity lat changed to {}", latitudeRadians);
+        }
+    });
 }
 
 double Entity::returnLatAsDeg() const
 {
-    return (m_latitudeRadians * 180) / M_PI;
+    return (latitudeRadians() * 180) / M_PI;
 }
 
 double Entity::longitudeRadians() const
 {
-    return m_longitudeRadians;
+    return current<double>([](const EntityStore &store, EntityStore::Slot slot) { return store.longitudeRadians(slot); }, 0.0);
 }
 
 void Entity::setLongitudeRadians(double longitudeRadians)
 {
-    if (m_longitudeRadians != longitudeRadians) {
-        m_longitudeRadians = longitudeRadians;
-        qDebug() << "Entity long changed to " << longitudeRadians;
-        emit longitudeRadiansChanged();
-    }
+    update([longitudeRadians](EntityStore &store, EntityStore::Slot slot) {
+        if (store.longitudeRadians(slot) != longitudeRadians) {
+            store.setLongitudeRadians(slot, longitudeRadians);
+            LOG_TRACE("Entity long changed to {}", longitudeRadians);
+        }
+    });
 }
 
 double Entity::returnLongAsDeg() const
 {
-    return (m_longitudeRadians * 180) / M_PI;
+    return (longitudeRadians() * 180) / M_PI;
 }
 
 void Entity::logMessage(const QString &message) {
-    qDebug() << "CPP: Entity logged message: " << message;
+    LOG_INFO("CPP: Entity logged message: {}", message);
 }
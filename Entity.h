@@ -3,14 +3,15 @@
 
 #include <QObject>
 #include <QString>
+#include <functional>
+#include "EntityStore.h"
 
-enum EntitySymbol
-{
-    BLUE,
-    RED,
-    UNKNOWN
-};
+class EntityManager;
 
+// A QObject view over one entity of EntityManager's store, created on demand for QML and the web
+// channel. Reads come from the latest snapshot and writes are queued to the manager's writer thread,
+// the view holds no entity data of its own. NOTIFY signals are emitted when EntityManager flushes
+// changes, not from the setters. Once its entity is removed a view reads defaults and ignores writes.
 class Entity : public QObject
 {
     Q_OBJECT
@@ -25,13 +26,18 @@ class Entity : public QObject
     Q_PROPERTY(double radius READ radius WRITE setRadius NOTIFY radiusChanged)
     Q_PROPERTY(double altitude READ altitude WRITE setAltitude
                NOTIFY altitudeChanged)
+    Q_PROPERTY(double heading READ heading WRITE setHeading NOTIFY headingChanged)
     Q_PROPERTY(double latitudeRadians READ latitudeRadians WRITE setLatitudeRadians
                NOTIFY latitudeRadiansChanged)
     Q_PROPERTY(double longitudeRadians READ longitudeRadians WRITE setLongitudeRadians
                NOTIFY longitudeRadiansChanged)
 
 public:
-    explicit Entity(QObject *parent = nullptr);
+    Entity(EntityManager *manager, EntityStore::Slot slot, std::uint32_t generation);
+
+    EntityStore::Slot slot() const;
+    std::uint32_t generation() const;
+    void notifyChanged(std::uint16_t fields);
 
 public slots:
     // Properties
@@ -54,6 +60,10 @@ public slots:
     double altitude() const;
     void setAltitude(double altitude);
 
+    // Radians clockwise from true north
+    double heading() const;
+    void setHeading(double heading);
+
     double latitudeRadians() const;
     void setLatitudeRadians(double latitudeRadians);
     double returnLatAsDeg() const;
@@ -71,18 +81,19 @@ signals:
     void speedChanged();
     void radiusChanged();
     void altitudeChanged();
+    void headingChanged();
     void latitudeRadiansChanged();
     void longitudeRadiansChanged();
 
 private:
-    QString m_name;
-    EntitySymbol m_symbol;
-    QString m_UID;
-    double m_speed;
-    double m_radius;
-    double m_altitude;
-    double m_latitudeRadians;
-    double m_longitudeRadians;
+    // Reads `read` from the latest snapshot, or returns `fallback` if the entity is gone
+    template <typename T, typename Read>
+    T current(Read read, T fallback) const;
+    void update(std::function<void(EntityStore &, EntityStore::Slot)> write);
+
+    EntityManager *m_manager;
+    EntityStore::Slot m_slot;
+    std::uint32_t m_generation;
 };
 
 #endif // ENTITY_H
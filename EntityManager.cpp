@@ -1,70 +1,1097 @@
 #include "EntityManager.h"
+#include <QMetaMethod>
 #include <QVariantMap>
-#include <QDebug>
+#include <QtEndian>
+#include <QtMath>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include "Geodesy.h"
+#include "Log.h"
+
+namespace {
+
+// Every publish copies the changes since the buffer's last one, so a writer busy with a stream
+// of small commands publishes at most this often. Flushes always publish first.
+constexpr std::chrono::milliseconds kPublishInterval(4);
+
+// A track is extrapolated no further than this past its last fix
+constexpr double kMaxPredictionSeconds = 30.0;
+
+// The viewport is widened by this fraction of its size on every side, so entities just off
+// screen are already known when the user pans to them and entities on the edge don't flap
+constexpr double kViewportPadding = 0.25;
+
+// m_subscriptionOf for a slot readers weren't told about
+constexpr std::uint32_t kNotSubscribed = ~std::uint32_t(0);
+
+} // namespace
 
 EntityManager::EntityManager(QObject *parent)
-    : QObject(parent)
+    : QObject(parent), m_unpublished(false), m_epoch(std::chrono::steady_clock::now()), m_frameVersion(0),
+      m_sentFrameVersion(0), m_viewportChanged(false),
+      m_writing(true), m_writerIdle(false), m_changeFlushInterval(16), m_flushRequested(false),
+      m_predictionInterval(50), m_frameInterval(33)
+{
+    // Readers always find a snapshot, even before the first change
+    publishSnapshot();
+    m_writerThread = std::thread([this] { runWriter(); });
+}
+
+EntityManager::~EntityManager()
+{
+    m_writing = false;
+    {
+        std::lock_guard<std::mutex> lock(m_writerMutex);
+        m_writerWake.notify_one();
+    }
+    m_writerThread.join();
+}
+
+/*!
+    \fn EntitySnapshotHandle EntityManager::snapshot() const
+    \brief Pins the latest published state of the store.
+
+    The snapshot is immutable and stays valid for as long as the handle is held.
+    Holding it doesn't block the writer, which publishes into other buffers.
+*/
+EntitySnapshotHandle EntityManager::snapshot() const
+{
+    return m_snapshots.acquire();
+}
+
+/*!
+    \fn void EntityManager::post(std::function<void()> command)
+    \brief Queues \a command to run on the writer thread, the only thread that touches m_store.
+*/
+void EntityManager::post(std::function<void()> command)
+{
+    m_commands.push(std::move(command));
+    if (m_writerIdle) {
+        std::lock_guard<std::mutex> lock(m_writerMutex);
+        m_writerWake.notify_one();
+    }
+}
+
+/*!
+    \fn void EntityManager::runWriter()
+    \brief Writer thread loop: applies queued commands, dead reckons, publishes snapshots and flushes changes.
+
+    Commands are drained in batches. Every prediction interval the store dead
+    reckons moving entities to the current time. A snapshot is published once
+    the batch is applied, no more often than kPublishInterval, and always before
+    changes are flushed so that views notified of a change read the new value.
+    Every frame interval what changed since the last frame is packed and sent.
+    When idle the writer sleeps until a command arrives, for at most a
+    millisecond in case a wake up raced with the queue check.
+*/
+void EntityManager::runWriter()
+{
+    auto now = std::chrono::steady_clock::now();
+    auto nextFlush = now + std::chrono::milliseconds(m_changeFlushInterval.load());
+    auto nextPrediction = now;
+    auto nextFrame = now;
+    while (m_writing) {
+        // Fixes applied in this pass are stamped with the time the pass started
+        m_store.setClock(clock());
+        while (std::optional<std::function<void()>> command = m_commands.pop()) {
+            (*command)();
+            m_unpublished = true;
+        }
+
+        now = std::chrono::steady_clock::now();
+        int predictionInterval = m_predictionInterval.load();
+        if (predictionInterval > 0 && now >= nextPrediction) {
+            m_store.setClock(clock());
+            if (m_store.extrapolate(kMaxPredictionSeconds) > 0) {
+                m_unpublished = true;
+            }
+            // Catch up rather than bunching ticks after a stall
+            nextPrediction = std::max(nextPrediction + std::chrono::milliseconds(predictionInterval), now);
+        }
+
+        int interval = m_changeFlushInterval.load();
+        bool flushDue = m_flushRequested.exchange(false) || (interval > 0 && now >= nextFlush);
+        if (m_unpublished && (flushDue || now - m_lastPublish >= kPublishInterval)) {
+            publishSnapshot();
+        }
+        if (flushDue) {
+            collectChanges();
+            nextFlush = now + std::chrono::milliseconds(interval > 0 ? interval : 16);
+        }
+
+        // Frames only carry published changes, so a reader of the frame and a reader of the
+        // snapshot agree. If the last publish was deferred the frame waits for the next one.
+        int frameInterval = m_frameInterval.load();
+        if (frameInterval > 0 && now >= nextFrame && !m_unpublished) {
+            std::uint64_t published = m_store.version() - 1;
+            if (published > m_frameVersion || m_viewportChanged) {
+                QStringList entered;
+                QStringList left;
+                QByteArray frame = buildFrame(m_frameVersion, published, entered, left);
+                m_frameVersion = published;
+                if (!frame.isEmpty()) {
+                    m_sentFrameVersion = published;
+                    QMetaObject::invokeMethod(this, [this, frame] { deliverFrame(frame); }, Qt::QueuedConnection);
+                }
+                if (!entered.isEmpty() || !left.isEmpty()) {
+                    QMetaObject::invokeMethod(this, [this, entered, left] { deliverViewportChanges(entered, left); },
+                                              Qt::QueuedConnection);
+                }
+            }
+            nextFrame = std::max(nextFrame + std::chrono::milliseconds(frameInterval), now);
+        }
+
+        std::unique_lock<std::mutex> lock(m_writerMutex);
+        m_writerIdle = true;
+        if (m_writing && m_commands.empty() && !m_flushRequested) {
+            m_writerWake.wait_for(lock, std::chrono::milliseconds(1));
+        }
+        m_writerIdle = false;
+    }
+}
+
+// Seconds since the manager was created, the clock fixes are stamped with
+double EntityManager::clock() const
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - m_epoch).count();
+}
+
+/*!
+    \fn void EntityManager::publishSnapshot()
+    \brief Brings a free snapshot buffer up to date with the store and makes it the latest.
+
+    Each buffer keeps the store as it was when the buffer was last published, so
+    only the slots changed and removed since then are copied into it, see
+    EntityStore::updateFrom(). The cost follows the number of changes rather than
+    the number of entities, and the buffer shares no strings or index with the
+    store for the writer to detach. If readers hold every buffer the publish is
+    skipped and retried on the next pass.
+*/
+void EntityManager::publishSnapshot()
+{
+    EntitySnapshot *next = m_snapshots.beginWrite();
+    if (!next) {
+        LOG_WARNING("CPP: Every entity snapshot is held by a reader, publish deferred");
+        return;
+    }
+    next->store.updateFrom(m_store, next->version);
+    next->version = m_store.version();
+    m_snapshots.publish();
+    m_store.advanceVersion();
+    m_unpublished = false;
+    m_lastPublish = std::chrono::steady_clock::now();
+}
+
+/*!
+    \fn void EntityManager::upsertBatch(const PE *pes, std::size_t count)
+    \brief Applies \a count decoded PEs to the store in one pass on the writer thread.
+
+    A PE whose id is not yet known creates an entity named after the id, otherwise
+    the entity's position, altitude, speed and heading are updated. Each PE is a
+    new fix that dead reckoning continues from. PE coordinates and headings are
+    in degrees and are stored in radians, speeds are metres per second.
+    Listeners get a single entitiesChanged with every UID touched rather than a
+    signal per entity or property, entityCreated is not emitted. The list is
+    only built while entitiesChanged is connected, since it grows with every
+    track in the feed; the page follows entityFrameEncoded instead. Property
+    changes are also picked up by the next flushChanges().
+*/
+void EntityManager::upsertBatch(const PE *pes, std::size_t count)
+{
+    if (count == 0) {
+        return;
+    }
+    post([this, batch = std::vector<PE>(pes, pes + count)] {
+        bool changesWanted = isSignalConnected(QMetaMethod::fromSignal(&EntityManager::entitiesChanged));
+        QStringList changed;
+
+        for (const PE &pe : batch) {
+            if (pe.id.isEmpty()) {
+                continue;
+            }
+            double latitude = qDegreesToRadians(pe.lat);
+            double longitude = qDegreesToRadians(pe.lon);
+            double heading = qDegreesToRadians(pe.heading);
+
+            EntityStore::Slot slot = m_store.find(pe.id);
+            if (slot == EntityStore::InvalidSlot) {
+                slot = m_store.insert(pe.id, pe.id, 0.0, latitude, longitude);
+                m_store.setAltitude(slot, pe.altitude);
+                m_store.setSpeed(slot, pe.speed);
+                m_store.setHeading(slot, heading);
+                if (changesWanted) changed.append(pe.id);
+                continue;
+            }
+
+            bool latitudeChanged = m_store.latitudeRadians(slot) != latitude;
+            bool longitudeChanged = m_store.longitudeRadians(slot) != longitude;
+            bool altitudeChanged = m_store.altitude(slot) != pe.altitude;
+            bool speedChanged = m_store.speed(slot) != pe.speed;
+            bool headingChanged = m_store.heading(slot) != heading;
+            m_store.setAltitude(slot, pe.altitude);
+            m_store.setSpeed(slot, pe.speed);
+            m_store.setHeading(slot, heading);
+            // Last, so the fix is taken at the reported position with the reported motion
+            m_store.setPosition(slot, latitude, longitude);
+            if (changesWanted && (latitudeChanged || longitudeChanged || altitudeChanged || speedChanged || headingChanged)) {
+                changed.append(pe.id);
+            }
+        }
+
+        if (!changed.isEmpty()) {
+            QMetaObject::invokeMethod(this, [this, changed] { emit entitiesChanged(changed); }, Qt::QueuedConnection);
+        }
+    });
+}
+
+void EntityManager::upsertBatch(const std::vector<PE> &pes)
+{
+    upsertBatch(pes.data(), pes.size());
+}
+
+/*!
+    \fn void EntityManager::updateEntity(EntityStore::Slot slot, std::uint32_t generation, std::function<void(EntityStore &, EntityStore::Slot)> update)
+    \brief Applies \a update to one entity on the writer thread.
+
+    The update is dropped if the entity was removed, or its slot reused, before
+    the writer got to it.
+*/
+void EntityManager::updateEntity(EntityStore::Slot slot, std::uint32_t generation,
+                                 std::function<void(EntityStore &, EntityStore::Slot)> update)
+{
+    post([this, slot, generation, update = std::move(update)] {
+        if (m_store.contains(slot) && m_store.generation(slot) == generation) {
+            update(m_store, slot);
+        }
+    });
+}
+
+/*!
+    \fn void EntityManager::setChangeFlushInterval(int milliseconds)
+    \brief Sets how often property changes are published, 16 ms by default.
+
+    With 0 nothing is published until flushChanges() is called, for example from
+    a frame swap, so the cadence can follow the display instead of a timer.
+*/
+void EntityManager::setChangeFlushInterval(int milliseconds)
+{
+    m_changeFlushInterval = qMax(0, milliseconds);
+}
+
+/*!
+    \fn void EntityManager::setPredictionInterval(int milliseconds)
+    \brief Sets how often moving entities are dead reckoned, 50 ms by default.
+
+    Each tick extrapolates every entity with a speed from its last fix along its
+    heading, for at most 30 seconds past the fix. The new positions reach the UI
+    through the usual change flush. With 0, entities stay at their last fix.
+*/
+void EntityManager::setPredictionInterval(int milliseconds)
+{
+    m_predictionInterval = qMax(0, milliseconds);
+}
+
+/*!
+    \fn void EntityManager::setFrameInterval(int milliseconds)
+    \brief Sets how often entityFrame is sent, 33 ms by default. With 0 no frames are sent.
+*/
+void EntityManager::setFrameInterval(int milliseconds)
 {
+    m_frameInterval = qMax(0, milliseconds);
 }
 
+/*!
+    \fn void EntityManager::setViewport(double minLatitude, double minLongitude, double maxLatitude, double maxLongitude)
+    \brief Limits entityFrame to entities inside the box, in radians, widened by a quarter of its size on every side.
+
+    Pass minLongitude > maxLongitude for a box across the antimeridian. The next
+    frame brings every entity that came into view, as a change, and removes every
+    entity that went out of it, as a removal. After that only entities in view are
+    sent, and entities crossing the edge are sent or removed as they cross.
+    entitiesEntered and entitiesLeft report the same crossings by UID, and
+    entitiesUpdated only carries changes to entities inside the padded box.
+*/
+void EntityManager::setViewport(double minLatitude, double minLongitude, double maxLatitude, double maxLongitude)
+{
+    if (!(minLatitude <= maxLatitude) || !std::isfinite(minLongitude) || !std::isfinite(maxLongitude)) {
+        LOG_WARNING("CPP: EntityManager ignored an invalid viewport");
+        return;
+    }
+    double span = minLongitude <= maxLongitude ? maxLongitude - minLongitude : maxLongitude + 2 * M_PI - minLongitude;
+    double latitudePadding = (maxLatitude - minLatitude) * kViewportPadding;
+    double longitudePadding = span * kViewportPadding;
+
+    Viewport viewport;
+    viewport.minLatitude = std::max(minLatitude - latitudePadding, -M_PI_2);
+    viewport.maxLatitude = std::min(maxLatitude + latitudePadding, M_PI_2);
+    if (span + 2 * longitudePadding >= 2 * M_PI) {
+        viewport.minLongitude = -M_PI;
+        viewport.maxLongitude = M_PI;
+    } else {
+        viewport.minLongitude = std::remainder(minLongitude - longitudePadding, 2 * M_PI);
+        viewport.maxLongitude = std::remainder(maxLongitude + longitudePadding, 2 * M_PI);
+    }
+    post([this, viewport] {
+        m_viewport = viewport;
+        m_viewportChanged = true;
+    });
+}
+
+void EntityManager::clearViewport()
+{
+    post([this] {
+        m_viewport.reset();
+        m_subscriptions.clear();
+        m_subscriptionOf.clear();
+        // The next frame starts over with every entity
+        m_frameVersion = 0;
+    });
+}
+
+bool EntityManager::Viewport::contains(double latitude, double longitude) const
+{
+    if (!(latitude >= minLatitude && latitude <= maxLatitude)) return false;
+    return minLongitude <= maxLongitude ? longitude >= minLongitude && longitude <= maxLongitude
+                                        : longitude >= minLongitude || longitude <= maxLongitude;
+}
+
+/*!
+    \fn QByteArray EntityManager::buildFrame(std::uint64_t since, std::uint64_t version, QStringList &entered, QStringList &left)
+    \brief Packs the changes after \a since, up to the published \a version, into one frame.
+
+    The frame is little-endian and laid out as columns, each aligned for its type
+    so a reader can view it in place, for example as JavaScript typed arrays:
+
+    \list
+    \li Header, 32 bytes: uint32 changed count, uint32 removed count, uint32 flags,
+        uint32 reserved, float64 since, float64 version. Versions fit a double exactly.
+        The header's since is the version of the last frame sent, frames with
+        nothing in them aren't sent.
+    \li For each changed entity: float64 latitude[], float64 longitude[] in radians,
+        float32 radius[], uint32 handle[], uint32 generation[].
+    \li For each removed entity: uint32 handle[], uint32 generation[].
+    \li For each changed entity: uint8 symbol[].
+    \endlist
+
+    A reader applies removals before changes, since a slot can be freed and
+    reused between frames. Flag bit 0 means reset: removals after \a since were
+    forgotten, the frame holds every entity and replaces whatever the reader had.
+    Otherwise a reader whose own version is older than the header's since missed
+    a frame and should reload with getEntityChangesSince.
+
+    With a viewport set, only entities in it are sent, see filterToViewport(),
+    and the UIDs crossing its edge are added to \a entered and \a left.
+    Returns an empty array if nothing changed.
+*/
+QByteArray EntityManager::buildFrame(std::uint64_t since, std::uint64_t version, QStringList &entered, QStringList &left)
+{
+    std::vector<EntityStore::Slot> changed;
+    std::vector<std::pair<EntityStore::Slot, std::uint32_t>> removed;
+    bool reset = !m_store.hasChangesSince(since);
+    if (reset) {
+        changed.reserve(m_store.size());
+        for (EntityStore::Slot slot = 0; slot < m_store.slotCount(); ++slot) {
+            if (m_store.contains(slot)) changed.push_back(slot);
+        }
+    } else {
+        m_store.changesSince(since, [&changed](EntityStore::Slot slot) { changed.push_back(slot); });
+        m_store.removalsSince(since, [&removed](const QString &, EntityStore::Slot slot, std::uint32_t generation) {
+            // Renames keep their slot, readers of frames don't track UIDs
+            if (slot != EntityStore::InvalidSlot) removed.emplace_back(slot, generation);
+        });
+    }
+    if (m_viewport) {
+        filterToViewport(since, reset, changed, removed, entered, left);
+    }
+    m_viewportChanged = false;
+    if (changed.empty() && removed.empty() && !reset) {
+        return QByteArray();
+    }
+
+    const std::size_t headerBytes = 32;
+    std::size_t size = headerBytes + changed.size() * (8 + 8 + 4 + 4 + 4 + 1) + removed.size() * (4 + 4);
+    QByteArray frame(static_cast<int>(size), Qt::Uninitialized);
+    uchar *out = reinterpret_cast<uchar *>(frame.data());
+    auto putDouble = [&out](double value) {
+        quint64 bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        qToLittleEndian<quint64>(bits, out);
+        out += 8;
+    };
+    auto putFloat = [&out](float value) {
+        quint32 bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        qToLittleEndian<quint32>(bits, out);
+        out += 4;
+    };
+    auto putUint = [&out](quint32 value) {
+        qToLittleEndian<quint32>(value, out);
+        out += 4;
+    };
+
+    putUint(static_cast<quint32>(changed.size()));
+    putUint(static_cast<quint32>(removed.size()));
+    putUint(reset ? 1u : 0u);
+    putUint(0);
+    putDouble(static_cast<double>(reset ? since : m_sentFrameVersion));
+    putDouble(static_cast<double>(version));
+
+    for (EntityStore::Slot slot : changed) putDouble(m_store.latitudeRadians(slot));
+    for (EntityStore::Slot slot : changed) putDouble(m_store.longitudeRadians(slot));
+    for (EntityStore::Slot slot : changed) putFloat(static_cast<float>(m_store.radius(slot)));
+    for (EntityStore::Slot slot : changed) putUint(slot);
+    for (EntityStore::Slot slot : changed) putUint(m_store.generation(slot));
+    for (const auto &entry : removed) putUint(entry.first);
+    for (const auto &entry : removed) putUint(entry.second);
+    for (EntityStore::Slot slot : changed) *out++ = static_cast<uchar>(m_store.symbol(slot));
+    return frame;
+}
+
+/*!
+    \fn void EntityManager::filterToViewport(std::uint64_t since, bool reset, std::vector<EntityStore::Slot> &changed, std::vector<std::pair<EntityStore::Slot, std::uint32_t>> &removed, QStringList &entered, QStringList &left)
+    \brief Cuts a frame's \a changed and \a removed entities down to those readers subscribed to.
+
+    An entity is subscribed from the frame that first sends it inside the
+    viewport until one removes it. Changes inside the viewport are sent,
+    entities moving in are sent whole and entities moving out are sent as
+    removals, and removals of entities readers never had are dropped. Only
+    changed entities can cross the edge, so this costs the number of changes,
+    plus the entities subscribed and in view when the viewport itself has moved.
+
+    A \a reset frame replaces whatever readers had, and the removals that would
+    say which subscribed entities are gone were forgotten. Every subscription is
+    dropped and reported as having left, and every entity in view enters again.
+*/
+void EntityManager::filterToViewport(std::uint64_t since, bool reset, std::vector<EntityStore::Slot> &changed,
+                                     std::vector<std::pair<EntityStore::Slot, std::uint32_t>> &removed,
+                                     QStringList &entered, QStringList &left)
+{
+    m_subscriptionOf.resize(m_store.slotCount(), kNotSubscribed);
+
+    std::vector<std::pair<EntityStore::Slot, std::uint32_t>> removedInView;
+    std::vector<EntityStore::Slot> candidates;
+    candidates.swap(changed);
+    if (reset) {
+        // Candidates are already every entity in the store
+        for (const Subscription &subscription : m_subscriptions) {
+            left.append(subscription.UID);
+            m_subscriptionOf[subscription.slot] = kNotSubscribed;
+        }
+        m_subscriptions.clear();
+    } else {
+        // Removals first, the slot may since hold a new entity
+        for (const auto &entry : removed) {
+            if (subscribed(entry.first) && m_subscriptions[m_subscriptionOf[entry.first]].generation == entry.second) {
+                unsubscribe(entry.first);
+                removedInView.push_back(entry);
+            }
+        }
+        if (m_viewportChanged) {
+            for (const Subscription &subscription : m_subscriptions) candidates.push_back(subscription.slot);
+            std::vector<EntityStore::Slot> inView = m_store.queryBox(m_viewport->minLatitude, m_viewport->minLongitude,
+                                                                     m_viewport->maxLatitude, m_viewport->maxLongitude);
+            candidates.insert(candidates.end(), inView.begin(), inView.end());
+            std::sort(candidates.begin(), candidates.end());
+            candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+        }
+    }
+
+    for (EntityStore::Slot slot : candidates) {
+        bool inside = m_store.contains(slot)
+                && m_viewport->contains(m_store.latitudeRadians(slot), m_store.longitudeRadians(slot));
+        if (inside && !subscribed(slot)) {
+            subscribe(slot);
+            changed.push_back(slot);
+            entered.append(m_store.UID(slot));
+        } else if (inside) {
+            if (m_store.modifiedVersion(slot) > since) changed.push_back(slot);
+        } else if (subscribed(slot)) {
+            const Subscription &subscription = m_subscriptions[m_subscriptionOf[slot]];
+            removedInView.emplace_back(slot, subscription.generation);
+            left.append(subscription.UID);
+            unsubscribe(slot);
+        }
+    }
+    removed.swap(removedInView);
+}
+
+bool EntityManager::subscribed(EntityStore::Slot slot) const
+{
+    return slot < m_subscriptionOf.size() && m_subscriptionOf[slot] != kNotSubscribed;
+}
+
+void EntityManager::subscribe(EntityStore::Slot slot)
+{
+    m_subscriptionOf[slot] = static_cast<std::uint32_t>(m_subscriptions.size());
+    m_subscriptions.push_back({slot, m_store.generation(slot), m_store.UID(slot)});
+}
+
+// Swaps the last subscription into the slot's place, so unsubscribing costs the same however many there are
+void EntityManager::unsubscribe(EntityStore::Slot slot)
+{
+    std::uint32_t position = m_subscriptionOf[slot];
+    Subscription last = m_subscriptions.back();
+    m_subscriptions[position] = last;
+    m_subscriptionOf[last.slot] = position;
+    m_subscriptions.pop_back();
+    m_subscriptionOf[slot] = kNotSubscribed;
+}
+
+void EntityManager::deliverFrame(const QByteArray &frame)
+{
+    emit entityFrame(frame);
+    if (isSignalConnected(QMetaMethod::fromSignal(&EntityManager::entityFrameEncoded))) {
+        emit entityFrameEncoded(QString::fromLatin1(frame.toBase64()));
+    }
+}
+
+void EntityManager::deliverViewportChanges(const QStringList &entered, const QStringList &left)
+{
+    if (!left.isEmpty()) emit entitiesLeft(left);
+    if (!entered.isEmpty()) emit entitiesEntered(entered);
+}
+
+/*!
+    \fn void EntityManager::flushChanges()
+    \brief Asks the writer to publish every property change since the last flush.
+
+    The store accumulates a dirty mask per entity, so however many times an
+    entity's properties were set it produces one entry in entitiesUpdated and
+    one NOTIFY signal per changed property on its Entity view, if it has one.
+*/
+void EntityManager::flushChanges()
+{
+    m_flushRequested = true;
+    std::lock_guard<std::mutex> lock(m_writerMutex);
+    m_writerWake.notify_one();
+}
+
+/*!
+    \fn void EntityManager::collectChanges()
+    \brief Takes the store's dirty masks and hands them to the GUI thread as one change set.
+
+    Only entities with an Entity view get a view change, and entitiesUpdated is
+    only built while something is connected to it. With a viewport set it only
+    carries entities inside the padded viewport, like entityFrame, so neither
+    thread does work per entity for tracks nobody is looking at.
+*/
+void EntityManager::collectChanges()
+{
+    if (!m_store.hasDirty()) {
+        return;
+    }
+
+    bool updatesWanted = isSignalConnected(QMetaMethod::fromSignal(&EntityManager::entitiesUpdated));
+    QVariantList changes;
+    std::vector<ViewChange> viewChanges;
+    m_store.takeDirty([this, updatesWanted, &changes, &viewChanges](EntityStore::Slot slot, std::uint16_t fields) {
+        if (slot < m_viewed.size() && m_viewed[slot]) {
+            viewChanges.push_back({slot, m_store.generation(slot), fields});
+        }
+        if (!updatesWanted || (m_viewport && !m_viewport->contains(m_store.latitudeRadians(slot), m_store.longitudeRadians(slot)))) {
+            return;
+        }
+        QVariantMap change;
+        change["UID"] = m_store.UID(slot);
+        if (fields & EntityStore::NameField) change["name"] = m_store.name(slot);
+        if (fields & EntityStore::SymbolField) change["symbol"] = static_cast<int>(m_store.symbol(slot));
+        if (fields & EntityStore::SpeedField) change["speed"] = m_store.speed(slot);
+        if (fields & EntityStore::RadiusField) change["radius"] = m_store.radius(slot);
+        if (fields & EntityStore::AltitudeField) change["altitude"] = m_store.altitude(slot);
+        if (fields & EntityStore::LatitudeField) change["latitude"] = m_store.latitudeRadians(slot);
+        if (fields & EntityStore::LongitudeField) change["longitude"] = m_store.longitudeRadians(slot);
+        if (fields & EntityStore::HeadingField) change["heading"] = m_store.heading(slot);
+        changes.append(change);
+    });
+    if (!changes.isEmpty() || !viewChanges.empty()) {
+        QMetaObject::invokeMethod(this, [this, changes, viewChanges] { deliverChanges(changes, viewChanges); },
+                                  Qt::QueuedConnection);
+    }
+}
+
+void EntityManager::deliverChanges(const QVariantList &changes, const std::vector<ViewChange> &viewChanges)
+{
+    for (const ViewChange &change : viewChanges) {
+        Entity *entity = m_views.value(change.slot, nullptr);
+        if (entity && entity->generation() == change.generation) {
+            entity->notifyChanged(change.fields);
+        }
+    }
+    if (!changes.isEmpty()) {
+        emit entitiesUpdated(changes);
+    }
+}
+
+/*!
+    \fn void EntityManager::createEntity(const QString &name, const QString &UID, double radius, double latitude, double longitude)
+    \brief Adds an entity to the store. UIDs must be unique, a duplicate is refused.
+*/
 void EntityManager::createEntity(const QString &name, const QString &UID, double radius, double latitude, double longitude)
 {
-    Entity *entity = new Entity(this);
-    entity->setName(name);
-    entity->setUID(UID);
-    entity->setRadius(radius);
-    entity->setLatitudeRadians(latitude);
-    entity->setLongitudeRadians(longitude);
+    post([this, name, UID, radius, latitude, longitude] {
+        if (m_store.insert(name, UID, radius, latitude, longitude) == EntityStore::InvalidSlot) {
+            LOG_WARNING("CPP: Refusing to create entity with duplicate UID {}", UID);
+            return;
+        }
+        LOG_DEBUG("CPP: Created entity with name {} and UID {} at lat {} long {}", name, UID, latitude, longitude);
+        QMetaObject::invokeMethod(this, [this, UID] { emit entityCreated(UID); }, Qt::QueuedConnection);
+    });
+}
 
-    m_database.append(entity);
-    emit entityCreated(entity);
-    qDebug() << "CPP: Created entity with name" << name << "and UID" << UID << "at lat" << latitude << "long" << longitude;
+/*!
+    \fn bool EntityManager::removeEntity(const QString &UID)
+    \brief Removes the entity with \a UID in constant time. Its slot is reused by a later create.
+
+    Returns whether the entity exists in the latest snapshot, the removal itself
+    happens on the writer thread. Any Entity object handed out for it is deleted,
+    so QML references to it become null.
+*/
+bool EntityManager::removeEntity(const QString &UID)
+{
+    return removeEntities(QStringList{UID}) == 1;
 }
 
-Entity* EntityManager::getEntityByUID(const QString &UID) const
+/*!
+    \fn int EntityManager::removeEntities(const QStringList &UIDs)
+    \brief Removes every entity in \a UIDs that exists, with one entitiesRemoved signal for the lot.
+
+    Returns how many of them exist in the latest snapshot.
+*/
+int EntityManager::removeEntities(const QStringList &UIDs)
 {
-    for (Entity *entity : m_database) {
-        if (entity->UID() == UID) {
-            qDebug() << "CPP: Found entity UID: " << UID;
-            return entity;
+    int found = 0;
+    {
+        EntitySnapshotHandle current = snapshot();
+        for (const QString &UID : UIDs) {
+            if (current->store.find(UID) != EntityStore::InvalidSlot) {
+                ++found;
+            }
         }
     }
-    qDebug() << "CPP: Couldn't find entity UID: " << UID;
-    return nullptr;
+    post([this, UIDs] { removeSlots(UIDs); });
+    return found;
+}
+
+/*!
+    \fn int EntityManager::setEntityPositions(const QByteArray &packed)
+    \brief Applies a buffer of PositionUpdate records to the store in one pass on the writer thread.
+
+    Entities are addressed by slot handle and generation rather than UID, so
+    there's no lookup per record, and a record for an entity that has since
+    been removed is dropped. Each position is a new fix. A buffer whose size
+    isn't a whole number of records is refused. Returns how many records were
+    queued.
+*/
+int EntityManager::setEntityPositions(const QByteArray &packed)
+{
+    if (packed.size() % static_cast<int>(sizeof(PositionUpdate)) != 0) {
+        LOG_WARNING("CPP: Refusing {} byte position buffer, records are {} bytes", packed.size(), sizeof(PositionUpdate));
+        return 0;
+    }
+    std::size_t count = static_cast<std::size_t>(packed.size()) / sizeof(PositionUpdate);
+    if (count == 0) {
+        return 0;
+    }
+
+    // Decoded field by field, the buffer need not be aligned or in host byte order
+    std::vector<PositionUpdate> updates(count);
+    const uchar *record = reinterpret_cast<const uchar *>(packed.constData());
+    for (PositionUpdate &update : updates) {
+        quint64 latitude = qFromLittleEndian<quint64>(record + 8);
+        quint64 longitude = qFromLittleEndian<quint64>(record + 16);
+        update.handle = qFromLittleEndian<quint32>(record);
+        update.generation = qFromLittleEndian<quint32>(record + 4);
+        std::memcpy(&update.latitude, &latitude, sizeof(double));
+        std::memcpy(&update.longitude, &longitude, sizeof(double));
+        record += sizeof(PositionUpdate);
+    }
+    post([this, updates = std::move(updates)] {
+        for (const PositionUpdate &update : updates) {
+            EntityStore::Slot slot = update.handle;
+            if (!m_store.contains(slot) || m_store.generation(slot) != update.generation) {
+                continue;
+            }
+            m_store.setPosition(slot, update.latitude, update.longitude);
+        }
+    });
+    return static_cast<int>(count);
+}
+
+int EntityManager::setEntityPositionsBase64(const QString &base64)
+{
+    return setEntityPositions(QByteArray::fromBase64(base64.toLatin1()));
+}
+
+void EntityManager::removeSlots(const QStringList &UIDs)
+{
+    QStringList removed;
+    std::vector<ViewChange> views;
+    for (const QString &UID : UIDs) {
+        EntityStore::Slot slot = m_store.find(UID);
+        if (slot == EntityStore::InvalidSlot) {
+            continue;
+        }
+        std::uint32_t generation = m_store.generation(slot);
+        m_store.remove(slot);
+        removed.append(UID);
+        views.push_back({slot, generation, 0});
+    }
+    if (!removed.isEmpty()) {
+        QMetaObject::invokeMethod(this, [this, removed, views] { deliverRemovals(removed, views); }, Qt::QueuedConnection);
+    }
+}
+
+void EntityManager::deliverRemovals(const QStringList &UIDs, const std::vector<ViewChange> &removed)
+{
+    for (const ViewChange &entry : removed) {
+        Entity *entity = m_views.value(entry.slot, nullptr);
+        if (entity && entity->generation() == entry.generation) {
+            delete m_views.take(entry.slot);
+            EntityStore::Slot slot = entry.slot;
+            post([this, slot] {
+                if (slot < m_viewed.size()) m_viewed[slot] = 0;
+            });
+        }
+    }
+    emit entitiesRemoved(UIDs);
+}
+
+/*!
+    \fn Entity* EntityManager::getEntityByUID(const QString &UID)
+    \brief Returns the entity with \a UID, or nullptr. Constant time and silent, the map calls this for every entity each frame.
+*/
+Entity* EntityManager::getEntityByUID(const QString &UID)
+{
+    EntitySnapshotHandle current = snapshot();
+    EntityStore::Slot slot = current->store.find(UID);
+    if (slot == EntityStore::InvalidSlot) {
+        return nullptr;
+    }
+    return view(slot, current->store.generation(slot));
+}
+
+/*!
+    \fn Entity* EntityManager::view(EntityStore::Slot slot, std::uint32_t generation)
+    \brief Returns the Entity object for \a slot, creating it the first time it's asked for.
+
+    A cached view left over from an earlier occupant of the slot, whose removal
+    hasn't been delivered yet, is replaced.
+*/
+Entity* EntityManager::view(EntityStore::Slot slot, std::uint32_t generation)
+{
+    Entity *&entity = m_views[slot];
+    if (entity && entity->generation() != generation) {
+        delete entity;
+        entity = nullptr;
+    }
+    if (!entity) {
+        entity = new Entity(this, slot, generation);
+        // Changes flushed before the writer gets this are missed, the view reads the latest snapshot anyway
+        post([this, slot] {
+            if (slot >= m_viewed.size()) m_viewed.resize(slot + 1, 0);
+            m_viewed[slot] = 1;
+        });
+    }
+    return entity;
 }
 
 void EntityManager::printAllEntities()
 {
-    for (const Entity *entity : m_database) {
-        qDebug() << "CPP: Entity Name:" << entity->name();
-        qDebug() << "CPP: Entity UID:" << entity->UID();
-        qDebug() << "CPP: Entity Radius:" << entity->radius();
-        qDebug() << "CPP: Entity Lat:" << entity->latitudeRadians();
-        qDebug() << "CPP: Entity Long:" << entity->longitudeRadians();
+    EntitySnapshotHandle current = snapshot();
+    const EntityStore &store = current->store;
+    for (EntityStore::Slot slot = 0; slot < store.slotCount(); ++slot) {
+        if (!store.contains(slot)) continue;
+        LOG_INFO("CPP: Entity Name: {} UID: {} Radius: {} Lat: {} Long: {}", store.name(slot), store.UID(slot),
+                 store.radius(slot), store.latitudeRadians(slot), store.longitudeRadians(slot));
     }
 }
 
 QVariantMap EntityManager::getEntityList() const
 {
     QVariantMap resultMap;
+    EntitySnapshotHandle current = snapshot();
+    const EntityStore &store = current->store;
 
     QList<QVariant> entityList;
-    for (Entity* entity : m_database) {
-        QVariantMap entityMap;
-        entityMap["name"] = entity->name();
-        entityMap["UID"] = entity->UID();
-        entityMap["radius"] = entity->radius();
-        entityMap["latitude"] = entity->latitudeRadians();
-        entityMap["longitude"] = entity->longitudeRadians();
-        entityList.append(entityMap);
+    entityList.reserve(static_cast<int>(store.size()));
+    for (EntityStore::Slot slot = 0; slot < store.slotCount(); ++slot) {
+        if (!store.contains(slot)) continue;
+        entityList.append(entityMap(store, slot));
     }
 
     resultMap["entities"] = entityList;
+    resultMap["version"] = static_cast<qulonglong>(current->version);
     return resultMap;
 }
 
+/*!
+    \fn QVariantMap EntityManager::getEntityChangesSince(qulonglong version) const
+    \brief Returns what changed in the store after \a version, so a client can keep a copy current.
+
+    The result has "inserted" and "updated" lists of entity maps, as in
+    getEntityList, a "removed" list of UIDs and the "version" to ask from next
+    time. Start from 0 or the version getEntityList returned. Apply removals
+    before insertions, a UID removed and created again appears in both.
+
+    The cost follows the number of changes rather than the number of entities.
+    If \a version is too old for the removals still remembered, or isn't one
+    this store published, "reset" is true and "inserted" holds every entity:
+    the client should drop what it has and start again from the result.
+*/
+QVariantMap EntityManager::getEntityChangesSince(qulonglong version) const
+{
+    EntitySnapshotHandle current = snapshot();
+    const EntityStore &store = current->store;
+
+    QVariantList inserted;
+    QVariantList updated;
+    QStringList removed;
+    bool reset = !store.hasChangesSince(version);
+    if (reset) {
+        for (EntityStore::Slot slot = 0; slot < store.slotCount(); ++slot) {
+            if (store.contains(slot)) inserted.append(entityMap(store, slot));
+        }
+    } else {
+        store.changesSince(version, [&](EntityStore::Slot slot) {
+            (store.insertedVersion(slot) > version ? inserted : updated).append(entityMap(store, slot));
+        });
+        store.removalsSince(version, [&](const QString &UID, EntityStore::Slot, std::uint32_t) {
+            removed.append(UID);
+        });
+    }
+
+    QVariantMap result;
+    result["inserted"] = inserted;
+    result["updated"] = updated;
+    result["removed"] = removed;
+    result["reset"] = reset;
+    result["version"] = static_cast<qulonglong>(current->version);
+    return result;
+}
+
+QVariantMap EntityManager::entityMap(const EntityStore &store, EntityStore::Slot slot)
+{
+    QVariantMap entity;
+    entity["handle"] = slot;
+    entity["generation"] = store.generation(slot);
+    entity["name"] = store.name(slot);
+    entity["UID"] = store.UID(slot);
+    entity["radius"] = store.radius(slot);
+    entity["symbol"] = static_cast<int>(store.symbol(slot));
+    entity["latitude"] = store.latitudeRadians(slot);
+    entity["longitude"] = store.longitudeRadians(slot);
+    entity["speed"] = store.speed(slot);
+    entity["heading"] = store.heading(slot);
+    return entity;
+}
+
+/*!
+    \fn QStringList EntityManager::queryBox(double minLatitude, double minLongitude, double maxLatitude, double maxLongitude) const
+    \brief Returns the UIDs of entities inside the box, in radians. Pass minLongitude > maxLongitude for a box across the antimeridian.
+*/
+QStringList EntityManager::queryBox(double minLatitude, double minLongitude, double maxLatitude, double maxLongitude) const
+{
+    EntitySnapshotHandle current = snapshot();
+    return UIDs(current->store, current->store.queryBox(minLatitude, minLongitude, maxLatitude, maxLongitude));
+}
+
+/*!
+    \fn QStringList EntityManager::queryRadius(double latitude, double longitude, double radiusMetres) const
+    \brief Returns the UIDs of entities within \a radiusMetres great-circle distance of the point, in radians.
+*/
+QStringList EntityManager::queryRadius(double latitude, double longitude, double radiusMetres) const
+{
+    EntitySnapshotHandle current = snapshot();
+    return UIDs(current->store, current->store.queryRadius(latitude, longitude, radiusMetres));
+}
+
+/*!
+    \fn QVariantMap EntityManager::queryClusters(double minLatitude, double minLongitude, double maxLatitude, double maxLongitude, int zoom) const
+    \brief Returns the entities in the box clustered for display at Leaflet zoom \a zoom.
+
+    "clusters" holds one map per cluster with its "count", "latitude" and
+    "longitude". A cluster of one is the entity itself, with every property
+    getEntityList gives. "version" is the snapshot the clusters were taken from.
+    Zooms past ClusterIndex::kMaxZoom get the finest clusters.
+*/
+QVariantMap EntityManager::queryClusters(double minLatitude, double minLongitude, double maxLatitude, double maxLongitude, int zoom) const
+{
+    EntitySnapshotHandle current = snapshot();
+    const EntityStore &store = current->store;
+
+    QVariantList clusters;
+    for (const EntityStore::Cluster &cluster : store.queryClusters(minLatitude, minLongitude, maxLatitude, maxLongitude, zoom)) {
+        QVariantMap entry;
+        if (cluster.member != EntityStore::InvalidSlot) {
+            entry = entityMap(store, cluster.member);
+        } else {
+            entry["latitude"] = cluster.latitude;
+            entry["longitude"] = cluster.longitude;
+        }
+        entry["count"] = cluster.count;
+        clusters.append(entry);
+    }
+
+    QVariantMap result;
+    result["clusters"] = clusters;
+    result["version"] = static_cast<qulonglong>(current->version);
+    return result;
+}
+
+/*!
+    \fn QVariantMap EntityManager::rangesAndBearings(double latitude, double longitude, const QStringList &UIDs, bool ellipsoidal) const
+    \brief Returns the range and initial bearing from the point to each entity in \a UIDs, in one batch.
+
+    "UIDs" lists the entities found, in order, "range" their great-circle
+    distances in metres, or WGS84 distances with \a ellipsoidal, and "bearing"
+    the bearings to them in radians clockwise from true north. Unknown UIDs are skipped.
+*/
+QVariantMap EntityManager::rangesAndBearings(double latitude, double longitude, const QStringList &UIDs, bool ellipsoidal) const
+{
+    EntitySnapshotHandle current = snapshot();
+    const EntityStore &store = current->store;
+    QStringList found;
+    std::vector<EntityStore::Slot> matched = findSlots(store, UIDs, found);
+
+    std::size_t count = matched.size();
+    std::vector<double> fromLatitude(count, latitude);
+    std::vector<double> fromLongitude(count, longitude);
+    std::vector<double> toLatitude(count);
+    std::vector<double> toLongitude(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        toLatitude[i] = store.latitudeRadians(matched[i]);
+        toLongitude[i] = store.longitudeRadians(matched[i]);
+    }
+    std::vector<double> range(count);
+    std::vector<double> bearing(count);
+    if (ellipsoidal) {
+        geodesy::vincentyDistance(fromLatitude.data(), fromLongitude.data(), toLatitude.data(), toLongitude.data(), range.data(), count);
+    } else {
+        geodesy::haversineDistance(fromLatitude.data(), fromLongitude.data(), toLatitude.data(), toLongitude.data(), range.data(), count);
+    }
+    geodesy::initialBearing(fromLatitude.data(), fromLongitude.data(), toLatitude.data(), toLongitude.data(), bearing.data(), count);
+
+    QVariantList ranges;
+    QVariantList bearings;
+    ranges.reserve(static_cast<int>(count));
+    bearings.reserve(static_cast<int>(count));
+    for (std::size_t i = 0; i < count; ++i) {
+        ranges.append(range[i]);
+        bearings.append(bearing[i]);
+    }
+    QVariantMap result;
+    result["UIDs"] = found;
+    result["range"] = ranges;
+    result["bearing"] = bearings;
+    return result;
+}
+
+/*!
+    \fn QVariantMap EntityManager::localPositions(double latitude, double longitude, double altitude, const QStringList &UIDs) const
+    \brief Returns where each entity in \a UIDs is in the east, north, up frame at the origin.
+
+    "UIDs" lists the entities found, in order, and "east", "north" and "up" their
+    offsets in metres. Entities are placed at their altitude above the WGS84
+    ellipsoid. Unknown UIDs are skipped.
+*/
+QVariantMap EntityManager::localPositions(double latitude, double longitude, double altitude, const QStringList &UIDs) const
+{
+    EntitySnapshotHandle current = snapshot();
+    const EntityStore &store = current->store;
+    QStringList found;
+    std::vector<EntityStore::Slot> matched = findSlots(store, UIDs, found);
+
+    std::size_t count = matched.size();
+    std::vector<double> latitudes(count);
+    std::vector<double> longitudes(count);
+    std::vector<double> altitudes(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        latitudes[i] = store.latitudeRadians(matched[i]);
+        longitudes[i] = store.longitudeRadians(matched[i]);
+        altitudes[i] = store.altitude(matched[i]);
+    }
+    std::vector<double> x(count);
+    std::vector<double> y(count);
+    std::vector<double> z(count);
+    geodesy::geodeticToEcef(latitudes.data(), longitudes.data(), altitudes.data(), x.data(), y.data(), z.data(), count);
+    std::vector<double> east(count);
+    std::vector<double> north(count);
+    std::vector<double> up(count);
+    geodesy::ecefToEnu(latitude, longitude, altitude, x.data(), y.data(), z.data(), east.data(), north.data(), up.data(), count);
+
+    QVariantList eastList;
+    QVariantList northList;
+    QVariantList upList;
+    for (std::size_t i = 0; i < count; ++i) {
+        eastList.append(east[i]);
+        northList.append(north[i]);
+        upList.append(up[i]);
+    }
+    QVariantMap result;
+    result["UIDs"] = found;
+    result["east"] = eastList;
+    result["north"] = northList;
+    result["up"] = upList;
+    return result;
+}
+
+/*!
+    \fn QVariantList EntityManager::rangeRing(double latitude, double longitude, double metres, int segments) const
+    \brief Returns \a segments points on the circle \a metres from the point along the surface.
+
+    The list alternates latitude and longitude in radians, starting due north and
+    going clockwise. Unlike a circle drawn on the Mercator map it stays true to
+    distance at any size and latitude. Segments are clamped to 3..1024.
+*/
+QVariantList EntityManager::rangeRing(double latitude, double longitude, double metres, int segments) const
+{
+    std::size_t count = static_cast<std::size_t>(qBound(3, segments, 1024));
+    std::vector<double> latitudes(count, latitude);
+    std::vector<double> longitudes(count, longitude);
+    std::vector<double> bearings(count);
+    std::vector<double> distances(count, metres);
+    for (std::size_t i = 0; i < count; ++i) {
+        bearings[i] = 2 * M_PI * static_cast<double>(i) / static_cast<double>(count);
+    }
+    geodesy::destination(latitudes.data(), longitudes.data(), bearings.data(), distances.data(),
+                         latitudes.data(), longitudes.data(), count);
+
+    QVariantList points;
+    points.reserve(static_cast<int>(2 * count));
+    for (std::size_t i = 0; i < count; ++i) {
+        points.append(latitudes[i]);
+        points.append(longitudes[i]);
+    }
+    return points;
+}
+
+std::vector<EntityStore::Slot> EntityManager::findSlots(const EntityStore &store, const QStringList &UIDs, QStringList &found)
+{
+    std::vector<EntityStore::Slot> matched;
+    matched.reserve(static_cast<std::size_t>(UIDs.size()));
+    for (const QString &UID : UIDs) {
+        EntityStore::Slot slot = store.find(UID);
+        if (slot != EntityStore::InvalidSlot) {
+            matched.push_back(slot);
+            found.append(UID);
+        }
+    }
+    return matched;
+}
+
+QStringList EntityManager::UIDs(const EntityStore &store, const std::vector<EntityStore::Slot> &matched) const
+{
+    QStringList result;
+    result.reserve(static_cast<int>(matched.size()));
+    for (EntityStore::Slot slot : matched) {
+        result.append(store.UID(slot));
+    }
+    return result;
+}
+
 void EntityManager::logMessage(const QString &message) {
-    qDebug() << "CPP: EntityManager logged message: " << message;
+    LOG_INFO("CPP: EntityManager logged message: {}", message);
 }
 
 // Q_DECLARE_METATYPE(EntityManager);
@@ -1,30 +1,199 @@
 #ifndef ENTITYMANAGER_H
 #define ENTITYMANAGER_H
 
+#include <QByteArray>
 #include <QObject>
-#include <QList>
+#include <QHash>
+#include <QStringList>
 #include <QVariantMap>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
 #include "Entity.h"
+#include "EntityStore.h"
+#include "MpscQueue.h"
+#include "SnapshotPublisher.h"
+#include "pe.h"
 
+// Owns the entity store. A writer thread applies every change to the store and publishes
+// immutable snapshots of it, all reads are answered from the latest snapshot. Writes are
+// asynchronous: they become visible to reads once the writer has applied and published them.
+// The writer also dead reckons every moving entity from its last fix at a fixed tick.
 class EntityManager : public QObject
 {
     Q_OBJECT
 public:
     explicit EntityManager(QObject *parent = nullptr);
+    ~EntityManager() override;
+
+    // The latest published state. Safe from any thread, holding it never delays the writer.
+    EntitySnapshotHandle snapshot() const;
+
+    // Creates or updates one entity per PE, keyed on the PE id, then emits entitiesChanged once.
+    // Safe from any thread.
+    void upsertBatch(const PE *pes, std::size_t count);
+    void upsertBatch(const std::vector<PE> &pes);
+
+    // Runs `update` on the writer thread if the slot still holds the same entity. Safe from any thread.
+    void updateEntity(EntityStore::Slot slot, std::uint32_t generation,
+                      std::function<void(EntityStore &, EntityStore::Slot)> update);
 
 public slots:
-    Entity* getEntityByUID(const QString &UID) const;
+    // May create the Entity view for the UID on first use
+    Entity* getEntityByUID(const QString &UID);
+    // Every entity, plus the "version" to pass to getEntityChangesSince
     QVariantMap getEntityList() const;
+    // Entities inserted, updated and removed after `version`, and the version they bring the caller to
+    QVariantMap getEntityChangesSince(qulonglong version) const;
+    // UIDs of entities inside the box or circle, coordinates in radians
+    QStringList queryBox(double minLatitude, double minLongitude, double maxLatitude, double maxLongitude) const;
+    QStringList queryRadius(double latitude, double longitude, double radiusMetres) const;
+    // Entities in the box grouped for display at a map zoom, coordinates in radians
+    QVariantMap queryClusters(double minLatitude, double minLongitude, double maxLatitude, double maxLongitude, int zoom) const;
+    // Range in metres and initial bearing in radians from the point to each entity, see Geodesy.h
+    QVariantMap rangesAndBearings(double latitude, double longitude, const QStringList &UIDs, bool ellipsoidal) const;
+    // East, north and up metres of each entity from a WGS84 origin
+    QVariantMap localPositions(double latitude, double longitude, double altitude, const QStringList &UIDs) const;
+    // Points `metres` from the point at `segments` even bearings, as latitude, longitude pairs in radians
+    QVariantList rangeRing(double latitude, double longitude, double metres, int segments) const;
     void createEntity(const QString &name, const QString &UID, double radius, double latitude, double longitude);
+    bool removeEntity(const QString &UID);
+    // How often property changes are flushed, 0 to flush only when flushChanges() is called
+    void setChangeFlushInterval(int milliseconds);
+    void flushChanges();
+    // How often positions are dead reckoned from the last fixes, 0 to stop
+    void setPredictionInterval(int milliseconds);
+    // How often entityFrame is sent, 0 to stop
+    void setFrameInterval(int milliseconds);
+    // Limits frames to entities in and around the box the user is looking at, in radians
+    void setViewport(double minLatitude, double minLongitude, double maxLatitude, double maxLongitude);
+    // Frames cover every entity again
+    void clearViewport();
+    // Returns how many of the UIDs were removed
+    int removeEntities(const QStringList &UIDs);
+    // Moves many entities at once, see PositionUpdate. Returns how many records were queued.
+    int setEntityPositions(const QByteArray &packed);
+    // The same, for the web channel, which can't carry binary
+    int setEntityPositionsBase64(const QString &base64);
     void printAllEntities();
     void logMessage(const QString &message);
 
 signals:
-    void entityCreated(Entity* entity);
+    void entityCreated(const QString &UID);
     void entityUpdated(Entity* entity);
+    void entitiesChanged(const QStringList &UIDs);
+    void entitiesRemoved(const QStringList &UIDs);
+    // One map per changed entity: its UID plus the new value of every property that changed.
+    // With a viewport set, only entities inside the padded viewport, see setViewport.
+    void entitiesUpdated(const QVariantList &changes);
+    // Positions, radii and symbols of every entity changed since the last frame, and the
+    // entities removed, packed into columns. The layout is described at buildFrame().
+    void entityFrame(const QByteArray &frame);
+    // The same frame base64 encoded for the web channel, only encoded while connected
+    void entityFrameEncoded(const QString &frame);
+    // Entities that came into or went out of the padded viewport, see setViewport
+    void entitiesEntered(const QStringList &UIDs);
+    void entitiesLeft(const QStringList &UIDs);
+
+public:
+    // One record of the buffer setEntityPositions takes, little-endian and packed back to back.
+    // The handle and generation come from "handle" and "generation" in getEntityList.
+    struct PositionUpdate {
+        std::uint32_t handle;
+        std::uint32_t generation;
+        double latitude;
+        double longitude;
+    };
+    static_assert(sizeof(PositionUpdate) == 24, "PositionUpdate must match the packed layout");
 
 private:
-    QList<Entity*> m_database;
+    // Padded viewport frames are limited to, see setViewport. minLongitude > maxLongitude crosses the antimeridian.
+    struct Viewport {
+        double minLatitude;
+        double minLongitude;
+        double maxLatitude;
+        double maxLongitude;
+        bool contains(double latitude, double longitude) const;
+    };
+
+    // A change to one entity, for the Entity view of the slot if it has one
+    struct ViewChange {
+        EntityStore::Slot slot;
+        std::uint32_t generation;
+        std::uint16_t fields;
+    };
+
+    // An entity frames have told readers about while a viewport is set
+    struct Subscription {
+        EntityStore::Slot slot;
+        std::uint32_t generation;
+        QString UID;
+    };
+
+    // Writer thread
+    void post(std::function<void()> command);
+    void runWriter();
+    void publishSnapshot();
+    double clock() const;
+    void collectChanges();
+    void removeSlots(const QStringList &UIDs);
+    QByteArray buildFrame(std::uint64_t since, std::uint64_t version, QStringList &entered, QStringList &left);
+    void filterToViewport(std::uint64_t since, bool reset, std::vector<EntityStore::Slot> &changed,
+                          std::vector<std::pair<EntityStore::Slot, std::uint32_t>> &removed,
+                          QStringList &entered, QStringList &left);
+    bool subscribed(EntityStore::Slot slot) const;
+    void subscribe(EntityStore::Slot slot);
+    void unsubscribe(EntityStore::Slot slot);
+
+    // GUI thread
+    Entity* view(EntityStore::Slot slot, std::uint32_t generation);
+    void deliverChanges(const QVariantList &changes, const std::vector<ViewChange> &viewChanges);
+    void deliverRemovals(const QStringList &UIDs, const std::vector<ViewChange> &removed);
+    void deliverFrame(const QByteArray &frame);
+    void deliverViewportChanges(const QStringList &entered, const QStringList &left);
+    QStringList UIDs(const EntityStore &store, const std::vector<EntityStore::Slot> &matched) const;
+    // Slots of the UIDs the store has, appending those UIDs to `found`
+    static std::vector<EntityStore::Slot> findSlots(const EntityStore &store, const QStringList &UIDs, QStringList &found);
+    static QVariantMap entityMap(const EntityStore &store, EntityStore::Slot slot);
+
+    // Only touched by the writer thread once it has started
+    EntityStore m_store;
+    bool m_unpublished;
+    std::chrono::steady_clock::time_point m_lastPublish;
+    const std::chrono::steady_clock::time_point m_epoch;
+    // Every change up to this version has been sent in a frame
+    std::uint64_t m_frameVersion;
+    // Version of the last frame that wasn't empty, the "since" of the next one
+    std::uint64_t m_sentFrameVersion;
+    // Interest management: the padded viewport and the entities frames have told readers about.
+    // Subscriptions are listed so a viewport move visits only them, m_subscriptionOf holds each
+    // slot's position in the list.
+    std::optional<Viewport> m_viewport;
+    bool m_viewportChanged;
+    std::vector<Subscription> m_subscriptions;
+    std::vector<std::uint32_t> m_subscriptionOf;
+    // Slots that may have an Entity view, the only ones whose changes are sent to views
+    std::vector<std::uint8_t> m_viewed;
+    SnapshotPublisher<EntitySnapshot> m_snapshots;
+
+    MpscQueue<std::function<void()>> m_commands;
+    std::thread m_writerThread;
+    std::atomic<bool> m_writing;
+    std::atomic<bool> m_writerIdle;
+    std::mutex m_writerMutex;
+    std::condition_variable m_writerWake;
+    std::atomic<int> m_changeFlushInterval;
+    std::atomic<bool> m_flushRequested;
+    std::atomic<int> m_predictionInterval;
+    std::atomic<int> m_frameInterval;
+
+    // Entity objects handed out so far, most entities never get one. GUI thread only.
+    QHash<EntityStore::Slot, Entity*> m_views;
 };
 
 #endif // ENTITYMANAGER_H
@@ -0,0 +1,601 @@
+#include "EntityStore.h"
+#include <algorithm>
+#include <cmath>
+#include "Kinematics.h"
+
+using kinematics::kEarthRadiusMetres;
+
+/*!
+    \fn EntityStore::Slot EntityStore::insert(const QString &name, const QString &UID, double radius, double latitude, double longitude)
+    \brief Stores an entity in a free slot, or appends one to every column, and indexes it by UID.
+
+    Altitude, speed and heading start at zero and the symbol at UNKNOWN. The
+    position is the entity's first fix.
+*/
+EntityStore::Slot EntityStore::insert(const QString &name, const QString &UID, double radius, double latitude, double longitude)
+{
+    if (m_index.contains(UID)) {
+        return InvalidSlot;
+    }
+
+    Slot slot;
+    if (!m_freeSlots.empty()) {
+        slot = m_freeSlots.back();
+        m_freeSlots.pop_back();
+        m_latitude[slot] = latitude;
+        m_longitude[slot] = longitude;
+        m_altitude[slot] = 0.0;
+        m_speed[slot] = 0.0;
+        m_radius[slot] = radius;
+        m_symbol[slot] = static_cast<std::uint8_t>(EntitySymbol::UNKNOWN);
+        m_live[slot] = 1;
+        ++m_generation[slot];
+        m_dirty[slot] = 0;
+        m_inserted[slot] = m_version;
+        m_heading[slot] = 0.0;
+        m_UID[slot] = UID;
+        m_name[slot] = name;
+    } else {
+        slot = static_cast<Slot>(m_UID.size());
+        m_latitude.push_back(latitude);
+        m_longitude.push_back(longitude);
+        m_altitude.push_back(0.0);
+        m_speed.push_back(0.0);
+        m_radius.push_back(radius);
+        m_symbol.push_back(static_cast<std::uint8_t>(EntitySymbol::UNKNOWN));
+        m_live.push_back(1);
+        m_generation.push_back(0);
+        m_dirty.push_back(0);
+        m_inserted.push_back(m_version);
+        m_heading.push_back(0.0);
+        m_fixLatitude.push_back(latitude);
+        m_fixLongitude.push_back(longitude);
+        m_fixTime.push_back(m_clock);
+        m_latitudeRate.push_back(0.0);
+        m_longitudeRate.push_back(0.0);
+        m_modified.push_back(0);
+        m_olderChange.push_back(InvalidSlot);
+        m_newerChange.push_back(InvalidSlot);
+        m_UID.push_back(UID);
+        m_name.push_back(name);
+    }
+    m_index.insert(UID, slot);
+    m_spatial.update(slot, latitude, longitude);
+    m_clusters.update(slot, latitude, longitude);
+    refix(slot);
+    touch(slot);
+    ++m_size;
+    return slot;
+}
+
+/*!
+    \fn bool EntityStore::remove(Slot slot)
+    \brief Drops the entity in \a slot from the indexes and puts the slot on the free list.
+
+    The strings are released straight away, the numeric columns keep their old
+    values until the slot is reused.
+*/
+bool EntityStore::remove(Slot slot)
+{
+    if (!contains(slot)) {
+        return false;
+    }
+    m_index.remove(m_UID[slot]);
+    m_spatial.remove(slot);
+    m_clusters.remove(slot);
+    unlinkChanged(slot);
+    recordRemoval(m_UID[slot], slot);
+    m_UID[slot] = QString();
+    m_name[slot] = QString();
+    m_live[slot] = 0;
+    m_dirty[slot] = 0;
+    // Free slots are swept by extrapolate() with the rest, keep them still
+    m_latitudeRate[slot] = 0.0;
+    m_longitudeRate[slot] = 0.0;
+    m_freeSlots.push_back(slot);
+    --m_size;
+    return true;
+}
+
+EntityStore::Slot EntityStore::find(const QString &UID) const
+{
+    return m_index.value(UID, InvalidSlot);
+}
+
+bool EntityStore::contains(Slot slot) const
+{
+    return slot < m_live.size() && m_live[slot];
+}
+
+std::size_t EntityStore::size() const
+{
+    return m_size;
+}
+
+std::size_t EntityStore::slotCount() const
+{
+    return m_live.size();
+}
+
+void EntityStore::reserve(std::size_t count)
+{
+    m_latitude.reserve(count);
+    m_longitude.reserve(count);
+    m_altitude.reserve(count);
+    m_speed.reserve(count);
+    m_radius.reserve(count);
+    m_symbol.reserve(count);
+    m_live.reserve(count);
+    m_generation.reserve(count);
+    m_dirty.reserve(count);
+    m_inserted.reserve(count);
+    m_heading.reserve(count);
+    m_fixLatitude.reserve(count);
+    m_fixLongitude.reserve(count);
+    m_fixTime.reserve(count);
+    m_latitudeRate.reserve(count);
+    m_longitudeRate.reserve(count);
+    m_modified.reserve(count);
+    m_olderChange.reserve(count);
+    m_newerChange.reserve(count);
+    m_UID.reserve(count);
+    m_name.reserve(count);
+    m_index.reserve(static_cast<int>(count));
+}
+
+QString EntityStore::name(Slot slot) const
+{
+    return m_name[slot];
+}
+
+void EntityStore::setName(Slot slot, const QString &name)
+{
+    if (m_name[slot] != name) {
+        m_name[slot] = name;
+        markDirty(slot, NameField);
+    }
+}
+
+QString EntityStore::UID(Slot slot) const
+{
+    return m_UID[slot];
+}
+
+/*!
+    \fn bool EntityStore::setUID(Slot slot, const QString &UID)
+    \brief Renames the entity in \a slot and moves its index entry.
+
+    To readers of changesSince() the old UID is removed and the new one inserted.
+*/
+bool EntityStore::setUID(Slot slot, const QString &UID)
+{
+    if (m_UID[slot] == UID) {
+        return true;
+    }
+    if (m_index.contains(UID)) {
+        return false;
+    }
+    m_index.remove(m_UID[slot]);
+    m_index.insert(UID, slot);
+    recordRemoval(m_UID[slot], InvalidSlot);
+    m_UID[slot] = UID;
+    m_inserted[slot] = m_version;
+    markDirty(slot, UIDField);
+    return true;
+}
+
+EntitySymbol EntityStore::symbol(Slot slot) const
+{
+    return static_cast<EntitySymbol>(m_symbol[slot]);
+}
+
+void EntityStore::setSymbol(Slot slot, EntitySymbol symbol)
+{
+    if (m_symbol[slot] != static_cast<std::uint8_t>(symbol)) {
+        m_symbol[slot] = static_cast<std::uint8_t>(symbol);
+        markDirty(slot, SymbolField);
+    }
+}
+
+void EntityStore::setSpeed(Slot slot, double speed)
+{
+    if (m_speed[slot] != speed) {
+        m_speed[slot] = speed;
+        refix(slot);
+        markDirty(slot, SpeedField);
+    }
+}
+
+void EntityStore::setHeading(Slot slot, double heading)
+{
+    if (m_heading[slot] != heading) {
+        m_heading[slot] = heading;
+        refix(slot);
+        markDirty(slot, HeadingField);
+    }
+}
+
+void EntityStore::setRadius(Slot slot, double radius)
+{
+    if (m_radius[slot] != radius) {
+        m_radius[slot] = radius;
+        markDirty(slot, RadiusField);
+    }
+}
+
+void EntityStore::setAltitude(Slot slot, double altitude)
+{
+    if (m_altitude[slot] != altitude) {
+        m_altitude[slot] = altitude;
+        markDirty(slot, AltitudeField);
+    }
+}
+
+void EntityStore::setLatitudeRadians(Slot slot, double latitude)
+{
+    setPosition(slot, latitude, m_longitude[slot]);
+}
+
+void EntityStore::setLongitudeRadians(Slot slot, double longitude)
+{
+    setPosition(slot, m_latitude[slot], longitude);
+}
+
+void EntityStore::setPosition(Slot slot, double latitude, double longitude)
+{
+    std::uint16_t fields = 0;
+    if (m_latitude[slot] != latitude) fields |= LatitudeField;
+    if (m_longitude[slot] != longitude) fields |= LongitudeField;
+
+    m_latitude[slot] = latitude;
+    m_longitude[slot] = longitude;
+    // Reporting the same position again is still a fix, a moving entity restarts from it
+    refix(slot);
+    if (fields == 0) return;
+
+    m_spatial.update(slot, latitude, longitude);
+    m_clusters.update(slot, latitude, longitude);
+    markDirty(slot, fields);
+}
+
+void EntityStore::refix(Slot slot)
+{
+    m_fixLatitude[slot] = m_latitude[slot];
+    m_fixLongitude[slot] = m_longitude[slot];
+    m_fixTime[slot] = m_clock;
+    kinematics::rates(m_speed[slot], m_heading[slot], m_latitude[slot], m_latitudeRate[slot], m_longitudeRate[slot]);
+}
+
+/*!
+    \fn std::size_t EntityStore::extrapolate(double maxElapsed)
+    \brief Moves every entity to where its last fix, speed and heading put it at the current clock.
+
+    The whole position columns are extrapolated in one vectorised pass. Only
+    moving entities whose position changed are then reindexed and marked dirty,
+    so stationary entities and tracks past \a maxElapsed cost little after the pass.
+    Fixes are left alone, extrapolating again from a later clock starts from them.
+*/
+std::size_t EntityStore::extrapolate(double maxElapsed)
+{
+    std::size_t count = m_live.size();
+    m_predictedLatitude.resize(count);
+    m_predictedLongitude.resize(count);
+    kinematics::extrapolate(m_fixLatitude.data(), m_fixLongitude.data(), m_fixTime.data(),
+                            m_latitudeRate.data(), m_longitudeRate.data(), m_clock, maxElapsed,
+                            m_predictedLatitude.data(), m_predictedLongitude.data(), count);
+
+    std::size_t moved = 0;
+    for (Slot slot = 0; slot < count; ++slot) {
+        // Leaves stationary entities exactly where they were put, even outside the usual ranges
+        if (m_latitudeRate[slot] == 0.0 && m_longitudeRate[slot] == 0.0) continue;
+        double latitude = m_predictedLatitude[slot];
+        double longitude = m_predictedLongitude[slot];
+        std::uint16_t fields = 0;
+        if (m_latitude[slot] != latitude) fields |= LatitudeField;
+        if (m_longitude[slot] != longitude) fields |= LongitudeField;
+        if (fields == 0 || !m_live[slot]) continue;
+
+        m_latitude[slot] = latitude;
+        m_longitude[slot] = longitude;
+        m_spatial.update(slot, latitude, longitude);
+        m_clusters.update(slot, latitude, longitude);
+        markDirty(slot, fields);
+        ++moved;
+    }
+    return moved;
+}
+
+/*!
+    \fn void EntityStore::markDirty(Slot slot, std::uint16_t fields)
+    \brief Adds \a fields to the slot's dirty mask, listing the slot for takeDirty() on its first change.
+*/
+void EntityStore::markDirty(Slot slot, std::uint16_t fields)
+{
+    if (m_dirty[slot] == 0) {
+        m_dirtySlots.push_back(slot);
+    }
+    m_dirty[slot] |= fields;
+    touch(slot);
+}
+
+void EntityStore::touch(Slot slot)
+{
+    m_modified[slot] = m_version;
+    if (m_newestChange == slot) {
+        return;
+    }
+    unlinkChanged(slot);
+    m_olderChange[slot] = m_newestChange;
+    if (m_newestChange != InvalidSlot) {
+        m_newerChange[m_newestChange] = slot;
+    } else {
+        m_oldestChange = slot;
+    }
+    m_newestChange = slot;
+}
+
+void EntityStore::unlinkChanged(Slot slot)
+{
+    Slot older = m_olderChange[slot];
+    Slot newer = m_newerChange[slot];
+    if (older != InvalidSlot) {
+        m_newerChange[older] = newer;
+    } else if (m_oldestChange == slot) {
+        m_oldestChange = newer;
+    }
+    if (newer != InvalidSlot) {
+        m_olderChange[newer] = older;
+    } else if (m_newestChange == slot) {
+        m_newestChange = older;
+    }
+    m_olderChange[slot] = InvalidSlot;
+    m_newerChange[slot] = InvalidSlot;
+}
+
+/*!
+    \fn void EntityStore::recordRemoval(const QString &UID, Slot slot)
+    \brief Remembers that \a UID went away from \a slot at the current version, forgetting the oldest removal past kMaxRemovals.
+*/
+void EntityStore::recordRemoval(const QString &UID, Slot slot)
+{
+    m_removals.push_back({m_version, UID, slot, slot == InvalidSlot ? 0 : m_generation[slot]});
+    if (m_removals.size() > kMaxRemovals) {
+        m_removalsForgotten = m_removals.front().version;
+        m_removals.pop_front();
+    }
+}
+
+/*!
+    \fn void EntityStore::updateFrom(const EntityStore &source, std::uint64_t since)
+    \brief Applies what changed in \a source after \a since to this copy of it.
+
+    Removals after \a since are applied first, since their slots may hold new
+    entities by now. Then every slot changed after \a since is copied whole, in
+    the order it last changed, so this copy's change list matches the source's.
+    Renames need no removal of their own here: copying the renamed slot moves
+    its index entry. The removal log is extended with the same entries, so a
+    copy answers changesSince() and removalsSince() like the source.
+
+    Nothing is shared with \a source, so its next write never has to detach a
+    string column or the UID index the copy still refers to.
+*/
+void EntityStore::updateFrom(const EntityStore &source, std::uint64_t since)
+{
+    if (!source.hasChangesSince(since)) {
+        *this = EntityStore();
+        since = 0;
+    }
+    if (m_spatial.cellSize() != source.m_spatial.cellSize()) {
+        m_spatial.setCellSize(source.m_spatial.cellSize(), m_latitude, m_longitude);
+    }
+
+    std::size_t count = source.slotCount();
+    m_latitude.resize(count);
+    m_longitude.resize(count);
+    m_altitude.resize(count);
+    m_speed.resize(count);
+    m_radius.resize(count);
+    m_symbol.resize(count);
+    m_live.resize(count, 0);
+    m_generation.resize(count);
+    m_inserted.resize(count);
+    m_modified.resize(count);
+    m_heading.resize(count);
+    m_olderChange.resize(count, InvalidSlot);
+    m_newerChange.resize(count, InvalidSlot);
+    m_UID.resize(count);
+    m_name.resize(count);
+
+    source.removalsSince(since, [this](const QString &, Slot slot, std::uint32_t generation) {
+        if (slot != InvalidSlot && contains(slot) && m_generation[slot] == generation) {
+            dropSlot(slot);
+        }
+    });
+
+    // The change list runs oldest to newest, find where the changes after `since` start
+    Slot oldest = InvalidSlot;
+    for (Slot slot = source.m_newestChange; slot != InvalidSlot && source.m_modified[slot] > since; slot = source.m_olderChange[slot]) {
+        oldest = slot;
+    }
+    for (Slot slot = oldest; slot != InvalidSlot; slot = source.m_newerChange[slot]) {
+        copySlot(source, slot);
+    }
+
+    auto first = std::upper_bound(source.m_removals.begin(), source.m_removals.end(), since,
+                                  [](std::uint64_t version, const Removal &removal) { return version < removal.version; });
+    m_removals.insert(m_removals.end(), first, source.m_removals.end());
+    while (m_removals.size() > kMaxRemovals) {
+        m_removals.pop_front();
+    }
+    m_removalsForgotten = source.m_removalsForgotten;
+    m_version = source.m_version;
+    m_clock = source.m_clock;
+}
+
+void EntityStore::copySlot(const EntityStore &source, Slot slot)
+{
+    if (contains(slot) && m_generation[slot] != source.m_generation[slot]) {
+        dropSlot(slot);
+    }
+    bool live = contains(slot);
+    if (!live || m_UID[slot] != source.m_UID[slot]) {
+        if (live && m_index.value(m_UID[slot], InvalidSlot) == slot) {
+            m_index.remove(m_UID[slot]);
+        }
+        m_UID[slot] = source.m_UID[slot];
+        m_index.insert(m_UID[slot], slot);
+    }
+    if (!live) {
+        ++m_size;
+    }
+
+    m_latitude[slot] = source.m_latitude[slot];
+    m_longitude[slot] = source.m_longitude[slot];
+    m_altitude[slot] = source.m_altitude[slot];
+    m_speed[slot] = source.m_speed[slot];
+    m_radius[slot] = source.m_radius[slot];
+    m_symbol[slot] = source.m_symbol[slot];
+    m_live[slot] = 1;
+    m_generation[slot] = source.m_generation[slot];
+    m_inserted[slot] = source.m_inserted[slot];
+    m_heading[slot] = source.m_heading[slot];
+    m_name[slot] = source.m_name[slot];
+    m_spatial.update(slot, m_latitude[slot], m_longitude[slot]);
+    m_clusters.update(slot, m_latitude[slot], m_longitude[slot]);
+    touch(slot);
+    m_modified[slot] = source.m_modified[slot];
+}
+
+void EntityStore::dropSlot(Slot slot)
+{
+    if (m_index.value(m_UID[slot], InvalidSlot) == slot) {
+        m_index.remove(m_UID[slot]);
+    }
+    m_spatial.remove(slot);
+    m_clusters.remove(slot);
+    unlinkChanged(slot);
+    m_UID[slot] = QString();
+    m_name[slot] = QString();
+    m_live[slot] = 0;
+    --m_size;
+}
+
+/*!
+    \fn std::vector<EntityStore::Slot> EntityStore::queryBox(double minLatitude, double minLongitude, double maxLatitude, double maxLongitude) const
+    \brief Returns the slots whose position lies inside the box, edges included.
+*/
+std::vector<EntityStore::Slot> EntityStore::queryBox(double minLatitude, double minLongitude, double maxLatitude, double maxLongitude) const
+{
+    std::vector<Slot> result;
+    auto collect = [&](double west, double east) {
+        m_spatial.visitCells(minLatitude, west, maxLatitude, east, [&](const std::vector<Slot>& cell) {
+            for (Slot slot : cell) {
+                double latitude = m_latitude[slot];
+                double longitude = m_longitude[slot];
+                if (latitude >= minLatitude && latitude <= maxLatitude && longitude >= west && longitude <= east) {
+                    result.push_back(slot);
+                }
+            }
+        });
+    };
+
+    if (minLongitude <= maxLongitude) {
+        collect(minLongitude, maxLongitude);
+    } else {
+        collect(minLongitude, M_PI);
+        collect(-M_PI, maxLongitude);
+    }
+    return result;
+}
+
+/*!
+    \fn std::vector<EntityStore::Slot> EntityStore::queryRadius(double latitude, double longitude, double metres) const
+    \brief Returns the slots within \a metres of the point by haversine distance.
+
+    Candidates come from the bounding box of the circle, which is widened to every
+    longitude when the circle reaches a pole and split when it crosses the antimeridian.
+*/
+std::vector<EntityStore::Slot> EntityStore::queryRadius(double latitude, double longitude, double metres) const
+{
+    std::vector<Slot> result;
+    if (!(metres >= 0)) return result;
+
+    double angle = metres / kEarthRadiusMetres;
+    double minLatitude = latitude - angle;
+    double maxLatitude = latitude + angle;
+    double minLongitude = -M_PI;
+    double maxLongitude = M_PI;
+    if (minLatitude > -M_PI_2 && maxLatitude < M_PI_2) {
+        double spread = std::asin(std::min(1.0, std::sin(angle) / std::cos(latitude)));
+        minLongitude = longitude - spread;
+        maxLongitude = longitude + spread;
+    }
+
+    // Compare haversine terms rather than distances to avoid an asin per candidate
+    double limit = std::sin(std::min(angle, M_PI) / 2);
+    limit *= limit;
+    double cosLatitude = std::cos(latitude);
+    auto collect = [&](double west, double east) {
+        m_spatial.visitCells(minLatitude, west, maxLatitude, east, [&](const std::vector<Slot>& cell) {
+            for (Slot slot : cell) {
+                double sinLatitude = std::sin((m_latitude[slot] - latitude) / 2);
+                double sinLongitude = std::sin((m_longitude[slot] - longitude) / 2);
+                double h = sinLatitude * sinLatitude + cosLatitude * std::cos(m_latitude[slot]) * sinLongitude * sinLongitude;
+                if (h <= limit) {
+                    result.push_back(slot);
+                }
+            }
+        });
+    };
+
+    if (minLongitude < -M_PI) {
+        collect(-M_PI, maxLongitude);
+        collect(minLongitude + 2 * M_PI, M_PI);
+    } else if (maxLongitude > M_PI) {
+        collect(minLongitude, M_PI);
+        collect(-M_PI, maxLongitude - 2 * M_PI);
+    } else {
+        collect(minLongitude, maxLongitude);
+    }
+    return result;
+}
+
+double EntityStore::spatialCellSize() const
+{
+    return m_spatial.cellSize();
+}
+
+void EntityStore::setSpatialCellSize(double radians)
+{
+    m_spatial.setCellSize(radians, m_latitude, m_longitude);
+}
+
+/*!
+    \fn std::vector<EntityStore::Cluster> EntityStore::queryClusters(double minLatitude, double minLongitude, double maxLatitude, double maxLongitude, int zoom) const
+    \brief Returns the clusters at \a zoom whose cells overlap the box.
+
+    Clusters are maintained as entities move, so this costs the number of cells
+    in view rather than the number of entities. Cells are whole, a cluster near
+    the edge of the box can count members just outside it.
+*/
+std::vector<EntityStore::Cluster> EntityStore::queryClusters(double minLatitude, double minLongitude, double maxLatitude, double maxLongitude, int zoom) const
+{
+    std::vector<Cluster> result;
+    auto collect = [&](double west, double east) {
+        m_clusters.visitCells(zoom, minLatitude, west, maxLatitude, east, [&](const ClusterIndex::Cell &cell) {
+            if (cell.member != ClusterIndex::kNoMember) {
+                result.push_back({1, m_latitude[cell.member], m_longitude[cell.member], cell.member});
+            } else {
+                result.push_back({cell.count, cell.latitude, cell.longitude, InvalidSlot});
+            }
+        });
+    };
+
+    if (minLongitude <= maxLongitude) {
+        collect(minLongitude, maxLongitude);
+    } else {
+        collect(minLongitude, M_PI);
+        collect(-M_PI, maxLongitude);
+    }
+    return result;
+}
@@ -0,0 +1,265 @@
+#ifndef ENTITYSTORE_H
+#define ENTITYSTORE_H
+
+#include <QHash>
+#include <QString>
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <vector>
+#include "ClusterIndex.h"
+#include "SnapshotPublisher.h"
+#include "SpatialIndex.h"
+
+enum EntitySymbol
+{
+    BLUE,
+    RED,
+    UNKNOWN
+};
+
+// Columnar storage for every entity EntityManager knows about. Each entity is a slot index
+// into parallel arrays, so scans over one property touch only contiguous memory. Slots are
+// also the compact handles Entity views and bulk APIs refer to entities by. Removed slots go
+// on a free list and are reused by later inserts, so the columns stop growing once track
+// churn reaches a steady state.
+//
+// Every change is stamped with the store's current version, which the owner advances each time
+// it publishes the store, so readers can ask for just what changed since a version they've seen.
+class EntityStore
+{
+public:
+    using Slot = std::uint32_t;
+    static constexpr Slot InvalidSlot = std::numeric_limits<Slot>::max();
+
+    // Removals kept for changesSince(), older ones are forgotten and readers behind them must resync
+    static constexpr std::size_t kMaxRemovals = 16384;
+
+    // Bits of the per-slot dirty mask, one per property
+    enum Field : std::uint16_t {
+        NameField = 1 << 0,
+        SymbolField = 1 << 1,
+        UIDField = 1 << 2,
+        SpeedField = 1 << 3,
+        RadiusField = 1 << 4,
+        AltitudeField = 1 << 5,
+        LatitudeField = 1 << 6,
+        LongitudeField = 1 << 7,
+        HeadingField = 1 << 8
+    };
+
+    // Returns the new slot, or InvalidSlot if the UID is already in use
+    Slot insert(const QString &name, const QString &UID, double radius, double latitude, double longitude);
+    // Frees the slot for reuse. False if it holds no entity.
+    bool remove(Slot slot);
+    Slot find(const QString &UID) const;
+    // True if the slot holds an entity, removed and never used slots don't
+    bool contains(Slot slot) const;
+    // Bumped each time the slot is reused, so a slot and generation pair names one entity for good
+    std::uint32_t generation(Slot slot) const { return m_generation[slot]; }
+    // Live entities
+    std::size_t size() const;
+    // Length of every column, live or free. Iterate slots below this and skip those !contains().
+    std::size_t slotCount() const;
+    void reserve(std::size_t count);
+
+    QString name(Slot slot) const;
+    void setName(Slot slot, const QString &name);
+    QString UID(Slot slot) const;
+    // False if another entity already has the UID, leaving the slot unchanged
+    bool setUID(Slot slot, const QString &UID);
+    EntitySymbol symbol(Slot slot) const;
+    void setSymbol(Slot slot, EntitySymbol symbol);
+
+    double speed(Slot slot) const { return m_speed[slot]; }
+    double radius(Slot slot) const { return m_radius[slot]; }
+    double altitude(Slot slot) const { return m_altitude[slot]; }
+    double latitudeRadians(Slot slot) const { return m_latitude[slot]; }
+    double longitudeRadians(Slot slot) const { return m_longitude[slot]; }
+    // Radians clockwise from true north
+    double heading(Slot slot) const { return m_heading[slot]; }
+    // Setters only mark the slot dirty when the value actually changes
+    void setRadius(Slot slot, double radius);
+    void setAltitude(Slot slot, double altitude);
+    // Speed in metres per second. Speed and heading changes take effect from the current position.
+    void setSpeed(Slot slot, double speed);
+    void setHeading(Slot slot, double heading);
+    // Position setters record a new fix at the current clock and keep the spatial index current
+    void setLatitudeRadians(Slot slot, double latitude);
+    void setLongitudeRadians(Slot slot, double longitude);
+    void setPosition(Slot slot, double latitude, double longitude);
+
+    // Slots inside the box, all in radians. A box with minLongitude > maxLongitude crosses the antimeridian.
+    std::vector<Slot> queryBox(double minLatitude, double minLongitude, double maxLatitude, double maxLongitude) const;
+    // Slots within `metres` great-circle distance of the point
+    std::vector<Slot> queryRadius(double latitude, double longitude, double metres) const;
+    double spatialCellSize() const;
+    void setSpatialCellSize(double radians);
+
+    // Entities grouped by a grid of ClusterIndex::kCellPixels screen cells at a map zoom
+    struct Cluster {
+        std::uint32_t count;
+        // Mean position, or the member's own position in a cluster of one
+        double latitude;
+        double longitude;
+        // The only entity in a cluster of one, InvalidSlot otherwise
+        Slot member;
+    };
+    // Clusters at `zoom` overlapping the box, in radians. A box with minLongitude > maxLongitude crosses the antimeridian.
+    std::vector<Cluster> queryClusters(double minLatitude, double minLongitude, double maxLatitude, double maxLongitude, int zoom) const;
+
+    // Seconds on the owner's clock, the time new fixes are stamped with
+    double clock() const { return m_clock; }
+    void setClock(double seconds) { m_clock = seconds; }
+    // Dead reckons every entity from its last fix to the current clock, extrapolating at most
+    // `maxElapsed` seconds past a fix. Returns how many entities moved.
+    std::size_t extrapolate(double maxElapsed);
+
+    // Calls `visit(Slot, std::uint16_t fields)` once for every live slot changed since the
+    // last call, with the Field bits that changed, and clears them. Changes made from inside
+    // `visit` are kept for the next call.
+    template <typename Visit>
+    void takeDirty(Visit visit);
+    bool hasDirty() const { return !m_dirtySlots.empty(); }
+
+    // The version changes are currently stamped with, starting at 1
+    std::uint64_t version() const { return m_version; }
+    // Stamps later changes with the next version. Call after publishing the current one.
+    void advanceVersion() { ++m_version; }
+    // Version the slot's entity was inserted at, or got its current UID at
+    std::uint64_t insertedVersion(Slot slot) const { return m_inserted[slot]; }
+    // Version of the slot's last change
+    std::uint64_t modifiedVersion(Slot slot) const { return m_modified[slot]; }
+    // False if removals after `version` have been forgotten, so changesSince() would miss some
+    bool hasChangesSince(std::uint64_t version) const { return version >= m_removalsForgotten && version <= m_version; }
+    // Calls `visit(Slot)` for every live slot changed after `version`, most recent first.
+    // Costs the number of changes, not the number of entities.
+    template <typename Visit>
+    void changesSince(std::uint64_t version, Visit visit) const;
+    // Calls `visit(const QString &UID, Slot, std::uint32_t generation)` for every removal after
+    // `version`, oldest first. A renamed entity's old UID is reported with InvalidSlot.
+    template <typename Visit>
+    void removalsSince(std::uint64_t version, Visit visit) const;
+
+    // Brings a read-only copy of `source`, last brought up to date at source version `since`, to
+    // source's current version. Only slots changed and removed after `since` are copied, along with
+    // their index entries, so the cost follows the number of changes. A copy that's still empty is
+    // brought up from 0, one too far behind for the removals source remembers is rebuilt. Copies
+    // only answer reads: the dead reckoning and dirty tracking columns are left empty.
+    void updateFrom(const EntityStore &source, std::uint64_t since);
+
+    // Whole columns for bulk scans, indexed by slot
+    const std::vector<double>& latitudes() const { return m_latitude; }
+    const std::vector<double>& longitudes() const { return m_longitude; }
+    const std::vector<double>& altitudes() const { return m_altitude; }
+    const std::vector<double>& speeds() const { return m_speed; }
+    const std::vector<double>& radii() const { return m_radius; }
+    const std::vector<std::uint8_t>& symbols() const { return m_symbol; }
+
+private:
+    struct Removal {
+        std::uint64_t version;
+        QString UID;
+        Slot slot;
+        std::uint32_t generation;
+    };
+
+    void markDirty(Slot slot, std::uint16_t fields);
+    // Stamps the slot with the current version and moves it to the recent end of the change list
+    void touch(Slot slot);
+    void unlinkChanged(Slot slot);
+    void recordRemoval(const QString &UID, Slot slot);
+    // Makes the slot's current position its fix and works out its rates again
+    void refix(Slot slot);
+    // updateFrom() helpers, for copies only
+    void copySlot(const EntityStore &source, Slot slot);
+    void dropSlot(Slot slot);
+
+    // Hot numeric columns
+    std::vector<double> m_latitude;
+    std::vector<double> m_longitude;
+    std::vector<double> m_altitude;
+    std::vector<double> m_speed;
+    std::vector<double> m_radius;
+    std::vector<std::uint8_t> m_symbol;
+    std::vector<std::uint8_t> m_live;
+    std::vector<std::uint32_t> m_generation;
+    std::vector<std::uint16_t> m_dirty;
+    std::vector<Slot> m_dirtySlots;
+    std::vector<Slot> m_flushing;
+    std::vector<Slot> m_freeSlots;
+    std::size_t m_size = 0;
+    SpatialIndex m_spatial;
+    ClusterIndex m_clusters;
+
+    // Dead reckoning, see Kinematics.h
+    double m_clock = 0.0;
+    std::vector<double> m_heading;
+    std::vector<double> m_fixLatitude;
+    std::vector<double> m_fixLongitude;
+    std::vector<double> m_fixTime;
+    std::vector<double> m_latitudeRate;
+    std::vector<double> m_longitudeRate;
+    std::vector<double> m_predictedLatitude;
+    std::vector<double> m_predictedLongitude;
+
+    // Change tracking. Live slots form a doubly linked list ordered by modified version.
+    std::uint64_t m_version = 1;
+    std::vector<std::uint64_t> m_inserted;
+    std::vector<std::uint64_t> m_modified;
+    std::vector<Slot> m_olderChange;
+    std::vector<Slot> m_newerChange;
+    Slot m_oldestChange = InvalidSlot;
+    Slot m_newestChange = InvalidSlot;
+    std::deque<Removal> m_removals;
+    std::uint64_t m_removalsForgotten = 0;
+
+    // Cold columns, only read when an entity is looked up or listed
+    std::vector<QString> m_UID;
+    std::vector<QString> m_name;
+    QHash<QString, Slot> m_index;
+};
+
+template <typename Visit>
+void EntityStore::takeDirty(Visit visit)
+{
+    m_flushing.swap(m_dirtySlots);
+    for (Slot slot : m_flushing) {
+        std::uint16_t fields = m_dirty[slot];
+        m_dirty[slot] = 0;
+        // Slots are listed once per clean-to-dirty transition, so a removed and reused slot can appear twice
+        if (fields != 0 && contains(slot)) {
+            visit(slot, fields);
+        }
+    }
+    m_flushing.clear();
+}
+
+template <typename Visit>
+void EntityStore::changesSince(std::uint64_t version, Visit visit) const
+{
+    for (Slot slot = m_newestChange; slot != InvalidSlot && m_modified[slot] > version; slot = m_olderChange[slot]) {
+        visit(slot);
+    }
+}
+
+template <typename Visit>
+void EntityStore::removalsSince(std::uint64_t version, Visit visit) const
+{
+    auto first = std::upper_bound(m_removals.begin(), m_removals.end(), version,
+                                  [](std::uint64_t since, const Removal &removal) { return since < removal.version; });
+    for (auto it = first; it != m_removals.end(); ++it) {
+        visit(it->UID, it->slot, it->generation);
+    }
+}
+
+// One published state of the store, see EntityManager
+struct EntitySnapshot {
+    std::uint64_t version = 0;
+    EntityStore store;
+};
+
+using EntitySnapshotHandle = SnapshotPublisher<EntitySnapshot>::Handle;
+
+#endif // ENTITYSTORE_H
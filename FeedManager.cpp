@@ -0,0 +1,124 @@
+#include "FeedManager.h"
+#include <stdexcept>
+
+/*!
+    \class FeedManager
+    \brief Ingests PE and Emitter records from several upstream connections at once.
+
+    Every feed is a NetworkImplementation on one shared io_context, run by a
+    small fixed pool of threads, so adding a feed adds a socket and a pending
+    read rather than a thread. Each feed keeps its own frame reader, decoder
+    and counters. Decoded records are pushed onto one lock-free queue from
+    whichever io thread decoded them, and poll() drains it on the consumer's
+    thread as a single stream: records from one feed keep their arrival order,
+    and every record gets a sequence number in the order it was merged.
+*/
+
+/*!
+    \fn FeedManager::FeedManager(std::size_t ioThreads)
+    \brief Starts \a ioThreads threads running the shared io_context.
+*/
+FeedManager::FeedManager(std::size_t ioThreads)
+    : m_work(boost::asio::make_work_guard(m_context)), m_nextSequence(0) {
+    if (ioThreads == 0) ioThreads = 1;
+    for (std::size_t i = 0; i < ioThreads; ++i) {
+        m_threads.emplace_back([this] { m_context.run(); });
+    }
+}
+
+FeedManager::~FeedManager() {
+    stop();
+}
+
+/*!
+    \fn std::size_t FeedManager::addFeed(const std::string& address, unsigned short port, wire::WireFormat format)
+    \brief Connects to a feed and starts merging its records.
+    \param address The IP address of the feed.
+    \param port The port of the feed.
+    \param format The framing to negotiate before receiving starts.
+    \return The index of the feed, used in FeedRecord::feed and stats().
+
+    Must be called from the consumer thread, not concurrently with poll().
+*/
+std::size_t FeedManager::addFeed(const std::string& address, unsigned short port, wire::WireFormat format) {
+    auto feed = std::make_unique<Feed>(m_context);
+    feed->address = address;
+    feed->port = port;
+    feed->network.initialise(address, port);
+    if (format != wire::WireFormat::Json && !feed->network.negotiateWireFormat(format)) {
+        feed->network.close();
+        throw std::runtime_error("Feed " + address + ":" + std::to_string(port) + " declined wire format "
+                                 + wire::formatName(format));
+    }
+
+    std::size_t index = m_feeds.size();
+    Feed* raw = feed.get();
+    ReceiveHandlers handlers;
+    handlers.onPE = [this, raw, index](const PE& pe) {
+        raw->pes.fetch_add(1, std::memory_order_relaxed);
+        m_arrivals.push(Arrival{index, std::chrono::steady_clock::now(), pe});
+    };
+    handlers.onEmitter = [this, raw, index](const Emitter& emitter) {
+        raw->emitters.fetch_add(1, std::memory_order_relaxed);
+        m_arrivals.push(Arrival{index, std::chrono::steady_clock::now(), emitter});
+    };
+    handlers.onError = [raw](const std::string&) {
+        raw->errors.fetch_add(1, std::memory_order_relaxed);
+    };
+
+    m_feeds.push_back(std::move(feed));
+    raw->open = true;
+    raw->network.startReceiving(handlers);
+    return index;
+}
+
+std::size_t FeedManager::feedCount() const {
+    return m_feeds.size();
+}
+
+/*!
+    \fn std::size_t FeedManager::poll(std::vector<FeedRecord>& out, std::size_t maxRecords)
+    \brief Appends up to \a maxRecords merged records to \a out without blocking.
+    \return The number of records appended.
+*/
+std::size_t FeedManager::poll(std::vector<FeedRecord>& out, std::size_t maxRecords) {
+    std::size_t count = 0;
+    while (count < maxRecords) {
+        std::optional<Arrival> arrival = m_arrivals.pop();
+        if (!arrival) break;
+        out.push_back(FeedRecord{m_nextSequence++, arrival->feed, arrival->received, std::move(arrival->record)});
+        ++count;
+    }
+    return count;
+}
+
+/*!
+    \fn std::vector<FeedStats> FeedManager::stats() const
+    \brief Returns the per-feed counters, indexed like the feeds.
+*/
+std::vector<FeedStats> FeedManager::stats() const {
+    std::vector<FeedStats> result;
+    result.reserve(m_feeds.size());
+    for (const auto& feed : m_feeds) {
+        result.push_back(FeedStats{feed->address, feed->port,
+                                   feed->pes.load(std::memory_order_relaxed),
+                                   feed->emitters.load(std::memory_order_relaxed),
+                                   feed->errors.load(std::memory_order_relaxed)});
+    }
+    return result;
+}
+
+/*!
+    \fn void FeedManager::stop()
+    \brief Closes every feed, then lets the io threads finish and joins them.
+*/
+void FeedManager::stop() {
+    for (auto& feed : m_feeds) {
+        if (feed->open.exchange(false)) feed->network.close();
+    }
+    m_work.reset();
+    for (std::thread& thread : m_threads) {
+        if (thread.joinable()) thread.join();
+    }
+    m_threads.clear();
+}
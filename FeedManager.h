@@ -0,0 +1,79 @@
+#ifndef FEEDMANAGER_H
+#define FEEDMANAGER_H
+
+#include <boost/asio.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <variant>
+#include <vector>
+#include "AbstractNetworkInterface.h"
+#include "MpscQueue.h"
+
+// A decoded record from one upstream feed, in merged stream order
+struct FeedRecord {
+    std::uint64_t sequence;
+    std::size_t feed;
+    std::chrono::steady_clock::time_point received;
+    std::variant<PE, Emitter> record;
+};
+
+struct FeedStats {
+    std::string address;
+    unsigned short port;
+    std::uint64_t pes;
+    std::uint64_t emitters;
+    std::uint64_t errors;
+};
+
+// Receives from many upstream connections over one io_context and merges their records
+class FeedManager {
+public:
+    explicit FeedManager(std::size_t ioThreads = 2);
+    ~FeedManager();
+
+    FeedManager(const FeedManager&) = delete;
+    FeedManager& operator=(const FeedManager&) = delete;
+
+    // Connects, negotiates the framing and starts receiving, returns the feed index. Throws if the connection fails.
+    std::size_t addFeed(const std::string& address, unsigned short port, wire::WireFormat format = wire::WireFormat::Json);
+    std::size_t feedCount() const;
+
+    // Moves up to maxRecords merged records into out, returns how many. Single consumer only.
+    std::size_t poll(std::vector<FeedRecord>& out, std::size_t maxRecords = SIZE_MAX);
+
+    std::vector<FeedStats> stats() const;
+
+    // Stops every feed and the io threads, pending records can still be polled
+    void stop();
+
+private:
+    struct Feed {
+        explicit Feed(boost::asio::io_context& context) : network(context) {}
+        NetworkImplementation network;
+        std::string address;
+        unsigned short port = 0;
+        std::atomic<std::uint64_t> pes{0};
+        std::atomic<std::uint64_t> emitters{0};
+        std::atomic<std::uint64_t> errors{0};
+        std::atomic<bool> open{false};
+    };
+
+    struct Arrival {
+        std::size_t feed;
+        std::chrono::steady_clock::time_point received;
+        std::variant<PE, Emitter> record;
+    };
+
+    boost::asio::io_context m_context;
+    boost::asio::executor_work_guard<boost::asio::io_context::executor_type> m_work;
+    std::vector<std::thread> m_threads;
+    std::vector<std::unique_ptr<Feed>> m_feeds;
+    MpscQueue<Arrival> m_arrivals;
+    std::uint64_t m_nextSequence;
+};
+
+#endif // FEEDMANAGER_H
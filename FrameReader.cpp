@@ -0,0 +1,113 @@
+#include "FrameReader.h"
+#include <cstring>
+#include <stdexcept>
+
+/*!
+    \class FrameReader
+    \brief Connection-lifetime receive buffer that yields every complete frame from each read.
+
+    Bytes are read into one reusable buffer. After each read all complete frames
+    (JSON lines or binary frames, depending on the format) can be taken out as
+    string_view slices of that buffer. A trailing partial frame stays buffered and
+    is moved to the front of the buffer before the next read, so nothing that
+    arrived in the same segment is lost and steady state reads never allocate.
+*/
+
+FrameReader::FrameReader(std::size_t capacity)
+    : m_buffer(capacity), m_format(wire::WireFormat::Json),
+      m_begin(0), m_end(0), m_scanned(0), m_peekedSize(0) {}
+
+void FrameReader::setFormat(wire::WireFormat format) {
+    m_format = format;
+    m_scanned = 0;
+    m_peekedSize = 0;
+}
+
+wire::WireFormat FrameReader::format() const {
+    return m_format;
+}
+
+/*!
+    \fn boost::asio::mutable_buffer FrameReader::prepare()
+    \brief Returns the free space after the buffered bytes.
+
+    If the buffer tail is exhausted, unconsumed bytes are moved to the front. The
+    buffer only grows when a single frame is larger than its capacity.
+*/
+boost::asio::mutable_buffer FrameReader::prepare() {
+    m_peekedSize = 0;
+    if (m_end == m_buffer.size()) {
+        if (m_begin > 0) {
+            std::memmove(m_buffer.data(), m_buffer.data() + m_begin, m_end - m_begin);
+            m_end -= m_begin;
+            m_begin = 0;
+        } else {
+            if (m_buffer.size() >= wire::kHeaderSize + wire::kMaxPayloadSize) {
+                throw std::runtime_error("Frame exceeds maximum size");
+            }
+            m_buffer.resize(m_buffer.size() * 2);
+        }
+    }
+    return boost::asio::buffer(m_buffer.data() + m_end, m_buffer.size() - m_end);
+}
+
+void FrameReader::commit(std::size_t bytes) {
+    m_end += bytes;
+}
+
+bool FrameReader::peek(Frame& frame) {
+    const char* data = m_buffer.data() + m_begin;
+    std::size_t available = m_end - m_begin;
+
+    if (m_format == wire::WireFormat::Binary) {
+        if (available < wire::kHeaderSize) return false;
+        wire::FrameHeader header;
+        if (!wire::parseHeader(data, header)) {
+            throw std::runtime_error("Invalid binary frame header");
+        }
+        std::size_t frameSize = wire::kHeaderSize + header.length;
+        if (available < frameSize) return false;
+        frame.type = header.type;
+        frame.payload = std::string_view(data + wire::kHeaderSize, header.length);
+        m_peekedSize = frameSize;
+        return true;
+    }
+
+    const void* newline = std::memchr(data + m_scanned, '\n', available - m_scanned);
+    if (!newline) {
+        m_scanned = available;
+        return false;
+    }
+    std::size_t length = static_cast<const char*>(newline) - data;
+    frame.type = wire::FrameType::Text;
+    frame.payload = std::string_view(data, length);
+    m_peekedSize = length + 1;
+    return true;
+}
+
+void FrameReader::pop() {
+    m_begin += m_peekedSize;
+    m_scanned = 0;
+    m_peekedSize = 0;
+    if (m_begin == m_end) {
+        m_begin = 0;
+        m_end = 0;
+    }
+}
+
+bool FrameReader::next(Frame& frame) {
+    if (!peek(frame)) return false;
+    pop();
+    return true;
+}
+
+std::size_t FrameReader::buffered() const {
+    return m_end - m_begin;
+}
+
+void FrameReader::reset() {
+    m_begin = 0;
+    m_end = 0;
+    m_scanned = 0;
+    m_peekedSize = 0;
+}
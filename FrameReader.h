@@ -0,0 +1,55 @@
+#ifndef FRAMEREADER_H
+#define FRAMEREADER_H
+
+#include <boost/asio/buffer.hpp>
+#include <cstddef>
+#include <string_view>
+#include <vector>
+#include "WireProtocol.h"
+
+// Splits a byte stream into complete frames without copying them out of the receive buffer
+class FrameReader {
+public:
+    struct Frame {
+        wire::FrameType type;     // Always Text for JSON lines
+        std::string_view payload; // Line without '\n', or binary payload without header
+    };
+
+    explicit FrameReader(std::size_t capacity = 64 * 1024);
+
+    void setFormat(wire::WireFormat format);
+    wire::WireFormat format() const;
+
+    // Writable space for the next read, carried-over bytes are moved to the front first.
+    // Invalidates every payload view handed out so far.
+    boost::asio::mutable_buffer prepare();
+    void commit(std::size_t bytes);
+
+    // Looks at the next complete frame without consuming it, false if only a partial frame is buffered
+    bool peek(Frame& frame);
+    // Consumes the frame returned by the last successful peek()
+    void pop();
+    // peek() followed by pop()
+    bool next(Frame& frame);
+
+    // Performs one read_some on the stream into the buffer
+    template <typename SyncReadStream>
+    std::size_t readSome(SyncReadStream& stream) {
+        std::size_t bytes = stream.read_some(prepare());
+        commit(bytes);
+        return bytes;
+    }
+
+    std::size_t buffered() const;
+    void reset();
+
+private:
+    std::vector<char> m_buffer;
+    wire::WireFormat m_format;
+    std::size_t m_begin;       // First unconsumed byte
+    std::size_t m_end;         // One past the last received byte
+    std::size_t m_scanned;     // Bytes after m_begin already searched for '\n'
+    std::size_t m_peekedSize;  // Bytes consumed by pop(), 0 when nothing is peeked
+};
+
+#endif // FRAMEREADER_H
@@ -0,0 +1,468 @@
+#include "Geodesy.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include "Kinematics.h"
+
+#if defined(__AVX__) || defined(__SSE2__) || defined(_M_X64)
+#include <immintrin.h>
+#define GEODESY_SSE2
+#endif
+
+namespace geodesy {
+
+namespace {
+
+using kinematics::kEarthRadiusMetres;
+
+constexpr double kTwoPi = 2 * M_PI;
+constexpr double kEccentricitySquared = kFlattening * (2 - kFlattening);
+constexpr double kSemiMinorAxisMetres = kSemiMajorAxisMetres * (1 - kFlattening);
+
+// Vincenty stops once successive longitude estimates agree to this, about 0.06 mm
+constexpr double kVincentyTolerance = 1e-12;
+constexpr int kVincentyMaxIterations = 200;
+
+/*
+    Each kernel below is a template over a lane type, so it is written once and
+    runs on four doubles with AVX, two with SSE2 and one with Scalar. Comparisons
+    return masks with every bit set where true, which select() chooses by.
+*/
+struct Scalar {
+    static constexpr std::size_t kWidth = 1;
+    double v;
+    static Scalar load(const double *p) { return {*p}; }
+    static Scalar set(double x) { return {x}; }
+    void store(double *p) const { *p = v; }
+};
+
+inline Scalar operator+(Scalar a, Scalar b) { return {a.v + b.v}; }
+inline Scalar operator-(Scalar a, Scalar b) { return {a.v - b.v}; }
+inline Scalar operator*(Scalar a, Scalar b) { return {a.v * b.v}; }
+inline Scalar operator/(Scalar a, Scalar b) { return {a.v / b.v}; }
+inline Scalar operator-(Scalar a) { return {-a.v}; }
+inline Scalar sqrt(Scalar a) { return {std::sqrt(a.v)}; }
+inline Scalar abs(Scalar a) { return {std::fabs(a.v)}; }
+inline Scalar truncate(Scalar a) { return {std::trunc(a.v)}; }
+inline Scalar min(Scalar a, Scalar b) { return {std::min(a.v, b.v)}; }
+inline Scalar max(Scalar a, Scalar b) { return {std::max(a.v, b.v)}; }
+inline Scalar mask(bool condition)
+{
+    std::uint64_t bits = condition ? ~std::uint64_t(0) : 0;
+    Scalar result;
+    std::memcpy(&result.v, &bits, sizeof(bits));
+    return result;
+}
+inline Scalar operator<(Scalar a, Scalar b) { return mask(a.v < b.v); }
+inline Scalar operator>(Scalar a, Scalar b) { return mask(a.v > b.v); }
+inline Scalar operator==(Scalar a, Scalar b) { return mask(a.v == b.v); }
+inline Scalar select(Scalar condition, Scalar a, Scalar b)
+{
+    std::uint64_t bits;
+    std::memcpy(&bits, &condition.v, sizeof(bits));
+    return bits ? a : b;
+}
+
+#if defined(__AVX__)
+struct Lanes {
+    static constexpr std::size_t kWidth = 4;
+    __m256d v;
+    static Lanes load(const double *p) { return {_mm256_loadu_pd(p)}; }
+    static Lanes set(double x) { return {_mm256_set1_pd(x)}; }
+    void store(double *p) const { _mm256_storeu_pd(p, v); }
+};
+
+inline Lanes operator+(Lanes a, Lanes b) { return {_mm256_add_pd(a.v, b.v)}; }
+inline Lanes operator-(Lanes a, Lanes b) { return {_mm256_sub_pd(a.v, b.v)}; }
+inline Lanes operator*(Lanes a, Lanes b) { return {_mm256_mul_pd(a.v, b.v)}; }
+inline Lanes operator/(Lanes a, Lanes b) { return {_mm256_div_pd(a.v, b.v)}; }
+inline Lanes operator-(Lanes a) { return {_mm256_xor_pd(a.v, _mm256_set1_pd(-0.0))}; }
+inline Lanes sqrt(Lanes a) { return {_mm256_sqrt_pd(a.v)}; }
+inline Lanes abs(Lanes a) { return {_mm256_andnot_pd(_mm256_set1_pd(-0.0), a.v)}; }
+inline Lanes truncate(Lanes a) { return {_mm256_round_pd(a.v, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC)}; }
+inline Lanes min(Lanes a, Lanes b) { return {_mm256_min_pd(a.v, b.v)}; }
+inline Lanes max(Lanes a, Lanes b) { return {_mm256_max_pd(a.v, b.v)}; }
+inline Lanes operator<(Lanes a, Lanes b) { return {_mm256_cmp_pd(a.v, b.v, _CMP_LT_OQ)}; }
+inline Lanes operator>(Lanes a, Lanes b) { return {_mm256_cmp_pd(a.v, b.v, _CMP_GT_OQ)}; }
+inline Lanes operator==(Lanes a, Lanes b) { return {_mm256_cmp_pd(a.v, b.v, _CMP_EQ_OQ)}; }
+// Masking rather than blendv, which some compilers lower lane by lane without AVX2
+inline Lanes select(Lanes condition, Lanes a, Lanes b)
+{
+    return {_mm256_or_pd(_mm256_and_pd(condition.v, a.v), _mm256_andnot_pd(condition.v, b.v))};
+}
+#elif defined(GEODESY_SSE2)
+struct Lanes {
+    static constexpr std::size_t kWidth = 2;
+    __m128d v;
+    static Lanes load(const double *p) { return {_mm_loadu_pd(p)}; }
+    static Lanes set(double x) { return {_mm_set1_pd(x)}; }
+    void store(double *p) const { _mm_storeu_pd(p, v); }
+};
+
+inline Lanes operator+(Lanes a, Lanes b) { return {_mm_add_pd(a.v, b.v)}; }
+inline Lanes operator-(Lanes a, Lanes b) { return {_mm_sub_pd(a.v, b.v)}; }
+inline Lanes operator*(Lanes a, Lanes b) { return {_mm_mul_pd(a.v, b.v)}; }
+inline Lanes operator/(Lanes a, Lanes b) { return {_mm_div_pd(a.v, b.v)}; }
+inline Lanes operator-(Lanes a) { return {_mm_xor_pd(a.v, _mm_set1_pd(-0.0))}; }
+inline Lanes sqrt(Lanes a) { return {_mm_sqrt_pd(a.v)}; }
+inline Lanes abs(Lanes a) { return {_mm_andnot_pd(_mm_set1_pd(-0.0), a.v)}; }
+inline Lanes min(Lanes a, Lanes b) { return {_mm_min_pd(a.v, b.v)}; }
+inline Lanes max(Lanes a, Lanes b) { return {_mm_max_pd(a.v, b.v)}; }
+inline Lanes operator<(Lanes a, Lanes b) { return {_mm_cmplt_pd(a.v, b.v)}; }
+inline Lanes operator>(Lanes a, Lanes b) { return {_mm_cmpgt_pd(a.v, b.v)}; }
+inline Lanes operator==(Lanes a, Lanes b) { return {_mm_cmpeq_pd(a.v, b.v)}; }
+inline Lanes select(Lanes condition, Lanes a, Lanes b)
+{
+    return {_mm_or_pd(_mm_and_pd(condition.v, a.v), _mm_andnot_pd(condition.v, b.v))};
+}
+// SSE2 has no rounding instruction. Adding and subtracting 2^52 rounds to an integer,
+// then anything rounded away from zero is stepped back. Exact for magnitudes below 2^51.
+inline Lanes truncate(Lanes a)
+{
+    const __m128d magic = _mm_set1_pd(4503599627370496.0);
+    __m128d sign = _mm_and_pd(a.v, _mm_set1_pd(-0.0));
+    __m128d magnitude = _mm_andnot_pd(sign, a.v);
+    __m128d rounded = _mm_sub_pd(_mm_add_pd(magnitude, magic), magic);
+    __m128d tooHigh = _mm_cmpgt_pd(rounded, magnitude);
+    rounded = _mm_sub_pd(rounded, _mm_and_pd(tooHigh, _mm_set1_pd(1.0)));
+    return {_mm_or_pd(rounded, sign)};
+}
+#endif
+
+template <typename V>
+V floorOf(V x)
+{
+    V truncated = truncate(x);
+    return truncated - select(truncated > x, V::set(1.0), V::set(0.0));
+}
+
+template <typename V, std::size_t N>
+V polynomial(V x, const double (&coefficients)[N])
+{
+    V result = V::set(coefficients[0]);
+    for (std::size_t i = 1; i < N; ++i) {
+        result = result * x + V::set(coefficients[i]);
+    }
+    return result;
+}
+
+/*
+    Sine and cosine together, after Cephes: the argument is reduced to
+    [-pi/4, pi/4] by the nearest even multiple of pi/4, subtracted in three
+    parts to keep the bits a single pi/4 would lose, then evaluated with
+    minimax polynomials. Accurate for any coordinate, degrading only past 1e9.
+*/
+template <typename V>
+void sinCos(V x, V &sine, V &cosine)
+{
+    static const double sinCoefficients[] = {
+        1.58962301576546568060e-10, -2.50507477628578072866e-8, 2.75573136213857245213e-6,
+        -1.98412698295895385996e-4, 8.33333333332211858878e-3, -1.66666666666666307295e-1};
+    static const double cosCoefficients[] = {
+        -1.13585365213876817300e-11, 2.08757008419747316778e-9, -2.75573141792967388112e-7,
+        2.48015872888517045348e-5, -1.38888888888730564116e-3, 4.16666666666665929218e-2};
+
+    V magnitude = abs(x);
+    V octant = truncate(magnitude * V::set(4 / M_PI));
+    octant = octant + (octant - V::set(2.0) * truncate(octant * V::set(0.5)));
+    V reduced = ((magnitude - octant * V::set(7.85398125648498535156e-1))
+                 - octant * V::set(3.77489470793079817668e-8))
+                - octant * V::set(2.69515142907905952645e-15);
+    octant = octant - V::set(8.0) * truncate(octant * V::set(0.125));
+
+    V squared = reduced * reduced;
+    V sinPart = reduced + reduced * squared * polynomial(squared, sinCoefficients);
+    V cosPart = V::set(1.0) - V::set(0.5) * squared + squared * squared * polynomial(squared, cosCoefficients);
+
+    // Octants 2 and 6 are a quarter turn on, where sine and cosine trade places
+    V swapped = (octant - V::set(4.0) * truncate(octant * V::set(0.25))) == V::set(2.0);
+    V secondHalf = octant > V::set(3.0);
+    sine = select(swapped, cosPart, sinPart);
+    sine = select(secondHalf, -sine, sine);
+    sine = select(x < V::set(0.0), -sine, sine);
+    cosine = select(swapped, sinPart, cosPart);
+    cosine = select(secondHalf, -cosine, cosine);
+    cosine = select(swapped, -cosine, cosine);
+}
+
+// Arctangent of t in [0, 1], Cephes' rational approximation
+template <typename V>
+V atanUnit(V t)
+{
+    static const double p[] = {
+        -8.750608600031904122785e-1, -1.615753718733365076637e1, -7.500855792314704667340e1,
+        -1.228866684490136173410e2, -6.485021904942025371773e1};
+    static const double q[] = {
+        1.0, 2.485846490142306297962e1, 1.650270098316988542046e2, 4.328810604912902668951e2,
+        4.853903996359136964868e2, 1.945506571482613964425e2};
+    // Bits of pi/4 beyond a double
+    const double moreBits = 6.123233995736765886130e-17;
+
+    V high = t > V::set(0.66);
+    V x = select(high, (t - V::set(1.0)) / (t + V::set(1.0)), t);
+    V squared = x * x;
+    V result = x + x * (squared * polynomial(squared, p) / polynomial(squared, q));
+    return result + select(high, V::set(M_PI_4 + 0.5 * moreBits), V::set(0.0));
+}
+
+template <typename V>
+V atan2Of(V y, V x)
+{
+    V absX = abs(x);
+    V absY = abs(y);
+    V larger = max(absX, absY);
+    V ratio = select(larger == V::set(0.0), V::set(0.0), min(absX, absY) / larger);
+    V angle = atanUnit(ratio);
+    angle = select(absY > absX, V::set(M_PI_2) - angle, angle);
+    angle = select(x < V::set(0.0), V::set(M_PI) - angle, angle);
+    return select(y < V::set(0.0), -angle, angle);
+}
+
+template <typename V>
+V asinOf(V x)
+{
+    return atan2Of(x, sqrt((V::set(1.0) - x) * (V::set(1.0) + x)));
+}
+
+template <typename V>
+std::size_t haversineLanes(const double *latitude1, const double *longitude1, const double *latitude2, const double *longitude2,
+                           double *metres, std::size_t i, std::size_t count)
+{
+    for (; i + V::kWidth <= count; i += V::kWidth) {
+        V lat1 = V::load(latitude1 + i);
+        V lat2 = V::load(latitude2 + i);
+        V sinHalfLatitude, sinHalfLongitude, cosLatitude1, cosLatitude2, unused;
+        sinCos((lat2 - lat1) * V::set(0.5), sinHalfLatitude, unused);
+        sinCos((V::load(longitude2 + i) - V::load(longitude1 + i)) * V::set(0.5), sinHalfLongitude, unused);
+        sinCos(lat1, unused, cosLatitude1);
+        sinCos(lat2, unused, cosLatitude2);
+
+        V h = sinHalfLatitude * sinHalfLatitude + cosLatitude1 * cosLatitude2 * sinHalfLongitude * sinHalfLongitude;
+        h = min(V::set(1.0), h);
+        V angle = V::set(2.0) * atan2Of(sqrt(h), sqrt(V::set(1.0) - h));
+        (angle * V::set(kEarthRadiusMetres)).store(metres + i);
+    }
+    return i;
+}
+
+template <typename V>
+std::size_t bearingLanes(const double *latitude1, const double *longitude1, const double *latitude2, const double *longitude2,
+                         double *bearing, std::size_t i, std::size_t count)
+{
+    for (; i + V::kWidth <= count; i += V::kWidth) {
+        V sinLatitude1, cosLatitude1, sinLatitude2, cosLatitude2, sinDelta, cosDelta;
+        sinCos(V::load(latitude1 + i), sinLatitude1, cosLatitude1);
+        sinCos(V::load(latitude2 + i), sinLatitude2, cosLatitude2);
+        sinCos(V::load(longitude2 + i) - V::load(longitude1 + i), sinDelta, cosDelta);
+
+        V angle = atan2Of(sinDelta * cosLatitude2, cosLatitude1 * sinLatitude2 - sinLatitude1 * cosLatitude2 * cosDelta);
+        angle = select(angle < V::set(0.0), angle + V::set(kTwoPi), angle);
+        angle.store(bearing + i);
+    }
+    return i;
+}
+
+template <typename V>
+std::size_t destinationLanes(const double *latitude, const double *longitude, const double *bearing, const double *metres,
+                             double *destinationLatitude, double *destinationLongitude, std::size_t i, std::size_t count)
+{
+    for (; i + V::kWidth <= count; i += V::kWidth) {
+        V sinLatitude, cosLatitude, sinBearing, cosBearing, sinAngle, cosAngle;
+        sinCos(V::load(latitude + i), sinLatitude, cosLatitude);
+        sinCos(V::load(bearing + i), sinBearing, cosBearing);
+        sinCos(V::load(metres + i) * V::set(1 / kEarthRadiusMetres), sinAngle, cosAngle);
+
+        V sinDestination = sinLatitude * cosAngle + cosLatitude * sinAngle * cosBearing;
+        sinDestination = max(V::set(-1.0), min(V::set(1.0), sinDestination));
+        V lon = V::load(longitude + i)
+                + atan2Of(sinBearing * sinAngle * cosLatitude, cosAngle - sinLatitude * sinDestination);
+        lon = lon - V::set(kTwoPi) * floorOf((lon + V::set(M_PI)) * V::set(1 / kTwoPi));
+
+        lon.store(destinationLongitude + i);
+        asinOf(sinDestination).store(destinationLatitude + i);
+    }
+    return i;
+}
+
+template <typename V>
+std::size_t ecefLanes(const double *latitude, const double *longitude, const double *altitude,
+                      double *x, double *y, double *z, std::size_t i, std::size_t count)
+{
+    for (; i + V::kWidth <= count; i += V::kWidth) {
+        V sinLatitude, cosLatitude, sinLongitude, cosLongitude;
+        sinCos(V::load(latitude + i), sinLatitude, cosLatitude);
+        sinCos(V::load(longitude + i), sinLongitude, cosLongitude);
+        V height = V::load(altitude + i);
+
+        // Prime vertical radius of curvature
+        V normal = V::set(kSemiMajorAxisMetres)
+                / sqrt(V::set(1.0) - V::set(kEccentricitySquared) * sinLatitude * sinLatitude);
+        V horizontal = (normal + height) * cosLatitude;
+        (horizontal * cosLongitude).store(x + i);
+        (horizontal * sinLongitude).store(y + i);
+        ((normal * V::set(1 - kEccentricitySquared) + height) * sinLatitude).store(z + i);
+    }
+    return i;
+}
+
+// The rotation from ECEF to east, north, up at one origin
+struct EnuFrame {
+    double x, y, z;
+    double sinLatitude, cosLatitude, sinLongitude, cosLongitude;
+};
+
+template <typename V>
+std::size_t enuLanes(const EnuFrame &frame, const double *x, const double *y, const double *z,
+                     double *east, double *north, double *up, std::size_t i, std::size_t count)
+{
+    const V sinLatitude = V::set(frame.sinLatitude);
+    const V cosLatitude = V::set(frame.cosLatitude);
+    const V sinLongitude = V::set(frame.sinLongitude);
+    const V cosLongitude = V::set(frame.cosLongitude);
+    for (; i + V::kWidth <= count; i += V::kWidth) {
+        V dx = V::load(x + i) - V::set(frame.x);
+        V dy = V::load(y + i) - V::set(frame.y);
+        V dz = V::load(z + i) - V::set(frame.z);
+        V horizontal = cosLongitude * dx + sinLongitude * dy;
+        (cosLongitude * dy - sinLongitude * dx).store(east + i);
+        (cosLatitude * dz - sinLatitude * horizontal).store(north + i);
+        (cosLatitude * horizontal + sinLatitude * dz).store(up + i);
+    }
+    return i;
+}
+
+double vincentyOne(double latitude1, double longitude1, double latitude2, double longitude2)
+{
+    const double a = kSemiMajorAxisMetres;
+    const double b = kSemiMinorAxisMetres;
+    const double f = kFlattening;
+
+    double L = std::remainder(longitude2 - longitude1, kTwoPi);
+    double U1 = std::atan((1 - f) * std::tan(latitude1));
+    double U2 = std::atan((1 - f) * std::tan(latitude2));
+    double sinU1 = std::sin(U1), cosU1 = std::cos(U1);
+    double sinU2 = std::sin(U2), cosU2 = std::cos(U2);
+
+    double lambda = L;
+    double sinSigma = 0, cosSigma = 0, sigma = 0, cosSquaredAlpha = 0, cos2SigmaM = 0;
+    int iteration = 0;
+    for (; iteration < kVincentyMaxIterations; ++iteration) {
+        double sinLambda = std::sin(lambda), cosLambda = std::cos(lambda);
+        double across = cosU2 * sinLambda;
+        double along = cosU1 * sinU2 - sinU1 * cosU2 * cosLambda;
+        sinSigma = std::sqrt(across * across + along * along);
+        if (sinSigma == 0) return 0.0;
+        cosSigma = sinU1 * sinU2 + cosU1 * cosU2 * cosLambda;
+        sigma = std::atan2(sinSigma, cosSigma);
+        double sinAlpha = cosU1 * cosU2 * sinLambda / sinSigma;
+        cosSquaredAlpha = 1 - sinAlpha * sinAlpha;
+        // Both points on the equator
+        cos2SigmaM = cosSquaredAlpha != 0 ? cosSigma - 2 * sinU1 * sinU2 / cosSquaredAlpha : 0.0;
+        double C = f / 16 * cosSquaredAlpha * (4 + f * (4 - 3 * cosSquaredAlpha));
+        double previous = lambda;
+        lambda = L + (1 - C) * f * sinAlpha
+                * (sigma + C * sinSigma * (cos2SigmaM + C * cosSigma * (-1 + 2 * cos2SigmaM * cos2SigmaM)));
+        if (std::fabs(lambda - previous) < kVincentyTolerance) break;
+    }
+    if (iteration == kVincentyMaxIterations || !std::isfinite(lambda)) {
+        return std::nan("");
+    }
+
+    double uSquared = cosSquaredAlpha * (a * a - b * b) / (b * b);
+    double A = 1 + uSquared / 16384 * (4096 + uSquared * (-768 + uSquared * (320 - 175 * uSquared)));
+    double B = uSquared / 1024 * (256 + uSquared * (-128 + uSquared * (74 - 47 * uSquared)));
+    double deltaSigma = B * sinSigma
+            * (cos2SigmaM + B / 4 * (cosSigma * (-1 + 2 * cos2SigmaM * cos2SigmaM)
+                                     - B / 6 * cos2SigmaM * (-3 + 4 * sinSigma * sinSigma) * (-3 + 4 * cos2SigmaM * cos2SigmaM)));
+    return b * A * (sigma - deltaSigma);
+}
+
+} // namespace
+
+/*!
+    \fn void geodesy::haversineDistance(const double *latitude1, const double *longitude1, const double *latitude2, const double *longitude2, double *metres, std::size_t count)
+    \brief Writes the great-circle distance between each pair of points to \a metres.
+
+    The spherical model is within about 0.5% of the ellipsoid, see vincentyDistance() where that matters.
+*/
+void haversineDistance(const double *latitude1, const double *longitude1, const double *latitude2, const double *longitude2,
+                       double *metres, std::size_t count)
+{
+    std::size_t i = 0;
+#if defined(GEODESY_SSE2)
+    i = haversineLanes<Lanes>(latitude1, longitude1, latitude2, longitude2, metres, i, count);
+#endif
+    haversineLanes<Scalar>(latitude1, longitude1, latitude2, longitude2, metres, i, count);
+}
+
+/*!
+    \fn void geodesy::vincentyDistance(const double *latitude1, const double *longitude1, const double *latitude2, const double *longitude2, double *metres, std::size_t count)
+    \brief Writes the WGS84 ellipsoidal distance between each pair of points to \a metres.
+
+    Points converge in anything from two to a few hundred iterations, so this
+    runs one pair at a time rather than holding a vector until its slowest lane finishes.
+*/
+void vincentyDistance(const double *latitude1, const double *longitude1, const double *latitude2, const double *longitude2,
+                      double *metres, std::size_t count)
+{
+    for (std::size_t i = 0; i < count; ++i) {
+        metres[i] = vincentyOne(latitude1[i], longitude1[i], latitude2[i], longitude2[i]);
+    }
+}
+
+void initialBearing(const double *latitude1, const double *longitude1, const double *latitude2, const double *longitude2,
+                    double *bearing, std::size_t count)
+{
+    std::size_t i = 0;
+#if defined(GEODESY_SSE2)
+    i = bearingLanes<Lanes>(latitude1, longitude1, latitude2, longitude2, bearing, i, count);
+#endif
+    bearingLanes<Scalar>(latitude1, longitude1, latitude2, longitude2, bearing, i, count);
+}
+
+void destination(const double *latitude, const double *longitude, const double *bearing, const double *metres,
+                 double *destinationLatitude, double *destinationLongitude, std::size_t count)
+{
+    std::size_t i = 0;
+#if defined(GEODESY_SSE2)
+    i = destinationLanes<Lanes>(latitude, longitude, bearing, metres, destinationLatitude, destinationLongitude, i, count);
+#endif
+    destinationLanes<Scalar>(latitude, longitude, bearing, metres, destinationLatitude, destinationLongitude, i, count);
+}
+
+void geodeticToEcef(const double *latitude, const double *longitude, const double *altitude,
+                    double *x, double *y, double *z, std::size_t count)
+{
+    std::size_t i = 0;
+#if defined(GEODESY_SSE2)
+    i = ecefLanes<Lanes>(latitude, longitude, altitude, x, y, z, i, count);
+#endif
+    ecefLanes<Scalar>(latitude, longitude, altitude, x, y, z, i, count);
+}
+
+/*!
+    \fn void geodesy::ecefToEnu(double originLatitude, double originLongitude, double originAltitude, const double *x, const double *y, const double *z, double *east, double *north, double *up, std::size_t count)
+    \brief Rotates ECEF points into the local tangent plane at the origin.
+
+    Once the origin is converted this is a translation and a rotation per point, with no trigonometry.
+*/
+void ecefToEnu(double originLatitude, double originLongitude, double originAltitude,
+               const double *x, const double *y, const double *z,
+               double *east, double *north, double *up, std::size_t count)
+{
+    EnuFrame frame;
+    ecefLanes<Scalar>(&originLatitude, &originLongitude, &originAltitude, &frame.x, &frame.y, &frame.z, 0, 1);
+    frame.sinLatitude = std::sin(originLatitude);
+    frame.cosLatitude = std::cos(originLatitude);
+    frame.sinLongitude = std::sin(originLongitude);
+    frame.cosLongitude = std::cos(originLongitude);
+
+    std::size_t i = 0;
+#if defined(GEODESY_SSE2)
+    i = enuLanes<Lanes>(frame, x, y, z, east, north, up, i, count);
+#endif
+    enuLanes<Scalar>(frame, x, y, z, east, north, up, i, count);
+}
+
+} // namespace geodesy
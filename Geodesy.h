@@ -0,0 +1,49 @@
+#ifndef GEODESY_H
+#define GEODESY_H
+
+#include <cstddef>
+
+/*
+    Batch geodesy over columns of coordinates. Every function takes parallel
+    arrays of `count` elements, in radians and metres, and writes its results to
+    caller-provided arrays of the same length, which may alias the inputs.
+
+    Spherical formulas use the mean Earth radius shared with kinematics, the
+    ellipsoidal ones WGS84. Apart from vincentyDistance, whose iteration count
+    depends on the points, each function processes four points per instruction
+    when built with AVX and two with SSE2, using its own polynomial sine, cosine
+    and arctangent. The remainder of a column, and other targets, go through the
+    same polynomials one point at a time, so results don't depend on where in a
+    column a point falls. Results agree with the same formulas evaluated with
+    the C library to about 1e-13 relative.
+*/
+namespace geodesy {
+
+// WGS84 ellipsoid
+constexpr double kSemiMajorAxisMetres = 6378137.0;
+constexpr double kFlattening = 1 / 298.257223563;
+
+// Great-circle distance on the mean-radius sphere
+void haversineDistance(const double *latitude1, const double *longitude1, const double *latitude2, const double *longitude2,
+                       double *metres, std::size_t count);
+// Distance on the WGS84 ellipsoid by Vincenty's inverse formula, accurate to about a millimetre.
+// NaN where the iteration doesn't converge, which only happens for nearly antipodal points.
+void vincentyDistance(const double *latitude1, const double *longitude1, const double *latitude2, const double *longitude2,
+                      double *metres, std::size_t count);
+// Initial great-circle bearing from point 1 towards point 2, clockwise from true north in [0, 2pi)
+void initialBearing(const double *latitude1, const double *longitude1, const double *latitude2, const double *longitude2,
+                    double *bearing, std::size_t count);
+// Where travelling `metres` along the great circle starting on `bearing` ends up. Longitudes are wrapped into [-pi, pi).
+void destination(const double *latitude, const double *longitude, const double *bearing, const double *metres,
+                 double *destinationLatitude, double *destinationLongitude, std::size_t count);
+// Earth-centred, Earth-fixed coordinates of WGS84 positions, altitudes above the ellipsoid
+void geodeticToEcef(const double *latitude, const double *longitude, const double *altitude,
+                    double *x, double *y, double *z, std::size_t count);
+// Local east, north, up coordinates of ECEF points relative to one WGS84 origin
+void ecefToEnu(double originLatitude, double originLongitude, double originAltitude,
+               const double *x, const double *y, const double *z,
+               double *east, double *north, double *up, std::size_t count);
+
+} // namespace geodesy
+
+#endif // GEODESY_H
@@ -0,0 +1,363 @@
+#include "JsonRecordDecoder.h"
+#include <charconv>
+#include <cstdint>
+
+/*
+    Fast path JSON decoding for the fixed PE and Emitter schemas.
+
+    The decoders walk the JSON text once, directly in the receive buffer. Known
+    keys are matched against a per-schema field table, values are parsed in
+    place (string values as views, numbers with std::from_chars) and required
+    fields are tracked in a bitmask. Unknown keys are skipped without being
+    materialised. The only allocations are the QStrings of the resulting record.
+
+    Anything outside the common shape, such as escaped strings or a value of an
+    unexpected type, returns Unsupported so the caller can fall back to QJson.
+*/
+
+namespace wire {
+
+namespace {
+
+enum class ValueKind {
+    String,
+    Number,
+    Bool
+};
+
+struct FieldSpec {
+    std::string_view key;
+    ValueKind kind;
+};
+
+constexpr int kMaxFields = 24;
+
+struct FieldValues {
+    std::string_view strings[kMaxFields];
+    double numbers[kMaxFields];
+    bool bools[kMaxFields];
+    std::uint32_t seen = 0;
+};
+
+class Cursor {
+public:
+    explicit Cursor(std::string_view text)
+        : m_pos(text.data()), m_end(text.data() + text.size()) {}
+
+    void skipWhitespace() {
+        while (m_pos != m_end && (*m_pos == ' ' || *m_pos == '\t' || *m_pos == '\r' || *m_pos == '\n')) {
+            ++m_pos;
+        }
+    }
+
+    char peek() {
+        skipWhitespace();
+        return m_pos == m_end ? '\0' : *m_pos;
+    }
+
+    bool consume(char c) {
+        if (peek() != c) return false;
+        ++m_pos;
+        return true;
+    }
+
+    bool atEnd() {
+        skipWhitespace();
+        return m_pos == m_end;
+    }
+
+    // Reads a string without escapes as a view into the input
+    bool readString(std::string_view& value, bool& escaped) {
+        escaped = false;
+        if (!consume('"')) return false;
+        const char* start = m_pos;
+        while (m_pos != m_end && *m_pos != '"') {
+            if (*m_pos == '\\') {
+                escaped = true;
+                if (++m_pos == m_end) return false;
+            }
+            ++m_pos;
+        }
+        if (m_pos == m_end) return false;
+        value = std::string_view(start, static_cast<std::size_t>(m_pos - start));
+        ++m_pos;
+        return true;
+    }
+
+    bool readNumber(double& value) {
+        skipWhitespace();
+        auto result = std::from_chars(m_pos, m_end, value);
+        if (result.ec != std::errc()) return false;
+        m_pos = result.ptr;
+        return true;
+    }
+
+    bool readLiteral(std::string_view literal) {
+        skipWhitespace();
+        if (static_cast<std::size_t>(m_end - m_pos) < literal.size()
+            || std::string_view(m_pos, literal.size()) != literal) {
+            return false;
+        }
+        m_pos += literal.size();
+        return true;
+    }
+
+    bool readBool(bool& value) {
+        if (readLiteral("true")) {
+            value = true;
+            return true;
+        }
+        if (readLiteral("false")) {
+            value = false;
+            return true;
+        }
+        return false;
+    }
+
+    // Skips any JSON value, including nested objects and arrays
+    bool skipValue() {
+        char c = peek();
+        if (c == '"') {
+            std::string_view ignored;
+            bool escaped;
+            return readString(ignored, escaped);
+        }
+        if (c == '{' || c == '[') {
+            int depth = 0;
+            while (m_pos != m_end) {
+                char current = *m_pos;
+                if (current == '"') {
+                    std::string_view ignored;
+                    bool escaped;
+                    if (!readString(ignored, escaped)) return false;
+                    continue;
+                }
+                ++m_pos;
+                if (current == '{' || current == '[') ++depth;
+                else if (current == '}' || current == ']') {
+                    if (--depth == 0) return true;
+                }
+            }
+            return false;
+        }
+        if (c == 't' || c == 'f') {
+            bool ignored;
+            return readBool(ignored);
+        }
+        if (c == 'n') return readLiteral("null");
+        double ignored;
+        return readNumber(ignored);
+    }
+
+private:
+    const char* m_pos;
+    const char* m_end;
+};
+
+int findField(const FieldSpec* fields, int count, std::string_view key) {
+    for (int i = 0; i < count; ++i) {
+        if (fields[i].key == key) return i;
+    }
+    return -1;
+}
+
+JsonDecodeResult parseObject(std::string_view json, const FieldSpec* fields, int count, FieldValues& values) {
+    Cursor cursor(json);
+    if (!cursor.consume('{')) return JsonDecodeResult::Unsupported;
+    if (cursor.consume('}')) return cursor.atEnd() ? JsonDecodeResult::Ok : JsonDecodeResult::Unsupported;
+
+    for (;;) {
+        std::string_view key;
+        bool escaped;
+        if (!cursor.readString(key, escaped) || escaped || !cursor.consume(':')) {
+            return JsonDecodeResult::Unsupported;
+        }
+
+        int field = findField(fields, count, key);
+        if (field < 0) {
+            if (!cursor.skipValue()) return JsonDecodeResult::Unsupported;
+        } else {
+            bool ok = false;
+            switch (fields[field].kind) {
+            case ValueKind::String:
+                ok = cursor.readString(values.strings[field], escaped) && !escaped;
+                break;
+            case ValueKind::Number:
+                ok = cursor.readNumber(values.numbers[field]);
+                break;
+            case ValueKind::Bool:
+                ok = cursor.readBool(values.bools[field]);
+                break;
+            }
+            if (!ok) return JsonDecodeResult::Unsupported;
+            values.seen |= (1u << field);
+        }
+
+        if (cursor.consume(',')) continue;
+        if (cursor.consume('}')) break;
+        return JsonDecodeResult::Unsupported;
+    }
+    return cursor.atEnd() ? JsonDecodeResult::Ok : JsonDecodeResult::Unsupported;
+}
+
+bool checkRequired(const FieldSpec* fields, std::uint32_t required, std::uint32_t seen, std::string_view& missingField) {
+    std::uint32_t missing = required & ~seen;
+    if (!missing) return true;
+    for (int i = 0; i < kMaxFields; ++i) {
+        if (missing & (1u << i)) {
+            missingField = fields[i].key;
+            break;
+        }
+    }
+    return false;
+}
+
+QString toQString(const FieldValues& values, std::uint32_t field) {
+    if (!(values.seen & (1u << field))) return QString();
+    const std::string_view& value = values.strings[field];
+    return QString::fromUtf8(value.data(), static_cast<int>(value.size()));
+}
+
+double toDouble(const FieldValues& values, std::uint32_t field) {
+    return (values.seen & (1u << field)) ? values.numbers[field] : 0.0;
+}
+
+bool toBool(const FieldValues& values, std::uint32_t field) {
+    return (values.seen & (1u << field)) && values.bools[field];
+}
+
+// Field order defines the bit used in the seen and required masks
+enum PEField : std::uint32_t {
+    PEId, PEType, PELat, PELon, PEAltitude, PESpeed, PEApd, PEPriority, PEJam, PEGhost,
+    PEHeading, PECategory, PEState, PEFieldCount
+};
+
+constexpr FieldSpec kPEFields[PEFieldCount] = {
+    {"id", ValueKind::String}, {"type", ValueKind::String}, {"lat", ValueKind::Number},
+    {"lon", ValueKind::Number}, {"altitude", ValueKind::Number}, {"speed", ValueKind::Number},
+    {"apd", ValueKind::String}, {"priority", ValueKind::String}, {"jam", ValueKind::Bool},
+    {"ghost", ValueKind::Bool}, {"heading", ValueKind::Number}, {"category", ValueKind::Number},
+    {"state", ValueKind::String}
+};
+
+constexpr std::uint32_t kPERequired = (1u << PEHeading) - 1;
+
+enum EmitterField : std::uint32_t {
+    EmitterId, EmitterType, EmitterCategory, EmitterLat, EmitterLon, EmitterFreqMin, EmitterFreqMax, EmitterJam,
+    EmitterActive, EmitterEaPriority, EmitterEsPriority, EmitterJamResponsible, EmitterReactiveEligible,
+    EmitterPreemptiveEligible, EmitterConsentRequired, EmitterAltitude, EmitterHeading, EmitterSpeed,
+    EmitterOperatorManaged, EmitterJamIneffective, EmitterJamEffective, EmitterFieldCount
+};
+
+constexpr FieldSpec kEmitterFields[EmitterFieldCount] = {
+    {"id", ValueKind::String}, {"type", ValueKind::String}, {"category", ValueKind::String},
+    {"lat", ValueKind::Number}, {"lon", ValueKind::Number}, {"freqMin", ValueKind::Number},
+    {"freqMax", ValueKind::Number}, {"jam", ValueKind::Bool}, {"active", ValueKind::Bool},
+    {"eaPriority", ValueKind::String}, {"esPriority", ValueKind::String}, {"jamResponsible", ValueKind::Bool},
+    {"reactiveEligible", ValueKind::Bool}, {"preemptiveEligible", ValueKind::Bool},
+    {"consentRequired", ValueKind::Bool}, {"altitude", ValueKind::Number}, {"heading", ValueKind::Number},
+    {"speed", ValueKind::Number}, {"operatorManaged", ValueKind::Bool}, {"jamIneffective", ValueKind::Number},
+    {"jamEffective", ValueKind::Number}
+};
+
+constexpr std::uint32_t kEmitterRequired = (1u << EmitterActive) - 1;
+
+static_assert(PEFieldCount <= kMaxFields && EmitterFieldCount <= kMaxFields, "Field table exceeds kMaxFields");
+
+} // namespace
+
+/*
+    Settings carry "setting", complex blobs "doubleMap", Emitters "freqMin" and
+    PEs "lat", checked in that order. Only keys of the outer object count, values
+    and nested objects are skipped, so a PE whose id is "setting" is still a PE
+    and the PE line embedded in a complex blob doesn't make it one. A line that
+    stops parsing part way is classified by the keys read before that point, so
+    a damaged record still reaches its decoder and fails there.
+*/
+JsonMessageKind classifyJsonMessage(std::string_view json) {
+    bool setting = false, doubleMap = false, freqMin = false, lat = false, wireFormat = false;
+    Cursor cursor(json);
+    if (cursor.consume('{') && !cursor.consume('}')) {
+        for (;;) {
+            std::string_view key;
+            bool escaped;
+            if (!cursor.readString(key, escaped) || !cursor.consume(':')) break;
+            if (key == "type" && cursor.peek() == '"') {
+                std::string_view type;
+                if (!cursor.readString(type, escaped)) break;
+                wireFormat = type == "WIRE_FORMAT";
+            } else {
+                setting |= key == "setting";
+                doubleMap |= key == "doubleMap";
+                freqMin |= key == "freqMin";
+                lat |= key == "lat";
+                if (!cursor.skipValue()) break;
+            }
+            if (!cursor.consume(',')) break;
+        }
+    }
+    if (setting) return JsonMessageKind::Setting;
+    if (doubleMap) return JsonMessageKind::ComplexBlob;
+    if (freqMin) return JsonMessageKind::Emitter;
+    if (lat) return JsonMessageKind::PE;
+    if (wireFormat) return JsonMessageKind::WireFormat;
+    return JsonMessageKind::Other;
+}
+
+JsonDecodeResult decodePEJson(std::string_view json, std::optional<PE>& out, std::string_view& missingField) {
+    FieldValues values;
+    JsonDecodeResult result = parseObject(json, kPEFields, PEFieldCount, values);
+    if (result != JsonDecodeResult::Ok) return result;
+    if (!checkRequired(kPEFields, kPERequired, values.seen, missingField)) return JsonDecodeResult::MissingField;
+
+    out.emplace(
+        toQString(values, PEId),
+        toQString(values, PEType),
+        toDouble(values, PELat),
+        toDouble(values, PELon),
+        toDouble(values, PEAltitude),
+        toDouble(values, PESpeed),
+        toQString(values, PEApd),
+        toQString(values, PEPriority),
+        toBool(values, PEJam),
+        toBool(values, PEGhost)
+    );
+    out->heading = toDouble(values, PEHeading);
+    out->category = static_cast<PE::PECategory>(static_cast<int>(toDouble(values, PECategory)));
+    out->state = toQString(values, PEState);
+    return JsonDecodeResult::Ok;
+}
+
+JsonDecodeResult decodeEmitterJson(std::string_view json, std::optional<Emitter>& out, std::string_view& missingField) {
+    FieldValues values;
+    JsonDecodeResult result = parseObject(json, kEmitterFields, EmitterFieldCount, values);
+    if (result != JsonDecodeResult::Ok) return result;
+    if (!checkRequired(kEmitterFields, kEmitterRequired, values.seen, missingField)) return JsonDecodeResult::MissingField;
+
+    out.emplace(
+        toQString(values, EmitterId),
+        toQString(values, EmitterType),
+        toQString(values, EmitterCategory),
+        toDouble(values, EmitterLat),
+        toDouble(values, EmitterLon),
+        toDouble(values, EmitterFreqMin),
+        toDouble(values, EmitterFreqMax),
+        toBool(values, EmitterActive),
+        toQString(values, EmitterEaPriority),
+        toQString(values, EmitterEsPriority),
+        toBool(values, EmitterJamResponsible),
+        toBool(values, EmitterReactiveEligible),
+        toBool(values, EmitterPreemptiveEligible),
+        toBool(values, EmitterConsentRequired),
+        toBool(values, EmitterJam)
+    );
+    out->altitude = toDouble(values, EmitterAltitude);
+    out->heading = toDouble(values, EmitterHeading);
+    out->speed = toDouble(values, EmitterSpeed);
+    out->operatorManaged = toBool(values, EmitterOperatorManaged);
+    out->jamIneffective = static_cast<int>(toDouble(values, EmitterJamIneffective));
+    out->jamEffective = static_cast<int>(toDouble(values, EmitterJamEffective));
+    return JsonDecodeResult::Ok;
+}
+
+} // namespace wire
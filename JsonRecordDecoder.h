@@ -0,0 +1,38 @@
+#ifndef JSONRECORDDECODER_H
+#define JSONRECORDDECODER_H
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include "pe.h"
+#include "emitter.h"
+
+namespace wire {
+
+enum class JsonDecodeResult {
+    Ok,
+    MissingField, // Well formed, but a required field is absent
+    Unsupported   // Valid JSON the fast path doesn't handle (escapes, unexpected value types), use QJson
+};
+
+// What a JSON line carries, see classifyJsonMessage
+enum class JsonMessageKind {
+    PE,
+    Emitter,
+    Setting,
+    ComplexBlob,
+    WireFormat, // A WIRE_FORMAT control message
+    Other
+};
+
+// Tells the kind of message from the object's top-level keys, so string values never decide it
+JsonMessageKind classifyJsonMessage(std::string_view json);
+
+// Schema-specific decoders that read straight from the receive buffer.
+// On MissingField, missingField names the first absent required field.
+JsonDecodeResult decodePEJson(std::string_view json, std::optional<PE>& out, std::string_view& missingField);
+JsonDecodeResult decodeEmitterJson(std::string_view json, std::optional<Emitter>& out, std::string_view& missingField);
+
+} // namespace wire
+
+#endif // JSONRECORDDECODER_H
@@ -0,0 +1,129 @@
+#include "Kinematics.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__AVX__) || defined(__SSE2__) || defined(_M_X64)
+#include <immintrin.h>
+#define KINEMATICS_SSE2
+#endif
+
+namespace kinematics {
+
+namespace {
+
+constexpr double kTwoPi = 2 * M_PI;
+constexpr double kInverseTwoPi = 1 / kTwoPi;
+// Longitude rates are worked out with the cosine of latitude floored at this, about 0.06 degrees from a pole
+constexpr double kMinCosLatitude = 1e-3;
+
+inline double extrapolateOne(double fix, double rate, double elapsed)
+{
+    return fix + rate * elapsed;
+}
+
+inline double wrapLongitude(double longitude)
+{
+    return longitude - kTwoPi * std::floor((longitude + M_PI) * kInverseTwoPi);
+}
+
+inline double clampLatitude(double latitude)
+{
+    return std::min(M_PI_2, std::max(-M_PI_2, latitude));
+}
+
+#if defined(KINEMATICS_SSE2) && !defined(__AVX__)
+// SSE2 has no floor. Adding and subtracting 2^52 rounds to an integer, then
+// anything rounded up is stepped back. Exact for magnitudes below 2^51.
+inline __m128d floor2(__m128d x)
+{
+    const __m128d magic = _mm_set1_pd(4503599627370496.0);
+    __m128d sign = _mm_and_pd(x, _mm_set1_pd(-0.0));
+    __m128d rounded = _mm_or_pd(_mm_sub_pd(_mm_add_pd(_mm_andnot_pd(sign, x), magic), magic), sign);
+    __m128d tooHigh = _mm_cmpgt_pd(rounded, x);
+    return _mm_sub_pd(rounded, _mm_and_pd(tooHigh, _mm_set1_pd(1.0)));
+}
+#endif
+
+} // namespace
+
+void rates(double speed, double heading, double latitude, double &latitudeRate, double &longitudeRate)
+{
+    if (!std::isfinite(speed) || !std::isfinite(heading) || speed == 0.0) {
+        latitudeRate = 0.0;
+        longitudeRate = 0.0;
+        return;
+    }
+    double angularSpeed = speed / kEarthRadiusMetres;
+    latitudeRate = angularSpeed * std::cos(heading);
+    longitudeRate = angularSpeed * std::sin(heading) / std::max(kMinCosLatitude, std::cos(latitude));
+}
+
+/*!
+    \fn void kinematics::extrapolate(const double *fixLatitude, const double *fixLongitude, const double *fixTime, const double *latitudeRate, const double *longitudeRate, double now, double maxElapsed, double *latitude, double *longitude, std::size_t count)
+    \brief Dead reckons \a count entities from their fixes to \a now.
+
+    The columns are read and written front to back, so the loop is bound by
+    memory bandwidth rather than arithmetic once vectorised.
+*/
+void extrapolate(const double *fixLatitude, const double *fixLongitude, const double *fixTime,
+                 const double *latitudeRate, const double *longitudeRate, double now, double maxElapsed,
+                 double *latitude, double *longitude, std::size_t count)
+{
+    std::size_t i = 0;
+
+#if defined(__AVX__)
+    const __m256d nowV = _mm256_set1_pd(now);
+    const __m256d zeroV = _mm256_setzero_pd();
+    const __m256d maxElapsedV = _mm256_set1_pd(maxElapsed);
+    const __m256d northV = _mm256_set1_pd(M_PI_2);
+    const __m256d southV = _mm256_set1_pd(-M_PI_2);
+    const __m256d piV = _mm256_set1_pd(M_PI);
+    const __m256d twoPiV = _mm256_set1_pd(kTwoPi);
+    const __m256d inverseTwoPiV = _mm256_set1_pd(kInverseTwoPi);
+    for (; i + 4 <= count; i += 4) {
+        __m256d elapsed = _mm256_sub_pd(nowV, _mm256_loadu_pd(fixTime + i));
+        elapsed = _mm256_min_pd(maxElapsedV, _mm256_max_pd(zeroV, elapsed));
+
+        __m256d lat = _mm256_add_pd(_mm256_loadu_pd(fixLatitude + i), _mm256_mul_pd(_mm256_loadu_pd(latitudeRate + i), elapsed));
+        lat = _mm256_min_pd(northV, _mm256_max_pd(southV, lat));
+
+        __m256d lon = _mm256_add_pd(_mm256_loadu_pd(fixLongitude + i), _mm256_mul_pd(_mm256_loadu_pd(longitudeRate + i), elapsed));
+        __m256d turns = _mm256_floor_pd(_mm256_mul_pd(_mm256_add_pd(lon, piV), inverseTwoPiV));
+        lon = _mm256_sub_pd(lon, _mm256_mul_pd(twoPiV, turns));
+
+        _mm256_storeu_pd(latitude + i, lat);
+        _mm256_storeu_pd(longitude + i, lon);
+    }
+#elif defined(KINEMATICS_SSE2)
+    const __m128d nowV = _mm_set1_pd(now);
+    const __m128d zeroV = _mm_setzero_pd();
+    const __m128d maxElapsedV = _mm_set1_pd(maxElapsed);
+    const __m128d northV = _mm_set1_pd(M_PI_2);
+    const __m128d southV = _mm_set1_pd(-M_PI_2);
+    const __m128d piV = _mm_set1_pd(M_PI);
+    const __m128d twoPiV = _mm_set1_pd(kTwoPi);
+    const __m128d inverseTwoPiV = _mm_set1_pd(kInverseTwoPi);
+    for (; i + 2 <= count; i += 2) {
+        __m128d elapsed = _mm_sub_pd(nowV, _mm_loadu_pd(fixTime + i));
+        elapsed = _mm_min_pd(maxElapsedV, _mm_max_pd(zeroV, elapsed));
+
+        __m128d lat = _mm_add_pd(_mm_loadu_pd(fixLatitude + i), _mm_mul_pd(_mm_loadu_pd(latitudeRate + i), elapsed));
+        lat = _mm_min_pd(northV, _mm_max_pd(southV, lat));
+
+        __m128d lon = _mm_add_pd(_mm_loadu_pd(fixLongitude + i), _mm_mul_pd(_mm_loadu_pd(longitudeRate + i), elapsed));
+        __m128d turns = floor2(_mm_mul_pd(_mm_add_pd(lon, piV), inverseTwoPiV));
+        lon = _mm_sub_pd(lon, _mm_mul_pd(twoPiV, turns));
+
+        _mm_storeu_pd(latitude + i, lat);
+        _mm_storeu_pd(longitude + i, lon);
+    }
+#endif
+
+    for (; i < count; ++i) {
+        double elapsed = std::min(maxElapsed, std::max(0.0, now - fixTime[i]));
+        latitude[i] = clampLatitude(extrapolateOne(fixLatitude[i], latitudeRate[i], elapsed));
+        longitude[i] = wrapLongitude(extrapolateOne(fixLongitude[i], longitudeRate[i], elapsed));
+    }
+}
+
+} // namespace kinematics
@@ -0,0 +1,36 @@
+#ifndef KINEMATICS_H
+#define KINEMATICS_H
+
+#include <cstddef>
+
+/*
+    Dead reckoning over whole columns of entities. Each entity moves in a
+    straight line across a local flat-earth approximation from its last fix:
+    position = fix + rate * (now - fixTime), with the elapsed time capped so a
+    track that stops reporting doesn't wander off forever. Rates are angular,
+    radians per second, and are worked out once per fix with rates(), leaving
+    the per-tick update free of trigonometry.
+
+    extrapolate() processes four entities per instruction when built with AVX
+    and two with SSE2, which every x86-64 target has. Other targets, and the
+    remainder of a column, use scalar code.
+*/
+namespace kinematics {
+
+// Mean Earth radius
+constexpr double kEarthRadiusMetres = 6371008.8;
+
+// Latitude and longitude rates for `speed` in metres per second on `heading`, radians
+// clockwise from true north, starting at `latitude`. Longitude rates are capped near the poles.
+void rates(double speed, double heading, double latitude, double &latitudeRate, double &longitudeRate);
+
+// Writes every entity's position at `now` to `latitude` and `longitude`. Times are seconds
+// on one clock, elapsed times are clamped to [0, maxElapsed]. Latitudes are clamped to the
+// poles and longitudes wrapped into [-pi, pi).
+void extrapolate(const double *fixLatitude, const double *fixLongitude, const double *fixTime,
+                 const double *latitudeRate, const double *longitudeRate, double now, double maxElapsed,
+                 double *latitude, double *longitude, std::size_t count);
+
+} // namespace kinematics
+
+#endif // KINEMATICS_H
@@ -0,0 +1,312 @@
+#include "Log.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace logging {
+
+namespace {
+
+const char* levelName(Level level)
+{
+    switch (level) {
+    case Level::Trace: return "TRACE";
+    case Level::Debug: return "DEBUG";
+    case Level::Info: return "INFO";
+    case Level::Warning: return "WARN";
+    case Level::Error: return "ERROR";
+    }
+    return "?";
+}
+
+void appendUtf16(std::string& out, const char* data, std::size_t units)
+{
+    for (std::size_t i = 0; i < units; ++i) {
+        std::uint32_t code;
+        std::uint16_t unit;
+        std::memcpy(&unit, data + 2 * i, 2);
+        code = unit;
+        if (unit >= 0xD800 && unit < 0xDC00 && i + 1 < units) {
+            std::uint16_t low;
+            std::memcpy(&low, data + 2 * (i + 1), 2);
+            if (low >= 0xDC00 && low < 0xE000) {
+                code = 0x10000 + ((unit - 0xD800) << 10) + (low - 0xDC00);
+                ++i;
+            }
+        }
+        if (code < 0x80) {
+            out += static_cast<char>(code);
+        } else if (code < 0x800) {
+            out += static_cast<char>(0xC0 | (code >> 6));
+            out += static_cast<char>(0x80 | (code & 0x3F));
+        } else if (code < 0x10000) {
+            out += static_cast<char>(0xE0 | (code >> 12));
+            out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (code & 0x3F));
+        } else {
+            out += static_cast<char>(0xF0 | (code >> 18));
+            out += static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+            out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (code & 0x3F));
+        }
+    }
+}
+
+// Decodes the argument at `offset` onto `out`, returns the offset of the next one
+std::size_t appendArgument(std::string& out, const Record& record, std::size_t offset)
+{
+    auto tag = static_cast<Tag>(record.data[offset++]);
+    char number[32];
+    switch (tag) {
+    case Tag::Signed: {
+        std::int64_t value;
+        std::memcpy(&value, record.data + offset, sizeof(value));
+        std::snprintf(number, sizeof(number), "%lld", static_cast<long long>(value));
+        out += number;
+        return offset + sizeof(value);
+    }
+    case Tag::Unsigned: {
+        std::uint64_t value;
+        std::memcpy(&value, record.data + offset, sizeof(value));
+        std::snprintf(number, sizeof(number), "%llu", static_cast<unsigned long long>(value));
+        out += number;
+        return offset + sizeof(value);
+    }
+    case Tag::Double: {
+        double value;
+        std::memcpy(&value, record.data + offset, sizeof(value));
+        std::snprintf(number, sizeof(number), "%g", value);
+        out += number;
+        return offset + sizeof(value);
+    }
+    case Tag::Bool:
+        out += record.data[offset] ? "true" : "false";
+        return offset + 1;
+    case Tag::Utf8:
+    case Tag::Utf16: {
+        std::uint16_t bytes;
+        std::memcpy(&bytes, record.data + offset, sizeof(bytes));
+        offset += sizeof(bytes);
+        if (tag == Tag::Utf8) {
+            out.append(record.data + offset, bytes);
+        } else {
+            appendUtf16(out, record.data + offset, bytes / 2);
+        }
+        return offset + bytes;
+    }
+    }
+    return record.size;
+}
+
+void format(std::string& out, const Record& record)
+{
+    auto seconds = static_cast<std::time_t>(record.time / 1000000000);
+    auto millis = static_cast<int>((record.time / 1000000) % 1000);
+    std::tm local{};
+#ifdef _WIN32
+    localtime_s(&local, &seconds);
+#else
+    localtime_r(&seconds, &local);
+#endif
+    char prefix[48];
+    std::snprintf(prefix, sizeof(prefix), "%02d:%02d:%02d.%03d %-5s ",
+                  local.tm_hour, local.tm_min, local.tm_sec, millis, levelName(record.level));
+    out += prefix;
+
+    std::size_t offset = 0;
+    int remaining = record.arguments;
+    for (const char* p = record.format; *p; ++p) {
+        if (p[0] == '{' && p[1] == '}') {
+            if (remaining > 0) {
+                offset = appendArgument(out, record, offset);
+                --remaining;
+            } else {
+                out += "{}";
+            }
+            ++p;
+        } else {
+            out += *p;
+        }
+    }
+    out += '\n';
+}
+
+// Owns the rings of every thread that has logged and the thread that drains them
+class Drain {
+public:
+    Drain() : m_stop(false), m_thread([this] { run(); }) {}
+
+    ~Drain() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_wake.notify_all();
+        m_thread.join();
+    }
+
+    void add(std::shared_ptr<Ring> ring) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_rings.push_back(std::move(ring));
+    }
+
+    void flush() {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        std::uint64_t target = m_passes + 2;
+        m_wake.notify_all();
+        m_passed.wait(lock, [&] { return m_passes >= target || m_stop; });
+    }
+
+private:
+    void run() {
+        std::string out;
+        std::vector<std::shared_ptr<Ring>> rings;
+        std::unique_lock<std::mutex> lock(m_mutex);
+        for (;;) {
+            bool stopping = m_stop;
+            rings = m_rings;
+            lock.unlock();
+
+            bool wrote = false;
+            for (const auto& ring : rings) {
+                while (const Record* record = ring->peek()) {
+                    format(out, *record);
+                    ring->release();
+                    wrote = true;
+                    if (out.size() > 64 * 1024) {
+                        std::fwrite(out.data(), 1, out.size(), stderr);
+                        out.clear();
+                    }
+                }
+                std::uint64_t dropped = ring->dropped.exchange(0, std::memory_order_relaxed);
+                if (dropped > 0) {
+                    char line[64];
+                    std::snprintf(line, sizeof(line), "Log: dropped %llu records, ring full\n",
+                                  static_cast<unsigned long long>(dropped));
+                    out += line;
+                    wrote = true;
+                }
+            }
+            if (!out.empty()) {
+                std::fwrite(out.data(), 1, out.size(), stderr);
+                std::fflush(stderr);
+                out.clear();
+            }
+
+            lock.lock();
+            // Rings of exited threads go once they're empty
+            m_rings.erase(std::remove_if(m_rings.begin(), m_rings.end(), [](const std::shared_ptr<Ring>& ring) {
+                return ring->retired.load(std::memory_order_acquire) && !ring->peek();
+            }), m_rings.end());
+            ++m_passes;
+            m_passed.notify_all();
+            if (stopping) return;
+            if (!wrote) {
+                m_wake.wait_for(lock, std::chrono::milliseconds(5));
+            }
+        }
+    }
+
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_passed;
+    std::vector<std::shared_ptr<Ring>> m_rings;
+    std::uint64_t m_passes = 0;
+    bool m_stop;
+    std::thread m_thread;
+};
+
+Drain& drain()
+{
+    static Drain instance;
+    return instance;
+}
+
+// Marks the thread's ring retired when the thread exits, the drain thread frees it once empty
+struct RingHolder {
+    std::shared_ptr<Ring> ring;
+
+    RingHolder() : ring(std::make_shared<Ring>()) {
+        drain().add(ring);
+    }
+    ~RingHolder() {
+        ring->retired.store(true, std::memory_order_release);
+    }
+};
+
+} // namespace
+
+Record* Ring::claim()
+{
+    std::size_t head = m_head.load(std::memory_order_relaxed);
+    if (head - m_tail.load(std::memory_order_acquire) == kRingRecords) {
+        return nullptr;
+    }
+    return &m_records[head % kRingRecords];
+}
+
+void Ring::publish()
+{
+    m_head.store(m_head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+const Record* Ring::peek()
+{
+    std::size_t tail = m_tail.load(std::memory_order_relaxed);
+    if (tail == m_head.load(std::memory_order_acquire)) {
+        return nullptr;
+    }
+    return &m_records[tail % kRingRecords];
+}
+
+void Ring::release()
+{
+    m_tail.store(m_tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+Ring& threadRing()
+{
+    thread_local RingHolder holder;
+    return *holder.ring;
+}
+
+std::int64_t now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+void flush()
+{
+    drain().flush();
+}
+
+bool Encoder::reserve(std::size_t bytes)
+{
+    return m_record.size + bytes <= kArgumentBytes;
+}
+
+void Encoder::putString(Tag tag, const void* data, std::size_t bytes, std::size_t unit)
+{
+    constexpr std::size_t header = 1 + sizeof(std::uint16_t);
+    if (!reserve(header)) return;
+    std::size_t room = kArgumentBytes - m_record.size - header;
+    // Truncate on a whole code unit
+    bytes = std::min(bytes, room - room % unit);
+
+    auto length = static_cast<std::uint16_t>(bytes);
+    m_record.data[m_record.size++] = static_cast<char>(tag);
+    std::memcpy(m_record.data + m_record.size, &length, sizeof(length));
+    m_record.size += sizeof(length);
+    std::memcpy(m_record.data + m_record.size, data, bytes);
+    m_record.size += static_cast<std::uint16_t>(bytes);
+    ++m_record.arguments;
+}
+
+} // namespace logging
@@ -0,0 +1,160 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include <QString>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+/*
+    Structured logging for hot paths. A call below LOG_MIN_LEVEL compiles to
+    nothing and its arguments are never evaluated. Above it, a call copies the
+    format string pointer and binary-encoded arguments into a ring owned by the
+    calling thread, without locks, allocation or formatting. A background thread
+    drains the rings, formats the records and writes them to stderr.
+
+    Format strings must be literals, each "{}" is replaced by the next argument.
+    Supported arguments are integers, floating point, bool, C strings,
+    std::string, std::string_view and QString. A record holds up to
+    logging::kArgumentBytes of arguments, longer strings are truncated. When a
+    thread's ring is full, records are dropped and counted rather than blocking.
+*/
+
+// 0 trace, 1 debug, 2 info, 3 warning, 4 error. Set with DEFINES += LOG_MIN_LEVEL=n.
+#ifndef LOG_MIN_LEVEL
+#ifdef QT_NO_DEBUG
+#define LOG_MIN_LEVEL 2
+#else
+#define LOG_MIN_LEVEL 1
+#endif
+#endif
+
+#define LOG_AT(level, ...) \
+    do { \
+        if constexpr (static_cast<int>(level) >= LOG_MIN_LEVEL) { \
+            logging::write(level, __VA_ARGS__); \
+        } \
+    } while (0)
+
+#define LOG_TRACE(...) LOG_AT(logging::Level::Trace, __VA_ARGS__)
+#define LOG_DEBUG(...) LOG_AT(logging::Level::Debug, __VA_ARGS__)
+#define LOG_INFO(...) LOG_AT(logging::Level::Info, __VA_ARGS__)
+#define LOG_WARNING(...) LOG_AT(logging::Level::Warning, __VA_ARGS__)
+#define LOG_ERROR(...) LOG_AT(logging::Level::Error, __VA_ARGS__)
+
+namespace logging {
+
+enum class Level : std::uint8_t { Trace, Debug, Info, Warning, Error };
+
+constexpr std::size_t kArgumentBytes = 224;
+constexpr std::size_t kRingRecords = 1024;
+
+// Argument type tags in a record's argument bytes
+enum class Tag : std::uint8_t { Signed, Unsigned, Double, Bool, Utf8, Utf16 };
+
+struct Record {
+    std::int64_t time;        // Nanoseconds since the Unix epoch
+    const char* format;
+    Level level;
+    std::uint8_t arguments;   // Arguments encoded, may be fewer than the format asks for
+    std::uint16_t size;       // Bytes of `data` used
+    char data[kArgumentBytes];
+};
+
+// Single-producer single-consumer ring, written by its thread and read by the drain thread
+class Ring {
+public:
+    Record* claim();
+    void publish();
+    const Record* peek();
+    void release();
+
+    std::atomic<std::uint64_t> dropped{0};
+    std::atomic<bool> retired{false};
+
+private:
+    alignas(64) std::atomic<std::size_t> m_head{0};
+    alignas(64) std::atomic<std::size_t> m_tail{0};
+    Record m_records[kRingRecords];
+};
+
+// The calling thread's ring, registered with the drain thread on first use
+Ring& threadRing();
+std::int64_t now();
+// Blocks until every record published so far has been written
+void flush();
+
+class Encoder {
+public:
+    explicit Encoder(Record& record) : m_record(record) {}
+
+    template <typename T>
+    void put(const T& value);
+
+private:
+    bool reserve(std::size_t bytes);
+    // Encodes as much of the string as fits, a string that doesn't fit at all is left out
+    void putString(Tag tag, const void* data, std::size_t bytes, std::size_t unit);
+
+    Record& m_record;
+};
+
+template <typename T>
+void Encoder::put(const T& value)
+{
+    if constexpr (std::is_same_v<T, bool>) {
+        if (!reserve(2)) return;
+        m_record.data[m_record.size++] = static_cast<char>(Tag::Bool);
+        m_record.data[m_record.size++] = value ? 1 : 0;
+        ++m_record.arguments;
+    } else if constexpr (std::is_integral_v<T> || std::is_enum_v<T>) {
+        using Wide = std::conditional_t<std::is_signed_v<T>, std::int64_t, std::uint64_t>;
+        Wide wide = static_cast<Wide>(value);
+        if (!reserve(1 + sizeof(wide))) return;
+        m_record.data[m_record.size++] = static_cast<char>(std::is_signed_v<T> ? Tag::Signed : Tag::Unsigned);
+        std::memcpy(m_record.data + m_record.size, &wide, sizeof(wide));
+        m_record.size += sizeof(wide);
+        ++m_record.arguments;
+    } else if constexpr (std::is_floating_point_v<T>) {
+        double wide = static_cast<double>(value);
+        if (!reserve(1 + sizeof(wide))) return;
+        m_record.data[m_record.size++] = static_cast<char>(Tag::Double);
+        std::memcpy(m_record.data + m_record.size, &wide, sizeof(wide));
+        m_record.size += sizeof(wide);
+        ++m_record.arguments;
+    } else if constexpr (std::is_same_v<T, QString>) {
+        // Copied as UTF-16, converted when the record is formatted
+        putString(Tag::Utf16, value.constData(), static_cast<std::size_t>(value.size()) * 2, 2);
+    } else if constexpr (std::is_convertible_v<const T&, std::string_view>) {
+        std::string_view text(value);
+        putString(Tag::Utf8, text.data(), text.size(), 1);
+    } else {
+        static_assert(!sizeof(T), "Unsupported log argument type");
+    }
+}
+
+template <std::size_t N, typename... Args>
+void write(Level level, const char (&format)[N], const Args&... args)
+{
+    Ring& ring = threadRing();
+    Record* record = ring.claim();
+    if (!record) {
+        ring.dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    record->time = now();
+    record->format = format;
+    record->level = level;
+    record->arguments = 0;
+    record->size = 0;
+    Encoder encoder(*record);
+    (encoder.put(args), ...);
+    ring.publish();
+}
+
+} // namespace logging
+
+#endif // LOG_H
@@ -0,0 +1,64 @@
+#ifndef MPSCQUEUE_H
+#define MPSCQUEUE_H
+
+#include <atomic>
+#include <optional>
+#include <utility>
+
+/*
+    Unbounded lock-free multi-producer/single-consumer queue (Vyukov's intrusive
+    node queue). push() may be called from any number of threads and never
+    blocks; pop() and empty() must only be called from the one consumer thread.
+    An item pushed while another producer is mid-push may briefly be invisible
+    to pop(), it is returned by a later call.
+*/
+template <typename T>
+class MpscQueue {
+public:
+    MpscQueue() {
+        Node* stub = new Node();
+        m_head.store(stub, std::memory_order_relaxed);
+        m_tail = stub;
+    }
+
+    ~MpscQueue() {
+        while (pop()) {}
+        delete m_tail;
+    }
+
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    void push(T value) {
+        Node* node = new Node();
+        node->value.emplace(std::move(value));
+        Node* previous = m_head.exchange(node, std::memory_order_acq_rel);
+        previous->next.store(node, std::memory_order_release);
+    }
+
+    std::optional<T> pop() {
+        Node* tail = m_tail;
+        Node* next = tail->next.load(std::memory_order_acquire);
+        if (!next) return std::nullopt;
+        std::optional<T> value(std::move(next->value));
+        next->value.reset(); // next becomes the stub
+        m_tail = next;
+        delete tail;
+        return value;
+    }
+
+    bool empty() const {
+        return m_tail->next.load(std::memory_order_acquire) == nullptr;
+    }
+
+private:
+    struct Node {
+        std::atomic<Node*> next{nullptr};
+        std::optional<T> value; // Empty in the stub node
+    };
+
+    std::atomic<Node*> m_head; // Most recently pushed node, shared by producers
+    Node* m_tail;              // Consumer-owned, value already taken
+};
+
+#endif // MPSCQUEUE_H
@@ -0,0 +1,622 @@
+#include "MulticastNetworkInterface.h"
+#include "Log.h"
+#include "JsonRecordDecoder.h"
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#ifdef __linux__
+#include <sys/socket.h>
+#endif
+
+/*!
+    \class MulticastNetworkInterface
+    \brief Sends and receives PE and Emitter records as UDP multicast datagrams.
+
+    Each datagram carries a small header with the sender's format and sequence
+    number, followed by as many JSON lines or binary frames as fit. Binary
+    datagrams include the StringDef frames they use, so a lost datagram never
+    affects the decoding of another and there is no per-connection state.
+
+    Receivers accept both formats from any sender, track sequence numbers per
+    sender address to count lost, reordered and duplicate datagrams, and decode records
+    with the same JSON and binary decoders as NetworkImplementation. On Linux
+    datagrams are read in batches with recvmmsg().
+*/
+
+namespace {
+
+constexpr std::size_t kReadBatch = 32;
+constexpr std::size_t kMaxDatagram = 64 * 1024;
+
+std::string endpointName(const boost::asio::ip::udp::endpoint& endpoint) {
+    return endpoint.address().to_string() + ":" + std::to_string(endpoint.port());
+}
+
+} // namespace
+
+/*!
+    \fn MulticastNetworkInterface::MulticastNetworkInterface()
+    \brief Constructs an unopened interface sending JSON datagrams of at most 1400 bytes.
+
+    1400 bytes keeps datagrams inside a typical Ethernet MTU, avoiding IP fragmentation.
+*/
+MulticastNetworkInterface::MulticastNetworkInterface()
+    : m_socket(m_context),
+      m_timeToLive(1),
+      m_maxDatagramSize(1400),
+      m_format(wire::WireFormat::Json),
+      m_sequence(0),
+      m_buffers(kReadBatch, std::vector<char>(kMaxDatagram)),
+      m_receiving(false) {}
+
+MulticastNetworkInterface::~MulticastNetworkInterface() {
+    close();
+}
+
+void MulticastNetworkInterface::setInterface(const std::string& address) {
+    m_interface = boost::asio::ip::make_address(address);
+}
+
+void MulticastNetworkInterface::setTimeToLive(int hops) {
+    m_timeToLive = hops;
+}
+
+void MulticastNetworkInterface::setMaxDatagramSize(std::size_t bytes) {
+    m_maxDatagramSize = std::min(std::max(bytes, wire::kDatagramHeaderSize + wire::kEmitterRecordSize * 2), kMaxDatagram);
+}
+
+/*!
+    \fn void MulticastNetworkInterface::initialise(const std::string& address, unsigned short port)
+    \brief Binds to \a port and joins the multicast group \a address.
+
+    Loopback is enabled so senders and receivers on the same host, including
+    within one process, see each other's datagrams.
+*/
+void MulticastNetworkInterface::initialise(const std::string& address, unsigned short port) {
+    namespace multicast = boost::asio::ip::multicast;
+    using boost::asio::ip::udp;
+    try {
+        boost::asio::ip::address group = boost::asio::ip::make_address(address);
+        m_group = udp::endpoint(group, port);
+        m_socket.open(m_group.protocol());
+        m_socket.set_option(udp::socket::reuse_address(true));
+        m_socket.set_option(boost::asio::socket_base::receive_buffer_size(4 * 1024 * 1024));
+        m_socket.bind(udp::endpoint(group.is_v6() ? boost::asio::ip::address(boost::asio::ip::address_v6::any())
+                                                  : boost::asio::ip::address(boost::asio::ip::address_v4::any()), port));
+        if (group.is_v4() && m_interface.is_v4() && !m_interface.is_unspecified()) {
+            m_socket.set_option(multicast::join_group(group.to_v4(), m_interface.to_v4()));
+            m_socket.set_option(multicast::outbound_interface(m_interface.to_v4()));
+        } else {
+            m_socket.set_option(multicast::join_group(group));
+        }
+        m_socket.set_option(multicast::enable_loopback(true));
+        m_socket.set_option(multicast::hops(m_timeToLive));
+    } catch (const std::exception& e) {
+        logError("Failed to initialize multicast socket: " + std::string(e.what()));
+        throw;
+    }
+}
+
+/*!
+    \fn bool MulticastNetworkInterface::negotiateWireFormat(wire::WireFormat format)
+    \brief Selects the format of sent datagrams.
+
+    There is no peer to negotiate with: every datagram names its own format and
+    receivers decode either, so this always succeeds.
+*/
+bool MulticastNetworkInterface::negotiateWireFormat(wire::WireFormat format) {
+    m_format = format;
+    return true;
+}
+
+/*!
+    \fn bool MulticastNetworkInterface::sendPacked(std::size_t count, Encode encode)
+    \brief Encodes \a count records with \a encode, packing them into as few datagrams as possible.
+    \return False if any record could not be encoded, did not fit in a datagram, or failed to send.
+
+    \a encode is called as encode(index, format, encoder, out). A record that
+    overflows the current datagram is re-encoded into a fresh one, so each
+    datagram's StringDef frames cover exactly the records it carries.
+*/
+template <typename Encode>
+bool MulticastNetworkInterface::sendPacked(std::size_t count, Encode encode) {
+    wire::WireFormat format = m_format;
+    wire::BinaryEncoder encoder;
+    std::string body;
+    bool ok = true;
+
+    for (std::size_t i = 0; i < count; ++i) {
+        std::size_t mark = body.size();
+        try {
+            if (!encode(i, format, encoder, body)) {
+                ok = false;
+                continue;
+            }
+            if (wire::kDatagramHeaderSize + body.size() > m_maxDatagramSize && mark > 0) {
+                body.resize(mark);
+                sendDatagram(format, body);
+                body.clear();
+                encoder.reset();
+                encode(i, format, encoder, body);
+            }
+            if (wire::kDatagramHeaderSize + body.size() > m_maxDatagramSize) {
+                logError("Record too large for a datagram, dropped");
+                body.clear();
+                encoder.reset();
+                ok = false;
+            }
+        } catch (const std::exception& e) {
+            logError("Failed to send datagram: " + std::string(e.what()));
+            body.clear();
+            encoder.reset();
+            ok = false;
+        }
+    }
+    if (!body.empty()) {
+        try {
+            sendDatagram(format, body);
+        } catch (const std::exception& e) {
+            logError("Failed to send datagram: " + std::string(e.what()));
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+/*!
+    \fn void MulticastNetworkInterface::sendDatagram(wire::WireFormat format, const std::string& body)
+    \brief Sends \a body to the group behind a datagram header carrying the next sequence number.
+*/
+void MulticastNetworkInterface::sendDatagram(wire::WireFormat format, const std::string& body) {
+    std::string header;
+    wire::putDatagramHeader(header, format, m_sequence.fetch_add(1, std::memory_order_relaxed));
+    std::array<boost::asio::const_buffer, 2> datagram{boost::asio::buffer(header), boost::asio::buffer(body)};
+    m_socket.send_to(datagram, m_group);
+}
+
+bool MulticastNetworkInterface::sendPE(const PE& pe) {
+    return sendPEBatch({pe});
+}
+
+bool MulticastNetworkInterface::sendEmitter(const Emitter& emitter) {
+    return sendEmitterBatch({emitter});
+}
+
+bool MulticastNetworkInterface::sendBlob(const std::string& blobString) {
+    return sendPacked(1, [&blobString](std::size_t, wire::WireFormat format, wire::BinaryEncoder& encoder, std::string& out) {
+        if (format == wire::WireFormat::Binary) {
+            encoder.encodeText(blobString, out);
+        } else {
+            out += blobString;
+            out += '\n';
+        }
+        return true;
+    });
+}
+
+bool MulticastNetworkInterface::sendComplexBlob(const PE& pe, const Emitter& emitter, const std::map<std::string, double>& doubleMap) {
+    std::string data = NetworkImplementation::serializeComplexBlob(pe, emitter, doubleMap);
+    data.pop_back();
+    return sendBlob(data);
+}
+
+bool MulticastNetworkInterface::sendPESetting(const std::string& setting, const std::string& id, int updateVal) {
+    return sendSettingsBatch({SettingUpdate{wire::SettingKind::PE, setting, id, updateVal}});
+}
+
+bool MulticastNetworkInterface::sendEmitterSetting(const std::string& setting, const std::string& id, int updateVal) {
+    return sendSettingsBatch({SettingUpdate{wire::SettingKind::Emitter, setting, id, updateVal}});
+}
+
+/*!
+    \fn bool MulticastNetworkInterface::sendPEBatch(const std::vector<PE>& pes)
+    \brief Sends the valid PEs in \a pes, packed into as few datagrams as possible.
+*/
+bool MulticastNetworkInterface::sendPEBatch(const std::vector<PE>& pes) {
+    return sendPacked(pes.size(), [&pes](std::size_t i, wire::WireFormat format, wire::BinaryEncoder& encoder, std::string& out) {
+        if (!NetworkImplementation::validatePE(pes[i])) {
+            logError("Invalid PE data");
+            return false;
+        }
+        if (format == wire::WireFormat::Binary) encoder.encodePE(pes[i], out);
+        else out += NetworkImplementation::serializePE(pes[i]);
+        return true;
+    });
+}
+
+bool MulticastNetworkInterface::sendEmitterBatch(const std::vector<Emitter>& emitters) {
+    return sendPacked(emitters.size(), [&emitters](std::size_t i, wire::WireFormat format, wire::BinaryEncoder& encoder, std::string& out) {
+        if (!NetworkImplementation::validateEmitter(emitters[i])) {
+            logError("Invalid Emitter data");
+            return false;
+        }
+        if (format == wire::WireFormat::Binary) encoder.encodeEmitter(emitters[i], out);
+        else out += NetworkImplementation::serializeEmitter(emitters[i]);
+        return true;
+    });
+}
+
+bool MulticastNetworkInterface::sendSettingsBatch(const std::vector<SettingUpdate>& settings) {
+    return sendPacked(settings.size(), [&settings](std::size_t i, wire::WireFormat format, wire::BinaryEncoder& encoder, std::string& out) {
+        const SettingUpdate& update = settings[i];
+        if (format == wire::WireFormat::Binary) {
+            encoder.encodeSetting(update.kind, update.id, update.setting, update.value, out);
+            return true;
+        }
+        QJsonObject json;
+        json["type"] = update.kind == wire::SettingKind::Emitter ? "EMITTER_SETTING" : "PE_SETTING";
+        json["id"] = QString::fromStdString(update.id);
+        json["setting"] = QString::fromStdString(update.setting);
+        json["value"] = update.value;
+        out += QJsonDocument(json).toJson(QJsonDocument::Compact).toStdString();
+        out += '\n';
+        return true;
+    });
+}
+
+/*!
+    \fn void MulticastNetworkInterface::setFlushThreshold(std::size_t bytes, std::chrono::microseconds delay)
+    \brief Has no effect, every send call packs and sends its datagrams immediately.
+*/
+void MulticastNetworkInterface::setFlushThreshold(std::size_t, std::chrono::microseconds) {}
+
+bool MulticastNetworkInterface::flush() {
+    return true;
+}
+
+/*!
+    \fn void MulticastNetworkInterface::startSending()
+    \brief Has no effect. Each send builds its datagrams on the calling thread and
+    hands each to the kernel in a single call, so sends are already safe to make
+    from several threads at once.
+*/
+void MulticastNetworkInterface::startSending() {}
+
+void MulticastNetworkInterface::stopSending() {}
+
+/*!
+    \fn MulticastNetworkInterface::Message MulticastNetworkInterface::nextMessage()
+    \brief Blocks until a decoded message is available and removes it from the pending queue.
+*/
+MulticastNetworkInterface::Message MulticastNetworkInterface::nextMessage() {
+    while (m_pending.empty()) {
+        m_socket.wait(boost::asio::ip::udp::socket::wait_read);
+        readDatagrams();
+    }
+    Message message = std::move(m_pending.front());
+    m_pending.pop_front();
+    return message;
+}
+
+std::tuple<std::string, std::string, std::string, int> MulticastNetworkInterface::receiveSetting() {
+    Message message = nextMessage();
+    if (auto* setting = std::get_if<Setting>(&message)) return std::move(*setting);
+    logError("Failed to receive Setting: next message is not a setting");
+    throw std::runtime_error("Next message is not a setting");
+}
+
+PE MulticastNetworkInterface::receivePE() {
+    Message message = nextMessage();
+    if (auto* pe = std::get_if<PE>(&message)) return std::move(*pe);
+    logError("Failed to receive PE: next message is not a PE");
+    throw std::runtime_error("Next message is not a PE");
+}
+
+/*!
+    \fn std::vector<PE> MulticastNetworkInterface::receivePEBatch()
+    \brief Receives every PE already read, reading from the socket only if none is.
+
+    Stops at the first pending message that is not a PE, which is left for the
+    matching receive call.
+*/
+std::vector<PE> MulticastNetworkInterface::receivePEBatch() {
+    while (m_pending.empty()) {
+        m_socket.wait(boost::asio::ip::udp::socket::wait_read);
+        readDatagrams();
+    }
+    std::vector<PE> result;
+    while (!m_pending.empty() && std::holds_alternative<PE>(m_pending.front())) {
+        result.push_back(std::move(std::get<PE>(m_pending.front())));
+        m_pending.pop_front();
+    }
+    if (result.empty()) {
+        logError("Failed to receive PE batch: next message is not a PE");
+        throw std::runtime_error("Next buffered message is not a PE");
+    }
+    return result;
+}
+
+Emitter MulticastNetworkInterface::receiveEmitter() {
+    Message message = nextMessage();
+    if (auto* emitter = std::get_if<Emitter>(&message)) return std::move(*emitter);
+    logError("Failed to receive Emitter: next message is not an Emitter");
+    throw std::runtime_error("Next message is not an Emitter");
+}
+
+std::vector<std::string> MulticastNetworkInterface::receiveBlob() {
+    Message message = nextMessage();
+    if (auto* text = std::get_if<std::string>(&message)) return {std::move(*text)};
+    logError("Failed to receive blob: next message is not a blob");
+    throw std::runtime_error("Next message is not a blob");
+}
+
+std::tuple<PE, Emitter, std::map<std::string, double>> MulticastNetworkInterface::receiveComplexBlob() {
+    Message message = nextMessage();
+    if (auto* text = std::get_if<std::string>(&message)) return NetworkImplementation::deserializeComplexBlob(*text);
+    logError("Failed to receive complex blob: next message is not a blob");
+    throw std::runtime_error("Next message is not a blob");
+}
+
+/*!
+    \fn std::size_t MulticastNetworkInterface::readDatagrams()
+    \brief Reads and decodes every datagram already queued on the socket without blocking.
+    \return The number of datagrams read.
+*/
+std::size_t MulticastNetworkInterface::readDatagrams() {
+    std::size_t total = 0;
+#ifdef __linux__
+    std::array<mmsghdr, kReadBatch> headers{};
+    std::array<iovec, kReadBatch> vectors{};
+    std::array<sockaddr_storage, kReadBatch> senders{};
+    for (;;) {
+        for (std::size_t i = 0; i < kReadBatch; ++i) {
+            vectors[i].iov_base = m_buffers[i].data();
+            vectors[i].iov_len = m_buffers[i].size();
+            headers[i].msg_hdr = msghdr{};
+            headers[i].msg_hdr.msg_iov = &vectors[i];
+            headers[i].msg_hdr.msg_iovlen = 1;
+            headers[i].msg_hdr.msg_name = &senders[i];
+            headers[i].msg_hdr.msg_namelen = sizeof(sockaddr_storage);
+        }
+        int count = ::recvmmsg(m_socket.native_handle(), headers.data(), kReadBatch, MSG_DONTWAIT, nullptr);
+        if (count < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) return total;
+            throw boost::system::system_error(errno, boost::system::system_category(), "recvmmsg");
+        }
+        for (int i = 0; i < count; ++i) {
+            boost::asio::ip::udp::endpoint sender;
+            std::memcpy(sender.data(), &senders[i], headers[i].msg_hdr.msg_namelen);
+            sender.resize(headers[i].msg_hdr.msg_namelen);
+            if (headers[i].msg_hdr.msg_flags & MSG_TRUNC) {
+                handleDatagram(sender, std::string_view()); // Counted as malformed
+                continue;
+            }
+            handleDatagram(sender, std::string_view(m_buffers[i].data(), headers[i].msg_len));
+        }
+        total += static_cast<std::size_t>(count);
+        if (static_cast<std::size_t>(count) < kReadBatch) return total;
+    }
+#else
+    while (m_socket.available() > 0) {
+        boost::asio::ip::udp::endpoint sender;
+        std::size_t bytes = m_socket.receive_from(boost::asio::buffer(m_buffers[0]), sender);
+        handleDatagram(sender, std::string_view(m_buffers[0].data(), bytes));
+        ++total;
+    }
+    return total;
+#endif
+}
+
+/*!
+    \fn void MulticastNetworkInterface::handleDatagram(const boost::asio::ip::udp::endpoint& sender, std::string_view datagram)
+    \brief Tracks the datagram's sequence number and decodes every record it carries.
+
+    A record that fails to decode is counted as malformed and skipped, the rest
+    of the datagram is still delivered.
+*/
+void MulticastNetworkInterface::handleDatagram(const boost::asio::ip::udp::endpoint& sender, std::string_view datagram) {
+    wire::DatagramHeader header;
+    bool valid = wire::parseDatagramHeader(datagram, header);
+    std::uint64_t malformed = valid ? 0 : 1;
+
+    if (valid) {
+        std::string_view body = datagram.substr(wire::kDatagramHeaderSize);
+        if (header.format == wire::WireFormat::Json) {
+            while (!body.empty()) {
+                std::size_t end = body.find('\n');
+                std::string_view line = body.substr(0, end);
+                body.remove_prefix(end == std::string_view::npos ? body.size() : end + 1);
+                if (line.empty()) continue;
+                try {
+                    switch (NetworkImplementation::classifyJsonFrame(line)) {
+                    case wire::FrameType::PE:
+                        deliver(NetworkImplementation::deserializePE(line));
+                        break;
+                    case wire::FrameType::Emitter:
+                        deliver(NetworkImplementation::deserializeEmitter(line));
+                        break;
+                    case wire::FrameType::Setting:
+                        deliver(NetworkImplementation::deserializeSetting(line));
+                        break;
+                    default:
+                        deliver(std::string(line));
+                        break;
+                    }
+                } catch (const std::exception&) {
+                    ++malformed;
+                }
+            }
+        } else {
+            m_decoder.reset();
+            while (body.size() >= wire::kHeaderSize) {
+                wire::FrameHeader frame;
+                if (!wire::parseHeader(body.data(), frame) || body.size() < wire::kHeaderSize + frame.length) {
+                    ++malformed;
+                    break;
+                }
+                std::string_view payload = body.substr(wire::kHeaderSize, frame.length);
+                body.remove_prefix(wire::kHeaderSize + frame.length);
+                try {
+                    switch (frame.type) {
+                    case wire::FrameType::StringDef:
+                        if (!m_decoder.applyStringDef(payload)) ++malformed;
+                        break;
+                    case wire::FrameType::PE:
+                        deliver(m_decoder.decodePE(payload));
+                        break;
+                    case wire::FrameType::Emitter:
+                        deliver(m_decoder.decodeEmitter(payload));
+                        break;
+                    case wire::FrameType::Setting:
+                        deliver(m_decoder.decodeSetting(payload));
+                        break;
+                    case wire::FrameType::Text:
+                        deliver(std::string(payload));
+                        break;
+                    }
+                } catch (const std::exception&) {
+                    ++malformed;
+                }
+            }
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(m_sourcesMutex);
+    Source& source = m_sources[sender];
+    ++source.stats.datagrams;
+    source.stats.malformed += malformed;
+    if (valid) trackSequence(source, header.sequence);
+}
+
+/*!
+    \fn void MulticastNetworkInterface::trackSequence(Source& source, std::uint32_t sequence)
+    \brief Updates the lost, reordered and duplicate counts of \a source for a datagram numbered \a sequence.
+
+    The source remembers which of the last kSequenceWindow sequence numbers
+    arrived. A datagram filling a gap counted earlier is reordered and no longer
+    lost, while one whose number already arrived is a duplicate and leaves the
+    lost count alone. Gaps that slide out of the window stay lost.
+*/
+void MulticastNetworkInterface::trackSequence(Source& source, std::uint32_t sequence) {
+    auto distance = static_cast<std::int32_t>(sequence - source.expected);
+    if (!source.seen || distance < -static_cast<std::int32_t>(kSequenceWindow)) {
+        source.seen = true;
+        source.received.reset();
+    } else if (distance >= 0) {
+        source.stats.lost += static_cast<std::uint32_t>(distance);
+        if (static_cast<std::uint32_t>(distance) >= kSequenceWindow) {
+            source.received.reset();
+        } else {
+            for (std::uint32_t skipped = source.expected; skipped != sequence; ++skipped) {
+                source.received.reset(skipped % kSequenceWindow);
+            }
+        }
+    } else {
+        if (source.received.test(sequence % kSequenceWindow)) {
+            ++source.stats.duplicates;
+        } else {
+            source.received.set(sequence % kSequenceWindow);
+            ++source.stats.reordered;
+            if (source.stats.lost > 0) --source.stats.lost; // Not a gap if sent before the first one seen
+        }
+        return;
+    }
+    source.received.set(sequence % kSequenceWindow);
+    source.expected = sequence + 1;
+}
+
+/*!
+    \fn void MulticastNetworkInterface::deliver(Message&& message)
+    \brief Passes a decoded message to the receive handlers, or queues it for the blocking receive calls.
+*/
+void MulticastNetworkInterface::deliver(Message&& message) {
+    if (!m_receiving) {
+        m_pending.push_back(std::move(message));
+        return;
+    }
+    if (auto* pe = std::get_if<PE>(&message)) {
+        if (m_handlers.onPE) m_handlers.onPE(*pe);
+    } else if (auto* emitter = std::get_if<Emitter>(&message)) {
+        if (m_handlers.onEmitter) m_handlers.onEmitter(*emitter);
+    } else if (auto* setting = std::get_if<Setting>(&message)) {
+        if (m_handlers.onSetting) m_handlers.onSetting(*setting);
+    } else {
+        const std::string& text = std::get<std::string>(message);
+        if (wire::classifyJsonMessage(text) == wire::JsonMessageKind::ComplexBlob) {
+            if (m_handlers.onComplexBlob) m_handlers.onComplexBlob(NetworkImplementation::deserializeComplexBlob(text));
+        } else if (m_handlers.onBlob) {
+            m_handlers.onBlob(text);
+        }
+    }
+}
+
+/*!
+    \fn void MulticastNetworkInterface::startReceiving(const ReceiveHandlers& handlers)
+    \brief Starts decoding incoming datagrams on a dedicated thread.
+
+    The thread waits for the socket to become readable, then drains every queued
+    datagram in batches before waiting again. Messages already pending from the
+    blocking receive calls are delivered first.
+*/
+void MulticastNetworkInterface::startReceiving(const ReceiveHandlers& handlers) {
+    if (m_receiving.exchange(true)) {
+        logError("Receive thread already running");
+        return;
+    }
+    m_handlers = handlers;
+    while (!m_pending.empty()) {
+        Message message = std::move(m_pending.front());
+        m_pending.pop_front();
+        deliver(std::move(message));
+    }
+    m_context.restart();
+    waitNextAsync();
+    m_receiveThread = std::thread([this] { m_context.run(); });
+}
+
+void MulticastNetworkInterface::waitNextAsync() {
+    m_socket.async_wait(boost::asio::ip::udp::socket::wait_read, [this](const boost::system::error_code& ec) {
+        if (ec || !m_receiving) return;
+        try {
+            readDatagrams();
+        } catch (const std::exception& e) {
+            if (m_handlers.onError) m_handlers.onError(e.what());
+        }
+        waitNextAsync();
+    });
+}
+
+void MulticastNetworkInterface::stopReceiving() {
+    if (m_receiving.exchange(false)) {
+        boost::asio::post(m_context, [this] {
+            boost::system::error_code ec;
+            m_socket.cancel(ec);
+        });
+    }
+    if (m_receiveThread.joinable() && m_receiveThread.get_id() != std::this_thread::get_id()) {
+        m_receiveThread.join();
+    }
+}
+
+void MulticastNetworkInterface::close() {
+    stopReceiving();
+    if (m_socket.is_open()) {
+        boost::system::error_code ec;
+        m_socket.set_option(boost::asio::ip::multicast::leave_group(m_group.address()), ec);
+        m_socket.close(ec);
+        if (ec) logError("Failed to close socket: " + ec.message());
+    }
+}
+
+/*!
+    \fn std::vector<MulticastSourceStats> MulticastNetworkInterface::sourceStats() const
+    \brief Returns the datagram, loss, reordering and duplicate counts for every sender seen so far.
+*/
+std::vector<MulticastSourceStats> MulticastNetworkInterface::sourceStats() const {
+    std::lock_guard<std::mutex> lock(m_sourcesMutex);
+    std::vector<MulticastSourceStats> result;
+    result.reserve(m_sources.size());
+    for (const auto& [endpoint, source] : m_sources) {
+        result.push_back(source.stats);
+        result.back().source = endpointName(endpoint);
+    }
+    return result;
+}
+
+void MulticastNetworkInterface::logError(const std::string& message) {
+    LOG_ERROR("MulticastNetworkInterface Error: {}", message);
+}
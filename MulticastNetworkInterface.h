@@ -0,0 +1,110 @@
+#ifndef MULTICASTNETWORKINTERFACE_H
+#define MULTICASTNETWORKINTERFACE_H
+
+#include <boost/asio.hpp>
+#include <atomic>
+#include <bitset>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <variant>
+#include <vector>
+#include "AbstractNetworkInterface.h"
+
+// Sequence tracking for one multicast sender
+struct MulticastSourceStats {
+    std::string source;      // Sender address:port
+    std::uint64_t datagrams;
+    std::uint64_t lost;       // Sequence numbers skipped and not yet seen late
+    std::uint64_t reordered;  // Datagrams that arrived after a later one
+    std::uint64_t duplicates; // Datagrams whose sequence number was already received
+    std::uint64_t malformed; // Datagrams or records that could not be decoded
+};
+
+class MulticastNetworkInterface : public AbstractNetworkInterface {
+public:
+    MulticastNetworkInterface();
+    ~MulticastNetworkInterface() override;
+
+    // Local interface address to join the group on and send from, e.g. "127.0.0.1". Call before initialise().
+    void setInterface(const std::string& address);
+    void setTimeToLive(int hops);
+    // Largest datagram sent, records are packed into datagrams up to this size
+    void setMaxDatagramSize(std::size_t bytes);
+
+    // Joins multicast group `address` on `port`, sends go to the same group
+    void initialise(const std::string& address, unsigned short port) override;
+    bool negotiateWireFormat(wire::WireFormat format) override;
+    bool sendPE(const PE& pe) override;
+    bool sendEmitter(const Emitter& emitter) override;
+    bool sendBlob(const std::string& blobString) override;
+    bool sendComplexBlob(const PE& pe, const Emitter& emitter, const std::map<std::string, double>& doubleMap) override;
+    bool sendPESetting(const std::string& setting, const std::string& id, int updateVal) override;
+    bool sendEmitterSetting(const std::string& setting, const std::string& id, int updateVal) override;
+    bool sendPEBatch(const std::vector<PE>& pes) override;
+    bool sendEmitterBatch(const std::vector<Emitter>& emitters) override;
+    bool sendSettingsBatch(const std::vector<SettingUpdate>& settings) override;
+    void setFlushThreshold(std::size_t bytes, std::chrono::microseconds delay) override;
+    bool flush() override;
+    std::tuple<std::string, std::string, std::string, int> receiveSetting() override;
+    PE receivePE() override;
+    std::vector<PE> receivePEBatch() override;
+    Emitter receiveEmitter() override;
+    std::vector<std::string> receiveBlob() override;
+    std::tuple<PE, Emitter, std::map<std::string, double>> receiveComplexBlob() override;
+    void startReceiving(const ReceiveHandlers& handlers) override;
+    void stopReceiving() override;
+    void startSending() override;
+    void stopSending() override;
+    void close() override;
+
+    std::vector<MulticastSourceStats> sourceStats() const;
+
+private:
+    using Setting = std::tuple<std::string, std::string, std::string, int>;
+    using Message = std::variant<PE, Emitter, Setting, std::string>;
+
+    // Sequence numbers further back than this are taken as the sender restarting
+    static constexpr std::uint32_t kSequenceWindow = 1024;
+
+    struct Source {
+        bool seen = false;
+        std::uint32_t expected = 0;
+        std::bitset<kSequenceWindow> received; // Which of the last kSequenceWindow sequence numbers arrived
+        MulticastSourceStats stats{};
+    };
+
+    template <typename Encode>
+    bool sendPacked(std::size_t count, Encode encode);
+    void sendDatagram(wire::WireFormat format, const std::string& body);
+    Message nextMessage();
+    std::size_t readDatagrams();
+    void handleDatagram(const boost::asio::ip::udp::endpoint& sender, std::string_view datagram);
+    void trackSequence(Source& source, std::uint32_t sequence);
+    void deliver(Message&& message);
+    void waitNextAsync();
+    static void logError(const std::string& message);
+
+    boost::asio::io_context m_context;
+    boost::asio::ip::udp::socket m_socket;
+    boost::asio::ip::udp::endpoint m_group;
+    boost::asio::ip::address m_interface;
+    int m_timeToLive;
+    std::size_t m_maxDatagramSize;
+    std::atomic<wire::WireFormat> m_format;
+    std::atomic<std::uint32_t> m_sequence;
+
+    std::vector<std::vector<char>> m_buffers;
+    wire::BinaryDecoder m_decoder;
+    std::deque<Message> m_pending;
+    mutable std::mutex m_sourcesMutex;
+    std::map<boost::asio::ip::udp::endpoint, Source> m_sources;
+
+    ReceiveHandlers m_handlers;
+    std::thread m_receiveThread;
+    std::atomic<bool> m_receiving;
+};
+
+#endif // MULTICASTNETWORKINTERFACE_H
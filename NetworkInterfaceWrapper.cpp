@@ -1,6 +1,7 @@
 #include "NetworkInterfaceWrapper.h"
 #include <QJsonObject>
 #include <QJsonArray>
+#include <QMetaMethod>
 
 /*!
     \class NetworkInterfaceWrapper
@@ -13,8 +14,19 @@
 */
 
 NetworkInterfaceWrapper::NetworkInterfaceWrapper(AbstractNetworkInterface* interface, QObject *parent)
-    : QObject(parent), m_interface(interface)
+    : QObject(parent), m_interface(interface), m_coalesceWindow(0), m_deliveryQueued(false),
+      m_pesDelivered(0), m_deliveries(0), m_largestDelivery(0)
 {
+    connect(&m_flushTimer, &QTimer::timeout, this, &NetworkInterfaceWrapper::flush);
+    m_coalesceTimer.setSingleShot(true);
+    connect(&m_coalesceTimer, &QTimer::timeout, this, &NetworkInterfaceWrapper::flushSettings);
+}
+
+NetworkInterfaceWrapper::~NetworkInterfaceWrapper()
+{
+    // The receive handlers capture this object, stop them before it goes away
+    m_interface->stopReceiving();
+    m_interface->stopSending();
 }
 
 /*!
@@ -35,6 +47,31 @@ void NetworkInterfaceWrapper::initialise(const QString& address, unsigned short
     }
 }
 
+/*!
+    \fn bool NetworkInterfaceWrapper::negotiateWireFormat(const QString& format)
+    \brief Switches the connection to a different wire format.
+    \param format Either "json" or "binary".
+    \return True if the peer accepted the format, false otherwise.
+
+    If the format name is unknown or negotiation fails, it emits an error signal with a description.
+*/
+bool NetworkInterfaceWrapper::negotiateWireFormat(const QString& format)
+{
+    wire::WireFormat requested;
+    if (!wire::parseFormatName(format.toStdString(), requested)) {
+        emit error(QString("Unknown wire format: %1").arg(format));
+        return false;
+    }
+    try {
+        if (m_interface->negotiateWireFormat(requested)) return true;
+        emit error(QString("Peer declined wire format: %1").arg(format));
+        return false;
+    } catch (const std::exception& e) {
+        emit error(QString("Failed to negotiate wire format: %1").arg(e.what()));
+        return false;
+    }
+}
+
 /*!
     \fn bool NetworkInterfaceWrapper::sendPE(const QVariantMap& pe)
     \brief Sends a Platform Element (PE) over the network.
@@ -121,11 +158,17 @@ bool NetworkInterfaceWrapper::sendComplexBlob(const QVariantMap& pe, const QVari
     \param updateVal The new value for the setting.
     \return True if the setting was sent successfully, false otherwise.
 
-    This function sends an update for a specific PE setting.
+    This function sends an update for a specific PE setting. While a coalescing
+    window is set the update is queued instead, see setSettingCoalescingWindow().
     If an error occurs, it emits an error signal with a description.
 */
 bool NetworkInterfaceWrapper::sendPESetting(const QString& setting, const QString& id, int updateVal)
 {
+    if (m_coalesceWindow > 0) {
+        m_settingCoalescer.add(SettingUpdate{wire::SettingKind::PE, setting.toStdString(), id.toStdString(), updateVal});
+        if (!m_coalesceTimer.isActive()) m_coalesceTimer.start(m_coalesceWindow);
+        return true;
+    }
     try {
         return m_interface->sendPESetting(setting.toStdString(), id.toStdString(), updateVal);
     } catch (const std::exception& e) {
@@ -142,11 +185,17 @@ bool NetworkInterfaceWrapper::sendPESetting(const QString& setting, const QStrin
     \param updateVal The new value for the setting.
     \return True if the setting was sent successfully, false otherwise.
 
-    This function sends an update for a specific Emitter setting.
+    This function sends an update for a specific Emitter setting. While a coalescing
+    window is set the update is queued instead, see setSettingCoalescingWindow().
     If an error occurs, it emits an error signal with a description.
 */
 bool NetworkInterfaceWrapper::sendEmitterSetting(const QString& setting, const QString& id, int updateVal)
 {
+    if (m_coalesceWindow > 0) {
+        m_settingCoalescer.add(SettingUpdate{wire::SettingKind::Emitter, setting.toStdString(), id.toStdString(), updateVal});
+        if (!m_coalesceTimer.isActive()) m_coalesceTimer.start(m_coalesceWindow);
+        return true;
+    }
     try {
         return m_interface->sendEmitterSetting(setting.toStdString(), id.toStdString(), updateVal);
     } catch (const std::exception& e) {
@@ -155,6 +204,181 @@ bool NetworkInterfaceWrapper::sendEmitterSetting(const QString& setting, const Q
     }
 }
 
+/*!
+    \fn bool NetworkInterfaceWrapper::sendPEBatch(const QVariantList& pes)
+    \brief Sends many Platform Elements (PEs) with a single write.
+    \param pes A QVariantList of QVariantMaps, each representing a PE.
+    \return True if every PE was queued or sent successfully, false otherwise.
+
+    The PEs are written once the flush threshold set by setFlushThreshold() is reached.
+    If an error occurs, it emits an error signal with a description.
+*/
+bool NetworkInterfaceWrapper::sendPEBatch(const QVariantList& pes)
+{
+    try {
+        std::vector<PE> batch;
+        batch.reserve(pes.size());
+        for (const QVariant& pe : pes) {
+            batch.push_back(convertToPE(pe.toMap()));
+        }
+        return m_interface->sendPEBatch(batch);
+    } catch (const std::exception& e) {
+        emit error(QString("Failed to send PE batch: %1").arg(e.what()));
+        return false;
+    }
+}
+
+/*!
+    \fn bool NetworkInterfaceWrapper::sendEmitterBatch(const QVariantList& emitters)
+    \brief Sends many Emitters with a single write.
+    \param emitters A QVariantList of QVariantMaps, each representing an Emitter.
+    \return True if every Emitter was queued or sent successfully, false otherwise.
+
+    The Emitters are written once the flush threshold set by setFlushThreshold() is reached.
+    If an error occurs, it emits an error signal with a description.
+*/
+bool NetworkInterfaceWrapper::sendEmitterBatch(const QVariantList& emitters)
+{
+    try {
+        std::vector<Emitter> batch;
+        batch.reserve(emitters.size());
+        for (const QVariant& emitter : emitters) {
+            batch.push_back(convertToEmitter(emitter.toMap()));
+        }
+        return m_interface->sendEmitterBatch(batch);
+    } catch (const std::exception& e) {
+        emit error(QString("Failed to send Emitter batch: %1").arg(e.what()));
+        return false;
+    }
+}
+
+/*!
+    \fn bool NetworkInterfaceWrapper::sendSettingsBatch(const QVariantList& settings)
+    \brief Sends many PE and Emitter setting updates with a single write.
+    \param settings A QVariantList of [type, id, setting, value] lists, as returned by receiveSetting().
+    \return True if every setting was queued or sent successfully, false otherwise.
+
+    The type is either "PE_SETTING" or "EMITTER_SETTING".
+    If an error occurs, it emits an error signal with a description.
+*/
+bool NetworkInterfaceWrapper::sendSettingsBatch(const QVariantList& settings)
+{
+    try {
+        std::vector<SettingUpdate> batch;
+        batch.reserve(settings.size());
+        for (const QVariant& entry : settings) {
+            QVariantList fields = entry.toList();
+            if (fields.size() != 4) {
+                emit error(QString("Failed to send settings batch: malformed setting entry"));
+                return false;
+            }
+            batch.push_back(SettingUpdate{
+                fields[0].toString() == "EMITTER_SETTING" ? wire::SettingKind::Emitter : wire::SettingKind::PE,
+                fields[2].toString().toStdString(),
+                fields[1].toString().toStdString(),
+                fields[3].toInt()
+            });
+        }
+        return m_interface->sendSettingsBatch(batch);
+    } catch (const std::exception& e) {
+        emit error(QString("Failed to send settings batch: %1").arg(e.what()));
+        return false;
+    }
+}
+
+/*!
+    \fn void NetworkInterfaceWrapper::setFlushThreshold(int bytes, int microseconds)
+    \brief Sets when batched sends are written.
+    \param bytes Write once this many bytes are pending, 0 to disable.
+    \param microseconds Write once the oldest pending record is this old, 0 to disable.
+
+    With both at 0 every batch is written immediately. A non-zero delay also
+    starts a timer that flushes pending records at that interval, so the last
+    batch before the feed goes quiet is not held back indefinitely.
+*/
+void NetworkInterfaceWrapper::setFlushThreshold(int bytes, int microseconds)
+{
+    m_interface->setFlushThreshold(static_cast<std::size_t>(qMax(0, bytes)),
+                                   std::chrono::microseconds(qMax(0, microseconds)));
+    if (microseconds > 0) {
+        m_flushTimer.start(qMax(1, microseconds / 1000));
+    } else {
+        m_flushTimer.stop();
+    }
+}
+
+/*!
+    \fn bool NetworkInterfaceWrapper::flush()
+    \brief Writes all pending batched sends.
+    \return True if the write succeeded or nothing was pending, false otherwise.
+*/
+bool NetworkInterfaceWrapper::flush()
+{
+    try {
+        if (m_interface->flush()) return true;
+        emit error(QString("Failed to flush batched sends"));
+        return false;
+    } catch (const std::exception& e) {
+        emit error(QString("Failed to flush batched sends: %1").arg(e.what()));
+        return false;
+    }
+}
+
+/*!
+    \fn void NetworkInterfaceWrapper::setSettingCoalescingWindow(int milliseconds)
+    \brief Coalesces PE and Emitter setting updates over a time window.
+    \param milliseconds The window length, 0 to send every update immediately.
+
+    While a window is set, sendPESetting() and sendEmitterSetting() only record
+    the latest value per (type, id, setting). The first update in a window starts
+    a timer, and when it fires the surviving updates are sent as one batch.
+    Disabling coalescing sends anything still pending.
+*/
+void NetworkInterfaceWrapper::setSettingCoalescingWindow(int milliseconds)
+{
+    m_coalesceWindow = qMax(0, milliseconds);
+    if (m_coalesceWindow == 0) {
+        m_coalesceTimer.stop();
+        flushSettings();
+    }
+}
+
+/*!
+    \fn bool NetworkInterfaceWrapper::flushSettings()
+    \brief Sends the coalesced setting updates now.
+    \return True if the updates were sent or nothing was pending, false otherwise.
+
+    If an error occurs, it emits an error signal with a description.
+*/
+bool NetworkInterfaceWrapper::flushSettings()
+{
+    m_coalesceTimer.stop();
+    if (m_settingCoalescer.empty()) return true;
+    try {
+        if (m_interface->sendSettingsBatch(m_settingCoalescer.take())) return true;
+        emit error(QString("Failed to send coalesced settings"));
+        return false;
+    } catch (const std::exception& e) {
+        emit error(QString("Failed to send coalesced settings: %1").arg(e.what()));
+        return false;
+    }
+}
+
+/*!
+    \fn QVariantMap NetworkInterfaceWrapper::settingCoalescingStats() const
+    \brief Returns setting coalescing statistics.
+    \return A QVariantMap with the number of updates "received" from callers,
+    the number "sent" on the network and their "ratio".
+*/
+QVariantMap NetworkInterfaceWrapper::settingCoalescingStats() const
+{
+    return QVariantMap{
+        {"received", static_cast<qulonglong>(m_settingCoalescer.received())},
+        {"sent", static_cast<qulonglong>(m_settingCoalescer.sent())},
+        {"ratio", m_settingCoalescer.ratio()}
+    };
+}
+
 /*!
     \fn QVariantList NetworkInterfaceWrapper::receiveSetting()
     \brief Receives a setting update.
@@ -193,6 +417,28 @@ QVariantMap NetworkInterfaceWrapper::receivePE()
     }
 }
 
+/*!
+    \fn QVariantList NetworkInterfaceWrapper::receivePEBatch()
+    \brief Receives every Platform Element (PE) already buffered.
+    \return A QVariantList of QVariantMaps representing the received PEs, or an empty list if an error occurred.
+
+    This function blocks only until at least one PE is available.
+    If an error occurs, it emits an error signal with a description.
+*/
+QVariantList NetworkInterfaceWrapper::receivePEBatch()
+{
+    try {
+        QVariantList result;
+        for (const PE& pe : m_interface->receivePEBatch()) {
+            result.append(convertFromPE(pe));
+        }
+        return result;
+    } catch (const std::exception& e) {
+        emit error(QString("Failed to receive PE batch: %1").arg(e.what()));
+        return QVariantList();
+    }
+}
+
 /*!
     \fn QVariantMap NetworkInterfaceWrapper::receiveEmitter()
     \brief Receives an Emitter.
@@ -257,6 +503,130 @@ QVariantList NetworkInterfaceWrapper::receiveComplexBlob()
     }
 }
 
+/*!
+    \fn void NetworkInterfaceWrapper::startReceiving()
+    \brief Starts pushing received messages to Qt instead of blocking on receive calls.
+
+    Messages are decoded on the network receive thread and delivered on this
+    object's thread through the peRecordsReceived, pesReceived,
+    emittersReceived, settingsReceived and complexBlobsReceived signals.
+    Messages that arrive while a delivery is already queued are batched into
+    it, so a saturated feed costs one queued event per batch rather than one
+    per message. PEs and Emitters are only converted to QVariantMaps for
+    pesReceived and emittersReceived while those signals are connected.
+*/
+void NetworkInterfaceWrapper::startReceiving()
+{
+    ReceiveHandlers handlers;
+    // Converting to QVariant costs more than decoding, so it is only done for signals something listens to
+    handlers.onPE = [this](const PE& pe) {
+        QVariant converted;
+        bool convert = isSignalConnected(QMetaMethod::fromSignal(&NetworkInterfaceWrapper::pesReceived));
+        if (convert) converted = convertFromPE(pe);
+        QMutexLocker locker(&m_pendingMutex);
+        m_pendingPERecords.push_back(pe);
+        if (convert) m_pendingPEs.append(converted);
+        queueDeliveryLocked();
+    };
+    handlers.onEmitter = [this](const Emitter& emitter) {
+        if (isSignalConnected(QMetaMethod::fromSignal(&NetworkInterfaceWrapper::emittersReceived))) {
+            queueReceived(m_pendingEmitters, convertFromEmitter(emitter));
+        }
+    };
+    handlers.onSetting = [this](const std::tuple<std::string, std::string, std::string, int>& update) {
+        const auto& [type, id, setting, value] = update;
+        queueReceived(m_pendingSettings, QVariantList{QString::fromStdString(type), QString::fromStdString(id),
+                                                      QString::fromStdString(setting), value});
+    };
+    handlers.onComplexBlob = [this](const std::tuple<PE, Emitter, std::map<std::string, double>>& blob) {
+        const auto& [pe, emitter, doubleMap] = blob;
+        QVariantMap convertedDoubleMap;
+        for (const auto& [key, value] : doubleMap) {
+            convertedDoubleMap[QString::fromStdString(key)] = value;
+        }
+        queueReceived(m_pendingComplexBlobs, QVariantList{convertFromPE(pe), convertFromEmitter(emitter), convertedDoubleMap});
+    };
+    handlers.onError = [this](const std::string& message) {
+        QString text = QString("Receive error: %1").arg(QString::fromStdString(message));
+        QMetaObject::invokeMethod(this, [this, text] { emit error(text); }, Qt::QueuedConnection);
+    };
+
+    m_pesDelivered = 0;
+    m_deliveries = 0;
+    m_largestDelivery = 0;
+    m_deliveryClock.start();
+    try {
+        m_interface->startReceiving(handlers);
+    } catch (const std::exception& e) {
+        emit error(QString("Failed to start receiving: %1").arg(e.what()));
+    }
+}
+
+/*!
+    \fn void NetworkInterfaceWrapper::stopReceiving()
+    \brief Stops the receive thread started by startReceiving().
+
+    Messages already decoded are still delivered.
+*/
+void NetworkInterfaceWrapper::stopReceiving()
+{
+    try {
+        m_interface->stopReceiving();
+    } catch (const std::exception& e) {
+        emit error(QString("Failed to stop receiving: %1").arg(e.what()));
+    }
+}
+
+/*!
+    \fn QVariantMap NetworkInterfaceWrapper::receiveStats() const
+    \brief Returns how many PEs have been delivered to Qt since startReceiving(), and how fast.
+
+    The signals are emitted synchronously to their receivers on this object's
+    thread, so pesPerSecond is the sustained rate the receivers absorbed. A
+    largestDelivery far above one means deliveries are queuing up behind them.
+*/
+QVariantMap NetworkInterfaceWrapper::receiveStats() const
+{
+    double elapsed = m_deliveryClock.isValid() ? m_deliveryClock.elapsed() / 1000.0 : 0.0;
+    QVariantMap stats;
+    stats["pesDelivered"] = m_pesDelivered;
+    stats["deliveries"] = m_deliveries;
+    stats["largestDelivery"] = m_largestDelivery;
+    stats["elapsedSeconds"] = elapsed;
+    stats["pesPerSecond"] = elapsed > 0 ? m_pesDelivered / elapsed : 0.0;
+    return stats;
+}
+
+/*!
+    \fn void NetworkInterfaceWrapper::startSending()
+    \brief Moves all socket writes to a background writer thread.
+
+    Sends return as soon as their frames are queued, so the GUI thread never
+    blocks on a slow peer, and worker threads may send through the same
+    interface concurrently.
+*/
+void NetworkInterfaceWrapper::startSending()
+{
+    try {
+        m_interface->startSending();
+    } catch (const std::exception& e) {
+        emit error(QString("Failed to start sending: %1").arg(e.what()));
+    }
+}
+
+/*!
+    \fn void NetworkInterfaceWrapper::stopSending()
+    \brief Writes anything still queued and stops the writer thread started by startSending().
+*/
+void NetworkInterfaceWrapper::stopSending()
+{
+    try {
+        m_interface->stopSending();
+    } catch (const std::exception& e) {
+        emit error(QString("Failed to stop sending: %1").arg(e.what()));
+    }
+}
+
 /*!
     \fn void NetworkInterfaceWrapper::close()
     \brief Closes the network connection.
@@ -275,6 +645,51 @@ void NetworkInterfaceWrapper::close()
 
 // Helper functions - private methods
 
+void NetworkInterfaceWrapper::queueReceived(QVariantList& pending, const QVariant& value)
+{
+    QMutexLocker locker(&m_pendingMutex);
+    queueReceivedLocked(pending, value);
+}
+
+void NetworkInterfaceWrapper::queueReceivedLocked(QVariantList& pending, const QVariant& value)
+{
+    pending.append(value);
+    queueDeliveryLocked();
+}
+
+void NetworkInterfaceWrapper::queueDeliveryLocked()
+{
+    if (!m_deliveryQueued) {
+        m_deliveryQueued = true;
+        QMetaObject::invokeMethod(this, [this] { deliverPending(); }, Qt::QueuedConnection);
+    }
+}
+
+void NetworkInterfaceWrapper::deliverPending()
+{
+    QVariantList pes, emitters, settings, complexBlobs;
+    std::vector<PE> peRecords;
+    {
+        QMutexLocker locker(&m_pendingMutex);
+        pes.swap(m_pendingPEs);
+        peRecords.swap(m_pendingPERecords);
+        emitters.swap(m_pendingEmitters);
+        settings.swap(m_pendingSettings);
+        complexBlobs.swap(m_pendingComplexBlobs);
+        m_deliveryQueued = false;
+    }
+    if (!peRecords.empty()) {
+        emit peRecordsReceived(peRecords);
+        m_pesDelivered += peRecords.size();
+        ++m_deliveries;
+        m_largestDelivery = qMax(m_largestDelivery, static_cast<int>(peRecords.size()));
+    }
+    if (!pes.isEmpty()) emit pesReceived(pes);
+    if (!emitters.isEmpty()) emit emittersReceived(emitters);
+    if (!settings.isEmpty()) emit settingsReceived(settings);
+    if (!complexBlobs.isEmpty()) emit complexBlobsReceived(complexBlobs);
+}
+
 PE NetworkInterfaceWrapper::convertToPE(const QVariantMap& map)
 {
     PE pe(
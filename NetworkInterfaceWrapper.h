@@ -2,9 +2,13 @@
 #define NETWORKINTERFACEWRAPPER_H
 
 #include <QObject>
+#include <QElapsedTimer>
+#include <QMutex>
 #include <QString>
+#include <QTimer>
 #include <QVariant>
 #include "AbstractNetworkInterface.h"
+#include "SettingCoalescer.h"
 
 class NetworkInterfaceWrapper : public QObject
 {
@@ -12,27 +16,73 @@ class NetworkInterfaceWrapper : public QObject
 
 public:
     explicit NetworkInterfaceWrapper(AbstractNetworkInterface* interface, QObject *parent = nullptr);
+    ~NetworkInterfaceWrapper() override;
 
 public slots:
     void initialise(const QString& address, unsigned short port);
+    bool negotiateWireFormat(const QString& format);
     bool sendPE(const QVariantMap& pe);
     bool sendEmitter(const QVariantMap& emitter);
     bool sendBlob(const QString& blobString);
     bool sendComplexBlob(const QVariantMap& pe, const QVariantMap& emitter, const QVariantMap& doubleMap);
     bool sendPESetting(const QString& setting, const QString& id, int updateVal);
     bool sendEmitterSetting(const QString& setting, const QString& id, int updateVal);
+    bool sendPEBatch(const QVariantList& pes);
+    bool sendEmitterBatch(const QVariantList& emitters);
+    bool sendSettingsBatch(const QVariantList& settings);
+    void setFlushThreshold(int bytes, int microseconds);
+    bool flush();
+    void setSettingCoalescingWindow(int milliseconds);
+    bool flushSettings();
+    QVariantMap settingCoalescingStats() const;
     QVariantList receiveSetting();
     QVariantMap receivePE();
+    QVariantList receivePEBatch();
     QVariantMap receiveEmitter();
     QVariantList receiveBlob();
     QVariantList receiveComplexBlob();
+    void startReceiving();
+    void stopReceiving();
+    QVariantMap receiveStats() const;
+    void startSending();
+    void stopSending();
     void close();
 
 signals:
     void error(const QString& message);
+    void pesReceived(const QVariantList& pes);
+    // The same PEs as pesReceived, undecoded for C++ consumers such as EntityManager::upsertBatch
+    void peRecordsReceived(const std::vector<PE>& pes);
+    void emittersReceived(const QVariantList& emitters);
+    void settingsReceived(const QVariantList& settings);
+    void complexBlobsReceived(const QVariantList& blobs);
 
 private:
     AbstractNetworkInterface* m_interface;
+    QTimer m_flushTimer;
+    SettingCoalescer m_settingCoalescer;
+    QTimer m_coalesceTimer;
+    int m_coalesceWindow;
+
+    // Messages decoded on the receive thread, waiting for delivery on the GUI thread
+    QMutex m_pendingMutex;
+    QVariantList m_pendingPEs;
+    std::vector<PE> m_pendingPERecords;
+    QVariantList m_pendingEmitters;
+    QVariantList m_pendingSettings;
+    QVariantList m_pendingComplexBlobs;
+    bool m_deliveryQueued;
+
+    // Delivery throughput since startReceiving(), measured on this object's thread
+    QElapsedTimer m_deliveryClock;
+    quint64 m_pesDelivered;
+    quint64 m_deliveries;
+    int m_largestDelivery;
+
+    void queueReceived(QVariantList& pending, const QVariant& value);
+    void queueReceivedLocked(QVariantList& pending, const QVariant& value);
+    void queueDeliveryLocked();
+    void deliverPending();
 
     PE convertToPE(const QVariantMap& map);
     Emitter convertToEmitter(const QVariantMap& map);
@@ -4,11 +4,34 @@ QT += quick core webenginewidgets gui webchannel
 # In order to do so, uncomment the following line.
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
+# Log calls below this level are compiled out: 0 trace, 1 debug, 2 info, 3 warning, 4 error.
+# Defaults to 1 in debug builds and 2 in release builds.
+#DEFINES += LOG_MIN_LEVEL=3
+
+# Dead reckoning uses SSE2 on x86-64. Uncomment to process four entities per instruction
+# where every target machine has AVX.
+#QMAKE_CXXFLAGS += -mavx
+
 SOURCES += \
+        BatchWriter.cpp \
+        ClusterIndex.cpp \
         Entity.cpp \
         EntityManager.cpp \
+        EntityStore.cpp \
+        FeedManager.cpp \
+        FrameReader.cpp \
+        Geodesy.cpp \
+        JsonRecordDecoder.cpp \
+        Kinematics.cpp \
+        Log.cpp \
+        MulticastNetworkInterface.cpp \
         AbstractNetworkInterface.cpp \
         NetworkInterfaceWrapper.cpp \
+        ReplayNetworkInterface.cpp \
+        SettingCoalescer.cpp \
+        SpatialIndex.cpp \
+        WireCapture.cpp \
+        WireProtocol.cpp \
         main.cpp
 
 RESOURCES += qml.qrc
@@ -29,9 +52,26 @@ DISTFILES += \
     mapStyle.css
 
 HEADERS += \
+    BatchWriter.h \
+    ClusterIndex.h \
     Entity.h \
     EntityManager.h \
+    EntityStore.h \
+    FeedManager.h \
+    FrameReader.h \
+    Geodesy.h \
+    JsonRecordDecoder.h \
+    Kinematics.h \
+    Log.h \
+    MpscQueue.h \
+    MulticastNetworkInterface.h \
     AbstractNetworkInterface.h  \
     NetworkInterfaceWrapper.h \
+    ReplayNetworkInterface.h \
+    SettingCoalescer.h \
+    SnapshotPublisher.h \
+    SpatialIndex.h \
+    WireCapture.h \
+    WireProtocol.h \
     pe.h \
     emitter.h
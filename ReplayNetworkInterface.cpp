@@ -0,0 +1,362 @@
+#include "ReplayNetworkInterface.h"
+#include "Log.h"
+#include "JsonRecordDecoder.h"
+#include <stdexcept>
+
+/*!
+    \class ReplayNetworkInterface
+    \brief Replays a wire capture through the AbstractNetworkInterface receive API.
+
+    The capture is memory-mapped and decoded record by record with the same
+    JSON and binary decoders as NetworkImplementation, so the rest of the
+    application runs unchanged against recorded production traffic.
+
+    Each record is due at its capture time divided by the replay speed,
+    measured from a fixed anchor rather than by sleeping between records, so
+    timing does not drift however long the replay runs. At speed 0 records are
+    delivered as fast as they are consumed, and stats() then reports the
+    sustained rate the consumer can absorb. Sends are accepted and discarded.
+*/
+
+ReplayNetworkInterface::ReplayNetworkInterface()
+    : m_lastFormat(wire::WireFormat::Json),
+      m_speed(1.0),
+      m_anchored(false),
+      m_anchorTimestamp(0),
+      m_stats{},
+      m_receiving(false),
+      m_stopRequested(false) {}
+
+ReplayNetworkInterface::~ReplayNetworkInterface() {
+    close();
+}
+
+/*!
+    \fn void ReplayNetworkInterface::setSpeed(double speed)
+    \brief Sets the playback rate, 0 for as fast as possible.
+
+    The schedule is re-anchored at the next record, so a change takes effect
+    without a jump.
+*/
+void ReplayNetworkInterface::setSpeed(double speed) {
+    m_speed = speed < 0 ? 0 : speed;
+    m_anchored = false;
+    m_wake.notify_all();
+}
+
+void ReplayNetworkInterface::rewind() {
+    if (m_reader) m_reader->rewind();
+    m_record.reset();
+    m_peeked.reset();
+    m_decoder.reset();
+    m_lastFormat = wire::WireFormat::Json;
+    m_anchored = false;
+    std::lock_guard<std::mutex> lock(m_statsMutex);
+    m_stats = ReplayStats{};
+}
+
+/*!
+    \fn ReplayStats ReplayNetworkInterface::stats() const
+    \brief Returns the records and PEs delivered so far and the sustained PE rate.
+
+    The rate is measured from the first delivered record to now, or to the
+    last record once the capture is exhausted.
+*/
+ReplayStats ReplayNetworkInterface::stats() const {
+    std::lock_guard<std::mutex> lock(m_statsMutex);
+    ReplayStats result = m_stats;
+    if (result.records > 0) {
+        auto end = result.finished ? m_finishedAt : std::chrono::steady_clock::now();
+        result.elapsedSeconds = std::chrono::duration<double>(end - m_started).count();
+        result.pesPerSecond = result.elapsedSeconds > 0 ? result.pes / result.elapsedSeconds : 0.0;
+    }
+    return result;
+}
+
+/*!
+    \fn void ReplayNetworkInterface::initialise(const std::string& address, unsigned short port)
+    \brief Maps the capture file at \a address and rewinds to its first record.
+*/
+void ReplayNetworkInterface::initialise(const std::string& address, unsigned short) {
+    try {
+        m_reader = std::make_unique<wire::CaptureReader>(address);
+    } catch (const std::exception& e) {
+        logError("Failed to open capture: " + std::string(e.what()));
+        throw;
+    }
+    rewind();
+}
+
+/*!
+    \fn bool ReplayNetworkInterface::negotiateWireFormat(wire::WireFormat format)
+    \brief Always succeeds, each captured record carries the format it arrived in.
+*/
+bool ReplayNetworkInterface::negotiateWireFormat(wire::WireFormat) {
+    return true;
+}
+
+bool ReplayNetworkInterface::sendPE(const PE&) { return true; }
+bool ReplayNetworkInterface::sendEmitter(const Emitter&) { return true; }
+bool ReplayNetworkInterface::sendBlob(const std::string&) { return true; }
+bool ReplayNetworkInterface::sendComplexBlob(const PE&, const Emitter&, const std::map<std::string, double>&) { return true; }
+bool ReplayNetworkInterface::sendPESetting(const std::string&, const std::string&, int) { return true; }
+bool ReplayNetworkInterface::sendEmitterSetting(const std::string&, const std::string&, int) { return true; }
+bool ReplayNetworkInterface::sendPEBatch(const std::vector<PE>&) { return true; }
+bool ReplayNetworkInterface::sendEmitterBatch(const std::vector<Emitter>&) { return true; }
+bool ReplayNetworkInterface::sendSettingsBatch(const std::vector<SettingUpdate>&) { return true; }
+void ReplayNetworkInterface::setFlushThreshold(std::size_t, std::chrono::microseconds) {}
+bool ReplayNetworkInterface::flush() { return true; }
+void ReplayNetworkInterface::startSending() {}
+void ReplayNetworkInterface::stopSending() {}
+
+/*!
+    \fn std::optional<ReplayNetworkInterface::Message> ReplayNetworkInterface::nextMessage(bool wait)
+    \brief Returns the next decoded message once it is due.
+    \param wait Block until the next record is due, otherwise return nothing if it isn't due yet.
+    \return Nothing at the end of the capture, when not waiting and nothing is due, or when stopped.
+*/
+std::optional<ReplayNetworkInterface::Message> ReplayNetworkInterface::nextMessage(bool wait) {
+    if (!m_reader) throw std::runtime_error("Replay capture not initialised");
+    for (;;) {
+        if (!m_record) {
+            wire::CaptureRecord record;
+            if (!m_reader->next(record)) {
+                std::lock_guard<std::mutex> lock(m_statsMutex);
+                if (!m_stats.finished && m_stats.records > 0) m_finishedAt = std::chrono::steady_clock::now();
+                m_stats.finished = true;
+                return std::nullopt;
+            }
+            m_record = record;
+        }
+
+        if (!m_anchored) {
+            m_anchorTimestamp = m_record->timestamp;
+            m_anchorTime = std::chrono::steady_clock::now();
+            m_anchored = true;
+        }
+        auto due = dueTime(m_record->timestamp);
+        auto now = std::chrono::steady_clock::now();
+        if (now < due) {
+            if (!wait) return std::nullopt;
+            std::unique_lock<std::mutex> lock(m_wakeMutex);
+            m_wake.wait_until(lock, due, [this] { return m_stopRequested || !m_anchored; });
+            if (m_stopRequested) return std::nullopt;
+            continue; // Due now, or the speed changed and the schedule needs re-anchoring
+        }
+
+        wire::CaptureRecord record = *m_record;
+        m_record.reset();
+        std::optional<Message> message = decode(record);
+
+        std::lock_guard<std::mutex> lock(m_statsMutex);
+        if (m_stats.records++ == 0) m_started = now;
+        double lag = std::chrono::duration<double, std::milli>(now - due).count();
+        if (m_speed > 0 && lag > m_stats.maxLagMs) m_stats.maxLagMs = lag;
+        if (!message) continue;
+        if (std::holds_alternative<PE>(*message)) ++m_stats.pes;
+        else if (std::holds_alternative<Emitter>(*message)) ++m_stats.emitters;
+        return message;
+    }
+}
+
+/*!
+    \fn std::chrono::steady_clock::time_point ReplayNetworkInterface::dueTime(std::uint64_t timestamp) const
+    \brief Returns when a record captured at \a timestamp is due under the current speed.
+*/
+std::chrono::steady_clock::time_point ReplayNetworkInterface::dueTime(std::uint64_t timestamp) const {
+    double speed = m_speed;
+    if (speed <= 0 || timestamp <= m_anchorTimestamp) return m_anchorTime;
+    auto offset = std::chrono::nanoseconds(static_cast<std::int64_t>((timestamp - m_anchorTimestamp) / speed));
+    return m_anchorTime + std::chrono::duration_cast<std::chrono::steady_clock::duration>(offset);
+}
+
+/*!
+    \fn std::optional<ReplayNetworkInterface::Message> ReplayNetworkInterface::decode(const wire::CaptureRecord& record)
+    \brief Decodes a captured frame, nothing for string definitions and wire format control messages.
+
+    The binary string table is reset whenever the captured format changes, as
+    it was on the live connection when the format was negotiated.
+*/
+std::optional<ReplayNetworkInterface::Message> ReplayNetworkInterface::decode(const wire::CaptureRecord& record) {
+    if (record.format != m_lastFormat) {
+        m_decoder.reset();
+        m_lastFormat = record.format;
+    }
+
+    wire::FrameType type = record.type;
+    if (record.format == wire::WireFormat::Json || type == wire::FrameType::Text) {
+        type = NetworkImplementation::classifyJsonFrame(record.payload);
+        switch (type) {
+        case wire::FrameType::PE:
+            return Message(NetworkImplementation::deserializePE(record.payload));
+        case wire::FrameType::Emitter:
+            return Message(NetworkImplementation::deserializeEmitter(record.payload));
+        case wire::FrameType::Setting:
+            return Message(NetworkImplementation::deserializeSetting(record.payload));
+        default:
+            if (wire::classifyJsonMessage(record.payload) == wire::JsonMessageKind::WireFormat) return std::nullopt;
+            return Message(std::string(record.payload));
+        }
+    }
+
+    switch (type) {
+    case wire::FrameType::StringDef:
+        if (!m_decoder.applyStringDef(record.payload)) {
+            throw std::runtime_error("Invalid binary string definition in capture");
+        }
+        return std::nullopt;
+    case wire::FrameType::PE:
+        return Message(m_decoder.decodePE(record.payload));
+    case wire::FrameType::Emitter:
+        return Message(m_decoder.decodeEmitter(record.payload));
+    case wire::FrameType::Setting:
+        return Message(m_decoder.decodeSetting(record.payload));
+    default:
+        throw std::runtime_error("Unknown frame type in capture");
+    }
+}
+
+/*!
+    \fn ReplayNetworkInterface::Message ReplayNetworkInterface::requireNext()
+    \brief Blocks until the next message is due and returns it, throws at the end of the capture.
+*/
+ReplayNetworkInterface::Message ReplayNetworkInterface::requireNext() {
+    if (m_peeked) {
+        Message message = std::move(*m_peeked);
+        m_peeked.reset();
+        return message;
+    }
+    std::optional<Message> message = nextMessage(true);
+    if (!message) throw std::runtime_error("End of replay capture");
+    return std::move(*message);
+}
+
+std::tuple<std::string, std::string, std::string, int> ReplayNetworkInterface::receiveSetting() {
+    Message message = requireNext();
+    if (auto* setting = std::get_if<Setting>(&message)) return std::move(*setting);
+    throw std::runtime_error("Next replayed message is not a setting");
+}
+
+PE ReplayNetworkInterface::receivePE() {
+    Message message = requireNext();
+    if (auto* pe = std::get_if<PE>(&message)) return std::move(*pe);
+    throw std::runtime_error("Next replayed message is not a PE");
+}
+
+/*!
+    \fn std::vector<PE> ReplayNetworkInterface::receivePEBatch()
+    \brief Receives every PE that is already due, waiting only for the first.
+
+    Stops at the first message that is not a PE, which is left for the
+    matching receive call.
+*/
+std::vector<PE> ReplayNetworkInterface::receivePEBatch() {
+    std::vector<PE> result;
+    Message first = requireNext();
+    if (!std::holds_alternative<PE>(first)) {
+        m_peeked = std::move(first);
+        throw std::runtime_error("Next replayed message is not a PE");
+    }
+    result.push_back(std::move(std::get<PE>(first)));
+    while (std::optional<Message> message = nextMessage(false)) {
+        if (!std::holds_alternative<PE>(*message)) {
+            m_peeked = std::move(message);
+            break;
+        }
+        result.push_back(std::move(std::get<PE>(*message)));
+    }
+    return result;
+}
+
+Emitter ReplayNetworkInterface::receiveEmitter() {
+    Message message = requireNext();
+    if (auto* emitter = std::get_if<Emitter>(&message)) return std::move(*emitter);
+    throw std::runtime_error("Next replayed message is not an Emitter");
+}
+
+std::vector<std::string> ReplayNetworkInterface::receiveBlob() {
+    Message message = requireNext();
+    if (auto* text = std::get_if<std::string>(&message)) return {std::move(*text)};
+    throw std::runtime_error("Next replayed message is not a blob");
+}
+
+std::tuple<PE, Emitter, std::map<std::string, double>> ReplayNetworkInterface::receiveComplexBlob() {
+    Message message = requireNext();
+    if (auto* text = std::get_if<std::string>(&message)) return NetworkImplementation::deserializeComplexBlob(*text);
+    throw std::runtime_error("Next replayed message is not a blob");
+}
+
+/*!
+    \fn void ReplayNetworkInterface::dispatch(Message&& message)
+    \brief Passes a replayed message to the matching receive handler.
+*/
+void ReplayNetworkInterface::dispatch(Message&& message) {
+    if (auto* pe = std::get_if<PE>(&message)) {
+        if (m_handlers.onPE) m_handlers.onPE(*pe);
+    } else if (auto* emitter = std::get_if<Emitter>(&message)) {
+        if (m_handlers.onEmitter) m_handlers.onEmitter(*emitter);
+    } else if (auto* setting = std::get_if<Setting>(&message)) {
+        if (m_handlers.onSetting) m_handlers.onSetting(*setting);
+    } else {
+        const std::string& text = std::get<std::string>(message);
+        if (wire::classifyJsonMessage(text) == wire::JsonMessageKind::ComplexBlob) {
+            if (m_handlers.onComplexBlob) m_handlers.onComplexBlob(NetworkImplementation::deserializeComplexBlob(text));
+        } else if (m_handlers.onBlob) {
+            m_handlers.onBlob(text);
+        }
+    }
+}
+
+/*!
+    \fn void ReplayNetworkInterface::startReceiving(const ReceiveHandlers& handlers)
+    \brief Replays the capture on a dedicated thread, passing each message to the handlers when due.
+
+    The thread exits at the end of the capture; stats() then reports it as finished.
+*/
+void ReplayNetworkInterface::startReceiving(const ReceiveHandlers& handlers) {
+    if (m_receiving.exchange(true)) {
+        logError("Receive thread already running");
+        return;
+    }
+    m_handlers = handlers;
+    m_stopRequested = false;
+    m_receiveThread = std::thread([this] {
+        if (m_peeked) {
+            dispatch(std::move(*m_peeked));
+            m_peeked.reset();
+        }
+        while (!m_stopRequested) {
+            try {
+                std::optional<Message> message = nextMessage(true);
+                if (!message) break;
+                dispatch(std::move(*message));
+            } catch (const std::exception& e) {
+                if (m_handlers.onError) m_handlers.onError(e.what());
+            }
+        }
+    });
+}
+
+void ReplayNetworkInterface::stopReceiving() {
+    if (m_receiving.exchange(false)) {
+        {
+            std::lock_guard<std::mutex> lock(m_wakeMutex);
+            m_stopRequested = true;
+        }
+        m_wake.notify_all();
+    }
+    if (m_receiveThread.joinable() && m_receiveThread.get_id() != std::this_thread::get_id()) {
+        m_receiveThread.join();
+    }
+    m_stopRequested = false;
+}
+
+void ReplayNetworkInterface::close() {
+    stopReceiving();
+    m_record.reset();
+    m_reader.reset();
+}
+
+void ReplayNetworkInterface::logError(const std::string& message) {
+    LOG_ERROR("ReplayNetworkInterface Error: {}", message);
+}
@@ -0,0 +1,101 @@
+#ifndef REPLAYNETWORKINTERFACE_H
+#define REPLAYNETWORKINTERFACE_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <variant>
+#include "AbstractNetworkInterface.h"
+#include "WireCapture.h"
+
+struct ReplayStats {
+    std::uint64_t records;
+    std::uint64_t pes;
+    std::uint64_t emitters;
+    double elapsedSeconds;
+    double pesPerSecond;  // Sustained rate over the whole replay so far
+    double maxLagMs;      // Furthest behind the capture schedule a record was delivered
+    bool finished;
+};
+
+// Feeds a capture written by NetworkImplementation::startCapture back through the receive API
+class ReplayNetworkInterface : public AbstractNetworkInterface {
+public:
+    ReplayNetworkInterface();
+    ~ReplayNetworkInterface() override;
+
+    // Playback rate relative to the capture, e.g. 1 for real time or 10 for ten times faster.
+    // 0 replays as fast as the receiver consumes.
+    void setSpeed(double speed);
+    // Restarts from the first record and clears the statistics
+    void rewind();
+    ReplayStats stats() const;
+
+    // `address` is the path of the capture file, `port` is unused
+    void initialise(const std::string& address, unsigned short port) override;
+    bool negotiateWireFormat(wire::WireFormat format) override;
+    bool sendPE(const PE& pe) override;
+    bool sendEmitter(const Emitter& emitter) override;
+    bool sendBlob(const std::string& blobString) override;
+    bool sendComplexBlob(const PE& pe, const Emitter& emitter, const std::map<std::string, double>& doubleMap) override;
+    bool sendPESetting(const std::string& setting, const std::string& id, int updateVal) override;
+    bool sendEmitterSetting(const std::string& setting, const std::string& id, int updateVal) override;
+    bool sendPEBatch(const std::vector<PE>& pes) override;
+    bool sendEmitterBatch(const std::vector<Emitter>& emitters) override;
+    bool sendSettingsBatch(const std::vector<SettingUpdate>& settings) override;
+    void setFlushThreshold(std::size_t bytes, std::chrono::microseconds delay) override;
+    bool flush() override;
+    std::tuple<std::string, std::string, std::string, int> receiveSetting() override;
+    PE receivePE() override;
+    std::vector<PE> receivePEBatch() override;
+    Emitter receiveEmitter() override;
+    std::vector<std::string> receiveBlob() override;
+    std::tuple<PE, Emitter, std::map<std::string, double>> receiveComplexBlob() override;
+    void startReceiving(const ReceiveHandlers& handlers) override;
+    void stopReceiving() override;
+    void startSending() override;
+    void stopSending() override;
+    void close() override;
+
+private:
+    using Setting = std::tuple<std::string, std::string, std::string, int>;
+    using Message = std::variant<PE, Emitter, Setting, std::string>;
+
+    std::optional<Message> nextMessage(bool wait);
+    std::chrono::steady_clock::time_point dueTime(std::uint64_t timestamp) const;
+    std::optional<Message> decode(const wire::CaptureRecord& record);
+    Message requireNext();
+    void dispatch(Message&& message);
+    static void logError(const std::string& message);
+
+    std::unique_ptr<wire::CaptureReader> m_reader;
+    std::optional<wire::CaptureRecord> m_record; // Read but not yet due
+    wire::BinaryDecoder m_decoder;
+    wire::WireFormat m_lastFormat;
+    std::optional<Message> m_peeked;
+
+    // Schedule anchor: capture time m_anchorTimestamp is due at m_anchorTime
+    std::atomic<double> m_speed;
+    std::atomic<bool> m_anchored;
+    std::uint64_t m_anchorTimestamp;
+    std::chrono::steady_clock::time_point m_anchorTime;
+
+    mutable std::mutex m_statsMutex;
+    ReplayStats m_stats;
+    std::chrono::steady_clock::time_point m_started;
+    std::chrono::steady_clock::time_point m_finishedAt;
+
+    ReceiveHandlers m_handlers;
+    std::thread m_receiveThread;
+    std::atomic<bool> m_receiving;
+    std::atomic<bool> m_stopRequested;
+    std::mutex m_wakeMutex;
+    std::condition_variable m_wake;
+};
+
+#endif // REPLAYNETWORKINTERFACE_H
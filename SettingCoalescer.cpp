@@ -0,0 +1,59 @@
+#include "SettingCoalescer.h"
+
+/*!
+    \class SettingCoalescer
+    \brief Outbound aggregation of PE and Emitter setting updates.
+
+    Repeated updates to the same setting of the same PE or Emitter, such as those
+    fired while a slider is dragged, replace each other while pending. Only the
+    final value of each is sent, so no final state is lost.
+*/
+
+void SettingCoalescer::add(const SettingUpdate& update) {
+    ++m_received;
+    ++m_pendingReceived;
+    std::string key;
+    key.reserve(update.id.size() + update.setting.size() + 2);
+    key += static_cast<char>(update.kind);
+    key += update.id;
+    key += '\0';
+    key += update.setting;
+
+    auto it = m_index.find(key);
+    if (it != m_index.end()) {
+        m_pending[it->second].value = update.value;
+        return;
+    }
+    m_index.emplace(std::move(key), m_pending.size());
+    m_pending.push_back(update);
+}
+
+std::vector<SettingUpdate> SettingCoalescer::take() {
+    std::vector<SettingUpdate> updates;
+    updates.swap(m_pending);
+    m_index.clear();
+    m_pendingReceived = 0;
+    m_sent += updates.size();
+    return updates;
+}
+
+bool SettingCoalescer::empty() const {
+    return m_pending.empty();
+}
+
+std::uint64_t SettingCoalescer::received() const {
+    return m_received;
+}
+
+std::uint64_t SettingCoalescer::sent() const {
+    return m_sent;
+}
+
+double SettingCoalescer::ratio() const {
+    return m_sent == 0 ? 1.0 : static_cast<double>(m_received - m_pendingReceived) / static_cast<double>(m_sent);
+}
+
+void SettingCoalescer::resetStats() {
+    m_received = m_pendingReceived;
+    m_sent = 0;
+}
@@ -0,0 +1,32 @@
+#ifndef SETTINGCOALESCER_H
+#define SETTINGCOALESCER_H
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "AbstractNetworkInterface.h"
+
+// Keeps only the latest value per (type, id, setting) until the pending updates are taken
+class SettingCoalescer {
+public:
+    void add(const SettingUpdate& update);
+    // Returns the pending updates in the order each key was first queued and clears them
+    std::vector<SettingUpdate> take();
+    bool empty() const;
+
+    std::uint64_t received() const;
+    std::uint64_t sent() const;
+    // Updates received per update sent, 1.0 when nothing was coalesced
+    double ratio() const;
+    void resetStats();
+
+private:
+    std::vector<SettingUpdate> m_pending;
+    std::unordered_map<std::string, std::size_t> m_index;
+    std::uint64_t m_received = 0;
+    std::uint64_t m_pendingReceived = 0;
+    std::uint64_t m_sent = 0;
+};
+
+#endif // SETTINGCOALESCER_H
@@ -0,0 +1,110 @@
+#ifndef SNAPSHOTPUBLISHER_H
+#define SNAPSHOTPUBLISHER_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+/*
+    Publishes immutable snapshots of a value from one writer thread to any
+    number of reader threads. The writer fills a buffer that no reader can see
+    and publishes it with a single atomic store. Readers pin the latest buffer
+    with a reference count and read it for as long as they like without locks.
+
+    A buffer is only refilled once its pin count has dropped to zero and it is
+    no longer the latest, so a pinned snapshot never changes under its reader.
+    With at least three buffers the writer always has one to fill while one is
+    published and one is still held by a slow reader. More buffers are
+    allocated, up to Capacity, when readers hold several old snapshots.
+    beginWrite() returns nullptr rather than waiting if every buffer is pinned.
+*/
+template <typename T, std::size_t Capacity = 8>
+class SnapshotPublisher {
+    struct Buffer {
+        std::atomic<std::uint32_t> pins{0};
+        T value;
+    };
+
+public:
+    // A pinned snapshot, released when the handle is destroyed
+    class Handle {
+    public:
+        Handle() : m_buffer(nullptr) {}
+        explicit Handle(Buffer* buffer) : m_buffer(buffer) {}
+        Handle(Handle&& other) noexcept : m_buffer(other.m_buffer) { other.m_buffer = nullptr; }
+        Handle& operator=(Handle&& other) noexcept {
+            if (this != &other) {
+                release();
+                m_buffer = other.m_buffer;
+                other.m_buffer = nullptr;
+            }
+            return *this;
+        }
+        Handle(const Handle&) = delete;
+        Handle& operator=(const Handle&) = delete;
+        ~Handle() { release(); }
+
+        explicit operator bool() const { return m_buffer != nullptr; }
+        const T& operator*() const { return m_buffer->value; }
+        const T* operator->() const { return &m_buffer->value; }
+
+    private:
+        void release() {
+            if (m_buffer) m_buffer->pins.fetch_sub(1);
+            m_buffer = nullptr;
+        }
+
+        Buffer* m_buffer;
+    };
+
+    SnapshotPublisher() : m_latest(-1), m_writing(-1) {}
+
+    SnapshotPublisher(const SnapshotPublisher&) = delete;
+    SnapshotPublisher& operator=(const SnapshotPublisher&) = delete;
+
+    // Writer only: a buffer no reader holds, still containing whatever it last published
+    T* beginWrite() {
+        int latest = m_latest.load();
+        for (std::size_t i = 0; i < Capacity; ++i) {
+            if (static_cast<int>(i) == latest) continue;
+            if (!m_buffers[i]) {
+                m_buffers[i] = std::make_unique<Buffer>();
+            } else if (m_buffers[i]->pins.load() != 0) {
+                continue;
+            }
+            m_writing = static_cast<int>(i);
+            return &m_buffers[i]->value;
+        }
+        m_writing = -1;
+        return nullptr;
+    }
+
+    // Writer only: makes the buffer from beginWrite() the latest snapshot
+    void publish() {
+        if (m_writing < 0) return;
+        m_latest.store(m_writing);
+        m_writing = -1;
+    }
+
+    // Any thread: pins the latest snapshot, empty before the first publish
+    Handle acquire() const {
+        for (;;) {
+            int latest = m_latest.load();
+            if (latest < 0) return Handle();
+            Buffer* buffer = m_buffers[latest].get();
+            buffer->pins.fetch_add(1);
+            // The writer may have moved on and started refilling it, try again with the new latest
+            if (m_latest.load() == latest) return Handle(buffer);
+            buffer->pins.fetch_sub(1);
+        }
+    }
+
+private:
+    // Allocated by the writer before the index of a buffer is first published
+    std::array<std::unique_ptr<Buffer>, Capacity> m_buffers;
+    std::atomic<int> m_latest;
+    int m_writing;
+};
+
+#endif // SNAPSHOTPUBLISHER_H
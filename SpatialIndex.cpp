@@ -0,0 +1,104 @@
+#include "SpatialIndex.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+SpatialIndex::SpatialIndex(double cellSize)
+    : m_cellSize(cellSize > 0 ? cellSize : kDefaultCellSize)
+{
+}
+
+double SpatialIndex::cellSize() const
+{
+    return m_cellSize;
+}
+
+void SpatialIndex::setCellSize(double radians, const std::vector<double>& latitudes, const std::vector<double>& longitudes)
+{
+    if (!(radians > 0)) return;
+    std::vector<bool> indexed(m_cellOf.size());
+    for (std::size_t slot = 0; slot < m_cellOf.size(); ++slot) {
+        indexed[slot] = m_cellOf[slot] != kUnindexed;
+    }
+    clear();
+    m_cellSize = radians;
+    for (std::size_t slot = 0; slot < indexed.size(); ++slot) {
+        if (indexed[slot]) {
+            update(static_cast<Slot>(slot), latitudes[slot], longitudes[slot]);
+        }
+    }
+}
+
+// Clamped one short of the int32 maximum, which as both row and column would make the key kUnindexed
+std::int32_t SpatialIndex::cellCoordinate(double radians) const
+{
+    double cell = std::floor(radians / m_cellSize);
+    const double lowest = std::numeric_limits<std::int32_t>::min();
+    const double highest = std::numeric_limits<std::int32_t>::max() - 1;
+    return static_cast<std::int32_t>(cell < lowest ? lowest : (cell > highest ? highest : cell));
+}
+
+SpatialIndex::CellKey SpatialIndex::key(std::int32_t row, std::int32_t column)
+{
+    return (static_cast<CellKey>(static_cast<std::uint32_t>(row) ^ 0x80000000u) << 32)
+        | (static_cast<std::uint32_t>(column) ^ 0x80000000u);
+}
+
+std::int32_t SpatialIndex::rowOf(CellKey key)
+{
+    return static_cast<std::int32_t>(static_cast<std::uint32_t>(key >> 32) ^ 0x80000000u);
+}
+
+std::int32_t SpatialIndex::columnOf(CellKey key)
+{
+    return static_cast<std::int32_t>(static_cast<std::uint32_t>(key & 0xFFFFFFFFu) ^ 0x80000000u);
+}
+
+/*!
+    \fn void SpatialIndex::update(Slot slot, double latitude, double longitude)
+    \brief Puts \a slot in the cell for the coordinate. Moving within a cell costs a lookup,
+    moving between cells a swap-remove and an append.
+*/
+void SpatialIndex::update(Slot slot, double latitude, double longitude)
+{
+    if (slot >= m_cellOf.size()) {
+        m_cellOf.resize(slot + 1, kUnindexed);
+        m_positionInCell.resize(slot + 1, 0);
+    }
+    if (!std::isfinite(latitude) || !std::isfinite(longitude)) {
+        remove(slot);
+        return;
+    }
+
+    CellKey cell = key(cellCoordinate(latitude), cellCoordinate(longitude));
+    if (m_cellOf[slot] == cell) return;
+    remove(slot);
+
+    std::vector<Slot>& slots = m_cells[cell];
+    m_cellOf[slot] = cell;
+    m_positionInCell[slot] = static_cast<std::uint32_t>(slots.size());
+    slots.push_back(slot);
+}
+
+void SpatialIndex::remove(Slot slot)
+{
+    if (slot >= m_cellOf.size() || m_cellOf[slot] == kUnindexed) return;
+
+    auto found = m_cells.find(m_cellOf[slot]);
+    std::vector<Slot>& slots = found->second;
+    std::uint32_t position = m_positionInCell[slot];
+    Slot last = slots.back();
+    slots[position] = last;
+    m_positionInCell[last] = position;
+    slots.pop_back();
+    if (slots.empty()) {
+        m_cells.erase(found);
+    }
+    m_cellOf[slot] = kUnindexed;
+}
+
+void SpatialIndex::clear()
+{
+    m_cells.clear();
+    std::fill(m_cellOf.begin(), m_cellOf.end(), kUnindexed);
+}
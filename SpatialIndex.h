@@ -0,0 +1,86 @@
+#ifndef SPATIALINDEX_H
+#define SPATIALINDEX_H
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Uniform grid over latitude/longitude in radians. Cells are hashed, so only occupied
+// cells cost memory and coordinates outside the usual ranges still index correctly.
+// Entries are store slots, exact filtering against coordinates is left to the caller.
+class SpatialIndex
+{
+public:
+    using Slot = std::uint32_t;
+
+    // About 6.4 km of latitude
+    static constexpr double kDefaultCellSize = 0.001;
+
+    explicit SpatialIndex(double cellSize = kDefaultCellSize);
+
+    double cellSize() const;
+    // Re-buckets every indexed slot, `latitudes` and `longitudes` are indexed by slot
+    void setCellSize(double radians, const std::vector<double>& latitudes, const std::vector<double>& longitudes);
+
+    // Adds or moves `slot` to the cell holding the coordinate. Non-finite coordinates are left unindexed.
+    void update(Slot slot, double latitude, double longitude);
+    void remove(Slot slot);
+    void clear();
+
+    // Calls `visit(const std::vector<Slot>&)` for every occupied cell overlapping the box.
+    // The box must not cross the antimeridian, callers split such boxes in two.
+    template <typename Visit>
+    void visitCells(double minLatitude, double minLongitude, double maxLatitude, double maxLongitude, Visit visit) const;
+
+private:
+    using CellKey = std::uint64_t;
+    static constexpr CellKey kUnindexed = ~CellKey(0);
+
+    std::int32_t cellCoordinate(double radians) const;
+    // Rows and columns are stored offset by 2^31, so no reachable cell has the key kUnindexed
+    static CellKey key(std::int32_t row, std::int32_t column);
+    static std::int32_t rowOf(CellKey key);
+    static std::int32_t columnOf(CellKey key);
+
+    double m_cellSize;
+    std::unordered_map<CellKey, std::vector<Slot>> m_cells;
+    // Per slot: the cell it's in and its position in that cell's list, for O(1) moves
+    std::vector<CellKey> m_cellOf;
+    std::vector<std::uint32_t> m_positionInCell;
+};
+
+template <typename Visit>
+void SpatialIndex::visitCells(double minLatitude, double minLongitude, double maxLatitude, double maxLongitude, Visit visit) const
+{
+    if (!(minLatitude <= maxLatitude) || !(minLongitude <= maxLongitude) || m_cells.empty()) {
+        return;
+    }
+    std::int64_t firstRow = cellCoordinate(minLatitude);
+    std::int64_t lastRow = cellCoordinate(maxLatitude);
+    std::int64_t firstColumn = cellCoordinate(minLongitude);
+    std::int64_t lastColumn = cellCoordinate(maxLongitude);
+
+    // A box covering more cells than are occupied is cheaper to answer by walking the occupied cells
+    std::uint64_t boxCells = static_cast<std::uint64_t>(lastRow - firstRow + 1) * static_cast<std::uint64_t>(lastColumn - firstColumn + 1);
+    if (boxCells > m_cells.size()) {
+        for (const auto& cell : m_cells) {
+            std::int32_t row = rowOf(cell.first);
+            std::int32_t column = columnOf(cell.first);
+            if (row >= firstRow && row <= lastRow && column >= firstColumn && column <= lastColumn) {
+                visit(cell.second);
+            }
+        }
+        return;
+    }
+
+    for (std::int64_t row = firstRow; row <= lastRow; ++row) {
+        for (std::int64_t column = firstColumn; column <= lastColumn; ++column) {
+            auto found = m_cells.find(key(static_cast<std::int32_t>(row), static_cast<std::int32_t>(column)));
+            if (found != m_cells.end()) {
+                visit(found->second);
+            }
+        }
+    }
+}
+
+#endif // SPATIALINDEX_H
@@ -0,0 +1,124 @@
+#include "WireCapture.h"
+#include <cstring>
+#include <stdexcept>
+
+/*
+    Capture files record every frame received on a connection with its arrival
+    time, for replay through ReplayNetworkInterface. Records are appended
+    through a large stdio buffer, so capturing costs a copy per frame and an
+    occasional write. Frames still buffered when the process dies are lost, a
+    reader stops cleanly at the last complete record.
+*/
+
+namespace wire {
+
+namespace {
+
+void putLE(char* out, std::uint64_t value, int bytes) {
+    for (int i = 0; i < bytes; ++i) {
+        out[i] = static_cast<char>((value >> (8 * i)) & 0xFF);
+    }
+}
+
+std::uint64_t getLE(const char* data, int bytes) {
+    const auto* in = reinterpret_cast<const unsigned char*>(data);
+    std::uint64_t value = 0;
+    for (int i = 0; i < bytes; ++i) {
+        value |= static_cast<std::uint64_t>(in[i]) << (8 * i);
+    }
+    return value;
+}
+
+} // namespace
+
+CaptureWriter::CaptureWriter()
+    : m_open(false), m_file(nullptr) {}
+
+CaptureWriter::~CaptureWriter() {
+    close();
+}
+
+bool CaptureWriter::open(const std::string& path) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_file) {
+        std::fclose(m_file);
+        m_file = nullptr;
+        m_open = false;
+    }
+    m_file = std::fopen(path.c_str(), "wb");
+    if (!m_file) return false;
+    std::setvbuf(m_file, nullptr, _IOFBF, 1 << 20);
+    std::fwrite(kCaptureMagic, 1, sizeof(kCaptureMagic), m_file);
+    m_start = std::chrono::steady_clock::now();
+    m_open = true;
+    return true;
+}
+
+void CaptureWriter::close() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_open = false;
+    if (m_file) {
+        std::fclose(m_file);
+        m_file = nullptr;
+    }
+}
+
+bool CaptureWriter::isOpen() const {
+    return m_open.load(std::memory_order_relaxed);
+}
+
+/*!
+    \fn void CaptureWriter::append(WireFormat format, FrameType type, std::string_view payload)
+    \brief Appends one received frame, timestamped now. Does nothing unless open.
+*/
+void CaptureWriter::append(WireFormat format, FrameType type, std::string_view payload) {
+    if (!isOpen()) return;
+    auto now = std::chrono::steady_clock::now();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_file) return;
+    char header[kCaptureRecordHeaderSize];
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(now - m_start).count();
+    putLE(header, static_cast<std::uint64_t>(elapsed), 8);
+    header[8] = static_cast<char>(format);
+    header[9] = static_cast<char>(type);
+    putLE(header + 10, 0, 2);
+    putLE(header + 12, payload.size(), 4);
+    std::fwrite(header, 1, sizeof(header), m_file);
+    std::fwrite(payload.data(), 1, payload.size(), m_file);
+}
+
+CaptureReader::CaptureReader(const std::string& path)
+    : m_file(path.c_str(), boost::interprocess::read_only),
+      m_region(m_file, boost::interprocess::read_only),
+      m_data(static_cast<const char*>(m_region.get_address())),
+      m_size(m_region.get_size()),
+      m_offset(sizeof(kCaptureMagic)) {
+    if (m_size < sizeof(kCaptureMagic) || std::memcmp(m_data, kCaptureMagic, sizeof(kCaptureMagic)) != 0) {
+        throw std::runtime_error("Not a wire capture file: " + path);
+    }
+}
+
+bool CaptureReader::next(CaptureRecord& record) {
+    if (m_size - m_offset < kCaptureRecordHeaderSize) return false;
+    const char* header = m_data + m_offset;
+    auto length = static_cast<std::size_t>(getLE(header + 12, 4));
+    if (m_size - m_offset - kCaptureRecordHeaderSize < length) return false;
+
+    record.timestamp = getLE(header, 8);
+    record.format = static_cast<WireFormat>(header[8]);
+    record.type = static_cast<FrameType>(header[9]);
+    record.payload = std::string_view(header + kCaptureRecordHeaderSize, length);
+    m_offset += kCaptureRecordHeaderSize + length;
+    return true;
+}
+
+void CaptureReader::rewind() {
+    m_offset = sizeof(kCaptureMagic);
+}
+
+std::size_t CaptureReader::size() const {
+    return m_size;
+}
+
+} // namespace wire
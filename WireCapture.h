@@ -0,0 +1,74 @@
+#ifndef WIRECAPTURE_H
+#define WIRECAPTURE_H
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include "WireProtocol.h"
+
+namespace wire {
+
+// A capture file is kCaptureMagic followed by records of a kCaptureRecordHeaderSize
+// header (u64 nanoseconds since capture start, format, frame type, 2 reserved,
+// u32 length) and the frame payload, all little-endian.
+constexpr char kCaptureMagic[8] = {'W', 'I', 'R', 'E', 'C', 'A', 'P', '1'};
+constexpr std::size_t kCaptureRecordHeaderSize = 16;
+
+struct CaptureRecord {
+    std::uint64_t timestamp; // Nanoseconds since the capture started
+    WireFormat format;
+    FrameType type;          // Text for JSON lines
+    std::string_view payload;
+};
+
+// Appends received frames to a capture file, safe to call from any thread
+class CaptureWriter {
+public:
+    CaptureWriter();
+    ~CaptureWriter();
+
+    CaptureWriter(const CaptureWriter&) = delete;
+    CaptureWriter& operator=(const CaptureWriter&) = delete;
+
+    // Truncates or creates `path` and starts timestamps from zero
+    bool open(const std::string& path);
+    void close();
+    bool isOpen() const;
+
+    void append(WireFormat format, FrameType type, std::string_view payload);
+
+private:
+    mutable std::mutex m_mutex;
+    std::atomic<bool> m_open;
+    std::FILE* m_file;
+    std::chrono::steady_clock::time_point m_start;
+};
+
+// Reads a capture file through a read-only memory mapping, payloads point into the mapping
+class CaptureReader {
+public:
+    // Throws if the file can't be mapped or is not a capture
+    explicit CaptureReader(const std::string& path);
+
+    // False at the end of the capture, or at a record truncated by an interrupted capture
+    bool next(CaptureRecord& record);
+    void rewind();
+    std::size_t size() const;
+
+private:
+    boost::interprocess::file_mapping m_file;
+    boost::interprocess::mapped_region m_region;
+    const char* m_data;
+    std::size_t m_size;
+    std::size_t m_offset;
+};
+
+} // namespace wire
+
+#endif // WIRECAPTURE_H
@@ -0,0 +1,526 @@
+#include "WireProtocol.h"
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+
+/*!
+    \namespace wire
+    \brief Binary framing for PE, Emitter and setting records.
+
+    A binary frame is an 8 byte header (magic, type, the generation of the string
+    table a record was encoded with and a little-endian payload length) followed by
+    a fixed-layout little-endian record. String fields are sent as 32-bit
+    references; before a reference is first used on a connection the encoder emits
+    a StringDef frame binding it to its UTF-8 bytes. Reference 0 is always the
+    empty string, and a StringDef for reference 0 tells the decoder to forget every
+    reference, which the encoder sends when its table moves to a new generation.
+*/
+
+namespace wire {
+
+namespace {
+
+void putU8(std::string& out, std::uint8_t value) {
+    out.push_back(static_cast<char>(value));
+}
+
+void putU16(std::string& out, std::uint16_t value) {
+    out.push_back(static_cast<char>(value & 0xFF));
+    out.push_back(static_cast<char>((value >> 8) & 0xFF));
+}
+
+void putU32(std::string& out, std::uint32_t value) {
+    for (int shift = 0; shift < 32; shift += 8) {
+        out.push_back(static_cast<char>((value >> shift) & 0xFF));
+    }
+}
+
+void putU64(std::string& out, std::uint64_t value) {
+    for (int shift = 0; shift < 64; shift += 8) {
+        out.push_back(static_cast<char>((value >> shift) & 0xFF));
+    }
+}
+
+void putF64(std::string& out, double value) {
+    std::uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    putU64(out, bits);
+}
+
+void putHeader(std::string& out, FrameType type, std::uint32_t length, std::uint16_t generation = 0) {
+    putU8(out, kFrameMagic);
+    putU8(out, static_cast<std::uint8_t>(type));
+    putU16(out, generation);
+    putU32(out, length);
+}
+
+std::uint16_t getU16(const char* data) {
+    const auto* bytes = reinterpret_cast<const unsigned char*>(data);
+    return static_cast<std::uint16_t>(bytes[0] | (bytes[1] << 8));
+}
+
+std::uint32_t getU32(const char* data) {
+    const auto* bytes = reinterpret_cast<const unsigned char*>(data);
+    std::uint32_t value = 0;
+    for (int i = 3; i >= 0; --i) {
+        value = (value << 8) | bytes[i];
+    }
+    return value;
+}
+
+std::uint64_t getU64(const char* data) {
+    const auto* bytes = reinterpret_cast<const unsigned char*>(data);
+    std::uint64_t value = 0;
+    for (int i = 7; i >= 0; --i) {
+        value = (value << 8) | bytes[i];
+    }
+    return value;
+}
+
+double getF64(const char* data) {
+    std::uint64_t bits = getU64(data);
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+void requireSize(std::string_view payload, std::size_t size, const char* what) {
+    if (payload.size() < size) {
+        throw std::runtime_error(std::string("Truncated binary ") + what + " record");
+    }
+}
+
+} // namespace
+
+const char* formatName(WireFormat format) {
+    return format == WireFormat::Binary ? "binary" : "json";
+}
+
+bool parseFormatName(const std::string& name, WireFormat& format) {
+    if (name == "json") {
+        format = WireFormat::Json;
+        return true;
+    }
+    if (name == "binary") {
+        format = WireFormat::Binary;
+        return true;
+    }
+    return false;
+}
+
+bool parseHeader(const char* data, FrameHeader& header) {
+    if (static_cast<std::uint8_t>(data[0]) != kFrameMagic) return false;
+    auto type = static_cast<std::uint8_t>(data[1]);
+    if (type < static_cast<std::uint8_t>(FrameType::StringDef) || type > static_cast<std::uint8_t>(FrameType::Text)) {
+        return false;
+    }
+    header.type = static_cast<FrameType>(type);
+    header.length = getU32(data + 4);
+    return header.length <= kMaxPayloadSize;
+}
+
+void putDatagramHeader(std::string& out, WireFormat format, std::uint32_t sequence) {
+    putU8(out, kDatagramMagic);
+    putU8(out, static_cast<std::uint8_t>(format));
+    putU16(out, 0);
+    putU32(out, sequence);
+}
+
+bool parseDatagramHeader(std::string_view datagram, DatagramHeader& header) {
+    if (datagram.size() < kDatagramHeaderSize || static_cast<std::uint8_t>(datagram[0]) != kDatagramMagic) return false;
+    auto format = static_cast<std::uint8_t>(datagram[1]);
+    if (format > static_cast<std::uint8_t>(WireFormat::Binary)) return false;
+    header.format = static_cast<WireFormat>(format);
+    header.sequence = getU32(datagram.data() + 4);
+    return true;
+}
+
+/*!
+    \class StringTable
+    \brief Interned string references shared by every encoding thread.
+
+    Lookups of strings that are already interned only take a shared lock, so
+    steady state encoding from many producers does not contend. A connection
+    whose ids or states keep changing would intern strings forever, so the table
+    is bounded: a record that doesn't fit starts a new generation, numbered from
+    reference 1 again, and every string of one record is interned in the same
+    generation. A generation that still has records queued for the writing
+    thread is retired rather than dropped, and freed when the last one is
+    released, so no record loses its strings however far the producers run ahead.
+*/
+StringTable::StringTable(std::uint32_t capacity)
+    : m_capacity(capacity < 8 ? 8 : (capacity > kMaxStringRef ? kMaxStringRef : capacity)),
+      m_current(std::make_unique<Generation>()) {
+    m_current->number = 0;
+}
+
+std::uint16_t StringTable::intern(const QString* values, std::size_t count, std::uint32_t* refs) {
+    {
+        std::shared_lock<std::shared_mutex> lock(m_mutex);
+        std::size_t found = 0;
+        for (; found < count; ++found) {
+            if (values[found].isEmpty()) {
+                refs[found] = 0;
+                continue;
+            }
+            auto it = m_refs.constFind(values[found]);
+            if (it == m_refs.constEnd()) break;
+            refs[found] = it.value();
+        }
+        if (found == count) {
+            m_current->pending.fetch_add(1, std::memory_order_relaxed);
+            return m_current->number;
+        }
+    }
+
+    std::unique_lock<std::shared_mutex> lock(m_mutex);
+    std::size_t missing = 0;
+    for (std::size_t i = 0; i < count; ++i) {
+        if (!values[i].isEmpty() && !m_refs.contains(values[i])) ++missing;
+    }
+    if (m_current->values.size() + missing > m_capacity) {
+        auto next = std::make_unique<Generation>();
+        next->number = static_cast<std::uint16_t>(m_current->number + 1);
+        if (m_current->pending.load() > 0) m_retired.push_back(std::move(m_current));
+        m_current = std::move(next);
+        m_refs.clear();
+    }
+    for (std::size_t i = 0; i < count; ++i) {
+        if (values[i].isEmpty()) {
+            refs[i] = 0;
+            continue;
+        }
+        auto it = m_refs.constFind(values[i]);
+        if (it != m_refs.constEnd()) {
+            refs[i] = it.value();
+            continue;
+        }
+        m_current->values.push_back(values[i]);
+        refs[i] = static_cast<std::uint32_t>(m_current->values.size());
+        m_refs.insert(values[i], refs[i]);
+    }
+    m_current->pending.fetch_add(1, std::memory_order_relaxed);
+    return m_current->number;
+}
+
+const StringTable::Generation* StringTable::find(std::uint16_t generation) const {
+    if (m_current->number == generation) return m_current.get();
+    for (const std::unique_ptr<Generation>& retired : m_retired) {
+        if (retired->number == generation) return retired.get();
+    }
+    return nullptr;
+}
+
+bool StringTable::lookup(std::uint16_t generation, std::uint32_t ref, QString& value) const {
+    std::shared_lock<std::shared_mutex> lock(m_mutex);
+    const Generation* held = find(generation);
+    if (!held || ref == 0 || ref > held->values.size()) return false;
+    value = held->values[ref - 1];
+    return true;
+}
+
+void StringTable::release(std::uint16_t generation) {
+    {
+        std::shared_lock<std::shared_mutex> lock(m_mutex);
+        const Generation* held = find(generation);
+        if (!held || held->pending.fetch_sub(1) != 1 || held == m_current.get()) return;
+    }
+    // Retired generations gain no records, so once empty it stays empty until erased
+    std::unique_lock<std::shared_mutex> lock(m_mutex);
+    m_retired.erase(std::remove_if(m_retired.begin(), m_retired.end(),
+                                   [](const std::unique_ptr<Generation>& retired) { return retired->pending.load() == 0; }),
+                    m_retired.end());
+}
+
+// Numbering carries on, so records interned before find no generation: their lookups fail and
+// their releases are ignored rather than taken from the new generation's count
+void StringTable::clear() {
+    std::unique_lock<std::shared_mutex> lock(m_mutex);
+    std::uint16_t next = static_cast<std::uint16_t>(m_current->number + 1);
+    m_refs.clear();
+    m_retired.clear();
+    m_current = std::make_unique<Generation>();
+    m_current->number = next;
+}
+
+BinaryEncoder::BinaryEncoder(std::uint32_t tableCapacity)
+    : m_table(tableCapacity), m_peerGeneration(0) {}
+
+void BinaryEncoder::encodePE(const PE& pe, std::string& out) {
+    std::size_t start = out.size();
+    encodePERecord(pe, out);
+    announceBefore(out, start);
+}
+
+void BinaryEncoder::encodeEmitter(const Emitter& emitter, std::string& out) {
+    std::size_t start = out.size();
+    encodeEmitterRecord(emitter, out);
+    announceBefore(out, start);
+}
+
+void BinaryEncoder::encodeSetting(SettingKind kind, const std::string& id, const std::string& setting, int value, std::string& out) {
+    std::size_t start = out.size();
+    encodeSettingRecord(kind, id, setting, value, out);
+    announceBefore(out, start);
+}
+
+void BinaryEncoder::encodePERecord(const PE& pe, std::string& out) {
+    const QString strings[] = {pe.id, pe.type, pe.apd, pe.priority, pe.state};
+    std::uint32_t refs[5];
+    std::uint16_t generation = m_table.intern(strings, 5, refs);
+
+    putHeader(out, FrameType::PE, kPERecordSize, generation);
+    for (std::uint32_t ref : refs) putU32(out, ref);
+    putF64(out, pe.lat);
+    putF64(out, pe.lon);
+    putF64(out, pe.altitude);
+    putF64(out, pe.speed);
+    putF64(out, pe.heading);
+    putU8(out, static_cast<std::uint8_t>(pe.category));
+    putU8(out, static_cast<std::uint8_t>((pe.jam ? 0x1 : 0) | (pe.ghost ? 0x2 : 0)));
+    putU16(out, 0);
+}
+
+void BinaryEncoder::encodeEmitterRecord(const Emitter& emitter, std::string& out) {
+    std::uint16_t flags = (emitter.active ? 0x01 : 0)
+                        | (emitter.jamResponsible ? 0x02 : 0)
+                        | (emitter.reactiveEligible ? 0x04 : 0)
+                        | (emitter.preemptiveEligible ? 0x08 : 0)
+                        | (emitter.consentRequired ? 0x10 : 0)
+                        | (emitter.operatorManaged ? 0x20 : 0)
+                        | (emitter.jam ? 0x40 : 0);
+    const QString strings[] = {emitter.id, emitter.type, emitter.category, emitter.eaPriority, emitter.esPriority};
+    std::uint32_t refs[5];
+    std::uint16_t generation = m_table.intern(strings, 5, refs);
+
+    putHeader(out, FrameType::Emitter, kEmitterRecordSize, generation);
+    for (std::uint32_t ref : refs) putU32(out, ref);
+    putF64(out, emitter.lat);
+    putF64(out, emitter.lon);
+    putF64(out, emitter.altitude);
+    putF64(out, emitter.heading);
+    putF64(out, emitter.speed);
+    putF64(out, emitter.freqMin);
+    putF64(out, emitter.freqMax);
+    putU32(out, static_cast<std::uint32_t>(emitter.jamIneffective));
+    putU32(out, static_cast<std::uint32_t>(emitter.jamEffective));
+    putU16(out, flags);
+    putU16(out, 0);
+}
+
+void BinaryEncoder::encodeSettingRecord(SettingKind kind, const std::string& id, const std::string& setting, int value, std::string& out) {
+    const QString strings[] = {QString::fromStdString(id), QString::fromStdString(setting)};
+    std::uint32_t refs[2];
+    std::uint16_t generation = m_table.intern(strings, 2, refs);
+
+    putHeader(out, FrameType::Setting, kSettingRecordSize, generation);
+    putU8(out, static_cast<std::uint8_t>(kind));
+    putU8(out, 0);
+    putU16(out, 0);
+    putU32(out, refs[0]);
+    putU32(out, refs[1]);
+    putU32(out, static_cast<std::uint32_t>(value));
+}
+
+void BinaryEncoder::encodeText(std::string_view text, std::string& out) {
+    putHeader(out, FrameType::Text, static_cast<std::uint32_t>(text.size()));
+    out.append(text.data(), text.size());
+}
+
+/*!
+    \fn std::size_t BinaryEncoder::appendFrames(std::string_view frames, std::string& out)
+    \brief Appends \a frames to \a out, with a StringDef frame ahead of each record
+    for every reference it uses that has not been announced on this connection.
+
+    References may have been interned by other threads in any order, so the
+    peer's table is filled in with explicit references rather than by sequence.
+    A record encoded in another table generation than the peer's is preceded by
+    a reset, a StringDef for reference 0, after which its references are
+    announced afresh, and every record releases its generation. Only records
+    encoded before reset() can have lost their strings; they are dropped and counted.
+*/
+std::size_t BinaryEncoder::appendFrames(std::string_view frames, std::string& out) {
+    static constexpr std::size_t kRecordRefs[] = {0, 4, 8, 12, 16};
+    static constexpr std::size_t kSettingRefs[] = {4, 8};
+
+    std::size_t dropped = 0;
+    while (frames.size() >= kHeaderSize) {
+        FrameHeader header;
+        if (!parseHeader(frames.data(), header) || frames.size() < kHeaderSize + header.length) break;
+        std::string_view frame = frames.substr(0, kHeaderSize + header.length);
+        frames.remove_prefix(frame.size());
+        const char* payload = frame.data() + kHeaderSize;
+
+        const std::size_t* offsets = nullptr;
+        std::size_t count = 0;
+        if ((header.type == FrameType::PE && header.length == kPERecordSize)
+            || (header.type == FrameType::Emitter && header.length == kEmitterRecordSize)) {
+            offsets = kRecordRefs;
+            count = 5;
+        } else if (header.type == FrameType::Setting && header.length == kSettingRecordSize) {
+            offsets = kSettingRefs;
+            count = 2;
+        }
+
+        std::uint16_t generation = getU16(frame.data() + 2);
+        bool restart = count > 0 && generation != m_peerGeneration;
+        std::uint32_t refs[5];
+        QString values[5];
+        bool known = true;
+        for (std::size_t i = 0; i < count; ++i) {
+            refs[i] = getU32(payload + offsets[i]);
+            bool announced = !restart && refs[i] < m_announced.size() && m_announced[refs[i]];
+            if (refs[i] != 0 && !announced && !m_table.lookup(generation, refs[i], values[i])) known = false;
+        }
+        if (count > 0) m_table.release(generation);
+        if (!known) {
+            ++dropped;
+            continue;
+        }
+
+        if (restart) {
+            putHeader(out, FrameType::StringDef, 4);
+            putU32(out, 0);
+            m_announced.clear();
+            m_peerGeneration = generation;
+        }
+        for (std::size_t i = 0; i < count; ++i) {
+            std::uint32_t ref = refs[i];
+            if (ref == 0) continue;
+            if (ref >= m_announced.size()) m_announced.resize(ref + 1, false);
+            if (m_announced[ref]) continue;
+            m_announced[ref] = true;
+
+            QByteArray utf8 = values[i].toUtf8();
+            putHeader(out, FrameType::StringDef, static_cast<std::uint32_t>(4 + utf8.size()));
+            putU32(out, ref);
+            out.append(utf8.constData(), static_cast<std::size_t>(utf8.size()));
+        }
+        out.append(frame.data(), frame.size());
+    }
+    out.append(frames.data(), frames.size());
+    return dropped;
+}
+
+void BinaryEncoder::announceBefore(std::string& out, std::size_t recordStart) {
+    std::string record = out.substr(recordStart);
+    out.resize(recordStart);
+    appendFrames(record, out);
+}
+
+void BinaryEncoder::reset() {
+    m_table.clear();
+    m_peerGeneration = 0;
+    m_announced.clear();
+}
+
+/*!
+    \fn bool BinaryDecoder::applyStringDef(std::string_view payload)
+    \brief Records the string carried by a StringDef payload.
+    \return False if the payload is malformed or the reference is out of range.
+
+    References need not arrive in order, a sender with several encoding threads
+    announces them in the order records reach the socket. A reference already
+    bound is rebound. Reference 0 with no bytes forgets every reference, the
+    sender's string table has started a new generation.
+*/
+bool BinaryDecoder::applyStringDef(std::string_view payload) {
+    if (payload.size() < 4) return false;
+    std::uint32_t ref = getU32(payload.data());
+    if (ref == 0 && payload.size() == 4) {
+        reset();
+        return true;
+    }
+    if (ref == 0 || ref > kMaxStringRef) return false;
+
+    if (ref > m_strings.size()) {
+        m_strings.resize(ref);
+        m_defined.resize(ref, false);
+    }
+    m_strings[ref - 1] = QString::fromUtf8(payload.data() + 4, static_cast<int>(payload.size() - 4));
+    m_defined[ref - 1] = true;
+    return true;
+}
+
+const QString& BinaryDecoder::lookup(std::uint32_t ref) const {
+    static const QString empty;
+    if (ref == 0) return empty;
+    if (ref > m_strings.size() || !m_defined[ref - 1]) {
+        throw std::runtime_error("Binary record references undefined string " + std::to_string(ref));
+    }
+    return m_strings[ref - 1];
+}
+
+PE BinaryDecoder::decodePE(std::string_view payload) const {
+    requireSize(payload, kPERecordSize, "PE");
+    const char* p = payload.data();
+    std::uint8_t flags = static_cast<std::uint8_t>(p[61]);
+
+    PE pe(
+        lookup(getU32(p)),
+        lookup(getU32(p + 4)),
+        getF64(p + 20),
+        getF64(p + 28),
+        getF64(p + 36),
+        getF64(p + 44),
+        lookup(getU32(p + 8)),
+        lookup(getU32(p + 12)),
+        (flags & 0x1) != 0,
+        (flags & 0x2) != 0
+    );
+    pe.heading = getF64(p + 52);
+    pe.category = static_cast<PE::PECategory>(static_cast<std::uint8_t>(p[60]));
+    pe.state = lookup(getU32(p + 16));
+    return pe;
+}
+
+Emitter BinaryDecoder::decodeEmitter(std::string_view payload) const {
+    requireSize(payload, kEmitterRecordSize, "Emitter");
+    const char* p = payload.data();
+    std::uint16_t flags = getU16(p + 84);
+
+    Emitter emitter(
+        lookup(getU32(p)),
+        lookup(getU32(p + 4)),
+        lookup(getU32(p + 8)),
+        getF64(p + 20),
+        getF64(p + 28),
+        getF64(p + 60),
+        getF64(p + 68),
+        (flags & 0x01) != 0,
+        lookup(getU32(p + 12)),
+        lookup(getU32(p + 16)),
+        (flags & 0x02) != 0,
+        (flags & 0x04) != 0,
+        (flags & 0x08) != 0,
+        (flags & 0x10) != 0,
+        (flags & 0x40) != 0
+    );
+    emitter.altitude = getF64(p + 36);
+    emitter.heading = getF64(p + 44);
+    emitter.speed = getF64(p + 52);
+    emitter.operatorManaged = (flags & 0x20) != 0;
+    emitter.jamIneffective = static_cast<int>(getU32(p + 76));
+    emitter.jamEffective = static_cast<int>(getU32(p + 80));
+    return emitter;
+}
+
+std::tuple<std::string, std::string, std::string, int> BinaryDecoder::decodeSetting(std::string_view payload) const {
+    requireSize(payload, kSettingRecordSize, "setting");
+    const char* p = payload.data();
+    auto kind = static_cast<SettingKind>(static_cast<std::uint8_t>(p[0]));
+
+    std::string type = kind == SettingKind::Emitter ? "EMITTER_SETTING" : "PE_SETTING";
+    return std::make_tuple(type,
+                           lookup(getU32(p + 4)).toStdString(),
+                           lookup(getU32(p + 8)).toStdString(),
+                           static_cast<int>(getU32(p + 12)));
+}
+
+void BinaryDecoder::reset() {
+    m_strings.clear();
+    m_defined.clear();
+}
+
+} // namespace wire
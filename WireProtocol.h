@@ -0,0 +1,153 @@
+#ifndef WIREPROTOCOL_H
+#define WIREPROTOCOL_H
+
+#include <QHash>
+#include <QString>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
+#include "pe.h"
+#include "emitter.h"
+
+namespace wire {
+
+// Framing used on a connection, agreed through NetworkImplementation::negotiateWireFormat
+enum class WireFormat : std::uint8_t {
+    Json,   // One compact JSON object per '\n' terminated line
+    Binary  // Length-prefixed little-endian records with interned strings
+};
+
+enum class FrameType : std::uint8_t {
+    StringDef = 1, // Binds a string reference to its UTF-8 bytes until rebound or reset by reference 0
+    PE = 2,
+    Emitter = 3,
+    Setting = 4,
+    Text = 5       // Opaque text payload (blobs, complex blobs, control messages)
+};
+
+enum class SettingKind : std::uint8_t {
+    PE = 0,
+    Emitter = 1
+};
+
+// Every binary frame starts with this header, followed by `length` payload bytes
+struct FrameHeader {
+    FrameType type;
+    std::uint32_t length;
+};
+
+constexpr std::uint8_t kFrameMagic = 0xB5; // Never a valid first byte of a JSON line
+constexpr std::size_t kHeaderSize = 8;     // magic, type, u16 string table generation, u32 length
+constexpr std::size_t kMaxPayloadSize = 16 * 1024 * 1024;
+constexpr std::uint32_t kMaxStringRef = 1u << 20; // Encoders start a new table generation before exceeding it
+
+// Every UDP datagram starts with this header, followed by JSON lines or binary frames.
+// Binary datagrams carry the StringDef frames they use, so each decodes on its own.
+struct DatagramHeader {
+    WireFormat format;
+    std::uint32_t sequence; // Per sender, incremented for every datagram
+};
+
+constexpr std::uint8_t kDatagramMagic = 0xB6;
+constexpr std::size_t kDatagramHeaderSize = 8; // magic, format, 2 reserved, u32 sequence
+
+constexpr std::size_t kPERecordSize = 64;
+constexpr std::size_t kEmitterRecordSize = 88;
+constexpr std::size_t kSettingRecordSize = 16;
+
+const char* formatName(WireFormat format);
+bool parseFormatName(const std::string& name, WireFormat& format);
+
+// Parses a header from at least kHeaderSize bytes; false when the magic or type is invalid
+bool parseHeader(const char* data, FrameHeader& header);
+
+void putDatagramHeader(std::string& out, WireFormat format, std::uint32_t sequence);
+bool parseDatagramHeader(std::string_view datagram, DatagramHeader& header);
+
+// String to reference table, safe for concurrent use by many encoding threads. It holds at most
+// `capacity` strings per generation: when a record needs more, the table starts its next
+// generation from reference 1. Earlier generations live on until their records have been sent.
+class StringTable {
+public:
+    explicit StringTable(std::uint32_t capacity = kMaxStringRef);
+
+    // Interns the `count` strings of one record in one generation, which is returned.
+    // The generation is kept until release() is called for the record.
+    std::uint16_t intern(const QString* values, std::size_t count, std::uint32_t* refs);
+    // False if the generation or the reference is no longer held
+    bool lookup(std::uint16_t generation, std::uint32_t ref, QString& value) const;
+    // Called once the record interned in `generation` has been sent or discarded
+    void release(std::uint16_t generation);
+    // Forgets every generation. The next one is numbered on from the current one.
+    void clear();
+
+private:
+    struct Generation {
+        std::uint16_t number;
+        std::vector<QString> values;
+        mutable std::atomic<std::size_t> pending{0}; // Records interned but not yet released
+    };
+    const Generation* find(std::uint16_t generation) const;
+
+    const std::uint32_t m_capacity;
+    mutable std::shared_mutex m_mutex;
+    std::unique_ptr<Generation> m_current;
+    QHash<QString, std::uint32_t> m_refs;
+    std::vector<std::unique_ptr<Generation>> m_retired; // Still holding unsent records
+};
+
+class BinaryEncoder {
+public:
+    explicit BinaryEncoder(std::uint32_t tableCapacity = kMaxStringRef);
+
+    // Each encode call appends any required StringDef frames followed by the record frame.
+    // Only the thread writing to the connection may call these.
+    void encodePE(const PE& pe, std::string& out);
+    void encodeEmitter(const Emitter& emitter, std::string& out);
+    void encodeSetting(SettingKind kind, const std::string& id, const std::string& setting, int value, std::string& out);
+    void encodeText(std::string_view text, std::string& out);
+
+    // Append only the record frame and may be called from any thread. The writing
+    // thread must pass the bytes through appendFrames() to send them.
+    void encodePERecord(const PE& pe, std::string& out);
+    void encodeEmitterRecord(const Emitter& emitter, std::string& out);
+    void encodeSettingRecord(SettingKind kind, const std::string& id, const std::string& setting, int value, std::string& out);
+
+    // Appends `frames` to `out`, each record preceded by the StringDef frames the peer needs to
+    // decode it. Returns how many records were dropped because reset() forgot their strings.
+    std::size_t appendFrames(std::string_view frames, std::string& out);
+
+    // Forgets all interned strings, required whenever the peer's decoder is reset
+    void reset();
+
+private:
+    void announceBefore(std::string& out, std::size_t recordStart);
+    StringTable m_table;
+    // Table generation the peer's references belong to, and which of them it has been sent
+    std::uint16_t m_peerGeneration;
+    std::vector<bool> m_announced;
+};
+
+class BinaryDecoder {
+public:
+    // Binds the string reference carried by a StringDef payload, or forgets every reference for reference 0
+    bool applyStringDef(std::string_view payload);
+    PE decodePE(std::string_view payload) const;
+    Emitter decodeEmitter(std::string_view payload) const;
+    std::tuple<std::string, std::string, std::string, int> decodeSetting(std::string_view payload) const;
+    void reset();
+
+private:
+    const QString& lookup(std::uint32_t ref) const;
+    std::vector<QString> m_strings;
+    std::vector<bool> m_defined;
+};
+
+} // namespace wire
+
+#endif // WIREPROTOCOL_H
@@ -0,0 +1,11 @@
+# Settings shared by every benchmark. Benchmarks build the application's own sources
+# from the repository root, optimised and with logging below warnings compiled out.
+TEMPLATE = app
+CONFIG += console c++17 release
+CONFIG -= app_bundle
+QT += core
+QT -= gui
+DEFINES += LOG_MIN_LEVEL=3
+
+ROOT = $$PWD/..
+INCLUDEPATH += $$ROOT
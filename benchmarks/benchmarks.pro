@@ -0,0 +1,13 @@
+# Standalone benchmarks, one program per subdirectory. Build with
+#   qmake benchmarks/benchmarks.pro && make
+# and run each program from the build directory, they print their own results.
+TEMPLATE = subdirs
+
+SUBDIRS += \
+        decode \
+        feeds \
+        geodesy \
+        lookup \
+        soak \
+        spatial \
+        wire
@@ -0,0 +1,175 @@
+/*
+    Messages decoded per core by NetworkImplementation::deserializePE and
+    deserializeEmitter, which go through the schema-specific decoders in
+    JsonRecordDecoder, against the QJsonDocument decoding they replaced.
+
+    The QJson baseline is a copy of the previous deserializePE and
+    deserializeEmitter: the line is converted through QString to UTF-8, parsed
+    into a QJsonDocument, checked against a QStringList of required fields and
+    read key by key. Both decode the same compact lines, with keys in the
+    order QJsonDocument writes them, and every record must come out the same.
+    The target is five times the baseline's rate.
+
+    Usage: bench_decode [lines] [rounds]
+*/
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QStringList>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "AbstractNetworkInterface.h"
+
+namespace {
+
+constexpr double kTarget = 5.0;
+
+PE legacyDeserializePE(const std::string& data)
+{
+    QJsonDocument doc = QJsonDocument::fromJson(QString::fromStdString(data).toUtf8());
+    if (doc.isNull()) throw std::runtime_error("Invalid JSON data for PE deserialization");
+    QJsonObject json = doc.object();
+
+    QStringList requiredFields = {"id", "type", "lat", "lon", "altitude", "speed", "apd", "priority", "jam", "ghost"};
+    for (auto& field : requiredFields) {
+        if (!json.contains(field)) throw std::runtime_error("JSON does not contain required field " + field.toStdString());
+    }
+
+    PE pe(json["id"].toString(), json["type"].toString(), json["lat"].toDouble(), json["lon"].toDouble(),
+          json["altitude"].toDouble(), json["speed"].toDouble(), json["apd"].toString(), json["priority"].toString(),
+          json["jam"].toBool(), json["ghost"].toBool());
+    pe.heading = json["heading"].toDouble();
+    pe.category = static_cast<PE::PECategory>(json["category"].toInt());
+    pe.state = json["state"].toString();
+    if (!NetworkImplementation::validatePE(pe)) throw std::runtime_error("Invalid PE object deserialized");
+    return pe;
+}
+
+Emitter legacyDeserializeEmitter(const std::string& data)
+{
+    QJsonDocument doc = QJsonDocument::fromJson(QString::fromStdString(data).toUtf8());
+    if (doc.isNull()) throw std::runtime_error("Invalid JSON data for Emitter deserialization");
+    QJsonObject json = doc.object();
+
+    QStringList requiredFields = {"id", "type", "category", "lat", "lon", "freqMin", "freqMax", "jam"};
+    for (auto& field : requiredFields) {
+        if (!json.contains(field)) throw std::runtime_error("JSON does not contain required field " + field.toStdString());
+    }
+
+    Emitter emitter(json["id"].toString(), json["type"].toString(), json["category"].toString(),
+                    json["lat"].toDouble(), json["lon"].toDouble(), json["freqMin"].toDouble(), json["freqMax"].toDouble(),
+                    json["active"].toBool(), json["eaPriority"].toString(), json["esPriority"].toString(),
+                    json["jamResponsible"].toBool(), json["reactiveEligible"].toBool(), json["preemptiveEligible"].toBool(),
+                    json["consentRequired"].toBool(), json["jam"].toBool());
+    emitter.altitude = json["altitude"].toDouble();
+    emitter.heading = json["heading"].toDouble();
+    emitter.speed = json["speed"].toDouble();
+    emitter.operatorManaged = json["operatorManaged"].toBool();
+    emitter.jamIneffective = json["jamIneffective"].toInt();
+    emitter.jamEffective = json["jamEffective"].toInt();
+    if (!NetworkImplementation::validateEmitter(emitter)) throw std::runtime_error("Invalid Emitter object deserialized");
+    return emitter;
+}
+
+std::string peLine(std::size_t i)
+{
+    return "{\"altitude\":" + std::to_string(1000 + i % 9000) + ",\"apd\":\"A\",\"category\":" + std::to_string(i % 2)
+         + ",\"ghost\":false,\"heading\":" + std::to_string((i % 360) * 0.0174533) + ",\"id\":\"TRK" + std::to_string(i)
+         + "\",\"jam\":" + (i % 7 ? "false" : "true") + ",\"lat\":" + std::to_string(-0.66 + (i % 1000) * 1e-5)
+         + ",\"lon\":" + std::to_string(2.53 - (i % 977) * 1e-5) + ",\"priority\":\"P" + std::to_string(i % 5)
+         + "\",\"speed\":" + std::to_string(120 + i % 200) + ",\"state\":\"STATE" + std::to_string(i % 13)
+         + "\",\"type\":\"AIR\"}";
+}
+
+std::string emitterLine(std::size_t i)
+{
+    return "{\"active\":true,\"altitude\":" + std::to_string(i % 500) + ",\"category\":\"RADAR\",\"consentRequired\":false"
+         + ",\"eaPriority\":\"EA" + std::to_string(i % 3) + "\",\"esPriority\":\"ES" + std::to_string(i % 4)
+         + "\",\"freqMax\":" + std::to_string(9.5e9 + i) + ",\"freqMin\":" + std::to_string(9.0e9 + i)
+         + ",\"heading\":0.5,\"id\":\"EMT" + std::to_string(i) + "\",\"jam\":false,\"jamEffective\":" + std::to_string(i % 9)
+         + ",\"jamIneffective\":0,\"jamResponsible\":true,\"lat\":" + std::to_string(-0.66 + (i % 1000) * 1e-5)
+         + ",\"lon\":" + std::to_string(2.53 - (i % 977) * 1e-5) + ",\"operatorManaged\":false"
+         + ",\"preemptiveEligible\":false,\"reactiveEligible\":true,\"speed\":12.5,\"type\":\"SEARCH\"}";
+}
+
+bool samePE(const PE& a, const PE& b)
+{
+    return a.id == b.id && a.type == b.type && a.lat == b.lat && a.lon == b.lon && a.altitude == b.altitude
+        && a.speed == b.speed && a.heading == b.heading && a.apd == b.apd && a.priority == b.priority
+        && a.jam == b.jam && a.ghost == b.ghost && a.category == b.category && a.state == b.state;
+}
+
+bool sameEmitter(const Emitter& a, const Emitter& b)
+{
+    return a.id == b.id && a.type == b.type && a.category == b.category && a.lat == b.lat && a.lon == b.lon
+        && a.altitude == b.altitude && a.heading == b.heading && a.speed == b.speed && a.freqMin == b.freqMin
+        && a.freqMax == b.freqMax && a.active == b.active && a.eaPriority == b.eaPriority && a.esPriority == b.esPriority
+        && a.jamResponsible == b.jamResponsible && a.reactiveEligible == b.reactiveEligible
+        && a.preemptiveEligible == b.preemptiveEligible && a.consentRequired == b.consentRequired
+        && a.operatorManaged == b.operatorManaged && a.jam == b.jam && a.jamIneffective == b.jamIneffective
+        && a.jamEffective == b.jamEffective;
+}
+
+// Best of `rounds` passes over the lines, in messages a second
+template <typename Decode>
+double messagesPerSecond(const std::vector<std::string>& lines, int rounds, Decode decode)
+{
+    double best = 0;
+    std::size_t checksum = 0;
+    for (int round = 0; round < rounds; ++round) {
+        auto start = std::chrono::steady_clock::now();
+        for (const std::string& line : lines) checksum += decode(line);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        best = std::max(best, lines.size() / seconds);
+    }
+    if (checksum == 0) std::printf("nothing decoded\n");
+    return best;
+}
+
+// Prints one row and returns whether the fast path met the target
+bool report(const char* record, double baseline, double fast)
+{
+    double speedup = fast / baseline;
+    std::printf("%8s %14.0f %14.0f %9.1fx %8s\n", record, baseline, fast, speedup, speedup >= kTarget ? "met" : "MISSED");
+    return speedup >= kTarget;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    std::size_t count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 100000;
+    int rounds = argc > 2 ? std::atoi(argv[2]) : 5;
+
+    std::vector<std::string> pes;
+    std::vector<std::string> emitters;
+    for (std::size_t i = 0; i < count; ++i) {
+        pes.push_back(peLine(i));
+        emitters.push_back(emitterLine(i));
+    }
+
+    std::size_t mismatched = 0;
+    for (std::size_t i = 0; i < count; ++i) {
+        if (!samePE(NetworkImplementation::deserializePE(pes[i]), legacyDeserializePE(pes[i]))) ++mismatched;
+        if (!sameEmitter(NetworkImplementation::deserializeEmitter(emitters[i]), legacyDeserializeEmitter(emitters[i]))) ++mismatched;
+    }
+    if (mismatched > 0) {
+        std::printf("%zu records decoded differently from the QJson baseline\n", mismatched);
+        return 1;
+    }
+
+    std::printf("%zu lines of each record, best of %d rounds, one core\n", count, rounds);
+    std::printf("%8s %14s %14s %10s %8s\n", "record", "QJson msgs/s", "fast msgs/s", "speedup", "target");
+    bool met = report("PE",
+        messagesPerSecond(pes, rounds, [](const std::string& line) { return legacyDeserializePE(line).id.size(); }),
+        messagesPerSecond(pes, rounds, [](const std::string& line) { return NetworkImplementation::deserializePE(line).id.size(); }));
+    met &= report("Emitter",
+        messagesPerSecond(emitters, rounds, [](const std::string& line) { return legacyDeserializeEmitter(line).id.size(); }),
+        messagesPerSecond(emitters, rounds, [](const std::string& line) { return NetworkImplementation::deserializeEmitter(line).id.size(); }));
+    std::printf("%gx target %s\n", kTarget, met ? "met" : "missed");
+    return 0;
+}
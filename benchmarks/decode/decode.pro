@@ -0,0 +1,13 @@
+include(../benchmarks.pri)
+
+TARGET = bench_decode
+
+SOURCES += \
+        bench_decode.cpp \
+        $$ROOT/AbstractNetworkInterface.cpp \
+        $$ROOT/BatchWriter.cpp \
+        $$ROOT/FrameReader.cpp \
+        $$ROOT/JsonRecordDecoder.cpp \
+        $$ROOT/Log.cpp \
+        $$ROOT/WireCapture.cpp \
+        $$ROOT/WireProtocol.cpp
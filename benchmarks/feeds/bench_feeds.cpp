@@ -0,0 +1,136 @@
+/*
+    Measures how the CPU FeedManager spends ingesting grows with the number of feeds.
+
+    Every feed sends the same paced rate of JSON PE lines over loopback, so the
+    record rate grows with the feed count. The senders run in a child process,
+    so getrusage() on this process counts only the io threads decoding and
+    merging, and the consumer draining poll() every 16 ms as main.cpp does.
+    Sub-linear scaling shows as CPU time per record falling as feeds are added.
+
+    Usage: bench_feeds [records per second per feed] [seconds] [io threads]
+*/
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <boost/asio.hpp>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+#include "FeedManager.h"
+
+using boost::asio::ip::tcp;
+
+namespace {
+
+double cpuSeconds()
+{
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+// Child process: accepts one connection per acceptor and sends `rate` records a second on each for `seconds`
+[[noreturn]] void sendFeeds(std::vector<tcp::acceptor>& acceptors, int rate, int seconds)
+{
+    std::vector<tcp::socket> sockets;
+    for (tcp::acceptor& acceptor : acceptors) {
+        sockets.push_back(acceptor.accept());
+    }
+
+    // 100 bursts a second, each track reporting in turn
+    const int perBurst = rate / 100 > 0 ? rate / 100 : 1;
+    auto next = std::chrono::steady_clock::now();
+    std::string burst;
+    for (int tick = 0; tick < seconds * 100; ++tick) {
+        for (std::size_t feed = 0; feed < sockets.size(); ++feed) {
+            burst.clear();
+            for (int i = 0; i < perBurst; ++i) {
+                int track = (tick * perBurst + i) % 500;
+                burst += "{\"id\":\"F" + std::to_string(feed) + "T" + std::to_string(track)
+                       + "\",\"type\":\"AIR\",\"lat\":-37.8,\"lon\":144.9,\"altitude\":" + std::to_string(tick)
+                       + ",\"speed\":120,\"heading\":90,\"apd\":\"A\",\"priority\":\"P\",\"jam\":false,\"ghost\":false}\n";
+            }
+            boost::asio::write(sockets[feed], boost::asio::buffer(burst));
+        }
+        next += std::chrono::milliseconds(10);
+        std::this_thread::sleep_until(next);
+    }
+    std::_Exit(0);
+}
+
+struct Result {
+    std::uint64_t records;
+    double wallSeconds;
+    double cpuSeconds;
+};
+
+Result run(std::size_t feedCount, int rate, int seconds, std::size_t ioThreads)
+{
+    boost::asio::io_context context;
+    std::vector<tcp::acceptor> acceptors;
+    std::vector<unsigned short> ports;
+    for (std::size_t i = 0; i < feedCount; ++i) {
+        acceptors.emplace_back(context, tcp::endpoint(boost::asio::ip::address_v4::loopback(), 0));
+        ports.push_back(acceptors.back().local_endpoint().port());
+    }
+
+    pid_t sender = fork();
+    if (sender == 0) {
+        sendFeeds(acceptors, rate, seconds);
+    }
+    for (tcp::acceptor& acceptor : acceptors) {
+        acceptor.close();
+    }
+
+    FeedManager feeds(ioThreads);
+    for (unsigned short port : ports) {
+        feeds.addFeed("127.0.0.1", port);
+    }
+
+    const int perBurst = rate / 100 > 0 ? rate / 100 : 1;
+    const std::uint64_t expected = static_cast<std::uint64_t>(perBurst) * 100 * seconds * feedCount;
+    std::vector<FeedRecord> records;
+    std::uint64_t received = 0;
+    double cpuStart = cpuSeconds();
+    auto start = std::chrono::steady_clock::now();
+    auto deadline = start + std::chrono::seconds(seconds + 10);
+    while (received < expected && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(16));
+        records.clear();
+        received += feeds.poll(records);
+    }
+    Result result{received, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(),
+                  cpuSeconds() - cpuStart};
+
+    feeds.stop();
+    waitpid(sender, nullptr, 0);
+    if (received != expected) {
+        std::fprintf(stderr, "%zu feeds: expected %llu records, received %llu\n", feedCount,
+                     static_cast<unsigned long long>(expected), static_cast<unsigned long long>(received));
+    }
+    return result;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    int rate = argc > 1 ? std::atoi(argv[1]) : 5000;
+    int seconds = argc > 2 ? std::atoi(argv[2]) : 3;
+    std::size_t ioThreads = argc > 3 ? static_cast<std::size_t>(std::atoi(argv[3])) : 2;
+
+    std::printf("%d records/s per feed for %d s, %zu io threads\n", rate, seconds, ioThreads);
+    std::printf("%6s %12s %10s %10s %12s %14s\n", "feeds", "records", "CPU s", "CPU %", "us/record", "CPU vs 1 feed");
+    double baseline = 0;
+    for (std::size_t feedCount : {1, 2, 4, 8, 16, 32}) {
+        Result result = run(feedCount, rate, seconds, ioThreads);
+        if (baseline == 0) baseline = result.cpuSeconds;
+        std::printf("%6zu %12llu %10.3f %10.1f %12.2f %13.2fx\n", feedCount, static_cast<unsigned long long>(result.records),
+                    result.cpuSeconds, 100 * result.cpuSeconds / result.wallSeconds,
+                    1e6 * result.cpuSeconds / static_cast<double>(result.records), result.cpuSeconds / baseline);
+    }
+    return 0;
+}
@@ -0,0 +1,14 @@
+include(../benchmarks.pri)
+
+TARGET = bench_feeds
+
+SOURCES += \
+        bench_feeds.cpp \
+        $$ROOT/AbstractNetworkInterface.cpp \
+        $$ROOT/BatchWriter.cpp \
+        $$ROOT/FeedManager.cpp \
+        $$ROOT/FrameReader.cpp \
+        $$ROOT/JsonRecordDecoder.cpp \
+        $$ROOT/Log.cpp \
+        $$ROOT/WireCapture.cpp \
+        $$ROOT/WireProtocol.cpp
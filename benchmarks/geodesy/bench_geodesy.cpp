@@ -0,0 +1,316 @@
+/*
+    Accuracy and throughput per core of the batch geodesy kernels.
+
+    Each kernel runs over the same columns of random positions, a third of the
+    pairs within a few kilometres of each other as neighbouring tracks are,
+    and is compared point by point with its formula evaluated with the C
+    library. The error is relative, or absolute where the result is under 1 m
+    or 1 rad, and must stay under 1e-12. Bearings and local coordinates, whose
+    conditioning depends on the points, are weighted as noted where checked.
+    Throughput is the best of several passes over the columns, against the
+    same C library loop.
+
+    vincentyDistance evaluates its series with the C library, so instead it is
+    checked against distances known independently: Flinders Peak to Buninyong
+    from the Geoscience Australia test data, arcs of the equator, and arcs of
+    meridians integrated numerically. It must be within a millimetre.
+
+    Usage: bench_geodesy [points] [rounds]
+*/
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+#include "Geodesy.h"
+#include "Kinematics.h"
+
+namespace {
+
+using kinematics::kEarthRadiusMetres;
+
+constexpr double kTolerance = 1e-12;
+constexpr double kVincentyToleranceMetres = 1e-3;
+constexpr double kEccentricitySquared = geodesy::kFlattening * (2 - geodesy::kFlattening);
+
+struct Columns {
+    std::vector<double> latitude1, longitude1, latitude2, longitude2, altitude, bearing, metres;
+};
+
+Columns randomColumns(std::size_t count)
+{
+    std::mt19937_64 random(1);
+    std::uniform_real_distribution<double> sinLatitude(-1, 1);
+    std::uniform_real_distribution<double> longitude(-M_PI, M_PI);
+    std::uniform_real_distribution<double> nearby(-5e-4, 5e-4);
+    std::uniform_real_distribution<double> altitude(-500, 15000);
+    std::uniform_real_distribution<double> bearing(0, 2 * M_PI);
+    std::uniform_real_distribution<double> metres(0, 2e7);
+
+    Columns columns;
+    for (std::size_t i = 0; i < count; ++i) {
+        double latitude1 = std::asin(sinLatitude(random));
+        double longitude1 = longitude(random);
+        columns.latitude1.push_back(latitude1);
+        columns.longitude1.push_back(longitude1);
+        columns.latitude2.push_back(i % 3 == 0 ? std::clamp(latitude1 + nearby(random), -M_PI / 2, M_PI / 2)
+                                               : std::asin(sinLatitude(random)));
+        columns.longitude2.push_back(i % 3 == 0 ? longitude1 + nearby(random) : longitude(random));
+        columns.altitude.push_back(altitude(random));
+        columns.bearing.push_back(bearing(random));
+        columns.metres.push_back(i % 3 == 0 ? metres(random) * 1e-4 : metres(random));
+    }
+    return columns;
+}
+
+double angleBetween(double a, double b)
+{
+    return std::fabs(std::remainder(a - b, 2 * M_PI));
+}
+
+double error(double result, double expected)
+{
+    return std::fabs(result - expected) / std::max(std::fabs(expected), 1.0);
+}
+
+// Best of `rounds` runs of `pass` over `count` points, in points a second
+template <typename Pass>
+double pointsPerSecond(std::size_t count, int rounds, Pass pass)
+{
+    double best = 0;
+    for (int round = 0; round < rounds; ++round) {
+        auto start = std::chrono::steady_clock::now();
+        pass();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        best = std::max(best, count / seconds);
+    }
+    return best;
+}
+
+// Prints one row and returns whether the kernel was within tolerance
+bool report(const char *function, double maxError, double kernel, double library)
+{
+    std::printf("%18s %12.2e %14.1f %14.1f %8.1fx %6s\n", function, maxError, kernel / 1e6, library / 1e6,
+                kernel / library, maxError <= kTolerance ? "ok" : "FAILED");
+    return maxError <= kTolerance;
+}
+
+void referenceHaversine(const Columns &in, std::vector<double> &metres)
+{
+    for (std::size_t i = 0; i < metres.size(); ++i) {
+        double sinLatitude = std::sin((in.latitude2[i] - in.latitude1[i]) / 2);
+        double sinLongitude = std::sin((in.longitude2[i] - in.longitude1[i]) / 2);
+        double h = sinLatitude * sinLatitude
+                 + std::cos(in.latitude1[i]) * std::cos(in.latitude2[i]) * sinLongitude * sinLongitude;
+        metres[i] = 2 * kEarthRadiusMetres * std::atan2(std::sqrt(h), std::sqrt(1 - h));
+    }
+}
+
+void referenceBearing(const Columns &in, std::vector<double> &bearing)
+{
+    for (std::size_t i = 0; i < bearing.size(); ++i) {
+        double deltaLongitude = in.longitude2[i] - in.longitude1[i];
+        double b = std::atan2(std::sin(deltaLongitude) * std::cos(in.latitude2[i]),
+                              std::cos(in.latitude1[i]) * std::sin(in.latitude2[i])
+                              - std::sin(in.latitude1[i]) * std::cos(in.latitude2[i]) * std::cos(deltaLongitude));
+        bearing[i] = b < 0 ? b + 2 * M_PI : b;
+    }
+}
+
+void referenceDestination(const Columns &in, std::vector<double> &latitude, std::vector<double> &longitude)
+{
+    for (std::size_t i = 0; i < latitude.size(); ++i) {
+        double angle = in.metres[i] / kEarthRadiusMetres;
+        double sinLatitude = std::sin(in.latitude1[i]) * std::cos(angle)
+                           + std::cos(in.latitude1[i]) * std::sin(angle) * std::cos(in.bearing[i]);
+        latitude[i] = std::asin(sinLatitude);
+        longitude[i] = std::remainder(in.longitude1[i] + std::atan2(std::sin(in.bearing[i]) * std::sin(angle) * std::cos(in.latitude1[i]),
+                                                                    std::cos(angle) - std::sin(in.latitude1[i]) * sinLatitude),
+                                      2 * M_PI);
+    }
+}
+
+void referenceEcef(double latitude, double longitude, double altitude, double &x, double &y, double &z)
+{
+    double sinLatitude = std::sin(latitude);
+    double primeVertical = geodesy::kSemiMajorAxisMetres / std::sqrt(1 - kEccentricitySquared * sinLatitude * sinLatitude);
+    x = (primeVertical + altitude) * std::cos(latitude) * std::cos(longitude);
+    y = (primeVertical + altitude) * std::cos(latitude) * std::sin(longitude);
+    z = (primeVertical * (1 - kEccentricitySquared) + altitude) * sinLatitude;
+}
+
+void referenceEnu(double originLatitude, double originLongitude, double originAltitude,
+                  const std::vector<double> &x, const std::vector<double> &y, const std::vector<double> &z,
+                  std::vector<double> &east, std::vector<double> &north, std::vector<double> &up)
+{
+    double originX, originY, originZ;
+    referenceEcef(originLatitude, originLongitude, originAltitude, originX, originY, originZ);
+    double sinLatitude = std::sin(originLatitude), cosLatitude = std::cos(originLatitude);
+    double sinLongitude = std::sin(originLongitude), cosLongitude = std::cos(originLongitude);
+    for (std::size_t i = 0; i < x.size(); ++i) {
+        double dx = x[i] - originX, dy = y[i] - originY, dz = z[i] - originZ;
+        east[i] = -sinLongitude * dx + cosLongitude * dy;
+        north[i] = -sinLatitude * cosLongitude * dx - sinLatitude * sinLongitude * dy + cosLatitude * dz;
+        up[i] = cosLatitude * cosLongitude * dx + cosLatitude * sinLongitude * dy + sinLatitude * dz;
+    }
+}
+
+// Length of the meridian from the equator to `latitude`, by Simpson's rule over its radius of curvature
+double meridianArc(double latitude)
+{
+    constexpr int kSteps = 20000;
+    auto radius = [](double phi) {
+        double s = std::sin(phi);
+        return geodesy::kSemiMajorAxisMetres * (1 - kEccentricitySquared) / std::pow(1 - kEccentricitySquared * s * s, 1.5);
+    };
+    double step = latitude / kSteps;
+    double sum = radius(0) + radius(latitude);
+    for (int i = 1; i < kSteps; ++i) sum += radius(i * step) * (i % 2 ? 4 : 2);
+    return sum * step / 3;
+}
+
+double vincenty(double latitude1, double longitude1, double latitude2, double longitude2)
+{
+    double metres;
+    geodesy::vincentyDistance(&latitude1, &longitude1, &latitude2, &longitude2, &metres, 1);
+    return metres;
+}
+
+// Largest error in metres of vincentyDistance against the known distances
+double vincentyError()
+{
+    auto radians = [](double degrees, double minutes, double seconds) {
+        return (degrees + minutes / 60 + seconds / 3600) * M_PI / 180;
+    };
+    double worst = std::fabs(vincenty(-radians(37, 57, 3.72030), radians(144, 25, 29.52440),
+                                      -radians(37, 39, 10.15610), radians(143, 55, 35.38390)) - 54972.271);
+
+    std::mt19937_64 random(2);
+    std::uniform_real_distribution<double> longitude(-M_PI, M_PI);
+    std::uniform_real_distribution<double> span(0, 3.0);
+    std::uniform_real_distribution<double> latitude(-M_PI / 2, M_PI / 2);
+    for (int i = 0; i < 100; ++i) {
+        // Along the equator the geodesic is the equator itself, up to antipodal spans
+        double start = longitude(random);
+        double length = span(random);
+        worst = std::max(worst, std::fabs(vincenty(0, start, 0, start + length) - geodesy::kSemiMajorAxisMetres * length));
+
+        double from = latitude(random);
+        double to = latitude(random);
+        double meridian = longitude(random);
+        worst = std::max(worst, std::fabs(vincenty(from, meridian, to, meridian) - std::fabs(meridianArc(to) - meridianArc(from))));
+    }
+    return worst;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    std::size_t count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    int rounds = argc > 2 ? std::atoi(argv[2]) : 5;
+    if (count == 0 || rounds <= 0) {
+        std::fprintf(stderr, "Need at least one point and one round\n");
+        return 1;
+    }
+
+    Columns in = randomColumns(count);
+    std::vector<double> a(count), b(count), c(count), expectedA(count), expectedB(count), expectedC(count);
+    std::vector<double> x(count), y(count), z(count);
+    bool passed = true;
+    double worst;
+
+    std::printf("%zu points, best of %d rounds, one core\n", count, rounds);
+    std::printf("%18s %12s %14s %14s %9s %6s\n", "function", "max error", "kernel Mpt/s", "libm Mpt/s", "speedup", "");
+
+    geodesy::haversineDistance(in.latitude1.data(), in.longitude1.data(), in.latitude2.data(), in.longitude2.data(), a.data(), count);
+    referenceHaversine(in, expectedA);
+    worst = 0;
+    for (std::size_t i = 0; i < count; ++i) worst = std::max(worst, error(a[i], expectedA[i]));
+    passed &= report("haversineDistance", worst,
+        pointsPerSecond(count, rounds, [&] {
+            geodesy::haversineDistance(in.latitude1.data(), in.longitude1.data(), in.latitude2.data(), in.longitude2.data(), a.data(), count);
+        }),
+        pointsPerSecond(count, rounds, [&] { referenceHaversine(in, expectedA); }));
+
+    geodesy::initialBearing(in.latitude1.data(), in.longitude1.data(), in.latitude2.data(), in.longitude2.data(), a.data(), count);
+    referenceBearing(in, expectedA);
+    referenceHaversine(in, expectedB);
+    worst = 0;
+    for (std::size_t i = 0; i < count; ++i) {
+        // The bearing between points metres apart is ill-conditioned however it's evaluated, so its error is
+        // weighted by the pair's separation, giving the sideways displacement it causes at the second point
+        if (a[i] < 0 || a[i] >= 2 * M_PI) worst = INFINITY;
+        worst = std::max(worst, angleBetween(a[i], expectedA[i]) * std::min(expectedB[i] / kEarthRadiusMetres, 1.0));
+    }
+    passed &= report("initialBearing", worst,
+        pointsPerSecond(count, rounds, [&] {
+            geodesy::initialBearing(in.latitude1.data(), in.longitude1.data(), in.latitude2.data(), in.longitude2.data(), a.data(), count);
+        }),
+        pointsPerSecond(count, rounds, [&] { referenceBearing(in, expectedA); }));
+
+    geodesy::destination(in.latitude1.data(), in.longitude1.data(), in.bearing.data(), in.metres.data(), a.data(), b.data(), count);
+    referenceDestination(in, expectedA, expectedB);
+    worst = 0;
+    for (std::size_t i = 0; i < count; ++i) {
+        if (b[i] < -M_PI || b[i] >= M_PI) worst = INFINITY;
+        worst = std::max({worst, error(a[i], expectedA[i]), angleBetween(b[i], expectedB[i])});
+    }
+    passed &= report("destination", worst,
+        pointsPerSecond(count, rounds, [&] {
+            geodesy::destination(in.latitude1.data(), in.longitude1.data(), in.bearing.data(), in.metres.data(), a.data(), b.data(), count);
+        }),
+        pointsPerSecond(count, rounds, [&] { referenceDestination(in, expectedA, expectedB); }));
+
+    geodesy::geodeticToEcef(in.latitude1.data(), in.longitude1.data(), in.altitude.data(), x.data(), y.data(), z.data(), count);
+    auto ecefReference = [&] {
+        for (std::size_t i = 0; i < count; ++i) {
+            referenceEcef(in.latitude1[i], in.longitude1[i], in.altitude[i], expectedA[i], expectedB[i], expectedC[i]);
+        }
+    };
+    ecefReference();
+    worst = 0;
+    for (std::size_t i = 0; i < count; ++i) {
+        worst = std::max({worst, error(x[i], expectedA[i]), error(y[i], expectedB[i]), error(z[i], expectedC[i])});
+    }
+    passed &= report("geodeticToEcef", worst,
+        pointsPerSecond(count, rounds, [&] {
+            geodesy::geodeticToEcef(in.latitude1.data(), in.longitude1.data(), in.altitude.data(), x.data(), y.data(), z.data(), count);
+        }),
+        pointsPerSecond(count, rounds, ecefReference));
+
+    // Relative to the first position, so the nearby points come out within a few kilometres
+    double originLatitude = in.latitude1[0], originLongitude = in.longitude1[0], originAltitude = in.altitude[0];
+    geodesy::ecefToEnu(originLatitude, originLongitude, originAltitude, x.data(), y.data(), z.data(), a.data(), b.data(), c.data(), count);
+    referenceEnu(originLatitude, originLongitude, originAltitude, x, y, z, expectedA, expectedB, expectedC);
+    worst = 0;
+    for (std::size_t i = 0; i < count; ++i) {
+        // Rounding of the ECEF coordinates alone limits the result, so the error is relative to their size
+        double scale = std::sqrt(x[i] * x[i] + y[i] * y[i] + z[i] * z[i]);
+        worst = std::max({worst, std::fabs(a[i] - expectedA[i]) / scale, std::fabs(b[i] - expectedB[i]) / scale,
+                          std::fabs(c[i] - expectedC[i]) / scale});
+    }
+    passed &= report("ecefToEnu", worst,
+        pointsPerSecond(count, rounds, [&] {
+            geodesy::ecefToEnu(originLatitude, originLongitude, originAltitude, x.data(), y.data(), z.data(), a.data(), b.data(), c.data(), count);
+        }),
+        pointsPerSecond(count, rounds, [&] {
+            referenceEnu(originLatitude, originLongitude, originAltitude, x, y, z, expectedA, expectedB, expectedC);
+        }));
+
+    double vincentyWorst = vincentyError();
+    double vincentyRate = pointsPerSecond(count, rounds, [&] {
+        geodesy::vincentyDistance(in.latitude1.data(), in.longitude1.data(), in.latitude2.data(), in.longitude2.data(), a.data(), count);
+    });
+    std::size_t unconverged = std::count_if(a.begin(), a.end(), [](double metres) { return std::isnan(metres); });
+    bool vincentyPassed = vincentyWorst <= kVincentyToleranceMetres;
+    std::printf("%18s %10.2e m %14.1f %14s %9s %6s\n", "vincentyDistance", vincentyWorst, vincentyRate / 1e6, "-", "-",
+                vincentyPassed ? "ok" : "FAILED");
+    std::printf("%zu nearly antipodal pairs didn't converge\n", unconverged);
+
+    passed &= vincentyPassed;
+    std::printf("accuracy %s\n", passed ? "met" : "missed");
+    return passed ? 0 : 1;
+}
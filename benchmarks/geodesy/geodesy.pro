@@ -0,0 +1,10 @@
+include(../benchmarks.pri)
+
+TARGET = bench_geodesy
+
+# Measures the SSE2 kernels by default. Uncomment, as in Qt5MappingDemo.pro, to measure the AVX ones.
+#QMAKE_CXXFLAGS += -mavx
+
+SOURCES += \
+        bench_geodesy.cpp \
+        $$ROOT/Geodesy.cpp
@@ -0,0 +1,112 @@
+/*
+    Cost of looking an entity up by UID as the number of entities grows from
+    10 to 1M, which should stay flat.
+
+    For each size the store is filled with entities, then the same number of
+    lookups, spread over every entity plus one in ten for UIDs that don't
+    exist, are timed through EntityStore::find, the index itself, and through
+    EntityManager::getEntityByUID, which is what the page calls.
+
+    Looking up random entities out of all of them measures cache misses as
+    much as the index: past a few thousand entities the table no longer fits
+    in cache, and every lookup waits on memory. The hot columns repeat the
+    lookups over a fixed sample of 1000 entities, so only the index's own cost
+    changes with size. The getEntityByUID column uses the same sample, whose
+    Entity views are created by a warm up pass, as they are after the first frame.
+
+    Usage: bench_lookup [lookups per size]
+*/
+#include <QCoreApplication>
+#include <QThread>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+#include "EntityManager.h"
+#include "EntityStore.h"
+
+namespace {
+
+QString uidFor(std::size_t index)
+{
+    return QString::fromStdString("TRK" + std::to_string(index));
+}
+
+// UIDs to look up: random entities among the first `sample`, with every tenth one missing from the store
+std::vector<QString> lookupUIDs(std::size_t entities, std::size_t lookups, std::size_t sample)
+{
+    std::mt19937 random(42);
+    std::uniform_int_distribution<std::size_t> pick(0, std::min(entities, sample) - 1);
+    std::vector<QString> UIDs;
+    UIDs.reserve(lookups);
+    for (std::size_t i = 0; i < lookups; ++i) {
+        UIDs.push_back(i % 10 == 9 ? uidFor(entities + pick(random)) : uidFor(pick(random)));
+    }
+    return UIDs;
+}
+
+template <typename Lookup>
+double nanosecondsPerLookup(const std::vector<QString>& UIDs, Lookup lookup)
+{
+    std::size_t found = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (const QString& UID : UIDs) found += lookup(UID);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (found == 0) std::printf("nothing found\n");
+    return 1e9 * seconds / UIDs.size();
+}
+
+constexpr std::size_t kHotSample = 1000;
+
+double storeLookup(std::size_t entities, std::size_t lookups, std::size_t sample)
+{
+    EntityStore store;
+    for (std::size_t i = 0; i < entities; ++i) {
+        store.insert(uidFor(i), uidFor(i), 100, -0.66 + (i % 1000) * 1e-5, 2.53 + (i / 1000 % 1000) * 1e-5);
+    }
+    std::vector<QString> UIDs = lookupUIDs(entities, lookups, sample);
+    return nanosecondsPerLookup(UIDs, [&store](const QString& UID) {
+        return store.find(UID) != EntityStore::InvalidSlot;
+    });
+}
+
+double managerLookup(std::size_t entities, std::size_t lookups)
+{
+    EntityManager manager;
+    manager.setPredictionInterval(0);
+    std::vector<PE> pes;
+    for (std::size_t i = 0; i < entities; ++i) {
+        pes.emplace_back(uidFor(i), "AIR", -37.8 + (i % 1000) * 1e-4, 144.9 + (i / 1000 % 1000) * 1e-4, 1000, 0, "A", "P", false, false);
+        if (pes.size() == 10000 || i + 1 == entities) {
+            manager.upsertBatch(pes);
+            pes.clear();
+        }
+    }
+    while (manager.snapshot()->store.size() < entities) QThread::msleep(5);
+
+    std::vector<QString> UIDs = lookupUIDs(entities, lookups, kHotSample);
+    for (const QString& UID : UIDs) manager.getEntityByUID(UID);
+    return nanosecondsPerLookup(UIDs, [&manager](const QString& UID) {
+        return manager.getEntityByUID(UID) != nullptr;
+    });
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    std::size_t lookups = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+
+    std::printf("%zu lookups per size, one in ten for a missing UID\n", lookups);
+    std::printf("%10s %14s %14s %22s\n", "entities", "random ns", "hot ns", "getEntityByUID hot ns");
+    for (std::size_t entities : {10, 100, 1000, 10000, 100000, 1000000}) {
+        double random = storeLookup(entities, lookups, entities);
+        double hot = storeLookup(entities, lookups, kHotSample);
+        double manager = managerLookup(entities, lookups);
+        std::printf("%10zu %14.1f %14.1f %22.1f\n", entities, random, hot, manager);
+    }
+    return 0;
+}
@@ -0,0 +1,131 @@
+/*
+    Soak test of entity churn: millions of creates and removes against a
+    steady population, reporting resident memory as it goes. With slots and
+    their strings reused, memory should stop growing once the first
+    population has been allocated.
+
+    The first phase churns an EntityStore directly, removing a random entity
+    and creating one with a new UID each cycle. The second goes through
+    EntityManager as a feed would, each round creating a batch of new tracks
+    with upsertBatch and removing the previous batch with removeEntities,
+    delivering the queued signals between rounds as the event loop would.
+
+    Usage: bench_soak [store cycles] [manager cycles] [population]
+*/
+#include <QCoreApplication>
+#include <QThread>
+#include <unistd.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+#include "EntityManager.h"
+#include "EntityStore.h"
+
+namespace {
+
+constexpr int kCheckpoints = 10;
+
+double residentMegabytes()
+{
+    std::ifstream statm("/proc/self/statm");
+    long pages = 0;
+    long resident = 0;
+    statm >> pages >> resident;
+    return resident * static_cast<double>(sysconf(_SC_PAGESIZE)) / (1024 * 1024);
+}
+
+QString uidFor(std::uint64_t index)
+{
+    return QString::fromStdString("TRK" + std::to_string(index));
+}
+
+void printCheckpoint(std::uint64_t cycles, std::size_t live, std::size_t slots, double seconds)
+{
+    std::printf("%12llu %10zu %10zu %12.1f %10.1f\n", static_cast<unsigned long long>(cycles), live, slots,
+                residentMegabytes(), seconds);
+}
+
+void soakStore(std::uint64_t cycles, std::size_t population)
+{
+    std::printf("EntityStore, %zu live entities\n", population);
+    std::printf("%12s %10s %10s %12s %10s\n", "cycles", "live", "slots", "resident MB", "seconds");
+
+    EntityStore store;
+    std::mt19937 random(7);
+    std::uniform_real_distribution<double> coordinate(-0.5, 0.5);
+    std::vector<EntityStore::Slot> live;
+    std::uint64_t next = 0;
+    for (std::size_t i = 0; i < population; ++i, ++next) {
+        live.push_back(store.insert(uidFor(next), uidFor(next), 100, coordinate(random), coordinate(random)));
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (std::uint64_t cycle = 1; cycle <= cycles; ++cycle, ++next) {
+        EntityStore::Slot &victim = live[random() % live.size()];
+        store.remove(victim);
+        victim = store.insert(uidFor(next), uidFor(next), 100, coordinate(random), coordinate(random));
+        if (cycle % (cycles / kCheckpoints) == 0) {
+            printCheckpoint(cycle, store.size(), store.slotCount(),
+                            std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+        }
+    }
+}
+
+void soakManager(std::uint64_t cycles, std::size_t population)
+{
+    std::printf("EntityManager, batches of %zu\n", population);
+    std::printf("%12s %10s %10s %12s %10s\n", "cycles", "live", "slots", "resident MB", "seconds");
+
+    EntityManager manager;
+    manager.setPredictionInterval(0);
+    std::uint64_t next = 0;
+    QStringList previous;
+    std::vector<PE> batch;
+    const std::uint64_t rounds = cycles / population;
+    auto start = std::chrono::steady_clock::now();
+    for (std::uint64_t round = 1; round <= rounds; ++round) {
+        batch.clear();
+        QStringList current;
+        for (std::size_t i = 0; i < population; ++i, ++next) {
+            double offset = static_cast<double>(next % 1000) * 1e-3;
+            batch.emplace_back(uidFor(next), "AIR", -37.8 + offset, 144.9 + offset, 1000, 0, "A", "P", false, false);
+            current.append(batch.back().id);
+        }
+        manager.removeEntities(previous);
+        manager.upsertBatch(batch);
+        previous = current;
+
+        // Commands apply in order, so once the new batch is published the old one is gone
+        while (manager.snapshot()->store.find(previous.back()) == EntityStore::InvalidSlot) QThread::usleep(100);
+        QCoreApplication::processEvents();
+
+        if (round % (rounds / kCheckpoints) == 0) {
+            EntitySnapshotHandle published = manager.snapshot();
+            printCheckpoint(round * population, published->store.size(), published->store.slotCount(),
+                            std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+        }
+    }
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    std::uint64_t storeCycles = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 5000000;
+    std::uint64_t managerCycles = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 2000000;
+    std::size_t population = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 1000;
+    if (storeCycles < kCheckpoints || managerCycles < population * kCheckpoints) {
+        std::fprintf(stderr, "Too few cycles for %d checkpoints\n", kCheckpoints);
+        return 1;
+    }
+
+    soakStore(storeCycles, population);
+    std::printf("\n");
+    soakManager(managerCycles, population);
+    return 0;
+}
@@ -0,0 +1,162 @@
+/*
+    Latency of EntityStore's box and radius queries, from 10k to 1M entities,
+    against a scan of every entity for the same answer.
+
+    Entities are spread uniformly over a region the size of a national
+    airspace, 35 by 45 degrees, so each query size sees a realistic number of
+    them. For each size the queries are centred at random points in the
+    region and the mean time per query is reported in microseconds, along
+    with how many entities the average radius query returned. The scan is
+    what answering the query without the index costs and grows with the
+    number of entities, the index should only grow with the number found.
+    Each scan also checks that the index found the same entities.
+
+    Queries that return a large share of every entity, the 1000 km row, visit
+    most occupied cells one hash lookup at a time and can be slower than the
+    scan's straight pass over the columns.
+
+    Usage: bench_spatial [queries per size]
+*/
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+#include "EntityStore.h"
+#include "Kinematics.h"
+
+using kinematics::kEarthRadiusMetres;
+
+namespace {
+
+constexpr double kMinLatitude = -45 * M_PI / 180;
+constexpr double kMaxLatitude = -10 * M_PI / 180;
+constexpr double kMinLongitude = 110 * M_PI / 180;
+constexpr double kMaxLongitude = 155 * M_PI / 180;
+
+struct Centre {
+    double latitude;
+    double longitude;
+};
+
+void fill(EntityStore &store, std::size_t entities)
+{
+    std::mt19937 random(21);
+    std::uniform_real_distribution<double> latitude(kMinLatitude, kMaxLatitude);
+    std::uniform_real_distribution<double> longitude(kMinLongitude, kMaxLongitude);
+    store.reserve(entities);
+    for (std::size_t i = 0; i < entities; ++i) {
+        QString UID = QString::fromStdString("TRK" + std::to_string(i));
+        store.insert(UID, UID, 100, latitude(random), longitude(random));
+    }
+}
+
+std::vector<Centre> centres(std::size_t queries)
+{
+    std::mt19937 random(5);
+    std::uniform_real_distribution<double> latitude(kMinLatitude, kMaxLatitude);
+    std::uniform_real_distribution<double> longitude(kMinLongitude, kMaxLongitude);
+    std::vector<Centre> result(queries);
+    for (Centre &centre : result) centre = {latitude(random), longitude(random)};
+    return result;
+}
+
+// Mean microseconds per query, adding the entities found to `found`
+template <typename Query>
+double timeQueries(const std::vector<Centre> &queries, Query query, std::size_t &found)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (const Centre &centre : queries) found += query(centre);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return 1e6 * seconds / queries.size();
+}
+
+// Times the index and the scan, and checks they find the same entities on the scan's queries
+template <typename Query, typename Scan>
+std::pair<double, double> compare(const char *name, const std::vector<Centre> &queries,
+                                  const std::vector<Centre> &scanQueries, Query query, Scan scan)
+{
+    std::size_t found = 0;
+    double queryMicroseconds = timeQueries(queries, query, found);
+    std::size_t scanned = 0;
+    double scanMicroseconds = timeQueries(scanQueries, scan, scanned);
+    std::size_t expected = 0;
+    for (const Centre &centre : scanQueries) expected += query(centre);
+    if (scanned != expected) std::printf("%s found %zu entities where the scan found %zu\n", name, expected, scanned);
+    return {queryMicroseconds, scanMicroseconds};
+}
+
+std::size_t scanBox(const EntityStore &store, double minLatitude, double minLongitude, double maxLatitude, double maxLongitude)
+{
+    const std::vector<double> &latitudes = store.latitudes();
+    const std::vector<double> &longitudes = store.longitudes();
+    std::size_t found = 0;
+    for (std::size_t slot = 0; slot < latitudes.size(); ++slot) {
+        found += latitudes[slot] >= minLatitude && latitudes[slot] <= maxLatitude && longitudes[slot] >= minLongitude
+            && longitudes[slot] <= maxLongitude;
+    }
+    return found;
+}
+
+std::size_t scanRadius(const EntityStore &store, const Centre &centre, double metres)
+{
+    const std::vector<double> &latitudes = store.latitudes();
+    const std::vector<double> &longitudes = store.longitudes();
+    double limit = std::sin(metres / kEarthRadiusMetres / 2);
+    limit *= limit;
+    double cosLatitude = std::cos(centre.latitude);
+    std::size_t found = 0;
+    for (std::size_t slot = 0; slot < latitudes.size(); ++slot) {
+        double sinLatitude = std::sin((latitudes[slot] - centre.latitude) / 2);
+        double sinLongitude = std::sin((longitudes[slot] - centre.longitude) / 2);
+        found += sinLatitude * sinLatitude + cosLatitude * std::cos(latitudes[slot]) * sinLongitude * sinLongitude <= limit;
+    }
+    return found;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    std::size_t queries = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 500;
+    std::vector<Centre> queryCentres = centres(queries);
+    // The scan is much slower, a tenth of the queries is plenty
+    std::vector<Centre> scanCentres(queryCentres.begin(), queryCentres.begin() + std::max<std::size_t>(1, queries / 10));
+
+    std::printf("%zu queries per size, centred at random in a 35 by 45 degree region\n", queries);
+    std::printf("%10s %8s %10s %12s %14s %12s %14s\n", "entities", "km", "found", "box us", "box scan us",
+                "radius us", "radius scan us");
+    for (std::size_t entities : {10000, 100000, 1000000}) {
+        EntityStore store;
+        fill(store, entities);
+        for (double kilometres : {1.0, 10.0, 100.0, 1000.0}) {
+            // A box the size of the circle, as a map view around the same point would be
+            double metres = kilometres * 1000;
+            double halfHeight = metres / kEarthRadiusMetres;
+            auto box = [&](const Centre &centre) {
+                double halfWidth = halfHeight / std::cos(centre.latitude);
+                return store.queryBox(centre.latitude - halfHeight, centre.longitude - halfWidth,
+                                      centre.latitude + halfHeight, centre.longitude + halfWidth).size();
+            };
+            auto boxScan = [&](const Centre &centre) {
+                double halfWidth = halfHeight / std::cos(centre.latitude);
+                return scanBox(store, centre.latitude - halfHeight, centre.longitude - halfWidth,
+                               centre.latitude + halfHeight, centre.longitude + halfWidth);
+            };
+            auto radius = [&](const Centre &centre) { return store.queryRadius(centre.latitude, centre.longitude, metres).size(); };
+            auto radiusScan = [&](const Centre &centre) { return scanRadius(store, centre, metres); };
+
+            std::pair<double, double> boxTimes = compare("queryBox", queryCentres, scanCentres, box, boxScan);
+            std::pair<double, double> radiusTimes = compare("queryRadius", queryCentres, scanCentres, radius, radiusScan);
+            std::size_t found = 0;
+            for (const Centre &centre : scanCentres) found += radius(centre);
+            std::printf("%10zu %8.0f %10.1f %12.2f %14.1f %12.2f %14.1f\n", entities, kilometres,
+                        static_cast<double>(found) / scanCentres.size(), boxTimes.first, boxTimes.second,
+                        radiusTimes.first, radiusTimes.second);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,10 @@
+include(../benchmarks.pri)
+
+TARGET = bench_spatial
+
+SOURCES += \
+        bench_spatial.cpp \
+        $$ROOT/ClusterIndex.cpp \
+        $$ROOT/EntityStore.cpp \
+        $$ROOT/Kinematics.cpp \
+        $$ROOT/SpatialIndex.cpp
@@ -0,0 +1,189 @@
+/*
+    Round trip and throughput of the binary wire format against the JSON line
+    protocol.
+
+    The round trip encodes tracks whose ids keep changing from several
+    producer threads, as NetworkImplementation::sendPE does, with a string
+    table small enough to roll over to new generations many times. The writing
+    thread passes the queued frames through appendFrames(), and every record
+    must decode to the PE it was encoded from. A mismatch fails the program.
+
+    The throughput runs encode then decode the same tracks one record at a
+    time on one core, through NetworkImplementation::serializePE and
+    deserializePE for JSON and BinaryEncoder and BinaryDecoder for binary.
+
+    Usage: bench_wire [records] [string table capacity for the round trip]
+*/
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+#include "AbstractNetworkInterface.h"
+#include "MpscQueue.h"
+#include "WireProtocol.h"
+
+namespace {
+
+PE makeTrack(std::size_t index)
+{
+    PE pe(QString::fromStdString("TRK" + std::to_string(index)), "AIR",
+          -0.66 + (index % 1000) * 1e-5, 2.53 - (index % 977) * 1e-5, 1000 + index % 9000, 120 + index % 200,
+          index % 2 ? "A" : "D", QString::fromStdString("P" + std::to_string(index % 5)), index % 7 == 0, index % 11 == 0);
+    pe.heading = (index % 360) * 0.0174533;
+    pe.category = static_cast<PE::PECategory>(index % 2);
+    pe.state = QString::fromStdString("STATE" + std::to_string(index % 13));
+    return pe;
+}
+
+bool samePE(const PE& a, const PE& b)
+{
+    return a.id == b.id && a.type == b.type && a.lat == b.lat && a.lon == b.lon && a.altitude == b.altitude
+        && a.speed == b.speed && a.heading == b.heading && a.apd == b.apd && a.priority == b.priority
+        && a.jam == b.jam && a.ghost == b.ghost && a.category == b.category && a.state == b.state;
+}
+
+// Decodes every frame in `bytes`, returning false on the first malformed one
+bool decodeFrames(wire::BinaryDecoder& decoder, std::string_view bytes, std::vector<PE>& out)
+{
+    while (!bytes.empty()) {
+        wire::FrameHeader header;
+        if (bytes.size() < wire::kHeaderSize || !wire::parseHeader(bytes.data(), header)
+            || bytes.size() < wire::kHeaderSize + header.length) {
+            return false;
+        }
+        std::string_view payload = bytes.substr(wire::kHeaderSize, header.length);
+        bytes.remove_prefix(wire::kHeaderSize + header.length);
+        if (header.type == wire::FrameType::StringDef) {
+            if (!decoder.applyStringDef(payload)) return false;
+        } else if (header.type == wire::FrameType::PE) {
+            out.push_back(decoder.decodePE(payload));
+        }
+    }
+    return true;
+}
+
+// Producers queue record frames while the writer appends them, as on a connection
+bool roundTrip(std::size_t records, std::uint32_t tableCapacity)
+{
+    const std::size_t producers = 4;
+    wire::BinaryEncoder encoder(tableCapacity);
+    MpscQueue<std::string> queue;
+    std::atomic<std::size_t> running{producers};
+    std::vector<std::thread> threads;
+    for (std::size_t producer = 0; producer < producers; ++producer) {
+        threads.emplace_back([&, producer] {
+            for (std::size_t i = producer; i < records; i += producers) {
+                std::string frame;
+                encoder.encodePERecord(makeTrack(i), frame);
+                queue.push(std::move(frame));
+            }
+            --running;
+        });
+    }
+
+    std::string wireBytes;
+    std::size_t dropped = 0;
+    for (;;) {
+        bool finished = running == 0;
+        while (std::optional<std::string> frame = queue.pop()) {
+            dropped += encoder.appendFrames(*frame, wireBytes);
+        }
+        if (finished) break;
+        std::this_thread::yield();
+    }
+    for (std::thread& thread : threads) thread.join();
+
+    wire::BinaryDecoder decoder;
+    std::vector<PE> decoded;
+    if (!decodeFrames(decoder, wireBytes, decoded)) {
+        std::printf("round trip: malformed frame\n");
+        return false;
+    }
+    std::size_t mismatched = 0;
+    for (const PE& pe : decoded) {
+        std::string id = pe.id.toStdString();
+        if (id.compare(0, 3, "TRK") != 0 || !samePE(pe, makeTrack(std::strtoull(id.c_str() + 3, nullptr, 10)))) ++mismatched;
+    }
+    std::printf("round trip: %zu records through a %u string table, %zu decoded, %zu dropped, %zu mismatched\n",
+                records, tableCapacity, decoded.size(), dropped, mismatched);
+    return mismatched == 0 && decoded.size() + dropped == records;
+}
+
+struct Throughput {
+    double encodePerSecond;
+    double decodePerSecond;
+    double bytesPerRecord;
+};
+
+template <typename Function>
+double perSecond(std::size_t records, Function function)
+{
+    auto start = std::chrono::steady_clock::now();
+    function();
+    return records / std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+Throughput jsonThroughput(const std::vector<PE>& tracks)
+{
+    std::vector<std::string> lines(tracks.size());
+    Throughput result;
+    result.encodePerSecond = perSecond(tracks.size(), [&] {
+        for (std::size_t i = 0; i < tracks.size(); ++i) lines[i] = NetworkImplementation::serializePE(tracks[i]);
+    });
+    std::size_t bytes = 0;
+    std::size_t checksum = 0;
+    result.decodePerSecond = perSecond(tracks.size(), [&] {
+        for (const std::string& line : lines) {
+            bytes += line.size();
+            checksum += NetworkImplementation::deserializePE(std::string_view(line).substr(0, line.size() - 1)).id.size();
+        }
+    });
+    result.bytesPerRecord = static_cast<double>(bytes) / tracks.size();
+    if (checksum == 0) std::printf("json: nothing decoded\n");
+    return result;
+}
+
+Throughput binaryThroughput(const std::vector<PE>& tracks)
+{
+    wire::BinaryEncoder encoder;
+    std::string bytes;
+    Throughput result;
+    result.encodePerSecond = perSecond(tracks.size(), [&] {
+        for (const PE& pe : tracks) encoder.encodePE(pe, bytes);
+    });
+    wire::BinaryDecoder decoder;
+    std::vector<PE> decoded;
+    decoded.reserve(tracks.size());
+    result.decodePerSecond = perSecond(tracks.size(), [&] { decodeFrames(decoder, bytes, decoded); });
+    result.bytesPerRecord = static_cast<double>(bytes.size()) / tracks.size();
+    if (decoded.size() != tracks.size()) std::printf("binary: decoded %zu of %zu\n", decoded.size(), tracks.size());
+    return result;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    std::size_t records = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 200000;
+    auto tableCapacity = static_cast<std::uint32_t>(argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 4096);
+
+    bool ok = roundTrip(records, tableCapacity);
+
+    // 5000 tracks reporting in turn, so strings repeat as on a live feed
+    std::vector<PE> tracks;
+    tracks.reserve(records);
+    for (std::size_t i = 0; i < records; ++i) tracks.push_back(makeTrack(i % 5000));
+    Throughput json = jsonThroughput(tracks);
+    Throughput binary = binaryThroughput(tracks);
+
+    std::printf("%8s %16s %16s %14s\n", "format", "encoded/s", "decoded/s", "bytes/record");
+    std::printf("%8s %16.0f %16.0f %14.1f\n", "json", json.encodePerSecond, json.decodePerSecond, json.bytesPerRecord);
+    std::printf("%8s %16.0f %16.0f %14.1f\n", "binary", binary.encodePerSecond, binary.decodePerSecond, binary.bytesPerRecord);
+    std::printf("binary vs json: %.1fx encode, %.1fx decode, %.1fx smaller\n",
+                binary.encodePerSecond / json.encodePerSecond, binary.decodePerSecond / json.decodePerSecond,
+                json.bytesPerRecord / binary.bytesPerRecord);
+    return ok ? 0 : 1;
+}
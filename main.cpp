@@ -1,27 +1,115 @@
 #include <QApplication>
+#include <QCommandLineParser>
 #include <QQmlApplicationEngine>
 #include <QQmlContext>
+#include <QTimer>
 #include <QtWebEngineWidgets>
 #include <QUrl>
+#include <QtMath>
 #include "EntityManager.h"
+#include "FeedManager.h"
+#include "MulticastNetworkInterface.h"
 #include "NetworkInterfaceWrapper.h"
 #include "AbstractNetworkInterface.h"
+#include "ReplayNetworkInterface.h"
 
 int main(int argc, char *argv[])
 {
     QGuiApplication app(argc, argv);
     QQmlApplicationEngine engine;
 
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    QCommandLineOption captureOption("capture", "Record every received frame to <file>.", "file");
+    QCommandLineOption replayOption("replay", "Replay the capture <file> instead of connecting.", "file");
+    QCommandLineOption speedOption("replay-speed", "Replay at <speed> times real time, 0 for as fast as possible.", "speed", "1");
+    QCommandLineOption feedOption("feed", "Also ingest PEs from the upstream feed at <address:port>. Repeat for more feeds.", "address:port");
+    QCommandLineOption feedFormatOption("feed-format", "Framing to negotiate with every --feed, json or binary.", "format", "json");
+    QCommandLineOption feedThreadsOption("feed-threads", "Threads receiving from all --feed connections.", "count", "2");
+    QCommandLineOption multicastOption("multicast", "Exchange records as UDP multicast datagrams, the page's address and port name the group.");
+    QCommandLineOption multicastInterfaceOption("multicast-interface", "Join the --multicast group on the local interface <address>.", "address");
+    parser.addOptions({captureOption, replayOption, speedOption, feedOption, feedFormatOption, feedThreadsOption,
+                       multicastOption, multicastInterfaceOption});
+    parser.process(app);
+
     EntityManager entityManager;
-    entityManager.createEntity("C", "CHARIOT", 1000, -37.814, 144.963);
-    entityManager.createEntity("D", "HANGED", 1000, -37.714, 144.863);
-    entityManager.createEntity("J", "JOKER", 1000, -37.914, 144.863);
-    entityManager.createEntity("Devil1", "DVL001", 500, -37.804, 144.953);
-    entityManager.createEntity("Devil2", "DVL002", 500, -37.714, 144.963);
-    entityManager.createEntity("Devil3", "DVL003", 700, -37.914, 144.873);
-
-    auto networkInterface = std::make_unique<NetworkImplementation>();
+    entityManager.createEntity("C", "CHARIOT", 1000, qDegreesToRadians(-37.814), qDegreesToRadians(144.963));
+    entityManager.createEntity("D", "HANGED", 1000, qDegreesToRadians(-37.714), qDegreesToRadians(144.863));
+    entityManager.createEntity("J", "JOKER", 1000, qDegreesToRadians(-37.914), qDegreesToRadians(144.863));
+    entityManager.createEntity("Devil1", "DVL001", 500, qDegreesToRadians(-37.804), qDegreesToRadians(144.953));
+    entityManager.createEntity("Devil2", "DVL002", 500, qDegreesToRadians(-37.714), qDegreesToRadians(144.963));
+    entityManager.createEntity("Devil3", "DVL003", 700, qDegreesToRadians(-37.914), qDegreesToRadians(144.873));
+
+    std::unique_ptr<AbstractNetworkInterface> networkInterface;
+    ReplayNetworkInterface* replay = nullptr;
+    if (parser.isSet(replayOption)) {
+        auto replayInterface = std::make_unique<ReplayNetworkInterface>();
+        replayInterface->setSpeed(parser.value(speedOption).toDouble());
+        try {
+            replayInterface->initialise(parser.value(replayOption).toStdString(), 0);
+        } catch (const std::exception&) {
+            return -1;
+        }
+        replay = replayInterface.get();
+        networkInterface = std::move(replayInterface);
+    } else if (parser.isSet(multicastOption)) {
+        auto multicast = std::make_unique<MulticastNetworkInterface>();
+        if (parser.isSet(multicastInterfaceOption)) {
+            try {
+                multicast->setInterface(parser.value(multicastInterfaceOption).toStdString());
+            } catch (const std::exception& e) {
+                qCritical("Invalid --multicast-interface %s: %s", qPrintable(parser.value(multicastInterfaceOption)), e.what());
+                return -1;
+            }
+        }
+        networkInterface = std::move(multicast);
+    } else {
+        auto network = std::make_unique<NetworkImplementation>();
+        if (parser.isSet(captureOption)) network->startCapture(parser.value(captureOption).toStdString());
+        networkInterface = std::move(network);
+    }
     NetworkInterfaceWrapper networkWrapper(networkInterface.get());
+    QObject::connect(&networkWrapper, &NetworkInterfaceWrapper::peRecordsReceived, &entityManager,
+                     qOverload<const std::vector<PE>&>(&EntityManager::upsertBatch));
+
+    // Extra feeds are merged by FeedManager and drained into the entity store once per display frame.
+    // EntityManager has no use for Emitters yet, they only show in FeedManager::stats().
+    std::unique_ptr<FeedManager> feeds;
+    QTimer feedTimer;
+    if (parser.isSet(feedOption)) {
+        wire::WireFormat feedFormat;
+        if (!wire::parseFormatName(parser.value(feedFormatOption).toStdString(), feedFormat)) {
+            qCritical("Unknown --feed-format %s", qPrintable(parser.value(feedFormatOption)));
+            return -1;
+        }
+        feeds = std::make_unique<FeedManager>(parser.value(feedThreadsOption).toUInt());
+        for (const QString& feed : parser.values(feedOption)) {
+            int colon = feed.lastIndexOf(':');
+            bool validPort = false;
+            unsigned short port = colon > 0 ? feed.mid(colon + 1).toUShort(&validPort) : 0;
+            if (!validPort) {
+                qCritical("Invalid --feed %s, expected address:port", qPrintable(feed));
+                return -1;
+            }
+            try {
+                feeds->addFeed(feed.left(colon).toStdString(), port, feedFormat);
+            } catch (const std::exception& e) {
+                qCritical("Feed %s failed: %s", qPrintable(feed), e.what());
+                return -1;
+            }
+        }
+        QObject::connect(&feedTimer, &QTimer::timeout,
+                         [&feeds, &entityManager, records = std::vector<FeedRecord>(), pes = std::vector<PE>()]() mutable {
+            records.clear();
+            pes.clear();
+            feeds->poll(records);
+            for (FeedRecord& record : records) {
+                if (PE* pe = std::get_if<PE>(&record.record)) pes.push_back(std::move(*pe));
+            }
+            entityManager.upsertBatch(pes);
+        });
+        feedTimer.start(16);
+    }
 
     engine.rootContext()->setContextProperty("entityManager", &entityManager);
     engine.rootContext()->setContextProperty("networkWrapper", &networkWrapper);
@@ -31,5 +119,17 @@ int main(int argc, char *argv[])
     if (engine.rootObjects().isEmpty())
         return -1;
 
+    if (replay) {
+        networkWrapper.startReceiving();
+        QObject::connect(&app, &QCoreApplication::aboutToQuit, [replay, &networkWrapper] {
+            ReplayStats stats = replay->stats();
+            QVariantMap delivered = networkWrapper.receiveStats();
+            qInfo("Replay: %llu records, %llu PEs in %.2fs (%.0f PEs/s fed, max lag %.1fms), %.0f PEs/s absorbed",
+                  static_cast<unsigned long long>(stats.records), static_cast<unsigned long long>(stats.pes),
+                  stats.elapsedSeconds, stats.pesPerSecond, stats.maxLagMs,
+                  delivered["pesPerSecond"].toDouble());
+        });
+    }
+
     return app.exec();
 }
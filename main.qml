@@ -28,17 +28,30 @@ Window {
         id: entityManagerObject
         WebChannel.id: "entityManager"
 
+        /* Pushed changes, forwarded from entityManager */
+        signal entitiesRemoved(var UIDs)
+        signal entityFrameEncoded(string frame)
+        signal entitiesEntered(var UIDs)
+        signal entitiesLeft(var UIDs)
+
         /* Getting */
         function getEntityByUID(UID) { if (entityManager) return entityManager.getEntityByUID(UID) }
         function getEntityLongRadByUID(UID) { if (entityManager) return  entityManager.getEntityByUID(UID).longitudeRadians }
         function getEntityLatRadByUID(UID) { if (entityManager) return entityManager.getEntityByUID(UID).latitudeRadians }
         function getEntityLongDegByUID(UID) { if (entityManager) return entityManager.getEntityByUID(UID).returnLongAsDeg() }
         function getEntityLatDegByUID(UID) { if (entityManager) return entityManager.getEntityByUID(UID).returnLatAsDeg() }
+        function queryBox(minLat, minLng, maxLat, maxLng) { if (entityManager) return entityManager.queryBox(minLat, minLng, maxLat, maxLng) }
+        function queryRadius(lat, lng, radiusMetres) { if (entityManager) return entityManager.queryRadius(lat, lng, radiusMetres) }
+        function queryClusters(minLat, minLng, maxLat, maxLng, zoom) { if (entityManager) return entityManager.queryClusters(minLat, minLng, maxLat, maxLng, zoom) }
+        function rangesAndBearings(lat, lng, UIDs, ellipsoidal) { if (entityManager) return entityManager.rangesAndBearings(lat, lng, UIDs, ellipsoidal) }
+        function localPositions(lat, lng, altitude, UIDs) { if (entityManager) return entityManager.localPositions(lat, lng, altitude, UIDs) }
+        function rangeRing(lat, lng, metres, segments) { if (entityManager) return entityManager.rangeRing(lat, lng, metres, segments) }
 
         /* Setting */
         function setEntityUID(currUID, newUID) { if (entityManager) entityManager.getEntityByUID(currUID).setUID(newUID) }
         function setEntityLongRadByUID(UID, lng) { if (entityManager)  entityManager.getEntityByUID(UID).setLongitudeRadians(lng) }
         function setEntityLatRadByUID(UID, lat) { if (entityManager) entityManager.getEntityByUID(UID).setLatitudeRadians(lat) }
+        function setEntityPositionsBase64(base64) { if (entityManager) return entityManager.setEntityPositionsBase64(base64) }
 
         /* Errors and logging. */
         function logMessage(message) { if (entityManager) entityManager.logMessage(message) }
@@ -46,8 +59,17 @@ Window {
 
         /* Entity helpers */
         function createEntity(name, UID, radius, latitude, longitude) { if (entityManager) return entityManager.createEntity(name, UID, radius, latitude, longitude) }
+        function removeEntity(UID) { if (entityManager) return entityManager.removeEntity(UID) }
+        function removeEntities(UIDs) { if (entityManager) return entityManager.removeEntities(UIDs) }
+        function setChangeFlushInterval(milliseconds) { if (entityManager) entityManager.setChangeFlushInterval(milliseconds) }
+        function flushChanges() { if (entityManager) entityManager.flushChanges() }
+        function setPredictionInterval(milliseconds) { if (entityManager) entityManager.setPredictionInterval(milliseconds) }
+        function setFrameInterval(milliseconds) { if (entityManager) entityManager.setFrameInterval(milliseconds) }
+        function setViewport(minLat, minLng, maxLat, maxLng) { if (entityManager) entityManager.setViewport(minLat, minLng, maxLat, maxLng) }
+        function clearViewport() { if (entityManager) entityManager.clearViewport() }
 
         function printAllEntities() { if (entityManager) entityManager.printAllEntities() }
+        function getEntityChangesSince(version) { if (entityManager) return entityManager.getEntityChangesSince(version) }
 
         function getEntityList() {
             var result = [];
@@ -65,6 +87,11 @@ Window {
         id: networkWrapperObject
         WebChannel.id: "networkWrapper"
 
+        /* Pushed updates, forwarded from networkWrapper once startReceiving() is called. Received
+           PEs go straight to entityManager in C++ rather than through the page. */
+        signal settingsReceived(var settings)
+        signal complexBlobsReceived(var blobs)
+
         /* Initialisation and connection */
         function initialise(address, port) {
             if (networkWrapper) networkWrapper.initialise(address, port)
@@ -72,6 +99,9 @@ Window {
         function close() {
             if (networkWrapper) networkWrapper.close()
         }
+        function negotiateWireFormat(format) {
+            if (networkWrapper) return networkWrapper.negotiateWireFormat(format)
+        }
 
         /* Sending */
         function sendPESetting(setting, id, updateVal) {
@@ -92,6 +122,36 @@ Window {
         function sendComplexBlob(pe, emitter, doubleMap) {
             if (networkWrapper) return networkWrapper.sendComplexBlob(pe, emitter, doubleMap)
         }
+        function sendPEBatch(pes) {
+            if (networkWrapper) return networkWrapper.sendPEBatch(pes)
+        }
+        function sendEmitterBatch(emitters) {
+            if (networkWrapper) return networkWrapper.sendEmitterBatch(emitters)
+        }
+        function sendSettingsBatch(settings) {
+            if (networkWrapper) return networkWrapper.sendSettingsBatch(settings)
+        }
+        function setFlushThreshold(bytes, microseconds) {
+            if (networkWrapper) networkWrapper.setFlushThreshold(bytes, microseconds)
+        }
+        function flush() {
+            if (networkWrapper) return networkWrapper.flush()
+        }
+        function startSending() {
+            if (networkWrapper) networkWrapper.startSending()
+        }
+        function stopSending() {
+            if (networkWrapper) networkWrapper.stopSending()
+        }
+        function setSettingCoalescingWindow(milliseconds) {
+            if (networkWrapper) networkWrapper.setSettingCoalescingWindow(milliseconds)
+        }
+        function flushSettings() {
+            if (networkWrapper) return networkWrapper.flushSettings()
+        }
+        function settingCoalescingStats() {
+            if (networkWrapper) return networkWrapper.settingCoalescingStats()
+        }
 
         /* Receiving */
         function receiveSetting() {
@@ -100,6 +160,9 @@ Window {
         function receivePE() {
             if (networkWrapper) return networkWrapper.receivePE()
         }
+        function receivePEBatch() {
+            if (networkWrapper) return networkWrapper.receivePEBatch()
+        }
         function receiveEmitter() {
             if (networkWrapper) return networkWrapper.receiveEmitter()
         }
@@ -109,6 +172,23 @@ Window {
         function receiveComplexBlob() {
             if (networkWrapper) return networkWrapper.receiveComplexBlob()
         }
+        function startReceiving() {
+            if (networkWrapper) networkWrapper.startReceiving()
+        }
+        function stopReceiving() {
+            if (networkWrapper) networkWrapper.stopReceiving()
+        }
+        function receiveStats() {
+            if (networkWrapper) return networkWrapper.receiveStats()
+        }
+    }
+
+    Connections {
+        target: entityManager
+        function onEntitiesRemoved(UIDs) { entityManagerObject.entitiesRemoved(UIDs) }
+        function onEntityFrameEncoded(frame) { entityManagerObject.entityFrameEncoded(frame) }
+        function onEntitiesEntered(UIDs) { entityManagerObject.entitiesEntered(UIDs) }
+        function onEntitiesLeft(UIDs) { entityManagerObject.entitiesLeft(UIDs) }
     }
 
     /* Error handling */
@@ -117,5 +197,7 @@ Window {
         function onError(message) {
             console.error("Network error:", message)
         }
+        function onSettingsReceived(settings) { networkWrapperObject.settingsReceived(settings) }
+        function onComplexBlobsReceived(blobs) { networkWrapperObject.complexBlobsReceived(blobs) }
     }
 }
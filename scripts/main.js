@@ -5,12 +5,7 @@ const CONFIG = {
         lng: 144.963,
         zoom: 13
     },
-    tileLayer: 'https://{s}.tile.openstreetmap.org/{z}/{x}/{y}.png',
-    animationParams: {
-        radius: 0.001,
-        speed: 0.01,
-        period: 5000
-    }
+    tileLayer: 'https://{s}.tile.openstreetmap.org/{z}/{x}/{y}.png'
 };
 
 // Main application object
@@ -20,22 +15,25 @@ const MapApp = {
         base: null,
         markers: null,
         lines: null,
-        entities: null
+        entities: null,
+        clusters: null
     },
     entityManager: null,
     entities: new Map(),
     userMarker: null,
     userRing: null,
     autoCentreOnPlane: true,
-    animationFrame: null,
+    entityVersion: 0,
+    loadPending: false,
+    clusterRefreshTimer: null,
+    clusterRefreshDelay: 250,
 
     async init() {
         this.initMap();
         await this.initWebChannel();
         await this.runTests();
-        this.initEntities();
+        await this.initEntities();
         this.bindEvents();
-        this.startAnimation();
     },
 
     initMap() {
@@ -44,6 +42,7 @@ const MapApp = {
         this.layers.markers = L.layerGroup().addTo(this.map);
         this.layers.lines = L.layerGroup().addTo(this.map);
         this.layers.entities = L.layerGroup().addTo(this.map);
+        this.layers.clusters = L.layerGroup().addTo(this.map);
     },
 
     async initWebChannel() {
@@ -66,9 +65,98 @@ const MapApp = {
     },
 
     async initEntities() {
-        const entityList = await this.getEntityList();
-        entityList.forEach(this.addEntity.bind(this));
+        this.updateViewport();
+        await this.loadEntities();
         this.initUserMarker();
+        this.entityManager.entityFrameEncoded.connect(frame => this.applyEntityFrame(frame));
+    },
+
+    /*
+        Replaces every marker with EntityManager's clusters for the current view. Entities are
+        grouped in C++ by EntityManager::queryClusters, so the page only ever holds markers for
+        what's on screen: one per entity standing alone at this zoom and one per cluster.
+    */
+    async loadEntities() {
+        if (this.clusterRefreshTimer) {
+            clearTimeout(this.clusterRefreshTimer);
+            this.clusterRefreshTimer = null;
+        }
+        const view = this.viewBounds();
+        const zoom = Math.round(this.map.getZoom());
+
+        this.loadPending = true;
+        const result = await new Promise(resolve => {
+            this.entityManager.queryClusters(view.south, view.west, view.north, view.east, zoom, result => resolve(result));
+        });
+        this.loadPending = false;
+        if (!result) return;
+
+        const shown = new Set();
+        this.layers.clusters.clearLayers();
+        result.clusters.forEach(cluster => {
+            if (cluster.count === 1 && cluster.handle !== undefined) {
+                this.placeEntity(cluster.handle, cluster.generation, cluster.latitude, cluster.longitude, cluster.radius, cluster.symbol);
+                shown.add(cluster.handle);
+            } else {
+                this.placeCluster(cluster.latitude, cluster.longitude, cluster.count);
+            }
+        });
+        this.entities.forEach((entity, handle) => {
+            if (!shown.has(handle)) this.removeEntity(handle);
+        });
+        this.entityVersion = result.version;
+    },
+
+    // The visible map in radians, west > east when it spans the antimeridian
+    viewBounds() {
+        const bounds = this.map.getBounds();
+        let west = bounds.getWest();
+        let east = bounds.getEast();
+        if (east - west >= 360) {
+            west = -180;
+            east = 180;
+        } else {
+            // Leaflet keeps longitudes unwrapped when panning past the antimeridian
+            west = ((west + 180) % 360 + 360) % 360 - 180;
+            east = ((east + 180) % 360 + 360) % 360 - 180;
+        }
+        return {
+            south: this.degToRad(Math.max(bounds.getSouth(), -90)),
+            west: this.degToRad(west),
+            north: this.degToRad(Math.min(bounds.getNorth(), 90)),
+            east: this.degToRad(east)
+        };
+    },
+
+    // Frames only carry entities around what's on screen, so they scale with the view, not the track count
+    updateViewport() {
+        const view = this.viewBounds();
+        this.entityManager.setViewport(view.south, view.west, view.north, view.east);
+    },
+
+    // Clusters change as entities move, so frames schedule a reload rather than patching them
+    scheduleClusterRefresh() {
+        if (this.clusterRefreshTimer || this.loadPending) return;
+        this.clusterRefreshTimer = setTimeout(() => {
+            this.clusterRefreshTimer = null;
+            this.loadEntities();
+        }, this.clusterRefreshDelay);
+    },
+
+    // Draws a cluster of `count` entities centred on its members, coordinates in radians
+    placeCluster(latitude, longitude, count) {
+        const size = Math.round(24 + 8 * Math.log10(count));
+        const marker = L.marker(L.latLng(this.radToDeg(latitude), this.radToDeg(longitude)), {
+            icon: L.divIcon({
+                className: 'cluster-icon',
+                html: `<div style="width: ${size}px; height: ${size}px; line-height: ${size}px; border-radius: 50%; `
+                    + `background-color: rgba(255, 165, 0, 0.6); text-align: center; font-weight: bold;">${count}</div>`,
+                iconSize: [size, size],
+                iconAnchor: [size / 2, size / 2]
+            })
+        });
+        marker.on('click', () => this.map.setView(marker.getLatLng(), this.map.getZoom() + 2));
+        marker.addTo(this.layers.clusters);
     },
 
     async getEntityList() {
@@ -77,28 +165,125 @@ const MapApp = {
         });
     },
 
-    addEntity(entity) {
-        const latLng = L.latLng(entity.latitude, entity.longitude);
-        const color = this.getRandomColor();
-        const marker = this.createDiamondMarker(latLng, color).addTo(this.layers.entities);
-        const circle = L.circle(latLng, { color, radius: 2000, fillOpacity: 0.05 }).addTo(this.layers.entities);
-
-        this.entities.set(entity.UID, {
-            marker,
-            circle,
-            latLng,
-            direction: Math.random() * 2 * Math.PI,
-            speed: 0.0001,
-            stopDuration: Math.random() * 2000 + 2000,
-            timeStopped: 0,
-            lastTimestamp: 0
-        });
+    /*
+        Applies one EntityManager::entityFrame, base64 encoded. Little-endian throughout:
+          header   uint32 changed, uint32 removed, uint32 flags, uint32 reserved,
+                   float64 since version, float64 version
+          changed  float64 latitude[], float64 longitude[], float32 radius[],
+                   uint32 handle[], uint32 generation[]
+          removed  uint32 handle[], uint32 generation[]
+          changed  uint8 symbol[]
+        Every column starts aligned for its type, so each is a typed array view with no copying.
+        Only entities already shown on their own are moved here, anything else that changed
+        waits for the next cluster refresh.
+    */
+    applyEntityFrame(encoded) {
+        const binary = atob(encoded);
+        const bytes = new Uint8Array(binary.length);
+        for (let i = 0; i < binary.length; ++i) bytes[i] = binary.charCodeAt(i);
+        const buffer = bytes.buffer;
+        const header = new DataView(buffer, 0, 32);
+        const changed = header.getUint32(0, true);
+        const removed = header.getUint32(4, true);
+        const reset = (header.getUint32(8, true) & 1) !== 0;
+        const since = header.getFloat64(16, true);
+        const version = header.getFloat64(24, true);
+
+        if (this.loadPending || version <= this.entityVersion) return;
+        if (!reset && since > this.entityVersion) {
+            // Missed a frame, most likely one sent before we subscribed
+            this.loadEntities();
+            return;
+        }
+
+        let offset = 32;
+        const latitudes = new Float64Array(buffer, offset, changed); offset += 8 * changed;
+        const longitudes = new Float64Array(buffer, offset, changed); offset += 8 * changed;
+        const radii = new Float32Array(buffer, offset, changed); offset += 4 * changed;
+        const handles = new Uint32Array(buffer, offset, changed); offset += 4 * changed;
+        const generations = new Uint32Array(buffer, offset, changed); offset += 4 * changed;
+        const removedHandles = new Uint32Array(buffer, offset, removed); offset += 4 * removed;
+        const removedGenerations = new Uint32Array(buffer, offset, removed); offset += 4 * removed;
+        const symbols = new Uint8Array(buffer, offset, changed);
+
+        if (reset) {
+            this.loadEntities();
+            return;
+        }
+        // Removals first, a slot can be freed and reused within one frame
+        for (let i = 0; i < removed; ++i) {
+            const existing = this.entities.get(removedHandles[i]);
+            if (existing && existing.generation === removedGenerations[i]) {
+                this.removeEntity(removedHandles[i]);
+            }
+        }
+        for (let i = 0; i < changed; ++i) {
+            const existing = this.entities.get(handles[i]);
+            if (existing && existing.generation === generations[i]) {
+                this.placeEntity(handles[i], generations[i], latitudes[i], longitudes[i], radii[i], symbols[i]);
+            }
+        }
+        this.entityVersion = version;
+        if (changed > 0 || removed > 0) this.scheduleClusterRefresh();
+    },
+
+    // Creates or moves the markers for the entity in slot `handle`, coordinates in radians
+    placeEntity(handle, generation, latitude, longitude, radius, symbol) {
+        const latLng = L.latLng(this.radToDeg(latitude), this.radToDeg(longitude));
+        let existing = this.entities.get(handle);
+        if (existing && existing.generation !== generation) {
+            this.removeEntity(handle);
+            existing = undefined;
+        }
+        if (!existing) {
+            const color = this.symbolColor(symbol);
+            const marker = this.createDiamondMarker(latLng, color).addTo(this.layers.entities);
+            const circle = L.circle(latLng, { color, radius, fillOpacity: 0.05 }).addTo(this.layers.entities);
+            this.entities.set(handle, { marker, circle, generation, symbol });
+            return;
+        }
+        existing.marker.setLatLng(latLng);
+        existing.circle.setLatLng(latLng);
+        existing.circle.setRadius(radius);
+        if (existing.symbol !== symbol) {
+            const color = this.symbolColor(symbol);
+            existing.marker.setIcon(this.createDiamondMarker(latLng, color).options.icon);
+            existing.circle.setStyle({ color });
+            existing.symbol = symbol;
+        }
+    },
+
+    removeEntity(handle) {
+        const existing = this.entities.get(handle);
+        if (!existing) return;
+        this.layers.entities.removeLayer(existing.marker);
+        this.layers.entities.removeLayer(existing.circle);
+        this.entities.delete(handle);
+    },
+
+    // EntitySymbol: BLUE, RED, UNKNOWN
+    symbolColor(symbol) {
+        return ['#3388ff', '#ff3333', 'orange'][symbol] || 'orange';
     },
 
     initUserMarker() {
         const userLatLng = L.latLng(CONFIG.initialView.lat, CONFIG.initialView.lng);
         this.userMarker = this.createDiamondMarker(userLatLng, 'white').addTo(this.map);
-        this.userRing = L.circle(userLatLng, { color: 'white', radius: 1000, fillOpacity: 0.05 }).addTo(this.map);
+        this.userRing = L.polygon([], { color: 'white', fillOpacity: 0.05 }).addTo(this.map);
+        this.updateUserRing(userLatLng);
+    },
+
+    // The ring is worked out by EntityManager along the ground, so it stays a true range at any latitude
+    updateUserRing(latLng) {
+        const metres = 1000;
+        const segments = 64;
+        this.entityManager.rangeRing(this.degToRad(latLng.lat), this.degToRad(latLng.lng), metres, segments, points => {
+            const latLngs = [];
+            for (let i = 0; i + 1 < points.length; i += 2) {
+                latLngs.push([this.radToDeg(points[i]), this.radToDeg(points[i + 1])]);
+            }
+            this.userRing.setLatLngs(latLngs);
+        });
     },
 
     createDiamondMarker(latLng, color) {
@@ -118,6 +303,10 @@ const MapApp = {
 
     bindEvents() {
         document.addEventListener('keydown', this.handleKeyPress.bind(this));
+        this.map.on('moveend zoomend', () => {
+            this.updateViewport();
+            this.loadEntities();
+        });
         // Add more event listeners as needed
     },
 
@@ -140,92 +329,18 @@ const MapApp = {
 
     updateUserPosition(latLng) {
         this.userMarker.setLatLng(latLng);
-        this.userRing.setLatLng(latLng);
+        this.updateUserRing(latLng);
         if (this.autoCentreOnPlane) {
             this.map.setView(latLng);
         }
     },
 
-    startAnimation() {
-        const animate = (timestamp) => {
-            this.entities.forEach(entity => this.animateEntity(entity, timestamp));
-            this.animationFrame = requestAnimationFrame(animate);
-        };
-        this.animationFrame = requestAnimationFrame(animate);
-    },
-
-    stopAnimation() {
-        if (this.animationFrame) {
-            cancelAnimationFrame(this.animationFrame);
-            this.animationFrame = null;
-        }
-    },
-
-    animateEntity(entity, timestamp) {
-        entity.timeStopped += timestamp - (entity.lastTimestamp || timestamp);
-        entity.lastTimestamp = timestamp;
-
-        if (entity.timeStopped < entity.stopDuration) {
-            const latLng = entity.marker.getLatLng();
-            const newLatLng = L.latLng(
-                latLng.lat + Math.sin(entity.direction) * entity.speed,
-                latLng.lng + Math.cos(entity.direction) * entity.speed
-            );
-
-            entity.marker.setLatLng(newLatLng);
-            entity.circle.setLatLng(newLatLng);
-
-            // Update backend entity position
-            this.updateEntityPosition(entity.marker.options.title, newLatLng);
-
-            if (Math.random() < 0.01) entity.direction = Math.random() * 2 * Math.PI;
-            if (Math.random() < 0.01) {
-                entity.stopDuration = Math.random() * 2000 + 2000;
-                entity.timeStopped = 0;
-            } else if (Math.random() < 0.01) {
-                entity.direction += Math.PI;
-            }
-        } else {
-            entity.speed = 0;
-            if (Math.random() < 0.01) {
-                entity.speed = 0.00005;
-                entity.stopDuration = Math.random() * 2000 + 2000;
-                entity.timeStopped = 0;
-            }
-        }
-    },
-
-    updateEntityPosition(UID, latLng) {
-        if (this.entityManager) {
-            const latRad = this.degToRad(latLng.lat);
-            const lngRad = this.degToRad(latLng.lng);
-            this.entityManager.setEntityLatRadByUID(UID, latRad);
-            this.entityManager.setEntityLongRadByUID(UID, lngRad);
-        }
-    },
-
     degToRad(degrees) {
         return degrees * (Math.PI / 180);
     },
 
-    addEntity(entity) {
-        const latLng = L.latLng(entity.latitude, entity.longitude);
-        const color = this.getRandomColor();
-        const marker = this.createDiamondMarker(latLng, color).addTo(this.layers.entities);
-        marker.options.title = entity.UID; // Add UID to marker for reference
-
-        const circle = L.circle(latLng, { color, radius: 2000, fillOpacity: 0.05 }).addTo(this.layers.entities);
-
-        this.entities.set(entity.UID, {
-            marker,
-            circle,
-            latLng,
-            direction: Math.random() * 2 * Math.PI,
-            speed: 0.0001,
-            stopDuration: Math.random() * 2000 + 2000,
-            timeStopped: 0,
-            lastTimestamp: 0
-        });
+    radToDeg(radians) {
+        return radians * (180 / Math.PI);
     },
 
     log(message) {
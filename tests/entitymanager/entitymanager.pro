@@ -0,0 +1,18 @@
+include(../tests.pri)
+
+TARGET = tst_entitymanager
+
+SOURCES += \
+        tst_entitymanager.cpp \
+        $$ROOT/ClusterIndex.cpp \
+        $$ROOT/Entity.cpp \
+        $$ROOT/EntityManager.cpp \
+        $$ROOT/EntityStore.cpp \
+        $$ROOT/Geodesy.cpp \
+        $$ROOT/Kinematics.cpp \
+        $$ROOT/Log.cpp \
+        $$ROOT/SpatialIndex.cpp
+
+HEADERS += \
+        $$ROOT/Entity.h \
+        $$ROOT/EntityManager.h
@@ -0,0 +1,897 @@
+/*
+    EntityManager's packed position updates and published snapshots.
+
+    Position buffers are built byte by byte in the little-endian layout
+    documented for web channel clients rather than from PositionUpdate, so a
+    change to the struct or to its decoding that breaks the layout fails here.
+
+    Snapshots are read from plain threads while the writer keeps publishing,
+    and checked for values that only a torn or reused buffer would show. Run
+    under ThreadSanitizer to check the publishing itself as well, see README.
+
+    Frames are read back byte by byte in the layout documented at buildFrame(),
+    with the viewport moved over entities and entities moved across its edge.
+*/
+#include <QDeadlineTimer>
+#include <QPointer>
+#include <QThread>
+#include <QtTest>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <random>
+#include <thread>
+#include "EntityManager.h"
+
+namespace {
+
+void appendU32(QByteArray &out, std::uint32_t value)
+{
+    for (int shift = 0; shift < 32; shift += 8) out.append(static_cast<char>((value >> shift) & 0xFF));
+}
+
+void appendF64(QByteArray &out, double value)
+{
+    std::uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    for (int shift = 0; shift < 64; shift += 8) out.append(static_cast<char>((bits >> shift) & 0xFF));
+}
+
+// uint32 handle, uint32 generation, float64 latitude and longitude in radians, little-endian
+void appendPosition(QByteArray &out, std::uint32_t handle, std::uint32_t generation, double latitude, double longitude)
+{
+    appendU32(out, handle);
+    appendU32(out, generation);
+    appendF64(out, latitude);
+    appendF64(out, longitude);
+}
+
+// A frame in the layout documented at EntityManager::buildFrame(), symbols aside
+struct Frame {
+    std::uint32_t flags = 0;
+    double since = 0.0;
+    double version = 0.0;
+    std::vector<double> latitudes;
+    std::vector<double> longitudes;
+    std::vector<float> radii;
+    std::vector<std::uint32_t> handles;
+    std::vector<std::uint32_t> generations;
+    std::vector<std::uint32_t> removedHandles;
+    std::vector<std::uint32_t> removedGenerations;
+    // False if the counts in the header don't account for every byte
+    bool complete = false;
+};
+
+std::uint64_t readLittleEndian(const QByteArray &in, int &offset, int bytes)
+{
+    std::uint64_t value = 0;
+    for (int i = 0; i < bytes && offset + i < in.size(); ++i) {
+        value |= std::uint64_t(static_cast<uchar>(in.at(offset + i))) << (8 * i);
+    }
+    offset += bytes;
+    return value;
+}
+
+Frame readFrame(const QByteArray &in)
+{
+    int offset = 0;
+    auto u32 = [&in, &offset] { return static_cast<std::uint32_t>(readLittleEndian(in, offset, 4)); };
+    auto f32 = [&u32] {
+        std::uint32_t bits = u32();
+        float value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    };
+    auto f64 = [&in, &offset] {
+        std::uint64_t bits = readLittleEndian(in, offset, 8);
+        double value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    };
+
+    Frame frame;
+    std::uint32_t changed = u32();
+    std::uint32_t removed = u32();
+    frame.flags = u32();
+    u32();
+    frame.since = f64();
+    frame.version = f64();
+    for (std::uint32_t i = 0; i < changed; ++i) frame.latitudes.push_back(f64());
+    for (std::uint32_t i = 0; i < changed; ++i) frame.longitudes.push_back(f64());
+    for (std::uint32_t i = 0; i < changed; ++i) frame.radii.push_back(f32());
+    for (std::uint32_t i = 0; i < changed; ++i) frame.handles.push_back(u32());
+    for (std::uint32_t i = 0; i < changed; ++i) frame.generations.push_back(u32());
+    for (std::uint32_t i = 0; i < removed; ++i) frame.removedHandles.push_back(u32());
+    for (std::uint32_t i = 0; i < removed; ++i) frame.removedGenerations.push_back(u32());
+    offset += static_cast<int>(changed);
+    frame.complete = offset == in.size();
+    return frame;
+}
+
+// The last frame the spy caught
+Frame lastFrame(const QSignalSpy &frames)
+{
+    return frames.isEmpty() ? Frame() : readFrame(frames.last().at(0).toByteArray());
+}
+
+// Every UID a spy on entitiesEntered or entitiesLeft caught, sorted
+QStringList caughtUIDs(const QSignalSpy &spy)
+{
+    QStringList UIDs;
+    for (const QList<QVariant> &arguments : spy) UIDs.append(arguments.at(0).toStringList());
+    UIDs.sort();
+    return UIDs;
+}
+
+// UIDs of a list of entity maps, as getEntityList and getEntityChangesSince return them
+QStringList UIDsOf(const QVariant &entities)
+{
+    QStringList UIDs;
+    for (const QVariant &entity : entities.toList()) UIDs.append(entity.toMap().value("UID").toString());
+    UIDs.sort();
+    return UIDs;
+}
+
+// Compares every column readers see, and the UID index, of a copy against its source
+bool sameEntities(const EntityStore &copy, const EntityStore &source)
+{
+    if (copy.size() != source.size()) return false;
+    std::size_t slotCount = std::max(copy.slotCount(), source.slotCount());
+    for (EntityStore::Slot slot = 0; slot < slotCount; ++slot) {
+        if (copy.contains(slot) != source.contains(slot)) return false;
+        if (!source.contains(slot)) continue;
+        if (copy.generation(slot) != source.generation(slot) || copy.UID(slot) != source.UID(slot)
+            || copy.name(slot) != source.name(slot) || copy.symbol(slot) != source.symbol(slot)
+            || copy.latitudeRadians(slot) != source.latitudeRadians(slot)
+            || copy.longitudeRadians(slot) != source.longitudeRadians(slot)
+            || copy.altitude(slot) != source.altitude(slot) || copy.speed(slot) != source.speed(slot)
+            || copy.radius(slot) != source.radius(slot) || copy.heading(slot) != source.heading(slot)
+            || copy.insertedVersion(slot) != source.insertedVersion(slot)
+            || copy.modifiedVersion(slot) != source.modifiedVersion(slot)
+            || copy.find(source.UID(slot)) != slot) {
+            return false;
+        }
+    }
+    std::vector<EntityStore::Slot> copied = copy.queryBox(-M_PI / 2, -M_PI, M_PI / 2, M_PI);
+    std::vector<EntityStore::Slot> expected = source.queryBox(-M_PI / 2, -M_PI, M_PI / 2, M_PI);
+    std::sort(copied.begin(), copied.end());
+    std::sort(expected.begin(), expected.end());
+    return copied == expected;
+}
+
+} // namespace
+
+class TestEntityManager : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+    void packedPositionsMoveEntities();
+    void packedPositionsSkipReusedSlots();
+    void packedPositionsRefuseTruncatedBuffers();
+    void pinnedBuffersAreNeverRefilled();
+    void readersNeverSeeTornSnapshots();
+    void managerSnapshotsStayConsistentUnderWrites();
+    void copiesMatchTheirSource();
+    void staleViewsReadDefaultsAndDropWrites();
+    void changesSinceListInsertsUpdatesAndRemovals();
+    void changesSinceReportRenamesAsRemoveAndInsert();
+    void changesSinceResetOnceRemovalsAreForgotten();
+    void changesSinceResetForUnpublishedVersions();
+    void framesCarryChangesSinceTheLastFrame();
+    void framesResetOnceRemovalsAreForgotten();
+    void viewportReportsEntitiesCrossingItsEdge();
+    void viewportResubscribesAfterAResetFrame();
+
+private:
+    // Waits for the writer to publish the entity, InvalidSlot if it doesn't within five seconds
+    EntityStore::Slot publishedSlot(const QString &UID);
+    // Waits for the writer to publish a store `condition` holds for, false if it doesn't within five seconds
+    bool published(const std::function<bool(const EntityStore &)> &condition);
+
+    EntityManager *m_manager = nullptr;
+};
+
+void TestEntityManager::init()
+{
+    m_manager = new EntityManager;
+    m_manager->setPredictionInterval(0);
+    m_manager->createEntity("A", "UID-A", 100, 0.1, 0.2);
+    m_manager->createEntity("B", "UID-B", 100, 0.3, 0.4);
+}
+
+void TestEntityManager::cleanup()
+{
+    delete m_manager;
+    m_manager = nullptr;
+}
+
+EntityStore::Slot TestEntityManager::publishedSlot(const QString &UID)
+{
+    QDeadlineTimer deadline(5000);
+    EntityStore::Slot slot = m_manager->snapshot()->store.find(UID);
+    while (slot == EntityStore::InvalidSlot && !deadline.hasExpired()) {
+        QTest::qWait(5);
+        slot = m_manager->snapshot()->store.find(UID);
+    }
+    return slot;
+}
+
+bool TestEntityManager::published(const std::function<bool(const EntityStore &)> &condition)
+{
+    QDeadlineTimer deadline(5000);
+    while (!condition(m_manager->snapshot()->store)) {
+        if (deadline.hasExpired()) return false;
+        QTest::qWait(5);
+    }
+    return true;
+}
+
+void TestEntityManager::packedPositionsMoveEntities()
+{
+    EntityStore::Slot a = publishedSlot("UID-A");
+    EntityStore::Slot b = publishedSlot("UID-B");
+    QVERIFY(a != EntityStore::InvalidSlot && b != EntityStore::InvalidSlot);
+    std::uint32_t generationA = m_manager->snapshot()->store.generation(a);
+    std::uint32_t generationB = m_manager->snapshot()->store.generation(b);
+
+    QByteArray packed;
+    appendPosition(packed, a, generationA, -0.66, 2.53);
+    appendPosition(packed, b, generationB, 0.5, -1.25);
+    QCOMPARE(packed.size(), int(2 * sizeof(EntityManager::PositionUpdate)));
+
+    // The page sends base64 over the web channel
+    QCOMPARE(m_manager->setEntityPositionsBase64(QString::fromLatin1(packed.toBase64())), 2);
+    QTRY_COMPARE_WITH_TIMEOUT(m_manager->snapshot()->store.latitudeRadians(a), -0.66, 5000);
+    EntitySnapshotHandle current = m_manager->snapshot();
+    QCOMPARE(current->store.longitudeRadians(a), 2.53);
+    QCOMPARE(current->store.latitudeRadians(b), 0.5);
+    QCOMPARE(current->store.longitudeRadians(b), -1.25);
+}
+
+void TestEntityManager::packedPositionsSkipReusedSlots()
+{
+    EntityStore::Slot a = publishedSlot("UID-A");
+    EntityStore::Slot b = publishedSlot("UID-B");
+    QVERIFY(a != EntityStore::InvalidSlot && b != EntityStore::InvalidSlot);
+    std::uint32_t generationA = m_manager->snapshot()->store.generation(a);
+    std::uint32_t generationB = m_manager->snapshot()->store.generation(b);
+
+    // A record whose generation isn't the slot's entity is dropped, the rest of the buffer still applies
+    QByteArray packed;
+    appendPosition(packed, a, generationA + 1, 1.0, 1.0);
+    appendPosition(packed, b, generationB, 0.7, 0.8);
+    QCOMPARE(m_manager->setEntityPositions(packed), 2);
+
+    QTRY_COMPARE_WITH_TIMEOUT(m_manager->snapshot()->store.latitudeRadians(b), 0.7, 5000);
+    EntitySnapshotHandle current = m_manager->snapshot();
+    QCOMPARE(current->store.latitudeRadians(a), 0.1);
+    QCOMPARE(current->store.longitudeRadians(a), 0.2);
+}
+
+void TestEntityManager::packedPositionsRefuseTruncatedBuffers()
+{
+    EntityStore::Slot a = publishedSlot("UID-A");
+    QVERIFY(a != EntityStore::InvalidSlot);
+
+    QByteArray packed;
+    appendPosition(packed, a, m_manager->snapshot()->store.generation(a), 1.0, 1.0);
+    packed.chop(1);
+    QCOMPARE(m_manager->setEntityPositions(packed), 0);
+    QCOMPARE(m_manager->setEntityPositions(QByteArray()), 0);
+}
+
+void TestEntityManager::pinnedBuffersAreNeverRefilled()
+{
+    SnapshotPublisher<int, 3> publisher;
+    QVERIFY(!publisher.acquire());
+
+    *publisher.beginWrite() = 1;
+    publisher.publish();
+    SnapshotPublisher<int, 3>::Handle first = publisher.acquire();
+    *publisher.beginWrite() = 2;
+    publisher.publish();
+    SnapshotPublisher<int, 3>::Handle second = publisher.acquire();
+    int *third = publisher.beginWrite();
+    QVERIFY(third && third != &*first && third != &*second);
+    *third = 3;
+    publisher.publish();
+    SnapshotPublisher<int, 3>::Handle latest = publisher.acquire();
+
+    // Two buffers pinned and the third the latest: nothing to write into
+    QVERIFY(publisher.beginWrite() == nullptr);
+    QCOMPARE(*first, 1);
+    QCOMPARE(*second, 2);
+    QCOMPARE(*latest, 3);
+
+    // Released, the oldest buffer comes back as it was last published
+    first = SnapshotPublisher<int, 3>::Handle();
+    int *reused = publisher.beginWrite();
+    QVERIFY(reused != nullptr);
+    QCOMPARE(*reused, 1);
+    *reused = 4;
+    publisher.publish();
+    QCOMPARE(*second, 2);
+    QCOMPARE(*latest, 3);
+    QCOMPARE(*publisher.acquire(), 4);
+}
+
+void TestEntityManager::readersNeverSeeTornSnapshots()
+{
+    // Every element of a published buffer holds its version, a reused or half written one wouldn't
+    constexpr std::uint64_t kVersions = 20000;
+    constexpr int kReaders = 4;
+    SnapshotPublisher<std::vector<std::uint64_t>> publisher;
+    std::atomic<bool> done{false};
+    std::atomic<int> torn{0};
+    std::atomic<int> backwards{0};
+    std::atomic<std::uint64_t> reads{0};
+
+    std::vector<std::thread> readers;
+    for (int reader = 0; reader < kReaders; ++reader) {
+        readers.emplace_back([&, reader] {
+            std::uint64_t last = 0;
+            // Odd readers hold an older snapshot across the next read, pinning a second buffer
+            SnapshotPublisher<std::vector<std::uint64_t>>::Handle held;
+            while (!done.load()) {
+                SnapshotPublisher<std::vector<std::uint64_t>>::Handle snapshot = publisher.acquire();
+                if (!snapshot) continue;
+                std::uint64_t version = snapshot->front();
+                if (version < last) ++backwards;
+                last = version;
+                for (std::uint64_t value : *snapshot) {
+                    if (value != version) ++torn;
+                }
+                if (held && std::any_of(held->begin(), held->end(), [&](std::uint64_t value) { return value != held->front(); })) {
+                    ++torn;
+                }
+                if (reader % 2 == 1) held = std::move(snapshot);
+                ++reads;
+            }
+        });
+    }
+
+    std::uint64_t deferred = 0;
+    for (std::uint64_t version = 1; version <= kVersions;) {
+        std::vector<std::uint64_t> *next = publisher.beginWrite();
+        if (!next) {
+            ++deferred;
+            std::this_thread::yield();
+            continue;
+        }
+        next->assign(256, version);
+        publisher.publish();
+        ++version;
+    }
+    // Let the readers catch the last versions too
+    while (reads.load() < kVersions / 10) std::this_thread::yield();
+    done = true;
+    for (std::thread &reader : readers) reader.join();
+
+    QCOMPARE(torn.load(), 0);
+    QCOMPARE(backwards.load(), 0);
+    QCOMPARE(publisher.acquire()->front(), kVersions);
+    qDebug("%llu reads, %llu publishes deferred", static_cast<unsigned long long>(reads.load()),
+           static_cast<unsigned long long>(deferred));
+}
+
+void TestEntityManager::managerSnapshotsStayConsistentUnderWrites()
+{
+    // Each round moves every track and sets its altitude and speed to the round number, so a
+    // snapshot with a track half written, or from two rounds, has them disagree
+    constexpr int kRounds = 300;
+    constexpr int kTracks = 500;
+    constexpr int kReaders = 3;
+    std::atomic<bool> done{false};
+    std::atomic<int> inconsistent{0};
+    std::atomic<int> backwards{0};
+    std::atomic<int> reads{0};
+
+    std::vector<std::thread> readers;
+    for (int reader = 0; reader < kReaders; ++reader) {
+        readers.emplace_back([&] {
+            std::uint64_t lastVersion = 0;
+            while (!done.load()) {
+                EntitySnapshotHandle current = m_manager->snapshot();
+                if (!current) continue;
+                const EntityStore &store = current->store;
+                if (current->version < lastVersion) ++backwards;
+                lastVersion = current->version;
+                double round = -1;
+                std::size_t live = 0;
+                for (EntityStore::Slot slot = 0; slot < store.slotCount(); ++slot) {
+                    if (!store.contains(slot)) continue;
+                    ++live;
+                    if (store.find(store.UID(slot)) != slot) ++inconsistent;
+                    if (!store.UID(slot).startsWith("TRK")) continue;
+                    if (store.altitude(slot) != store.speed(slot)) ++inconsistent;
+                    if (round < 0) round = store.altitude(slot);
+                    else if (store.altitude(slot) != round) ++inconsistent;
+                }
+                if (live != store.size()) ++inconsistent;
+                ++reads;
+            }
+        });
+    }
+
+    std::vector<PE> batch;
+    for (int round = 1; round <= kRounds; ++round) {
+        batch.clear();
+        for (int track = 0; track < kTracks; ++track) {
+            batch.emplace_back(QString("TRK%1").arg(track), "AIR", -37.8 + round * 1e-4, 144.9 + track * 1e-3, round,
+                               round, "A", "P", false, false);
+        }
+        m_manager->upsertBatch(batch);
+        // Churn slots under the readers too
+        if (round % 10 == 0) {
+            m_manager->removeEntity("UID-B");
+            m_manager->createEntity("B", "UID-B", 100, 0.3, 0.4);
+        }
+        if (round % 30 == 0) QThread::msleep(1);
+    }
+    QDeadlineTimer deadline(5000);
+    while (!deadline.hasExpired()) {
+        EntitySnapshotHandle current = m_manager->snapshot();
+        EntityStore::Slot last = current->store.find(QString("TRK%1").arg(kTracks - 1));
+        if (last != EntityStore::InvalidSlot && current->store.altitude(last) == kRounds) break;
+        QThread::msleep(1);
+    }
+    done = true;
+    for (std::thread &reader : readers) reader.join();
+
+    QCOMPARE(inconsistent.load(), 0);
+    QCOMPARE(backwards.load(), 0);
+    QVERIFY(reads.load() > 0);
+    EntitySnapshotHandle current = m_manager->snapshot();
+    QCOMPARE(current->store.size(), std::size_t(kTracks + 2));
+    QCOMPARE(current->store.altitude(current->store.find("TRK0")), double(kRounds));
+}
+
+void TestEntityManager::copiesMatchTheirSource()
+{
+    // Copies brought up to date at different cadences, as snapshot buffers are when readers pin some
+    const int cadences[] = {1, 3, 17, 101};
+    EntityStore source;
+    std::vector<EntityStore> copies(std::size(cadences));
+    std::vector<std::uint64_t> copied(std::size(cadences), 0);
+    std::mt19937 random(18);
+    std::uniform_real_distribution<double> coordinate(-1.5, 1.5);
+    std::vector<EntityStore::Slot> live;
+    int next = 0;
+
+    for (int step = 1; step <= 3000; ++step) {
+        int operations = 1 + random() % 8;
+        for (int i = 0; i < operations; ++i) {
+            unsigned operation = live.empty() ? 0 : random() % 6;
+            if (operation == 0) {
+                QString UID = QString("UID-%1").arg(next++);
+                live.push_back(source.insert(UID, UID, 100, coordinate(random), coordinate(random)));
+                continue;
+            }
+            std::size_t index = random() % live.size();
+            EntityStore::Slot slot = live[index];
+            if (operation == 1) {
+                source.remove(slot);
+                live.erase(live.begin() + static_cast<std::ptrdiff_t>(index));
+            } else if (operation == 2) {
+                source.setUID(slot, QString("UID-%1").arg(next++));
+            } else if (operation == 3) {
+                source.setAltitude(slot, step);
+                source.setSymbol(slot, static_cast<EntitySymbol>(step % 3));
+            } else {
+                source.setPosition(slot, coordinate(random), coordinate(random));
+            }
+        }
+        for (std::size_t copy = 0; copy < copies.size(); ++copy) {
+            if (step % cadences[copy] != 0) continue;
+            copies[copy].updateFrom(source, copied[copy]);
+            copied[copy] = source.version();
+            QVERIFY2(sameEntities(copies[copy], source), qPrintable(QString("copy %1 at step %2").arg(copy).arg(step)));
+        }
+        source.advanceVersion();
+    }
+
+    // A copy behind the removals the source still remembers is rebuilt
+    EntityStore behind;
+    behind.updateFrom(source, 0);
+    std::uint64_t behindVersion = source.version();
+    source.advanceVersion();
+    for (std::size_t i = 0; i < EntityStore::kMaxRemovals + 10; ++i) {
+        QString UID = QString("CHURN-%1").arg(i);
+        source.remove(source.insert(UID, UID, 100, 0.0, 0.0));
+        source.advanceVersion();
+    }
+    QVERIFY(!source.hasChangesSince(behindVersion));
+    behind.updateFrom(source, behindVersion);
+    QVERIFY(sameEntities(behind, source));
+}
+
+void TestEntityManager::staleViewsReadDefaultsAndDropWrites()
+{
+    EntityStore::Slot a = publishedSlot("UID-A");
+    QVERIFY(a != EntityStore::InvalidSlot);
+    QPointer<Entity> stale = m_manager->getEntityByUID("UID-A");
+    QVERIFY(stale);
+    QCOMPARE(stale->latitudeRadians(), 0.1);
+
+    // Removal is delivered to views through the event loop, which doesn't run until qWait,
+    // so the view outlives its entity and sees the slot reused
+    m_manager->removeEntity("UID-A");
+    m_manager->createEntity("C", "UID-C", 100, 0.5, 0.6);
+    QDeadlineTimer deadline(5000);
+    while (m_manager->snapshot()->store.find("UID-C") == EntityStore::InvalidSlot && !deadline.hasExpired()) {
+        QThread::msleep(1);
+    }
+    QCOMPARE(m_manager->snapshot()->store.find("UID-C"), a);
+    QVERIFY(stale);
+    QCOMPARE(stale->UID(), QString());
+    QCOMPARE(stale->latitudeRadians(), 0.0);
+
+    // Commands apply in order, once D exists the stale write has been dropped
+    stale->setLatitudeRadians(1.0);
+    stale->setName("stale");
+    m_manager->createEntity("D", "UID-D", 100, 0.7, 0.8);
+    while (m_manager->snapshot()->store.find("UID-D") == EntityStore::InvalidSlot && !deadline.hasExpired()) {
+        QThread::msleep(1);
+    }
+    EntitySnapshotHandle current = m_manager->snapshot();
+    QVERIFY(current->store.find("UID-D") != EntityStore::InvalidSlot);
+    QCOMPARE(current->store.latitudeRadians(a), 0.5);
+    QCOMPARE(current->store.name(a), QString("C"));
+
+    // The new occupant's view replaces the stale one, and the late removal leaves it alone
+    QPointer<Entity> fresh = m_manager->getEntityByUID("UID-C");
+    QVERIFY(fresh);
+    QVERIFY(!stale);
+    QCOMPARE(fresh->latitudeRadians(), 0.5);
+    QTest::qWait(50);
+    QVERIFY(fresh);
+    QCOMPARE(m_manager->getEntityByUID("UID-C"), fresh.data());
+}
+
+void TestEntityManager::changesSinceListInsertsUpdatesAndRemovals()
+{
+    QVERIFY(publishedSlot("UID-B") != EntityStore::InvalidSlot);
+    QVariantMap list = m_manager->getEntityList();
+    QCOMPARE(UIDsOf(list.value("entities")), QStringList({"UID-A", "UID-B"}));
+    qulonglong listed = list.value("version").toULongLong();
+
+    // Nothing has changed since the list
+    QVariantMap changes = m_manager->getEntityChangesSince(listed);
+    QCOMPARE(changes.value("reset").toBool(), false);
+    QVERIFY(changes.value("inserted").toList().isEmpty());
+    QVERIFY(changes.value("updated").toList().isEmpty());
+    QVERIFY(changes.value("removed").toStringList().isEmpty());
+    QCOMPARE(changes.value("version").toULongLong(), listed);
+
+    m_manager->createEntity("C", "UID-C", 100, 0.5, 0.6);
+    m_manager->getEntityByUID("UID-A")->setAltitude(500);
+    m_manager->removeEntity("UID-B");
+    QVERIFY(published([](const EntityStore &store) {
+        EntityStore::Slot a = store.find("UID-A");
+        return store.find("UID-C") != EntityStore::InvalidSlot && store.find("UID-B") == EntityStore::InvalidSlot
+            && a != EntityStore::InvalidSlot && store.altitude(a) == 500;
+    }));
+
+    changes = m_manager->getEntityChangesSince(listed);
+    QCOMPARE(changes.value("reset").toBool(), false);
+    QCOMPARE(UIDsOf(changes.value("inserted")), QStringList({"UID-C"}));
+    QCOMPARE(UIDsOf(changes.value("updated")), QStringList({"UID-A"}));
+    QCOMPARE(changes.value("removed").toStringList(), QStringList({"UID-B"}));
+    QCOMPARE(changes.value("updated").toList().first().toMap().value("latitude").toDouble(), 0.1);
+    qulonglong version = changes.value("version").toULongLong();
+    QVERIFY(version > listed);
+    QCOMPARE(version, qulonglong(m_manager->snapshot()->version));
+
+    // A removal and a creation under the same UID show in both lists
+    m_manager->removeEntity("UID-C");
+    m_manager->createEntity("C again", "UID-C", 100, 0.7, 0.8);
+    QVERIFY(published([](const EntityStore &store) {
+        EntityStore::Slot c = store.find("UID-C");
+        return c != EntityStore::InvalidSlot && store.name(c) == "C again";
+    }));
+    changes = m_manager->getEntityChangesSince(version);
+    QCOMPARE(UIDsOf(changes.value("inserted")), QStringList({"UID-C"}));
+    QVERIFY(changes.value("updated").toList().isEmpty());
+    QCOMPARE(changes.value("removed").toStringList(), QStringList({"UID-C"}));
+
+    // From 0 everything is an insertion
+    changes = m_manager->getEntityChangesSince(0);
+    QCOMPARE(changes.value("reset").toBool(), false);
+    QCOMPARE(UIDsOf(changes.value("inserted")), QStringList({"UID-A", "UID-C"}));
+}
+
+void TestEntityManager::changesSinceReportRenamesAsRemoveAndInsert()
+{
+    EntityStore::Slot a = publishedSlot("UID-A");
+    QVERIFY(a != EntityStore::InvalidSlot);
+    qulonglong before = m_manager->getEntityList().value("version").toULongLong();
+
+    m_manager->getEntityByUID("UID-A")->setUID("UID-A2");
+    QVERIFY(published([](const EntityStore &store) { return store.find("UID-A2") != EntityStore::InvalidSlot; }));
+    EntitySnapshotHandle current = m_manager->snapshot();
+    QCOMPARE(current->store.find("UID-A2"), a);
+    QCOMPARE(current->store.find("UID-A"), EntityStore::InvalidSlot);
+    // The new UID counts as inserted at the version it was taken at
+    QVERIFY(current->store.insertedVersion(a) > before);
+    QCOMPARE(current->store.insertedVersion(a), current->store.modifiedVersion(a));
+
+    QVariantMap changes = m_manager->getEntityChangesSince(before);
+    QCOMPARE(UIDsOf(changes.value("inserted")), QStringList({"UID-A2"}));
+    QVERIFY(changes.value("updated").toList().isEmpty());
+    QCOMPARE(changes.value("removed").toStringList(), QStringList({"UID-A"}));
+    QVariantMap renamed = changes.value("inserted").toList().first().toMap();
+    QCOMPARE(renamed.value("handle").toUInt(), a);
+    QCOMPARE(renamed.value("generation").toUInt(), current->store.generation(a));
+
+    // A client caught up past the rename sees a later move as an update
+    qulonglong version = changes.value("version").toULongLong();
+    m_manager->getEntityByUID("UID-A2")->setLatitudeRadians(0.25);
+    QVERIFY(published([a](const EntityStore &store) { return store.latitudeRadians(a) == 0.25; }));
+    changes = m_manager->getEntityChangesSince(version);
+    QVERIFY(changes.value("inserted").toList().isEmpty());
+    QCOMPARE(UIDsOf(changes.value("updated")), QStringList({"UID-A2"}));
+    QVERIFY(changes.value("removed").toStringList().isEmpty());
+}
+
+void TestEntityManager::changesSinceResetOnceRemovalsAreForgotten()
+{
+    QVERIFY(publishedSlot("UID-B") != EntityStore::InvalidSlot);
+    qulonglong before = m_manager->getEntityList().value("version").toULongLong();
+
+    // One more removal than the store remembers, then a marker to wait for
+    constexpr int kBatch = 1024;
+    int churned = 0;
+    while (churned <= static_cast<int>(EntityStore::kMaxRemovals)) {
+        QStringList batch;
+        for (int i = 0; i < kBatch; ++i, ++churned) {
+            QString UID = QString("CHURN-%1").arg(churned);
+            m_manager->createEntity(UID, UID, 100, 0.0, 0.0);
+            batch.append(UID);
+        }
+        m_manager->removeEntities(batch);
+        QTest::qWait(1);
+    }
+    m_manager->createEntity("End", "UID-END", 100, 0.0, 0.0);
+    QVERIFY(published([](const EntityStore &store) { return store.find("UID-END") != EntityStore::InvalidSlot; }));
+
+    QVariantMap changes = m_manager->getEntityChangesSince(before);
+    QCOMPARE(changes.value("reset").toBool(), true);
+    QCOMPARE(UIDsOf(changes.value("inserted")), QStringList({"UID-A", "UID-B", "UID-END"}));
+    QVERIFY(changes.value("updated").toList().isEmpty());
+    QVERIFY(changes.value("removed").toStringList().isEmpty());
+
+    // Starting again from the reset's version works as usual
+    qulonglong version = changes.value("version").toULongLong();
+    QCOMPARE(version, qulonglong(m_manager->snapshot()->version));
+    changes = m_manager->getEntityChangesSince(version);
+    QCOMPARE(changes.value("reset").toBool(), false);
+    QVERIFY(changes.value("inserted").toList().isEmpty());
+}
+
+void TestEntityManager::changesSinceResetForUnpublishedVersions()
+{
+    QVERIFY(publishedSlot("UID-B") != EntityStore::InvalidSlot);
+    qulonglong latest = m_manager->getEntityList().value("version").toULongLong();
+
+    // A version from another run of the application, or made up, may be ahead of this store
+    for (qulonglong version : {latest + 1, latest + 1000, std::numeric_limits<qulonglong>::max()}) {
+        QVariantMap changes = m_manager->getEntityChangesSince(version);
+        QCOMPARE(changes.value("reset").toBool(), true);
+        QCOMPARE(UIDsOf(changes.value("inserted")), QStringList({"UID-A", "UID-B"}));
+        QVERIFY(changes.value("removed").toStringList().isEmpty());
+        QCOMPARE(changes.value("version").toULongLong(), latest);
+    }
+}
+
+void TestEntityManager::framesCarryChangesSinceTheLastFrame()
+{
+    EntityStore::Slot a = publishedSlot("UID-A");
+    EntityStore::Slot b = publishedSlot("UID-B");
+    QVERIFY(a != EntityStore::InvalidSlot && b != EntityStore::InvalidSlot);
+    std::uint32_t generationA = m_manager->snapshot()->store.generation(a);
+    std::uint32_t generationB = m_manager->snapshot()->store.generation(b);
+    QSignalSpy frames(m_manager, &EntityManager::entityFrame);
+
+    // The frame with A and B may have gone before the spy, so start from one after it
+    QByteArray packed;
+    appendPosition(packed, a, generationA, -0.66, 2.53);
+    QCOMPARE(m_manager->setEntityPositions(packed), 1);
+    QTRY_VERIFY(!frames.isEmpty());
+    Frame frame = lastFrame(frames);
+    QVERIFY(frame.complete);
+    QCOMPARE(frame.flags, 0u);
+    QCOMPARE(frame.handles, std::vector<std::uint32_t>({a}));
+    QCOMPARE(frame.latitudes, std::vector<double>({-0.66}));
+    QCOMPARE(frame.version, double(m_manager->snapshot()->version));
+    double previous = frame.version;
+
+    // Each frame starts where the last one sent left off
+    frames.clear();
+    packed.clear();
+    appendPosition(packed, b, generationB, 0.5, -1.25);
+    QCOMPARE(m_manager->setEntityPositions(packed), 1);
+    QTRY_VERIFY(!frames.isEmpty());
+    frame = readFrame(frames.first().at(0).toByteArray());
+    QVERIFY(frame.complete);
+    QCOMPARE(frame.flags, 0u);
+    QCOMPARE(frame.since, previous);
+    QVERIFY(frame.version > previous);
+    QCOMPARE(frame.handles, std::vector<std::uint32_t>({b}));
+    QCOMPARE(frame.generations, std::vector<std::uint32_t>({generationB}));
+    QCOMPARE(frame.latitudes, std::vector<double>({0.5}));
+    QCOMPARE(frame.longitudes, std::vector<double>({-1.25}));
+    QCOMPARE(frame.radii, std::vector<float>({100.0f}));
+    QVERIFY(frame.removedHandles.empty());
+    previous = frame.version;
+
+    frames.clear();
+    QVERIFY(m_manager->removeEntity("UID-A"));
+    QTRY_VERIFY(!frames.isEmpty());
+    frame = readFrame(frames.first().at(0).toByteArray());
+    QVERIFY(frame.complete);
+    QCOMPARE(frame.since, previous);
+    QVERIFY(frame.handles.empty());
+    QCOMPARE(frame.removedHandles, std::vector<std::uint32_t>({a}));
+    QCOMPARE(frame.removedGenerations, std::vector<std::uint32_t>({generationA}));
+
+    // Nothing changed, nothing sent
+    frames.clear();
+    QTest::qWait(200);
+    QVERIFY(frames.isEmpty());
+}
+
+void TestEntityManager::framesResetOnceRemovalsAreForgotten()
+{
+    EntityStore::Slot b = publishedSlot("UID-B");
+    QVERIFY(b != EntityStore::InvalidSlot);
+    QSignalSpy frames(m_manager, &EntityManager::entityFrame);
+    QVERIFY(m_manager->removeEntity("UID-A"));
+    QTRY_VERIFY(!frames.isEmpty());
+    double previous = lastFrame(frames).version;
+
+    // With frames stopped, one more removal than the store remembers
+    m_manager->setFrameInterval(0);
+    constexpr int kBatch = 1024;
+    int churned = 0;
+    while (churned <= static_cast<int>(EntityStore::kMaxRemovals)) {
+        QStringList batch;
+        for (int i = 0; i < kBatch; ++i, ++churned) {
+            QString UID = QString("CHURN-%1").arg(churned);
+            m_manager->createEntity(UID, UID, 100, 0.0, 0.0);
+            batch.append(UID);
+        }
+        m_manager->removeEntities(batch);
+        QTest::qWait(1);
+    }
+    QVERIFY(published([](const EntityStore &store) { return store.size() == 1; }));
+
+    // The reset frame holds every entity and no removals, its since is the version readers had
+    frames.clear();
+    m_manager->setFrameInterval(33);
+    QTRY_VERIFY(!frames.isEmpty());
+    Frame frame = readFrame(frames.first().at(0).toByteArray());
+    QVERIFY(frame.complete);
+    QCOMPARE(frame.flags, 1u);
+    QCOMPARE(frame.since, previous);
+    QCOMPARE(frame.version, double(m_manager->snapshot()->version));
+    QCOMPARE(frame.handles, std::vector<std::uint32_t>({b}));
+    QCOMPARE(frame.latitudes, std::vector<double>({0.3}));
+    QVERIFY(frame.removedHandles.empty());
+}
+
+void TestEntityManager::viewportReportsEntitiesCrossingItsEdge()
+{
+    EntityStore::Slot a = publishedSlot("UID-A");
+    EntityStore::Slot b = publishedSlot("UID-B");
+    QVERIFY(a != EntityStore::InvalidSlot && b != EntityStore::InvalidSlot);
+    std::uint32_t generationA = m_manager->snapshot()->store.generation(a);
+    std::uint32_t generationB = m_manager->snapshot()->store.generation(b);
+    QSignalSpy frames(m_manager, &EntityManager::entityFrame);
+    QSignalSpy entered(m_manager, &EntityManager::entitiesEntered);
+    QSignalSpy left(m_manager, &EntityManager::entitiesLeft);
+
+    // The padding is a quarter of the box on each side, so B stays well outside. Frames are
+    // queued ahead of the entered and left signals of the same pass.
+    m_manager->setViewport(0.05, 0.15, 0.15, 0.25);
+    QTRY_COMPARE(caughtUIDs(entered), QStringList({"UID-A"}));
+    QVERIFY(left.isEmpty());
+    Frame frame = lastFrame(frames);
+    QVERIFY(frame.complete);
+    QCOMPARE(frame.handles, std::vector<std::uint32_t>({a}));
+    QCOMPARE(frame.latitudes, std::vector<double>({0.1}));
+    QVERIFY(frame.removedHandles.empty());
+
+    // Panning over to B sends B whole and A as a removal
+    entered.clear();
+    m_manager->setViewport(0.25, 0.35, 0.35, 0.45);
+    QTRY_COMPARE(caughtUIDs(left), QStringList({"UID-A"}));
+    QCOMPARE(caughtUIDs(entered), QStringList({"UID-B"}));
+    frame = lastFrame(frames);
+    QVERIFY(frame.complete);
+    QCOMPARE(frame.handles, std::vector<std::uint32_t>({b}));
+    QCOMPARE(frame.removedHandles, std::vector<std::uint32_t>({a}));
+    QCOMPARE(frame.removedGenerations, std::vector<std::uint32_t>({generationA}));
+
+    // B moving out and back in, and A moving about outside, with the viewport still
+    entered.clear();
+    left.clear();
+    QByteArray packed;
+    appendPosition(packed, b, generationB, 0.7, 0.8);
+    appendPosition(packed, a, generationA, -0.5, -0.5);
+    QCOMPARE(m_manager->setEntityPositions(packed), 2);
+    QTRY_COMPARE(caughtUIDs(left), QStringList({"UID-B"}));
+    QVERIFY(entered.isEmpty());
+    frame = lastFrame(frames);
+    QVERIFY(frame.handles.empty());
+    QCOMPARE(frame.removedHandles, std::vector<std::uint32_t>({b}));
+
+    left.clear();
+    packed.clear();
+    appendPosition(packed, b, generationB, 0.3, 0.4);
+    QCOMPARE(m_manager->setEntityPositions(packed), 1);
+    QTRY_COMPARE(caughtUIDs(entered), QStringList({"UID-B"}));
+    QVERIFY(left.isEmpty());
+    frame = lastFrame(frames);
+    QCOMPARE(frame.handles, std::vector<std::uint32_t>({b}));
+    QVERIFY(frame.removedHandles.empty());
+}
+
+void TestEntityManager::viewportResubscribesAfterAResetFrame()
+{
+    EntityStore::Slot a = publishedSlot("UID-A");
+    QVERIFY(a != EntityStore::InvalidSlot);
+    QSignalSpy frames(m_manager, &EntityManager::entityFrame);
+    QSignalSpy entered(m_manager, &EntityManager::entitiesEntered);
+    QSignalSpy left(m_manager, &EntityManager::entitiesLeft);
+    m_manager->setViewport(0.05, 0.15, 0.15, 0.25);
+    QTRY_COMPARE(caughtUIDs(entered), QStringList({"UID-A"}));
+
+    // With frames stopped, A is removed, C takes its slot in view and the removal is forgotten
+    m_manager->setFrameInterval(0);
+    m_manager->removeEntity("UID-A");
+    m_manager->createEntity("C", "UID-C", 100, 0.1, 0.2);
+    QCOMPARE(publishedSlot("UID-C"), a);
+    std::uint32_t generationC = m_manager->snapshot()->store.generation(a);
+    constexpr int kBatch = 1024;
+    int churned = 0;
+    while (churned <= static_cast<int>(EntityStore::kMaxRemovals)) {
+        QStringList batch;
+        for (int i = 0; i < kBatch; ++i, ++churned) {
+            QString UID = QString("CHURN-%1").arg(churned);
+            m_manager->createEntity(UID, UID, 100, 0.0, 0.0);
+            batch.append(UID);
+        }
+        m_manager->removeEntities(batch);
+        QTest::qWait(1);
+    }
+    QVERIFY(published([](const EntityStore &store) { return store.size() == 2; }));
+
+    // The reset frame replaces A with C, so readers hear A leave and C enter
+    entered.clear();
+    frames.clear();
+    m_manager->setFrameInterval(33);
+    QTRY_COMPARE(caughtUIDs(left), QStringList({"UID-A"}));
+    QCOMPARE(caughtUIDs(entered), QStringList({"UID-C"}));
+    Frame frame = lastFrame(frames);
+    QVERIFY(frame.complete);
+    QCOMPARE(frame.flags, 1u);
+    QCOMPARE(frame.handles, std::vector<std::uint32_t>({a}));
+    QCOMPARE(frame.generations, std::vector<std::uint32_t>({generationC}));
+    QVERIFY(frame.removedHandles.empty());
+
+    // Subscriptions carry on from the reset as usual
+    entered.clear();
+    left.clear();
+    m_manager->setViewport(0.25, 0.35, 0.35, 0.45);
+    QTRY_COMPARE(caughtUIDs(left), QStringList({"UID-C"}));
+    QCOMPARE(caughtUIDs(entered), QStringList({"UID-B"}));
+}
+
+QTEST_GUILESS_MAIN(TestEntityManager)
+
+#include "tst_entitymanager.moc"
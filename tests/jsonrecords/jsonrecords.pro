@@ -0,0 +1,13 @@
+include(../tests.pri)
+
+TARGET = tst_jsonrecords
+
+SOURCES += \
+        tst_jsonrecords.cpp \
+        $$ROOT/AbstractNetworkInterface.cpp \
+        $$ROOT/BatchWriter.cpp \
+        $$ROOT/FrameReader.cpp \
+        $$ROOT/JsonRecordDecoder.cpp \
+        $$ROOT/Log.cpp \
+        $$ROOT/WireCapture.cpp \
+        $$ROOT/WireProtocol.cpp
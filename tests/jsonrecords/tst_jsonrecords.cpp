@@ -0,0 +1,109 @@
+/*
+    Classification of JSON lines by their top-level keys. Records whose string
+    values spell another message's distinguishing key, "setting", "freqMin",
+    "doubleMap", "lat" or "WIRE_FORMAT", must still be told apart by their keys
+    and decode as what they are.
+*/
+#include <QtTest>
+#include <string>
+#include "AbstractNetworkInterface.h"
+#include "JsonRecordDecoder.h"
+
+Q_DECLARE_METATYPE(wire::JsonMessageKind)
+
+namespace {
+
+PE makePE(const QString& id, const QString& type, const QString& state)
+{
+    PE pe(id, type, -37.8, 144.9, 1000, 120, "A", "P", false, false);
+    pe.state = state;
+    return pe;
+}
+
+Emitter makeEmitter(const QString& id, const QString& category)
+{
+    return Emitter(id, "RADAR", category, -37.8, 144.9, 9.0e9, 9.5e9, true, "EA", "ES",
+                   false, false, false, false, false);
+}
+
+} // namespace
+
+class TestJsonRecords : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void classifiesByTopLevelKeys_data();
+    void classifiesByTopLevelKeys();
+    void collidingValuesDecodeAsTheirRecord();
+};
+
+void TestJsonRecords::classifiesByTopLevelKeys_data()
+{
+    QTest::addColumn<QByteArray>("line");
+    QTest::addColumn<wire::JsonMessageKind>("kind");
+    QTest::addColumn<int>("frameType");
+
+    const int pe = static_cast<int>(wire::FrameType::PE);
+    const int emitter = static_cast<int>(wire::FrameType::Emitter);
+    const int setting = static_cast<int>(wire::FrameType::Setting);
+    const int text = static_cast<int>(wire::FrameType::Text);
+
+    QTest::newRow("pe") << QByteArray::fromStdString(NetworkImplementation::serializePE(makePE("TRK1", "AIR", "S")))
+                        << wire::JsonMessageKind::PE << pe;
+    QTest::newRow("pe id setting") << QByteArray::fromStdString(NetworkImplementation::serializePE(makePE("setting", "AIR", "S")))
+                                   << wire::JsonMessageKind::PE << pe;
+    QTest::newRow("pe id freqMin") << QByteArray::fromStdString(NetworkImplementation::serializePE(makePE("freqMin", "AIR", "S")))
+                                   << wire::JsonMessageKind::PE << pe;
+    QTest::newRow("pe state doubleMap") << QByteArray::fromStdString(NetworkImplementation::serializePE(makePE("TRK1", "AIR", "doubleMap")))
+                                        << wire::JsonMessageKind::PE << pe;
+    QTest::newRow("pe type WIRE_FORMAT") << QByteArray::fromStdString(NetworkImplementation::serializePE(makePE("TRK1", "WIRE_FORMAT", "S")))
+                                         << wire::JsonMessageKind::PE << pe;
+    QTest::newRow("emitter") << QByteArray::fromStdString(NetworkImplementation::serializeEmitter(makeEmitter("EMT1", "SEARCH")))
+                             << wire::JsonMessageKind::Emitter << emitter;
+    QTest::newRow("emitter id setting") << QByteArray::fromStdString(NetworkImplementation::serializeEmitter(makeEmitter("setting", "doubleMap")))
+                                        << wire::JsonMessageKind::Emitter << emitter;
+    QTest::newRow("setting") << QByteArray("{\"id\":\"TRK1\",\"setting\":\"jam\",\"type\":\"PE_SETTING\",\"value\":1}")
+                             << wire::JsonMessageKind::Setting << setting;
+    QTest::newRow("setting id freqMin") << QByteArray("{\"id\":\"freqMin\",\"setting\":\"lat\",\"type\":\"PE_SETTING\",\"value\":1}")
+                                        << wire::JsonMessageKind::Setting << setting;
+    QTest::newRow("complex blob") << QByteArray::fromStdString(NetworkImplementation::serializeComplexBlob(
+                                         makePE("setting", "AIR", "S"), makeEmitter("EMT1", "SEARCH"), {{"lat", 1.0}}))
+                                  << wire::JsonMessageKind::ComplexBlob << text;
+    QTest::newRow("wire format") << QByteArray("{\"format\":\"binary\",\"type\":\"WIRE_FORMAT\"}")
+                                 << wire::JsonMessageKind::WireFormat << text;
+    QTest::newRow("blob value lat") << QByteArray("{\"note\":\"lat\",\"other\":[\"setting\",{\"freqMin\":1}]}")
+                                    << wire::JsonMessageKind::Other << text;
+    QTest::newRow("plain text") << QByteArray("\"setting\" \"lat\"") << wire::JsonMessageKind::Other << text;
+}
+
+void TestJsonRecords::classifiesByTopLevelKeys()
+{
+    QFETCH(QByteArray, line);
+    QFETCH(wire::JsonMessageKind, kind);
+    QFETCH(int, frameType);
+
+    std::string_view view(line.constData(), static_cast<std::size_t>(line.size()));
+    QCOMPARE(wire::classifyJsonMessage(view), kind);
+    QCOMPARE(static_cast<int>(NetworkImplementation::classifyJsonFrame(view)), frameType);
+}
+
+void TestJsonRecords::collidingValuesDecodeAsTheirRecord()
+{
+    std::string peLine = NetworkImplementation::serializePE(makePE("setting", "WIRE_FORMAT", "freqMin"));
+    QCOMPARE(NetworkImplementation::classifyJsonFrame(peLine), wire::FrameType::PE);
+    PE pe = NetworkImplementation::deserializePE(peLine);
+    QCOMPARE(pe.id, QString("setting"));
+    QCOMPARE(pe.type, QString("WIRE_FORMAT"));
+    QCOMPARE(pe.state, QString("freqMin"));
+
+    std::string emitterLine = NetworkImplementation::serializeEmitter(makeEmitter("setting", "lat"));
+    QCOMPARE(NetworkImplementation::classifyJsonFrame(emitterLine), wire::FrameType::Emitter);
+    Emitter emitter = NetworkImplementation::deserializeEmitter(emitterLine);
+    QCOMPARE(emitter.id, QString("setting"));
+    QCOMPARE(emitter.category, QString("lat"));
+}
+
+QTEST_GUILESS_MAIN(TestJsonRecords)
+
+#include "tst_jsonrecords.moc"
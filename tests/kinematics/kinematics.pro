@@ -0,0 +1,10 @@
+include(../tests.pri)
+
+TARGET = tst_kinematics
+
+# Tests the SSE2 kernel by default. Uncomment, as in Qt5MappingDemo.pro, to test the AVX one.
+#QMAKE_CXXFLAGS += -mavx
+
+SOURCES += \
+        tst_kinematics.cpp \
+        $$ROOT/Kinematics.cpp
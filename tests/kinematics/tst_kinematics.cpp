@@ -0,0 +1,185 @@
+/*
+    Dead reckoning by kinematics::extrapolate. The vector kernels, SSE2 or
+    AVX depending on the build, must give exactly what the scalar code gives.
+    That code handles the remainder of every column, so extrapolating one
+    entity at a time is the reference: any column of two or more entities
+    goes through the vector kernel instead.
+
+    Fixes are chosen to reach every clamp: tracks silent for longer than the
+    elapsed time cap, fixes stamped after now, tracks carried over the poles,
+    and longitudes wrapped once or many times, or landing on the antimeridian.
+*/
+#include <QtTest>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
+#include "Kinematics.h"
+
+namespace {
+
+constexpr double kMaxElapsed = 30.0;
+constexpr double kNow = 1000.0;
+
+struct Columns {
+    std::vector<double> fixLatitude;
+    std::vector<double> fixLongitude;
+    std::vector<double> fixTime;
+    std::vector<double> latitudeRate;
+    std::vector<double> longitudeRate;
+
+    std::size_t size() const { return fixLatitude.size(); }
+    void append(double latitude, double longitude, double time, double latitudeRate, double longitudeRate)
+    {
+        fixLatitude.push_back(latitude);
+        fixLongitude.push_back(longitude);
+        fixTime.push_back(time);
+        this->latitudeRate.push_back(latitudeRate);
+        this->longitudeRate.push_back(longitudeRate);
+    }
+};
+
+Columns mixedFixes(std::size_t count)
+{
+    std::mt19937 random(20);
+    std::uniform_real_distribution<double> latitude(-M_PI_2, M_PI_2);
+    std::uniform_real_distribution<double> longitude(-M_PI, M_PI);
+    std::uniform_real_distribution<double> unit(-1.0, 1.0);
+    Columns columns;
+    for (std::size_t i = 0; i < count; ++i) {
+        switch (i % 6) {
+        case 0: // Moving normally, fixed a few seconds ago
+            columns.append(latitude(random), longitude(random), kNow - 5 * (1 + unit(random)), 1e-5 * unit(random), 1e-5 * unit(random));
+            break;
+        case 1: // Silent for longer than the cap
+            columns.append(latitude(random), longitude(random), kNow - 1000 * (1 + unit(random)) - kMaxElapsed, 1e-4 * unit(random), 1e-4 * unit(random));
+            break;
+        case 2: // Fixed after now, by a clock that's ahead
+            columns.append(latitude(random), longitude(random), kNow + 10 * (1 + unit(random)), 1e-3 * unit(random), 1e-3 * unit(random));
+            break;
+        case 3: // Near a pole and heading over it
+            columns.append(std::copysign(M_PI_2 - 1e-4 * (1 + unit(random)), unit(random)), longitude(random), kNow - 20,
+                           std::copysign(1e-3, unit(random)), 1e-2 * unit(random));
+            break;
+        case 4: // Near the antimeridian and crossing it
+            columns.append(latitude(random), std::copysign(M_PI - 1e-4, unit(random)), kNow - 10, 0.0, 1e-3 * unit(random));
+            break;
+        default: // Longitude rates near a pole wrap many times within the cap
+            columns.append(latitude(random), longitude(random), kNow - 29, 0.0, 50 * unit(random));
+            break;
+        }
+    }
+    return columns;
+}
+
+bool sameBits(double a, double b)
+{
+    return std::memcmp(&a, &b, sizeof(double)) == 0;
+}
+
+} // namespace
+
+class TestKinematics : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void vectorKernelsMatchScalar_data();
+    void vectorKernelsMatchScalar();
+    void clampsAndWraps();
+};
+
+void TestKinematics::vectorKernelsMatchScalar_data()
+{
+    QTest::addColumn<int>("count");
+    QTest::addColumn<int>("offset");
+
+    // Lengths around the vector widths leave every possible remainder, offsets misalign the columns
+    for (int count : {2, 3, 4, 5, 7, 8, 9, 1001}) {
+        for (int offset : {0, 1}) {
+            QTest::newRow(qPrintable(QString("%1 from %2").arg(count).arg(offset))) << count << offset;
+        }
+    }
+    QTest::newRow("100000 from 0") << 100000 << 0;
+}
+
+void TestKinematics::vectorKernelsMatchScalar()
+{
+    QFETCH(int, count);
+    QFETCH(int, offset);
+    Columns columns = mixedFixes(static_cast<std::size_t>(count + offset));
+    std::size_t size = columns.size();
+
+    std::vector<double> latitude(size);
+    std::vector<double> longitude(size);
+    kinematics::extrapolate(columns.fixLatitude.data() + offset, columns.fixLongitude.data() + offset,
+                            columns.fixTime.data() + offset, columns.latitudeRate.data() + offset,
+                            columns.longitudeRate.data() + offset, kNow, kMaxElapsed, latitude.data() + offset,
+                            longitude.data() + offset, static_cast<std::size_t>(count));
+
+    int mismatches = 0;
+    QString first;
+    for (std::size_t i = static_cast<std::size_t>(offset); i < size; ++i) {
+        double scalarLatitude;
+        double scalarLongitude;
+        kinematics::extrapolate(&columns.fixLatitude[i], &columns.fixLongitude[i], &columns.fixTime[i],
+                                &columns.latitudeRate[i], &columns.longitudeRate[i], kNow, kMaxElapsed,
+                                &scalarLatitude, &scalarLongitude, 1);
+        if (!sameBits(latitude[i], scalarLatitude) || !sameBits(longitude[i], scalarLongitude)) {
+            if (mismatches++ == 0) {
+                first = QString("entity %1: %2, %3 against %4, %5").arg(i).arg(latitude[i], 0, 'g', 17)
+                            .arg(longitude[i], 0, 'g', 17).arg(scalarLatitude, 0, 'g', 17).arg(scalarLongitude, 0, 'g', 17);
+            }
+        }
+    }
+    QVERIFY2(mismatches == 0, qPrintable(QString("%1 mismatches, first %2").arg(mismatches).arg(first)));
+}
+
+void TestKinematics::clampsAndWraps()
+{
+    // The same entity in every lane of a vector and the scalar remainder
+    constexpr std::size_t kLanes = 9;
+    auto extrapolate = [](double latitude, double longitude, double time, double latitudeRate, double longitudeRate) {
+        Columns columns;
+        for (std::size_t i = 0; i < kLanes; ++i) columns.append(latitude, longitude, time, latitudeRate, longitudeRate);
+        std::vector<double> latitudes(kLanes);
+        std::vector<double> longitudes(kLanes);
+        kinematics::extrapolate(columns.fixLatitude.data(), columns.fixLongitude.data(), columns.fixTime.data(),
+                                columns.latitudeRate.data(), columns.longitudeRate.data(), kNow, kMaxElapsed,
+                                latitudes.data(), longitudes.data(), kLanes);
+        for (std::size_t i = 1; i < kLanes; ++i) {
+            if (!sameBits(latitudes[i], latitudes[0]) || !sameBits(longitudes[i], longitudes[0])) return std::make_pair(qQNaN(), qQNaN());
+        }
+        return std::make_pair(latitudes[0], longitudes[0]);
+    };
+
+    // Elapsed time is capped, and a fix from the future doesn't move
+    std::pair<double, double> moved = extrapolate(0.0, 0.0, kNow - 10, 1e-3, 2e-3);
+    QCOMPARE(moved.first, 10 * 1e-3);
+    QCOMPARE(moved.second, 10 * 2e-3);
+    std::pair<double, double> capped = extrapolate(0.0, 0.0, kNow - 1000, 1e-3, 2e-3);
+    QCOMPARE(capped.first, kMaxElapsed * 1e-3);
+    QCOMPARE(capped.second, kMaxElapsed * 2e-3);
+    std::pair<double, double> early = extrapolate(0.1, 0.2, kNow + 5, 1e-3, 1e-3);
+    QCOMPARE(early.first, 0.1);
+    QCOMPARE(early.second, 0.2);
+
+    // Latitude stops at the poles
+    QCOMPARE(extrapolate(M_PI_2 - 1e-3, 0.0, kNow - 10, 1e-3, 0.0).first, M_PI_2);
+    QCOMPARE(extrapolate(-M_PI_2 + 1e-3, 0.0, kNow - 10, -1e-3, 0.0).first, -M_PI_2);
+
+    // Longitude wraps into [-pi, pi), however many turns it makes
+    std::pair<double, double> east = extrapolate(0.0, M_PI - 0.01, kNow - 10, 0.0, 2e-3);
+    QVERIFY(std::abs(east.second - (-M_PI + 0.01)) < 1e-12);
+    std::pair<double, double> west = extrapolate(0.0, -M_PI + 0.01, kNow - 10, 0.0, -2e-3);
+    QVERIFY(std::abs(west.second - (M_PI - 0.01)) < 1e-12);
+    QCOMPARE(extrapolate(0.0, M_PI, kNow, 0.0, 0.0).second, -M_PI);
+    QCOMPARE(extrapolate(0.0, -M_PI, kNow, 0.0, 0.0).second, -M_PI);
+    std::pair<double, double> spun = extrapolate(0.0, 0.5, kNow - 10, 0.0, 10 * 2 * M_PI / 10 + 0.01);
+    QVERIFY(std::abs(spun.second - 0.6) < 1e-12);
+    QVERIFY(spun.second >= -M_PI && spun.second < M_PI);
+}
+
+QTEST_GUILESS_MAIN(TestKinematics)
+
+#include "tst_kinematics.moc"
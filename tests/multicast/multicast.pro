@@ -0,0 +1,14 @@
+include(../tests.pri)
+
+TARGET = tst_multicast
+
+SOURCES += \
+        tst_multicast.cpp \
+        $$ROOT/AbstractNetworkInterface.cpp \
+        $$ROOT/BatchWriter.cpp \
+        $$ROOT/FrameReader.cpp \
+        $$ROOT/JsonRecordDecoder.cpp \
+        $$ROOT/Log.cpp \
+        $$ROOT/MulticastNetworkInterface.cpp \
+        $$ROOT/WireCapture.cpp \
+        $$ROOT/WireProtocol.cpp
@@ -0,0 +1,146 @@
+/*
+    Multicast over the loopback interface: records sent by one
+    MulticastNetworkInterface reach another in the same process, and the
+    receiver's per-sender sequence tracking tells lost, reordered and duplicate
+    datagrams apart.
+*/
+#include <QtTest>
+#include <boost/asio.hpp>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include "MulticastNetworkInterface.h"
+
+namespace {
+
+const char* const kGroup = "239.255.42.99";
+const char* const kLoopback = "127.0.0.1";
+
+// Polls `done` until it holds or five seconds pass
+template <typename Condition>
+bool waitFor(Condition done)
+{
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (!done()) {
+        if (std::chrono::steady_clock::now() > deadline) return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    return true;
+}
+
+PE makeTrack(int index)
+{
+    PE pe(QString("TRK%1").arg(index), "AIR", -0.66 + index * 1e-4, 2.53, 1000 + index, 120, "A", "P", false, false);
+    pe.heading = 0.5;
+    pe.state = QString("STATE%1").arg(index % 3);
+    return pe;
+}
+
+} // namespace
+
+class TestMulticast : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void deliversRecordsOverLoopback_data();
+    void deliversRecordsOverLoopback();
+    void countsLossReorderingAndDuplicates();
+};
+
+void TestMulticast::deliversRecordsOverLoopback_data()
+{
+    QTest::addColumn<QString>("format");
+    QTest::newRow("json") << "json";
+    QTest::newRow("binary") << "binary";
+}
+
+void TestMulticast::deliversRecordsOverLoopback()
+{
+    QFETCH(QString, format);
+    wire::WireFormat wireFormat;
+    QVERIFY(wire::parseFormatName(format.toStdString(), wireFormat));
+    const unsigned short port = wireFormat == wire::WireFormat::Json ? 47311 : 47312;
+
+    MulticastNetworkInterface receiver;
+    receiver.setInterface(kLoopback);
+    receiver.initialise(kGroup, port);
+    std::mutex mutex;
+    std::vector<PE> received;
+    ReceiveHandlers handlers;
+    handlers.onPE = [&](const PE& pe) {
+        std::lock_guard<std::mutex> lock(mutex);
+        received.push_back(pe);
+    };
+    receiver.startReceiving(handlers);
+
+    MulticastNetworkInterface sender;
+    sender.setInterface(kLoopback);
+    sender.initialise(kGroup, port);
+    QVERIFY(sender.negotiateWireFormat(wireFormat));
+    std::vector<PE> sent;
+    for (int i = 0; i < 200; ++i) sent.push_back(makeTrack(i));
+    QVERIFY(sender.sendPEBatch(sent));
+
+    QVERIFY(waitFor([&] {
+        std::lock_guard<std::mutex> lock(mutex);
+        return received.size() >= sent.size();
+    }));
+    receiver.stopReceiving();
+
+    QCOMPARE(received.size(), sent.size());
+    for (std::size_t i = 0; i < sent.size(); ++i) {
+        QCOMPARE(received[i].id, sent[i].id);
+        QCOMPARE(received[i].state, sent[i].state);
+        QCOMPARE(received[i].lat, sent[i].lat);
+        QCOMPARE(received[i].altitude, sent[i].altitude);
+    }
+    std::vector<MulticastSourceStats> stats = receiver.sourceStats();
+    QCOMPARE(stats.size(), std::size_t(1));
+    QVERIFY(stats[0].datagrams > 1); // 200 records don't fit one datagram
+    QCOMPARE(stats[0].lost, std::uint64_t(0));
+    QCOMPARE(stats[0].reordered, std::uint64_t(0));
+    QCOMPARE(stats[0].duplicates, std::uint64_t(0));
+    QCOMPARE(stats[0].malformed, std::uint64_t(0));
+}
+
+void TestMulticast::countsLossReorderingAndDuplicates()
+{
+    const unsigned short port = 47313;
+    MulticastNetworkInterface receiver;
+    receiver.setInterface(kLoopback);
+    receiver.initialise(kGroup, port);
+    std::atomic<int> blobs{0};
+    ReceiveHandlers handlers;
+    handlers.onBlob = [&](const std::string&) { ++blobs; };
+    receiver.startReceiving(handlers);
+
+    // Hand-numbered datagrams from a plain socket, each carrying one text frame
+    using boost::asio::ip::udp;
+    boost::asio::io_context context;
+    udp::socket socket(context, udp::v4());
+    socket.set_option(boost::asio::ip::multicast::outbound_interface(boost::asio::ip::make_address_v4(kLoopback)));
+    udp::endpoint group(boost::asio::ip::make_address(kGroup), port);
+    const std::uint32_t sequences[] = {0, 1, 2, 4, 5, 3, 3, 5, 8};
+    for (std::uint32_t sequence : sequences) {
+        std::string datagram;
+        wire::putDatagramHeader(datagram, wire::WireFormat::Binary, sequence);
+        wire::BinaryEncoder().encodeText("tick", datagram);
+        socket.send_to(boost::asio::buffer(datagram), group);
+    }
+
+    QVERIFY(waitFor([&] { return blobs == 9; }));
+    receiver.stopReceiving();
+
+    std::vector<MulticastSourceStats> stats = receiver.sourceStats();
+    QCOMPARE(stats.size(), std::size_t(1));
+    QCOMPARE(stats[0].datagrams, std::uint64_t(9));
+    QCOMPARE(stats[0].lost, std::uint64_t(2));       // 6 and 7, 3 turned up late
+    QCOMPARE(stats[0].reordered, std::uint64_t(1));  // The first 3
+    QCOMPARE(stats[0].duplicates, std::uint64_t(2)); // The second 3 and 5
+}
+
+QTEST_GUILESS_MAIN(TestMulticast)
+
+#include "tst_multicast.moc"
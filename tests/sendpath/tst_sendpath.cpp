@@ -0,0 +1,256 @@
+/*
+    Stress test of NetworkImplementation's multi-producer send path. Several
+    threads send PEs, Emitters and settings at once through the writer thread
+    to a loopback peer, which must read back every frame intact, each thread's
+    frames in the order it sent them.
+
+    Records encoded before an encoder reset must be dropped and counted, not
+    sent with the strings of the table that replaced theirs.
+*/
+#include <QtTest>
+#include <boost/asio.hpp>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include "AbstractNetworkInterface.h"
+
+using boost::asio::ip::tcp;
+
+namespace {
+
+constexpr int kThreads = 8;
+constexpr int kRecordsPerThread = 5000;
+
+// Accepts one connection, acknowledges a wire format request if one is expected, then reads until the peer closes
+std::string readConnection(tcp::acceptor& acceptor, bool negotiate)
+{
+    tcp::socket socket = acceptor.accept();
+    std::string received;
+    boost::system::error_code ec;
+    if (negotiate) {
+        boost::asio::read_until(socket, boost::asio::dynamic_buffer(received), '\n', ec);
+        received.erase(0, received.find('\n') + 1);
+        boost::asio::write(socket, boost::asio::buffer(std::string("{\"format\":\"binary\",\"type\":\"WIRE_FORMAT\"}\n")));
+    }
+    boost::asio::read(socket, boost::asio::dynamic_buffer(received), ec);
+    return received;
+}
+
+// What the peer decoded, and whether every frame and every thread's order checked out
+struct Tally {
+    int pes = 0;
+    int emitters = 0;
+    int settings = 0;
+    QString failure;
+    std::vector<int> lastPE = std::vector<int>(kThreads, -1);
+    std::vector<int> lastEmitter = std::vector<int>(kThreads, -1);
+    std::vector<int> lastSetting = std::vector<int>(kThreads, -1);
+
+    void fail(const QString& reason) { if (failure.isEmpty()) failure = reason; }
+
+    // Records carry their thread in the latitude and their sequence number in a numeric field
+    void checkOrder(std::vector<int>& last, int thread, int sequence, const char* kind)
+    {
+        if (thread < 0 || thread >= kThreads || sequence <= last[thread]) {
+            fail(QString("%1 %2 from thread %3 out of order").arg(kind).arg(sequence).arg(thread));
+            return;
+        }
+        last[thread] = sequence;
+    }
+
+    void addPE(const PE& pe)
+    {
+        ++pes;
+        int thread = static_cast<int>(pe.lat);
+        int sequence = static_cast<int>(pe.altitude);
+        if (pe.id != QString("T%1_%2").arg(thread).arg(sequence % 200)) fail("PE id " + pe.id);
+        checkOrder(lastPE, thread, sequence, "PE");
+    }
+
+    void addEmitter(const Emitter& emitter)
+    {
+        ++emitters;
+        int thread = static_cast<int>(emitter.lat);
+        if (emitter.id != QString("E%1").arg(thread)) fail("Emitter id " + emitter.id);
+        checkOrder(lastEmitter, thread, static_cast<int>(emitter.freqMin), "Emitter");
+    }
+
+    void addSetting(const std::string& id, const std::string& setting, int value)
+    {
+        ++settings;
+        int thread = id.size() > 1 ? std::atoi(id.c_str() + 1) : -1;
+        if (setting != "setting" + std::to_string(value % 13)) fail(QString::fromStdString("Setting " + setting));
+        checkOrder(lastSetting, thread, value, "Setting");
+    }
+};
+
+void decodeJson(std::string_view bytes, Tally& tally)
+{
+    while (!bytes.empty()) {
+        std::size_t end = bytes.find('\n');
+        if (end == std::string_view::npos) {
+            tally.fail("Truncated line at the end of the stream");
+            return;
+        }
+        std::string_view line = bytes.substr(0, end);
+        bytes.remove_prefix(end + 1);
+        try {
+            switch (NetworkImplementation::classifyJsonFrame(line)) {
+            case wire::FrameType::PE:
+                tally.addPE(NetworkImplementation::deserializePE(line));
+                break;
+            case wire::FrameType::Emitter:
+                tally.addEmitter(NetworkImplementation::deserializeEmitter(line));
+                break;
+            case wire::FrameType::Setting: {
+                auto [kind, id, setting, value] = NetworkImplementation::deserializeSetting(line);
+                tally.addSetting(id, setting, value);
+                break;
+            }
+            default:
+                tally.fail(QString::fromStdString("Unexpected line " + std::string(line)));
+            }
+        } catch (const std::exception& e) {
+            tally.fail(QString::fromStdString("Corrupt line " + std::string(line) + ": " + e.what()));
+        }
+    }
+}
+
+void decodeBinary(std::string_view bytes, Tally& tally)
+{
+    wire::BinaryDecoder decoder;
+    while (!bytes.empty()) {
+        wire::FrameHeader header;
+        if (bytes.size() < wire::kHeaderSize || !wire::parseHeader(bytes.data(), header)
+            || bytes.size() < wire::kHeaderSize + header.length) {
+            tally.fail(QString("Corrupt frame %1 bytes from the end").arg(bytes.size()));
+            return;
+        }
+        std::string_view payload = bytes.substr(wire::kHeaderSize, header.length);
+        bytes.remove_prefix(wire::kHeaderSize + header.length);
+        try {
+            switch (header.type) {
+            case wire::FrameType::StringDef:
+                if (!decoder.applyStringDef(payload)) tally.fail("Corrupt StringDef frame");
+                break;
+            case wire::FrameType::PE:
+                tally.addPE(decoder.decodePE(payload));
+                break;
+            case wire::FrameType::Emitter:
+                tally.addEmitter(decoder.decodeEmitter(payload));
+                break;
+            case wire::FrameType::Setting: {
+                auto [kind, id, setting, value] = decoder.decodeSetting(payload);
+                tally.addSetting(id, setting, value);
+                break;
+            }
+            case wire::FrameType::Text:
+                tally.fail("Unexpected text frame");
+                break;
+            }
+        } catch (const std::exception& e) {
+            tally.fail(QString("Corrupt record: %1").arg(e.what()));
+        }
+    }
+}
+
+} // namespace
+
+class TestSendPath : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void concurrentSendersKeepFramesIntact_data();
+    void concurrentSendersKeepFramesIntact();
+    void resetDropsRecordsEncodedBefore();
+};
+
+void TestSendPath::concurrentSendersKeepFramesIntact_data()
+{
+    QTest::addColumn<bool>("binary");
+    QTest::newRow("json") << false;
+    QTest::newRow("binary") << true;
+}
+
+void TestSendPath::concurrentSendersKeepFramesIntact()
+{
+    QFETCH(bool, binary);
+
+    boost::asio::io_context context;
+    tcp::acceptor acceptor(context, tcp::endpoint(boost::asio::ip::address_v4::loopback(), 0));
+    std::string received;
+    std::thread peer([&] { received = readConnection(acceptor, binary); });
+
+    NetworkImplementation network;
+    network.initialise("127.0.0.1", acceptor.local_endpoint().port());
+    bool negotiated = !binary || network.negotiateWireFormat(wire::WireFormat::Binary);
+    if (!negotiated) {
+        network.close();
+        peer.join();
+    }
+    QVERIFY(negotiated);
+    network.startSending();
+
+    std::vector<std::thread> producers;
+    std::atomic<int> failedSends{0};
+    for (int thread = 0; thread < kThreads; ++thread) {
+        producers.emplace_back([&network, &failedSends, thread] {
+            for (int i = 0; i < kRecordsPerThread; ++i) {
+                PE pe(QString("T%1_%2").arg(thread).arg(i % 200), "AIR", thread, 144.9, i, 120, "A", "P", false, false);
+                pe.state = QString("STATE%1").arg(i % 5);
+                if (!network.sendPE(pe)) ++failedSends;
+                if (i % 5 == 0) {
+                    Emitter emitter(QString("E%1").arg(thread), "RADAR", "SEARCH", thread, 144.9, i, i + 1, true,
+                                    "EA", "ES", false, false, false, false, false);
+                    if (!network.sendEmitter(emitter)) ++failedSends;
+                }
+                if (i % 7 == 0) {
+                    if (!network.sendPESetting("setting" + std::to_string(i % 13), "T" + std::to_string(thread), i)) ++failedSends;
+                }
+            }
+        });
+    }
+    for (std::thread& producer : producers) producer.join();
+    network.close();
+    peer.join();
+
+    QCOMPARE(failedSends.load(), 0);
+    Tally tally;
+    if (binary) decodeBinary(received, tally);
+    else decodeJson(received, tally);
+    QVERIFY2(tally.failure.isEmpty(), qPrintable(tally.failure));
+    QCOMPARE(tally.pes, kThreads * kRecordsPerThread);
+    QCOMPARE(tally.emitters, kThreads * ((kRecordsPerThread + 4) / 5));
+    QCOMPARE(tally.settings, kThreads * ((kRecordsPerThread + 6) / 7));
+}
+
+void TestSendPath::resetDropsRecordsEncodedBefore()
+{
+    // Both records intern their id as reference 1, in the tables before and after the reset
+    wire::BinaryEncoder encoder;
+    std::string stale;
+    encoder.encodePERecord(PE("T0_0", "AIR", 0, 144.9, 0, 120, "A", "P", false, false), stale);
+    encoder.reset();
+    std::string fresh;
+    encoder.encodePERecord(PE("T0_1", "AIR", 0, 144.9, 1, 120, "A", "P", false, false), fresh);
+
+    std::string out;
+    QCOMPARE(encoder.appendFrames(stale, out), std::size_t(1));
+    QVERIFY(out.empty());
+    QCOMPARE(encoder.appendFrames(fresh, out), std::size_t(0));
+    // The released stale record took nothing from the new table, which still serves new records
+    std::string next;
+    encoder.encodePERecord(PE("T0_2", "AIR", 0, 144.9, 2, 120, "A", "P", false, false), next);
+    QCOMPARE(encoder.appendFrames(next, out), std::size_t(0));
+
+    Tally tally;
+    decodeBinary(out, tally);
+    QVERIFY2(tally.failure.isEmpty(), qPrintable(tally.failure));
+    QCOMPARE(tally.pes, 2);
+}
+
+QTEST_GUILESS_MAIN(TestSendPath)
+
+#include "tst_sendpath.moc"
@@ -0,0 +1,10 @@
+include(../tests.pri)
+
+TARGET = tst_spatialindex
+
+SOURCES += \
+        tst_spatialindex.cpp \
+        $$ROOT/ClusterIndex.cpp \
+        $$ROOT/EntityStore.cpp \
+        $$ROOT/Kinematics.cpp \
+        $$ROOT/SpatialIndex.cpp
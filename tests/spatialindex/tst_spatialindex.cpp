@@ -0,0 +1,247 @@
+/*
+    EntityStore's box and radius queries against a scan of every entity.
+
+    Entities are scattered over the whole globe, with crowds near both poles,
+    along the antimeridian and on the edges of the coordinate ranges, where
+    boxes are split and circles widened. Each query is answered by a store
+    with the default fine grid and by one with a coarse grid, which walks its
+    occupied cells instead for large boxes, and must find exactly the entities
+    the scan finds. A radius may only disagree about an entity within a
+    millimetre of the circle, where the scan's distance formula rounds
+    differently.
+*/
+#include <QtTest>
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+#include "EntityStore.h"
+#include "Kinematics.h"
+
+using kinematics::kEarthRadiusMetres;
+
+namespace {
+
+constexpr double kCoarseCellSize = 0.05;
+
+struct Point {
+    double latitude;
+    double longitude;
+};
+
+double radians(double degrees)
+{
+    return degrees * M_PI / 180;
+}
+
+// Great-circle distance by the Vincenty special case of the sphere, well conditioned at every separation
+double distanceMetres(double latitude1, double longitude1, double latitude2, double longitude2)
+{
+    double deltaLongitude = longitude2 - longitude1;
+    double a = std::cos(latitude2) * std::sin(deltaLongitude);
+    double b = std::cos(latitude1) * std::sin(latitude2) - std::sin(latitude1) * std::cos(latitude2) * std::cos(deltaLongitude);
+    double c = std::sin(latitude1) * std::sin(latitude2) + std::cos(latitude1) * std::cos(latitude2) * std::cos(deltaLongitude);
+    return kEarthRadiusMetres * std::atan2(std::hypot(a, b), c);
+}
+
+std::vector<Point> scatteredPoints()
+{
+    std::mt19937 random(13);
+    std::uniform_real_distribution<double> unit(-1.0, 1.0);
+    std::uniform_real_distribution<double> longitude(-M_PI, M_PI);
+    std::vector<Point> points;
+    // Uniform over the sphere
+    for (int i = 0; i < 20000; ++i) points.push_back({std::asin(unit(random)), longitude(random)});
+    // Within two degrees of each pole, and on them
+    for (int i = 0; i < 5000; ++i) points.push_back({radians(89 + unit(random)), longitude(random)});
+    for (int i = 0; i < 5000; ++i) points.push_back({radians(-89 + unit(random)), longitude(random)});
+    points.push_back({M_PI_2, 0.0});
+    points.push_back({-M_PI_2, 1.0});
+    // Within a degree either side of the antimeridian, and on it at both ends of the range
+    for (int i = 0; i < 5000; ++i) {
+        double offset = radians(unit(random));
+        points.push_back({std::asin(unit(random)), offset < 0 ? M_PI + offset : -M_PI + offset});
+    }
+    for (int i = -8; i <= 8; ++i) {
+        points.push_back({radians(i * 10.0), M_PI});
+        points.push_back({radians(i * 10.0), -M_PI});
+    }
+    // A city's worth of tracks a few kilometres apart
+    for (int i = 0; i < 2000; ++i) points.push_back({radians(-37.8 + 0.1 * unit(random)), radians(144.9 + 0.1 * unit(random))});
+    points.push_back({radians(12), radians(34)});
+    return points;
+}
+
+void fill(EntityStore &store, const std::vector<Point> &points)
+{
+    for (std::size_t i = 0; i < points.size(); ++i) {
+        QString UID = QString("UID-%1").arg(i);
+        store.insert(UID, UID, 100, points[i].latitude, points[i].longitude);
+    }
+}
+
+std::vector<EntityStore::Slot> sorted(std::vector<EntityStore::Slot> found)
+{
+    std::sort(found.begin(), found.end());
+    return found;
+}
+
+} // namespace
+
+class TestSpatialIndex : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void queryBoxMatchesScan_data();
+    void queryBoxMatchesScan();
+    void queryRadiusMatchesScan_data();
+    void queryRadiusMatchesScan();
+    void queriesFollowMovesAndRemovals();
+
+private:
+    std::vector<Point> m_points;
+    EntityStore m_fine;
+    EntityStore m_coarse;
+};
+
+void TestSpatialIndex::initTestCase()
+{
+    m_points = scatteredPoints();
+    fill(m_fine, m_points);
+    m_coarse.setSpatialCellSize(kCoarseCellSize);
+    fill(m_coarse, m_points);
+    QCOMPARE(m_fine.size(), m_points.size());
+}
+
+void TestSpatialIndex::queryBoxMatchesScan_data()
+{
+    // Degrees, converted when queried
+    QTest::addColumn<double>("minLatitude");
+    QTest::addColumn<double>("minLongitude");
+    QTest::addColumn<double>("maxLatitude");
+    QTest::addColumn<double>("maxLongitude");
+
+    QTest::newRow("few kilometres") << -37.82 << 144.88 << -37.78 << 144.93;
+    QTest::newRow("across the antimeridian") << -20.0 << 179.5 << -15.0 << -179.5;
+    QTest::newRow("wide across the antimeridian") << -60.0 << 170.0 << 60.0 << -170.0;
+    QTest::newRow("ending on the antimeridian") << -45.0 << 170.0 << 45.0 << 180.0;
+    QTest::newRow("starting on the antimeridian") << -45.0 << -180.0 << 45.0 << -170.0;
+    QTest::newRow("antimeridian only") << -90.0 << 180.0 << 90.0 << -180.0;
+    QTest::newRow("north polar cap") << 88.5 << -180.0 << 90.0 << 180.0;
+    QTest::newRow("south polar wedge") << -90.0 << 10.0 << -88.0 << 60.0;
+    QTest::newRow("whole world") << -90.0 << -180.0 << 90.0 << 180.0;
+    QTest::newRow("a single point") << 12.0 << 34.0 << 12.0 << 34.0;
+    QTest::newRow("latitudes reversed") << 10.0 << 0.0 << 5.0 << 1.0;
+}
+
+void TestSpatialIndex::queryBoxMatchesScan()
+{
+    QFETCH(double, minLatitude);
+    QFETCH(double, minLongitude);
+    QFETCH(double, maxLatitude);
+    QFETCH(double, maxLongitude);
+    double south = radians(minLatitude);
+    double west = radians(minLongitude);
+    double north = radians(maxLatitude);
+    double east = radians(maxLongitude);
+
+    std::vector<EntityStore::Slot> expected;
+    for (EntityStore::Slot slot = 0; slot < m_points.size(); ++slot) {
+        const Point &point = m_points[slot];
+        bool inLongitude = west <= east ? point.longitude >= west && point.longitude <= east
+                                        : point.longitude >= west || point.longitude <= east;
+        if (point.latitude >= south && point.latitude <= north && inLongitude) expected.push_back(slot);
+    }
+
+    QCOMPARE(sorted(m_fine.queryBox(south, west, north, east)), expected);
+    QCOMPARE(sorted(m_coarse.queryBox(south, west, north, east)), expected);
+}
+
+void TestSpatialIndex::queryRadiusMatchesScan_data()
+{
+    QTest::addColumn<double>("latitude");
+    QTest::addColumn<double>("longitude");
+    QTest::addColumn<double>("metres");
+
+    QTest::newRow("few kilometres") << -37.8 << 144.9 << 5000.0;
+    QTest::newRow("reaching the north pole") << 89.5 << 0.0 << 100000.0;
+    QTest::newRow("on the north pole") << 90.0 << 0.0 << 150000.0;
+    QTest::newRow("short of the south pole") << -88.0 << 45.0 << 100000.0;
+    QTest::newRow("over the south pole") << -89.2 << -120.0 << 200000.0;
+    QTest::newRow("across the antimeridian eastwards") << 0.0 << 179.9 << 50000.0;
+    QTest::newRow("across the antimeridian westwards") << 10.0 << -179.95 << 50000.0;
+    QTest::newRow("centred on the antimeridian") << -30.0 << 180.0 << 80000.0;
+    QTest::newRow("a hemisphere") << 0.0 << 0.0 << M_PI_2 * kEarthRadiusMetres;
+    QTest::newRow("beyond the antipode") << 0.0 << 0.0 << 30000000.0;
+    QTest::newRow("zero on an entity") << 12.0 << 34.0 << 0.0;
+    QTest::newRow("negative") << 12.0 << 34.0 << -1.0;
+}
+
+void TestSpatialIndex::queryRadiusMatchesScan()
+{
+    QFETCH(double, latitude);
+    QFETCH(double, longitude);
+    QFETCH(double, metres);
+    double centreLatitude = radians(latitude);
+    double centreLongitude = radians(longitude);
+
+    std::vector<EntityStore::Slot> expected;
+    for (EntityStore::Slot slot = 0; slot < m_points.size(); ++slot) {
+        const Point &point = m_points[slot];
+        if (distanceMetres(centreLatitude, centreLongitude, point.latitude, point.longitude) <= metres) expected.push_back(slot);
+    }
+
+    for (const EntityStore *store : {&m_fine, &m_coarse}) {
+        std::vector<EntityStore::Slot> found = sorted(store->queryRadius(centreLatitude, centreLongitude, metres));
+        std::vector<EntityStore::Slot> disagreements;
+        std::set_symmetric_difference(found.begin(), found.end(), expected.begin(), expected.end(),
+                                      std::back_inserter(disagreements));
+        for (EntityStore::Slot slot : disagreements) {
+            const Point &point = m_points[slot];
+            double distance = distanceMetres(centreLatitude, centreLongitude, point.latitude, point.longitude);
+            QVERIFY2(std::abs(distance - metres) < 1e-3, qPrintable(QString("slot %1 at %2 m").arg(slot).arg(distance)));
+        }
+    }
+    if (metres > 0) QVERIFY(!expected.empty());
+}
+
+void TestSpatialIndex::queriesFollowMovesAndRemovals()
+{
+    EntityStore store;
+    EntityStore::Slot moving = store.insert("A", "UID-A", 100, radians(-37.8), radians(144.9));
+    EntityStore::Slot removed = store.insert("B", "UID-B", 100, radians(-37.8), radians(144.9));
+    double west = radians(144.8);
+    double east = radians(145.0);
+    QCOMPARE(sorted(store.queryBox(radians(-38), west, radians(-37.6), east)), std::vector<EntityStore::Slot>({moving, removed}));
+
+    // Across the antimeridian and to the pole, each move leaving its old cell behind
+    store.setPosition(moving, radians(-20), radians(179.99));
+    store.remove(removed);
+    QVERIFY(store.queryBox(radians(-38), west, radians(-37.6), east).empty());
+    QCOMPARE(store.queryBox(radians(-21), radians(179), radians(-19), radians(-179)), std::vector<EntityStore::Slot>({moving}));
+    QCOMPARE(store.queryRadius(radians(-20), radians(-179.99), 5000), std::vector<EntityStore::Slot>({moving}));
+    store.setLatitudeRadians(moving, M_PI_2);
+    QVERIFY(store.queryBox(radians(-21), radians(179), radians(-19), radians(-179)).empty());
+    QCOMPARE(store.queryRadius(radians(89.99), radians(-90), 2000), std::vector<EntityStore::Slot>({moving}));
+
+    // Just south west of the origin, the cell whose key used to be the index's unindexed marker
+    EntityStore::Slot origin = store.insert("D", "UID-D", 100, -0.0005, -0.0005);
+    QCOMPARE(store.queryBox(-0.001, -0.001, 0.0, 0.0), std::vector<EntityStore::Slot>({origin}));
+    QCOMPARE(store.queryRadius(0.0, 0.0, 10000), std::vector<EntityStore::Slot>({origin}));
+    store.setPosition(origin, 0.5, 0.5);
+    QVERIFY(store.queryBox(-0.001, -0.001, 0.0, 0.0).empty());
+    QCOMPARE(store.queryRadius(0.5, 0.5, 1), std::vector<EntityStore::Slot>({origin}));
+    store.remove(origin);
+
+    // A reused slot is found where its new entity is, not where the old one was
+    EntityStore::Slot reused = store.insert("C", "UID-C", 100, radians(-89.5), radians(10));
+    QCOMPARE(reused, removed);
+    QCOMPARE(store.queryRadius(radians(-90), 0.0, 60000), std::vector<EntityStore::Slot>({reused}));
+    QVERIFY(store.queryBox(radians(-38), west, radians(-37.6), east).empty());
+}
+
+QTEST_GUILESS_MAIN(TestSpatialIndex)
+
+#include "tst_spatialindex.moc"
@@ -0,0 +1,9 @@
+TEMPLATE = app
+CONFIG += testcase console c++17
+CONFIG -= app_bundle
+
+QT += core testlib
+QT -= gui
+
+ROOT = $$PWD/..
+INCLUDEPATH += $$ROOT
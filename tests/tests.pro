@@ -0,0 +1,11 @@
+# Unit and stress tests, one QtTest program per subdirectory. Build and run with
+#   qmake tests/tests.pro && make && make check
+TEMPLATE = subdirs
+
+SUBDIRS += \
+        entitymanager \
+        jsonrecords \
+        kinematics \
+        multicast \
+        sendpath \
+        spatialindex